@@ -1,11 +1,15 @@
-//! Computer interaction via X11 tools (xdotool, ImageMagick import / xwd fallback).
+//! Computer interaction via X11 tools (xdotool) and in-process capture, with
+//! ImageMagick import / xwd as the screenshot fallback.
 //! Adapted from the main omar crate's computer module for standalone use.
 
 use anyhow::{Context, Result};
 use std::process::{Command, Output, Stdio};
+use std::sync::OnceLock;
 use std::thread;
 use std::time::{Duration, Instant};
 
+use crate::screen_capture::{self, CaptureOptions, Encoding, Screenshot};
+
 // ── X11 environment detection ─────────────────────────────────────────────────
 
 const PROBE_TIMEOUT: Duration = Duration::from_millis(250);
@@ -267,15 +271,62 @@ pub fn get_screen_size() -> Result<ScreenSize> {
 
 // ── Screenshot ────────────────────────────────────────────────────────────────
 
-/// Take a screenshot using ImageMagick `import` (preferred) or `xwd` + Python
-/// PIL (fallback). Returns a base64-encoded PNG.
-pub fn take_screenshot(max_width: Option<u32>, max_height: Option<u32>) -> Result<String> {
-    // Try ImageMagick import first
-    if let Ok(result) = screenshot_via_import(max_width, max_height) {
-        return Ok(result);
+/// Display for in-process capture: `$DISPLAY`, else the probed one. The
+/// probe forks, so its answer is kept for the life of the bridge.
+fn capture_display() -> Option<String> {
+    static DETECTED: OnceLock<Option<String>> = OnceLock::new();
+    std::env::var("DISPLAY")
+        .ok()
+        .filter(|d| !d.is_empty())
+        .or_else(|| {
+            DETECTED
+                .get_or_init(|| detect_x11_env().map(|(display, _)| display))
+                .clone()
+        })
+}
+
+/// Take a screenshot in-process (see `screen_capture`), falling back to
+/// ImageMagick `import` and then `xwd` + Python PIL. The fallbacks return
+/// a full-screen PNG scaled to the size limits: no region, other format
+/// or delta.
+pub fn take_screenshot(opts: &CaptureOptions) -> Result<Screenshot> {
+    if let Ok(shot) = screen_capture::capture(capture_display().as_deref(), opts) {
+        return Ok(shot);
     }
-    // Fall back to xwd + Python PIL
-    screenshot_via_xwd(max_width, max_height)
+
+    let (max_width, max_height) = match (opts.max_width, opts.max_height) {
+        (Some(w), Some(h)) => (Some(w), Some(h)),
+        _ => (None, None),
+    };
+    let image = match screenshot_via_import(max_width, max_height) {
+        Ok(image) => image,
+        Err(_) => screenshot_via_xwd(max_width, max_height)?,
+    };
+    let size = get_screen_size()?;
+    let (area, image_width, image_height, scale) = screen_capture::plan(
+        size.width,
+        size.height,
+        &CaptureOptions {
+            max_width,
+            max_height,
+            ..CaptureOptions::default()
+        },
+    )?;
+    Ok(Screenshot {
+        image_base64: Some(image),
+        format: Encoding::Png,
+        screen_width: size.width,
+        screen_height: size.height,
+        x: area.x,
+        y: area.y,
+        width: area.width,
+        height: area.height,
+        image_width,
+        image_height,
+        scale,
+        delta: false,
+        unchanged: false,
+    })
 }
 
 fn screenshot_via_import(max_width: Option<u32>, max_height: Option<u32>) -> Result<String> {
@@ -508,9 +559,12 @@ pub fn is_xdotool_available() -> bool {
     }
 }
 
-/// Check if screenshot capability is available (ImageMagick `import` or
-/// `xwd` + Python PIL).
+/// Check if screenshot capability is available (in-process capture,
+/// ImageMagick `import`, or `xwd` + Python PIL).
 pub fn is_screenshot_available() -> bool {
+    if screen_capture::available(capture_display().as_deref()) {
+        return true;
+    }
     // ImageMagick import
     let mut import_cmd = x11_command("import");
     import_cmd.arg("-version");
@@ -1,4 +1,5 @@
 mod computer;
+mod screen_capture;
 mod server;
 
 use std::net::SocketAddr;
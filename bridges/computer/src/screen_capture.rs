@@ -0,0 +1,591 @@
+//! In-process screen capture for computer use.
+//! Copied from the main omar crate's screen_capture module for standalone use.
+//!
+//! Forking ImageMagick `import` per screenshot costs hundreds of ms and a
+//! full-size PNG per frame, which dominates observe/act loops that look at
+//! the screen after every action. This module reads the root window over a
+//! cached X11 connection (`GetImage`, so it works on Xorg and Xwayland
+//! alike), downscales with an area-average filter, and encodes as PNG,
+//! JPEG (with a quality knob) or lossless WebP — all without a fork.
+//!
+//! With a delta key, each capture is compared tile by tile against the
+//! previous frame taken under the same key, and only the bounding box of
+//! the changed tiles is encoded; an unchanged screen yields no image at
+//! all. The reported `x`/`y`/`scale` say where the patch belongs.
+//!
+//! Callers fall back to their `import` path whenever [`capture`] fails
+//! (no X server reachable, or an unusual pixel format).
+
+use anyhow::{bail, Context, Result};
+use serde::{Deserialize, Serialize};
+use std::sync::{Mutex, OnceLock};
+use x11rb::connection::Connection;
+use x11rb::protocol::xproto::{ConnectionExt, ImageFormat, ImageOrder};
+use x11rb::rust_connection::RustConnection;
+
+/// Side of the square tiles compared in delta mode.
+const TILE: usize = 32;
+
+/// JPEG quality used when the caller does not pick one.
+pub const DEFAULT_QUALITY: u8 = 80;
+
+/// Output encoding.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum Encoding {
+    #[default]
+    Png,
+    Jpeg,
+    /// Lossless WebP: smaller than PNG for typical desktops.
+    Webp,
+}
+
+/// A rectangle in screen pixels.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub struct Rect {
+    pub x: u32,
+    pub y: u32,
+    pub width: u32,
+    pub height: u32,
+}
+
+#[derive(Debug, Clone, Default)]
+pub struct CaptureOptions {
+    /// Shrink (never enlarge) to fit within these bounds.
+    pub max_width: Option<u32>,
+    pub max_height: Option<u32>,
+    /// Capture only this part of the screen. Clamped to the screen.
+    pub region: Option<Rect>,
+    pub encoding: Encoding,
+    /// JPEG quality, 1–100. Ignored by the lossless encodings.
+    pub quality: Option<u8>,
+    /// Encode only what changed since the last capture with this key.
+    pub delta_key: Option<String>,
+}
+
+/// One encoded capture.
+#[derive(Debug, Clone, Serialize)]
+pub struct Screenshot {
+    /// Base64 image; `None` when delta mode found nothing changed.
+    pub image_base64: Option<String>,
+    pub format: Encoding,
+    pub screen_width: u32,
+    pub screen_height: u32,
+    /// Screen area the image covers.
+    pub x: u32,
+    pub y: u32,
+    pub width: u32,
+    pub height: u32,
+    /// Encoded size in pixels; the area was scaled by `scale` to get it.
+    pub image_width: u32,
+    pub image_height: u32,
+    pub scale: f64,
+    /// True when the image is a changed-area patch over the previous frame.
+    pub delta: bool,
+    pub unchanged: bool,
+}
+
+/// A raw frame: 32-bit little-endian pixels (B, G, R, pad).
+struct Frame {
+    area: Rect,
+    bgrx: Vec<u8>,
+}
+
+struct Display {
+    name: Option<String>,
+    conn: RustConnection,
+    root: u32,
+    width: u16,
+    height: u16,
+}
+
+fn display_slot() -> &'static Mutex<Option<Display>> {
+    static DISPLAY: OnceLock<Mutex<Option<Display>>> = OnceLock::new();
+    DISPLAY.get_or_init(|| Mutex::new(None))
+}
+
+/// Previous frame for delta mode, with the key it was taken under. One
+/// slot: the computer lock lets a single agent drive the screen at a time.
+fn previous_slot() -> &'static Mutex<Option<(String, Frame)>> {
+    static PREVIOUS: OnceLock<Mutex<Option<(String, Frame)>>> = OnceLock::new();
+    PREVIOUS.get_or_init(|| Mutex::new(None))
+}
+
+fn connect(name: Option<&str>) -> Result<Display> {
+    let (conn, screen_num) =
+        RustConnection::connect(name).context("Failed to connect to X display")?;
+    let setup = conn.setup();
+    let screen = &setup.roots[screen_num];
+    let bits_per_pixel = setup
+        .pixmap_formats
+        .iter()
+        .find(|format| format.depth == screen.root_depth)
+        .map(|format| format.bits_per_pixel);
+    if bits_per_pixel != Some(32) || setup.image_byte_order != ImageOrder::LSB_FIRST {
+        bail!(
+            "Unsupported X pixel format (depth {}, {:?} bpp)",
+            screen.root_depth,
+            bits_per_pixel
+        );
+    }
+    let (root, width, height) = (screen.root, screen.width_in_pixels, screen.height_in_pixels);
+    Ok(Display {
+        name: name.map(str::to_string),
+        conn,
+        root,
+        width,
+        height,
+    })
+}
+
+/// Read `region` (default: the whole root window) over the cached
+/// connection, reconnecting once if it went stale.
+fn grab(display: Option<&str>, region: Option<Rect>) -> Result<(Frame, u32, u32)> {
+    let mut slot = display_slot().lock().unwrap_or_else(|e| e.into_inner());
+    if slot.as_ref().is_some_and(|d| d.name.as_deref() != display) {
+        *slot = None;
+    }
+    for attempt in 0..2 {
+        if slot.is_none() {
+            *slot = Some(connect(display)?);
+        }
+        let Some(d) = slot.as_ref() else {
+            continue;
+        };
+        let (screen_w, screen_h) = (u32::from(d.width), u32::from(d.height));
+        let area = clamp(region, screen_w, screen_h)?;
+        let reply = d
+            .conn
+            .get_image(
+                ImageFormat::Z_PIXMAP,
+                d.root,
+                area.x as i16,
+                area.y as i16,
+                area.width as u16,
+                area.height as u16,
+                !0,
+            )
+            .map_err(anyhow::Error::from)
+            .and_then(|cookie| cookie.reply().map_err(anyhow::Error::from));
+        match reply {
+            Ok(reply) if reply.data.len() >= area.width as usize * area.height as usize * 4 => {
+                return Ok((
+                    Frame {
+                        area,
+                        bgrx: reply.data,
+                    },
+                    screen_w,
+                    screen_h,
+                ));
+            }
+            Ok(_) => bail!("X server returned a short image"),
+            // The server went away or the screen was resized under us.
+            Err(_) if attempt == 0 => *slot = None,
+            Err(e) => return Err(e.context("X GetImage failed")),
+        }
+    }
+    bail!("X GetImage failed")
+}
+
+fn clamp(region: Option<Rect>, screen_w: u32, screen_h: u32) -> Result<Rect> {
+    let Some(region) = region else {
+        return Ok(Rect {
+            x: 0,
+            y: 0,
+            width: screen_w,
+            height: screen_h,
+        });
+    };
+    let x = region.x.min(screen_w);
+    let y = region.y.min(screen_h);
+    let width = region.width.min(screen_w - x);
+    let height = region.height.min(screen_h - y);
+    if width == 0 || height == 0 {
+        bail!(
+            "Region {:?} is outside the {}x{} screen",
+            region,
+            screen_w,
+            screen_h
+        );
+    }
+    Ok(Rect {
+        x,
+        y,
+        width,
+        height,
+    })
+}
+
+/// True when [`capture`] can reach `display`.
+pub fn available(display: Option<&str>) -> bool {
+    let mut slot = display_slot().lock().unwrap_or_else(|e| e.into_inner());
+    if slot.as_ref().is_some_and(|d| d.name.as_deref() == display) {
+        return true;
+    }
+    match connect(display) {
+        Ok(d) => {
+            *slot = Some(d);
+            true
+        }
+        Err(_) => false,
+    }
+}
+
+/// Screen area, encoded width and height, and scale for capturing a
+/// `screen_width`x`screen_height` screen under `opts`. Fallback encoders
+/// use it so both paths report the same geometry.
+pub fn plan(
+    screen_width: u32,
+    screen_height: u32,
+    opts: &CaptureOptions,
+) -> Result<(Rect, u32, u32, f64)> {
+    let area = clamp(opts.region, screen_width, screen_height)?;
+    let scale = fit_scale(area.width, area.height, opts.max_width, opts.max_height);
+    Ok((
+        area,
+        scaled(area.width, scale),
+        scaled(area.height, scale),
+        scale,
+    ))
+}
+
+/// Capture, scale and encode the screen of `display` (`None` = `$DISPLAY`).
+pub fn capture(display: Option<&str>, opts: &CaptureOptions) -> Result<Screenshot> {
+    let (frame, screen_width, screen_height) = grab(display, opts.region)?;
+    let area = frame.area;
+    let scale = fit_scale(area.width, area.height, opts.max_width, opts.max_height);
+
+    // Delta mode: find what changed since the key's previous frame.
+    let mut patch = None;
+    let mut delta = false;
+    if let Some(key) = &opts.delta_key {
+        let previous = previous_slot().lock().unwrap_or_else(|e| e.into_inner());
+        if let Some((prev_key, prev)) = previous.as_ref() {
+            if prev_key == key && prev.area == area {
+                delta = true;
+                patch = changed_rect(
+                    &prev.bgrx,
+                    &frame.bgrx,
+                    area.width as usize,
+                    area.height as usize,
+                );
+            }
+        }
+        if delta && patch.is_none() {
+            return Ok(Screenshot {
+                image_base64: None,
+                format: opts.encoding,
+                screen_width,
+                screen_height,
+                x: area.x,
+                y: area.y,
+                width: 0,
+                height: 0,
+                image_width: 0,
+                image_height: 0,
+                scale,
+                delta,
+                unchanged: true,
+            });
+        }
+    }
+    let local = patch.unwrap_or(Rect {
+        x: 0,
+        y: 0,
+        width: area.width,
+        height: area.height,
+    });
+
+    let rgb = bgrx_to_rgb(&frame.bgrx, area.width as usize, local);
+    if let Some(key) = &opts.delta_key {
+        *previous_slot().lock().unwrap_or_else(|e| e.into_inner()) = Some((key.clone(), frame));
+    }
+    let image_width = scaled(local.width, scale);
+    let image_height = scaled(local.height, scale);
+    let rgb = if (image_width, image_height) == (local.width, local.height) {
+        rgb
+    } else {
+        downscale_rgb(
+            &rgb,
+            local.width as usize,
+            local.height as usize,
+            image_width as usize,
+            image_height as usize,
+        )
+    };
+    let encoded = encode(&rgb, image_width, image_height, opts.encoding, opts.quality)?;
+
+    use base64::Engine;
+    Ok(Screenshot {
+        image_base64: Some(base64::engine::general_purpose::STANDARD.encode(encoded)),
+        format: opts.encoding,
+        screen_width,
+        screen_height,
+        x: area.x + local.x,
+        y: area.y + local.y,
+        width: local.width,
+        height: local.height,
+        image_width,
+        image_height,
+        scale,
+        delta,
+        unchanged: false,
+    })
+}
+
+fn encode(
+    rgb: &[u8],
+    width: u32,
+    height: u32,
+    encoding: Encoding,
+    quality: Option<u8>,
+) -> Result<Vec<u8>> {
+    use image::codecs::jpeg::JpegEncoder;
+    use image::codecs::png::{CompressionType, FilterType, PngEncoder};
+    use image::codecs::webp::WebPEncoder;
+    use image::{ExtendedColorType, ImageEncoder};
+
+    let mut out = Vec::new();
+    let written = match encoding {
+        Encoding::Png => {
+            PngEncoder::new_with_quality(&mut out, CompressionType::Fast, FilterType::Sub)
+                .write_image(rgb, width, height, ExtendedColorType::Rgb8)
+        }
+        Encoding::Jpeg => {
+            let quality = quality.unwrap_or(DEFAULT_QUALITY).clamp(1, 100);
+            JpegEncoder::new_with_quality(&mut out, quality).write_image(
+                rgb,
+                width,
+                height,
+                ExtendedColorType::Rgb8,
+            )
+        }
+        Encoding::Webp => WebPEncoder::new_lossless(&mut out).write_image(
+            rgb,
+            width,
+            height,
+            ExtendedColorType::Rgb8,
+        ),
+    };
+    written.context("Failed to encode screenshot")?;
+    Ok(out)
+}
+
+/// Factor that shrinks `width`x`height` to fit the bounds, like
+/// ImageMagick's `WxH>`: aspect kept, never above 1.
+fn fit_scale(width: u32, height: u32, max_width: Option<u32>, max_height: Option<u32>) -> f64 {
+    let by_width = max_width.map_or(1.0, |max| f64::from(max.max(1)) / f64::from(width));
+    let by_height = max_height.map_or(1.0, |max| f64::from(max.max(1)) / f64::from(height));
+    by_width.min(by_height).min(1.0)
+}
+
+fn scaled(length: u32, scale: f64) -> u32 {
+    ((f64::from(length) * scale).round() as u32).clamp(1, length)
+}
+
+/// Bounding box, snapped to [`TILE`]-pixel tiles, of everything that
+/// differs between two frames of `width`x`height` BGRX pixels. Rows are
+/// compared whole first, so an unchanged row costs one `memcmp`.
+fn changed_rect(prev: &[u8], next: &[u8], width: usize, height: usize) -> Option<Rect> {
+    let stride = width * 4;
+    let (mut x0, mut y0, mut x1, mut y1) = (usize::MAX, usize::MAX, 0, 0);
+    for y in 0..height {
+        let (a, b) = (
+            &prev[y * stride..(y + 1) * stride],
+            &next[y * stride..(y + 1) * stride],
+        );
+        if a == b {
+            continue;
+        }
+        for (tile, (ta, tb)) in a.chunks(TILE * 4).zip(b.chunks(TILE * 4)).enumerate() {
+            if ta != tb {
+                x0 = x0.min(tile * TILE);
+                x1 = x1.max(((tile + 1) * TILE).min(width));
+            }
+        }
+        y0 = y0.min(y / TILE * TILE);
+        y1 = y1.max(((y / TILE + 1) * TILE).min(height));
+    }
+    (x1 > 0).then(|| Rect {
+        x: x0 as u32,
+        y: y0 as u32,
+        width: (x1 - x0) as u32,
+        height: (y1 - y0) as u32,
+    })
+}
+
+/// Packed RGB of `rect` within a BGRX frame `width` pixels wide.
+fn bgrx_to_rgb(bgrx: &[u8], width: usize, rect: Rect) -> Vec<u8> {
+    let (x, w) = (rect.x as usize, rect.width as usize);
+    let mut rgb = Vec::with_capacity(w * rect.height as usize * 3);
+    for y in rect.y as usize..(rect.y + rect.height) as usize {
+        let row = &bgrx[(y * width + x) * 4..(y * width + x + w) * 4];
+        for px in row.chunks_exact(4) {
+            rgb.extend_from_slice(&[px[2], px[1], px[0]]);
+        }
+    }
+    rgb
+}
+
+/// Source index range each destination pixel averages over.
+fn spans(src: usize, dst: usize) -> Vec<(usize, usize)> {
+    (0..dst)
+        .map(|i| {
+            let start = i * src / dst;
+            (start, ((i + 1) * src / dst).max(start + 1))
+        })
+        .collect()
+}
+
+/// Area-average downscale of packed RGB in two separable passes. Both
+/// inner loops are integer adds over contiguous rows, which the compiler
+/// vectorises; the vertical pass accumulates whole rows at a time.
+fn downscale_rgb(src: &[u8], sw: usize, sh: usize, dw: usize, dh: usize) -> Vec<u8> {
+    let xs = spans(sw, dw);
+    let ys = spans(sh, dh);
+
+    let mut horizontal = vec![0u32; dw * 3 * sh];
+    for (row, out) in src
+        .chunks_exact(sw * 3)
+        .zip(horizontal.chunks_exact_mut(dw * 3))
+    {
+        for (&(start, end), acc) in xs.iter().zip(out.chunks_exact_mut(3)) {
+            for px in row[start * 3..end * 3].chunks_exact(3) {
+                acc[0] += u32::from(px[0]);
+                acc[1] += u32::from(px[1]);
+                acc[2] += u32::from(px[2]);
+            }
+        }
+    }
+
+    let mut dst = vec![0u8; dw * dh * 3];
+    let mut acc = vec![0u32; dw * 3];
+    for (&(start, end), out) in ys.iter().zip(dst.chunks_exact_mut(dw * 3)) {
+        acc.fill(0);
+        for row in horizontal[start * dw * 3..end * dw * 3].chunks_exact(dw * 3) {
+            for (a, &v) in acc.iter_mut().zip(row) {
+                *a += v;
+            }
+        }
+        let rows = (end - start) as u32;
+        for ((&(x0, x1), sums), px) in xs
+            .iter()
+            .zip(acc.chunks_exact(3))
+            .zip(out.chunks_exact_mut(3))
+        {
+            let n = rows * (x1 - x0) as u32;
+            for (channel, &sum) in px.iter_mut().zip(sums) {
+                *channel = ((sum + n / 2) / n) as u8;
+            }
+        }
+    }
+    dst
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn frame(width: usize, height: usize, fill: u8) -> Vec<u8> {
+        vec![fill; width * height * 4]
+    }
+
+    #[test]
+    fn fit_scale_only_shrinks_and_keeps_aspect() {
+        assert_eq!(fit_scale(1920, 1080, None, None), 1.0);
+        assert_eq!(fit_scale(1920, 1080, Some(3840), Some(2160)), 1.0);
+        assert_eq!(fit_scale(1920, 1080, Some(960), Some(1080)), 0.5);
+        assert_eq!(fit_scale(1920, 1080, None, Some(540)), 0.5);
+        assert_eq!(scaled(1080, 0.5), 540);
+        assert_eq!(scaled(1, 0.01), 1);
+    }
+
+    #[test]
+    fn changed_rect_snaps_to_tiles_and_ignores_identical_frames() {
+        let (w, h) = (100, 70);
+        let prev = frame(w, h, 0);
+        assert_eq!(changed_rect(&prev, &prev, w, h), None);
+
+        let mut next = prev.clone();
+        next[(40 * w + 70) * 4] = 255;
+        assert_eq!(
+            changed_rect(&prev, &next, w, h),
+            Some(Rect {
+                x: 64,
+                y: 32,
+                width: 32,
+                height: 32
+            })
+        );
+
+        // Edge tiles are clipped to the frame.
+        next[(69 * w + 99) * 4] = 255;
+        assert_eq!(
+            changed_rect(&prev, &next, w, h),
+            Some(Rect {
+                x: 64,
+                y: 32,
+                width: 36,
+                height: 38
+            })
+        );
+    }
+
+    #[test]
+    fn bgrx_to_rgb_swaps_channels_inside_the_rect() {
+        let mut bgrx = frame(3, 2, 0);
+        bgrx[(3 + 1) * 4..(3 + 1) * 4 + 4].copy_from_slice(&[1, 2, 3, 0]);
+        let rect = Rect {
+            x: 1,
+            y: 1,
+            width: 2,
+            height: 1,
+        };
+        assert_eq!(bgrx_to_rgb(&bgrx, 3, rect), vec![3, 2, 1, 0, 0, 0]);
+    }
+
+    #[test]
+    fn downscale_averages_source_areas() {
+        // 4x2 → 2x1: each output pixel averages a 2x2 block.
+        let src: Vec<u8> = [
+            [0, 0, 0],
+            [100, 100, 100],
+            [10, 20, 30],
+            [10, 20, 30],
+            [100, 100, 100],
+            [200, 200, 200],
+            [30, 40, 50],
+            [30, 40, 50],
+        ]
+        .concat();
+        assert_eq!(
+            downscale_rgb(&src, 4, 2, 2, 1),
+            vec![100, 100, 100, 20, 30, 40]
+        );
+
+        // Non-integer ratios still cover every output pixel.
+        let src = vec![7u8; 5 * 3 * 3];
+        assert_eq!(downscale_rgb(&src, 5, 3, 3, 2), vec![7u8; 3 * 2 * 3]);
+    }
+
+    #[test]
+    fn clamp_keeps_regions_on_screen() {
+        let region = Rect {
+            x: 1800,
+            y: 1000,
+            width: 400,
+            height: 400,
+        };
+        assert_eq!(
+            clamp(Some(region), 1920, 1080).unwrap(),
+            Rect {
+                x: 1800,
+                y: 1000,
+                width: 120,
+                height: 80
+            }
+        );
+        let off_screen = Rect { x: 5000, ..region };
+        assert!(clamp(Some(off_screen), 1920, 1080).is_err());
+    }
+}
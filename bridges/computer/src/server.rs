@@ -9,6 +9,7 @@ use serde::Deserialize;
 use tracing::{error, info};
 
 use crate::computer;
+use crate::screen_capture::{CaptureOptions, Encoding, Rect};
 
 /// Shared server state.
 #[derive(Clone)]
@@ -38,6 +39,13 @@ pub fn build_router(state: ServerState) -> Router {
 pub struct ScreenshotRequest {
     pub max_width: Option<u32>,
     pub max_height: Option<u32>,
+    #[serde(default)]
+    pub format: Encoding,
+    pub quality: Option<u8>,
+    pub region: Option<Rect>,
+    /// Return only what changed since the previous `changed_only` call.
+    #[serde(default)]
+    pub changed_only: bool,
 }
 
 #[derive(Debug, Deserialize)]
@@ -93,43 +101,60 @@ fn default_scroll_amount() -> u32 {
 
 // ── Handlers ──
 
-/// POST /screenshot — capture screen, return base64 PNG.
+/// POST /screenshot — capture screen, return a base64 image.
 async fn handle_screenshot(
     State(state): State<ServerState>,
     body: Option<Json<ScreenshotRequest>>,
 ) -> impl IntoResponse {
-    let (max_w, max_h) = match body {
-        Some(Json(req)) => (req.max_width, req.max_height),
-        None => {
-            let w = if state.max_screenshot_width > 0 {
-                Some(state.max_screenshot_width)
-            } else {
-                None
-            };
-            let h = if state.max_screenshot_height > 0 {
-                Some(state.max_screenshot_height)
-            } else {
-                None
-            };
-            (w, h)
-        }
+    let default_limit = |max: u32| (max > 0).then_some(max);
+    let opts = match body {
+        Some(Json(req)) => CaptureOptions {
+            max_width: req.max_width,
+            max_height: req.max_height,
+            region: req.region,
+            encoding: req.format,
+            quality: req.quality,
+            delta_key: req.changed_only.then(|| "http".to_string()),
+        },
+        None => CaptureOptions {
+            max_width: default_limit(state.max_screenshot_width),
+            max_height: default_limit(state.max_screenshot_height),
+            ..CaptureOptions::default()
+        },
     };
 
     info!(
-        "screenshot max={}x{}",
-        max_w.unwrap_or(0),
-        max_h.unwrap_or(0)
+        "screenshot max={}x{} format={:?} delta={}",
+        opts.max_width.unwrap_or(0),
+        opts.max_height.unwrap_or(0),
+        opts.encoding,
+        opts.delta_key.is_some()
     );
 
     // Run blocking I/O on a dedicated thread
-    let result = tokio::task::spawn_blocking(move || computer::take_screenshot(max_w, max_h))
+    let result = tokio::task::spawn_blocking(move || computer::take_screenshot(&opts))
         .await
         .unwrap_or_else(|e| Err(anyhow::anyhow!("task join error: {}", e)));
 
     match result {
-        Ok(b64) => (
+        Ok(shot) => (
             StatusCode::OK,
-            Json(serde_json::json!({"ok": true, "image": b64})),
+            Json(serde_json::json!({
+                "ok": true,
+                "image": shot.image_base64,
+                "format": shot.format,
+                "region": {
+                    "x": shot.x,
+                    "y": shot.y,
+                    "width": shot.width,
+                    "height": shot.height,
+                },
+                "image_width": shot.image_width,
+                "image_height": shot.image_height,
+                "scale": shot.scale,
+                "delta": shot.delta,
+                "unchanged": shot.unchanged,
+            })),
         ),
         Err(e) => {
             error!("screenshot failed: {}", e);
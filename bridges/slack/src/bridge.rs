@@ -1,41 +1,29 @@
-use std::path::{Path, PathBuf};
 use std::sync::Arc;
-use std::time::Duration;
 
 use anyhow::{Context, Result};
-use serde::Deserialize;
-use tokio::sync::Mutex;
-use tracing::{debug, error, info, warn};
+use tracing::{error, info, warn};
 
 use crate::config::Config;
+use crate::lanes::{LaneRx, Lanes};
 use crate::omar::OmarMcp;
+use crate::outbox;
 use crate::settings;
 use crate::slack::{SlackClient, SlackMessage};
 
-/// A Slack reply the EA queued via the `slack_reply` MCP tool. Fields
-/// match the JSON written by `mcp::OmarMcpServer::slack_reply` — adding
-/// fields server-side should be backwards-compatible because unknown
-/// fields are ignored by serde's default behaviour.
-#[derive(Debug, Deserialize)]
-struct OutboxReply {
-    channel: String,
-    #[serde(default)]
-    thread_ts: Option<String>,
-    text: String,
-}
-
+/// Cheap to clone: inbound lanes each hold a handle.
+#[derive(Clone)]
 pub struct Bridge {
-    config: Config,
-    slack: Arc<Mutex<SlackClient>>,
-    omar: Arc<Mutex<OmarMcp>>,
+    config: Arc<Config>,
+    slack: Arc<SlackClient>,
+    omar: Arc<OmarMcp>,
 }
 
 impl Bridge {
     pub fn new(config: Config, slack: SlackClient, omar: OmarMcp) -> Self {
         Self {
-            config,
-            slack: Arc::new(Mutex::new(slack)),
-            omar: Arc::new(Mutex::new(omar)),
+            config: Arc::new(config),
+            slack: Arc::new(slack),
+            omar: Arc::new(omar),
         }
     }
 
@@ -43,15 +31,12 @@ impl Bridge {
     /// and drain the outbound slack_outbox directory in a background task.
     pub async fn run(&self) -> Result<()> {
         // 1. Authenticate with Slack.
-        let bot_user_id = {
-            let mut slack = self.slack.lock().await;
-            slack.auth_test().await?
-        };
+        let bot_user_id = self.slack.auth_test().await?;
         info!("Bot user ID: {}", bot_user_id);
 
         // 2. Probe the MCP server so we fail fast on a misconfigured
         //    OMAR_BINARY / missing active EA.
-        match self.omar.lock().await.health_check().await {
+        match self.omar.health_check().await {
             Ok(()) => info!(
                 "MCP server reachable via {}",
                 self.config.omar_binary.display()
@@ -73,7 +58,7 @@ impl Bridge {
             );
         }
 
-        // 3. Spawn the outbound outbox watcher.
+        // 3. Spawn the outbound outbox delivery engine.
         let outbox_dir = self.config.omar_dir.join("slack_outbox");
         if let Err(e) = std::fs::create_dir_all(&outbox_dir) {
             warn!(
@@ -81,31 +66,40 @@ impl Bridge {
                 outbox_dir, e
             );
         }
-        let slack_for_outbox = self.slack.clone();
-        let max_len = self.config.max_message_length;
-        tokio::spawn(async move {
-            run_outbox_watcher(outbox_dir, slack_for_outbox, max_len).await;
-        });
+        tokio::spawn(outbox::run_delivery(
+            outbox_dir,
+            self.slack.clone(),
+            self.config.max_message_length,
+        ));
 
         // 4. Connect Socket Mode and get message stream.
-        let mut message_rx = {
-            let slack = self.slack.lock().await;
-            slack.connect_socket_mode(bot_user_id.clone()).await?
-        };
+        let mut message_rx = self.slack.connect_socket_mode(bot_user_id.clone()).await?;
         info!("Socket Mode connected, listening for messages...");
 
         // 5. Process inbound messages — each becomes an EA-scoped event
-        //    via the `schedule_omar_event` MCP tool.
+        //    via the `schedule_omar_event` MCP tool. Messages in one thread
+        //    are handed over in order; different threads run concurrently,
+        //    up to the MCP pool's size.
+        let mut threads = Lanes::new();
         while let Some(msg) = message_rx.recv().await {
-            if let Err(e) = self.handle_message(msg).await {
-                error!("Error handling message: {}", e);
-            }
+            let key = format!("{}/{}", msg.channel, msg.thread_key());
+            let bridge = self.clone();
+            threads.push(&key, msg, move |lane| bridge.handle_thread(lane));
         }
 
         warn!("Message stream ended");
         Ok(())
     }
 
+    async fn handle_thread(self, mut lane: LaneRx<SlackMessage>) {
+        while let Some(msg) = lane.recv().await {
+            if let Err(e) = self.handle_message(msg).await {
+                error!("Error handling message: {}", e);
+            }
+            lane.done(1);
+        }
+    }
+
     /// Translate one Slack message into an EA event payload and hand it to
     /// OMAR via MCP. Re-checks the persisted `[slack_bridge].active_ea`
     /// before posting so dashboard-side edits land without a restart.
@@ -114,10 +108,7 @@ impl Bridge {
             warn!("Failed to refresh target EA before message: {}", e);
         }
 
-        let user_name = {
-            let mut slack = self.slack.lock().await;
-            slack.resolve_user_name(&msg.user).await
-        };
+        let user_name = self.slack.resolve_user_name(&msg.user).await;
         let thread_ts = msg.thread_ts.as_deref().unwrap_or(&msg.ts);
 
         let payload = format!(
@@ -139,8 +130,8 @@ impl Bridge {
             &msg.text[..80.min(msg.text.len())]
         );
 
-        let mut omar = self.omar.lock().await;
-        omar.post_slack_event(&payload)
+        self.omar
+            .post_slack_event(&payload)
             .await
             .context("Failed to post Slack event via MCP")?;
         Ok(())
@@ -152,7 +143,7 @@ impl Bridge {
     /// or unresolvable; never writes back, so the toml file remains the
     /// single source of truth (edited manually or via the dashboard).
     async fn resolve_target_ea(&self) -> Result<()> {
-        let mut omar = self.omar.lock().await;
+        let omar = &self.omar;
         let (_, eas) = omar.list_eas().await.context("list_eas failed")?;
         if eas.is_empty() {
             return Err(anyhow::anyhow!("dashboard reports zero registered EAs"));
@@ -192,10 +183,7 @@ impl Bridge {
     /// happens lazily inside `resolve_target_ea` on a real change.
     async fn refresh_target_if_changed(&self) -> Result<()> {
         let desired = settings::load_active_ea(&self.config.omar_dir);
-        let last = {
-            let omar = self.omar.lock().await;
-            omar.last_desired_name().map(|s| s.to_string())
-        };
+        let last = self.omar.last_desired_name();
         if desired.as_deref() == last.as_deref() {
             return Ok(());
         }
@@ -207,85 +195,3 @@ impl Bridge {
         self.resolve_target_ea().await
     }
 }
-
-/// Poll `outbox_dir` for `slack_reply` MCP tool results and forward them
-/// to Slack. Files are deleted on successful delivery; failures leave the
-/// file in place so the next poll retries. Survives bridge restarts —
-/// anything queued while the bridge was down is drained on the next run.
-async fn run_outbox_watcher(outbox_dir: PathBuf, slack: Arc<Mutex<SlackClient>>, max_len: usize) {
-    const MIN_POLL_INTERVAL: Duration = Duration::from_millis(500);
-    const MAX_IDLE_INTERVAL: Duration = Duration::from_secs(5);
-    let mut poll_interval = MIN_POLL_INTERVAL;
-    loop {
-        if drain_outbox_once(&outbox_dir, &slack, max_len).await {
-            poll_interval = MIN_POLL_INTERVAL;
-        } else {
-            poll_interval = (poll_interval * 2).min(MAX_IDLE_INTERVAL);
-        }
-        tokio::time::sleep(poll_interval).await;
-    }
-}
-
-async fn drain_outbox_once(outbox_dir: &Path, slack: &Mutex<SlackClient>, max_len: usize) -> bool {
-    let entries = match std::fs::read_dir(outbox_dir) {
-        Ok(entries) => entries,
-        Err(_) => return false,
-    };
-
-    // Collect first, then sort by name — MCP tool writes `<ts_ns>-<uuid>.json`
-    // so lexical order is chronological.
-    let mut paths: Vec<PathBuf> = entries
-        .flatten()
-        .map(|e| e.path())
-        .filter(|p| p.extension().and_then(|s| s.to_str()) == Some("json"))
-        .collect();
-    paths.sort();
-    if paths.is_empty() {
-        return false;
-    }
-
-    for path in paths {
-        let content = match std::fs::read_to_string(&path) {
-            Ok(c) => c,
-            Err(e) => {
-                warn!("Failed to read outbox file {:?}: {}", path, e);
-                continue;
-            }
-        };
-        let reply: OutboxReply = match serde_json::from_str(&content) {
-            Ok(r) => r,
-            Err(e) => {
-                // Malformed file — move it aside instead of retrying forever.
-                warn!("Discarding malformed outbox file {:?}: {}", path, e);
-                let bad = path.with_extension("json.bad");
-                let _ = std::fs::rename(&path, &bad);
-                continue;
-            }
-        };
-
-        let slack_guard = slack.lock().await;
-        match slack_guard
-            .post_message_chunked(
-                &reply.channel,
-                &reply.text,
-                reply.thread_ts.as_deref(),
-                max_len,
-            )
-            .await
-        {
-            Ok(()) => {
-                debug!("Delivered Slack reply from outbox: {:?}", path);
-                let _ = std::fs::remove_file(&path);
-            }
-            Err(e) => {
-                warn!(
-                    "Failed to deliver outbox reply {:?}: {} — will retry",
-                    path, e
-                );
-                // Don't delete — next poll retries.
-                break;
-            }
-        }
-    }
-    true
-}
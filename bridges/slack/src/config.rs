@@ -16,6 +16,9 @@ pub struct Config {
     pub omar_dir: PathBuf,
     /// Maximum Slack message length before chunking (Slack limit is 4000)
     pub max_message_length: usize,
+    /// Number of `omar mcp-server` children the bridge may run at once for
+    /// inbound messages.
+    pub mcp_pool_size: usize,
 }
 
 impl Config {
@@ -52,12 +55,19 @@ impl Config {
             .parse()
             .unwrap_or(3900);
 
+        let mcp_pool_size: usize = std::env::var("MCP_POOL_SIZE")
+            .ok()
+            .and_then(|v| v.parse().ok())
+            .filter(|&n| n > 0)
+            .unwrap_or(4);
+
         Ok(Self {
             bot_token,
             app_token,
             omar_binary,
             omar_dir,
             max_message_length,
+            mcp_pool_size,
         })
     }
 }
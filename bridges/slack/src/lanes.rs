@@ -0,0 +1,175 @@
+//! Per-key serial queues that run in parallel with each other.
+//!
+//! Both directions of the bridge need the same shape: work for one Slack
+//! thread must happen in arrival order, while work for different threads
+//! should not wait on each other. [`Lanes`] gives every key its own worker
+//! task fed by an unbounded channel. Workers are started on the first item
+//! for a key and stopped once their key has gone idle, so the map only
+//! holds threads with work outstanding.
+
+use std::collections::HashMap;
+use std::future::Future;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+
+use tokio::sync::mpsc;
+
+struct Lane<T> {
+    tx: mpsc::UnboundedSender<T>,
+    /// Items pushed but not yet reported [`LaneRx::done`].
+    pending: Arc<AtomicUsize>,
+}
+
+/// The worker's end of a lane.
+pub struct LaneRx<T> {
+    rx: mpsc::UnboundedReceiver<T>,
+    pending: Arc<AtomicUsize>,
+}
+
+impl<T> LaneRx<T> {
+    /// Next item, or `None` once the lane has been retired.
+    pub async fn recv(&mut self) -> Option<T> {
+        self.rx.recv().await
+    }
+
+    /// Next item if one is already queued.
+    pub fn try_recv(&mut self) -> Option<T> {
+        self.rx.try_recv().ok()
+    }
+
+    /// Report `count` received items as fully handled. A lane with nothing
+    /// pending is retired on the next push to any lane.
+    pub fn done(&self, count: usize) {
+        self.pending.fetch_sub(count, Ordering::AcqRel);
+    }
+}
+
+/// Lanes keyed by string. Owned by the single task that pushes work, so
+/// retiring an idle lane can never race a push to it.
+pub struct Lanes<T> {
+    lanes: HashMap<String, Lane<T>>,
+}
+
+impl<T: Send + 'static> Default for Lanes<T> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<T: Send + 'static> Lanes<T> {
+    pub fn new() -> Self {
+        Self {
+            lanes: HashMap::new(),
+        }
+    }
+
+    /// Queue `item` on the lane for `key`, starting that lane's worker with
+    /// `start` if it has none.
+    pub fn push<F, Fut>(&mut self, key: &str, item: T, start: F)
+    where
+        F: FnOnce(LaneRx<T>) -> Fut,
+        Fut: Future<Output = ()> + Send + 'static,
+    {
+        // Dropping an idle lane's sender ends its worker: `pending == 0`
+        // means its channel is empty and it is parked in `recv`.
+        self.lanes
+            .retain(|lane_key, lane| lane_key == key || lane.pending.load(Ordering::Acquire) > 0);
+
+        let item = match self.lanes.get(key) {
+            Some(lane) => {
+                lane.pending.fetch_add(1, Ordering::AcqRel);
+                match lane.tx.send(item) {
+                    Ok(()) => return,
+                    // The worker is gone (it panicked); start a fresh one.
+                    Err(mpsc::error::SendError(item)) => item,
+                }
+            }
+            None => item,
+        };
+
+        let (tx, rx) = mpsc::unbounded_channel();
+        let pending = Arc::new(AtomicUsize::new(1));
+        tx.send(item)
+            .unwrap_or_else(|_| unreachable!("receiver is alive"));
+        tokio::spawn(start(LaneRx {
+            rx,
+            pending: pending.clone(),
+        }));
+        self.lanes.insert(key.to_string(), Lane { tx, pending });
+    }
+
+    /// Number of lanes with a live worker.
+    #[cfg(test)]
+    pub fn len(&self) -> usize {
+        self.lanes.len()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::Mutex;
+    use std::time::Duration;
+
+    async fn record(
+        mut lane: LaneRx<(String, u32)>,
+        log: Arc<Mutex<Vec<(String, u32)>>>,
+        delay: Duration,
+    ) {
+        while let Some(item) = lane.recv().await {
+            tokio::time::sleep(delay).await;
+            log.lock().unwrap().push(item);
+            lane.done(1);
+        }
+    }
+
+    #[tokio::test]
+    async fn items_for_one_key_keep_their_order() {
+        let log = Arc::new(Mutex::new(Vec::new()));
+        let mut lanes = Lanes::new();
+        for i in 0..5 {
+            let log = log.clone();
+            lanes.push("a", ("a".to_string(), i), move |lane| {
+                record(lane, log, Duration::from_millis(5))
+            });
+        }
+        assert_eq!(lanes.len(), 1);
+        tokio::time::sleep(Duration::from_millis(200)).await;
+        let seen: Vec<u32> = log.lock().unwrap().iter().map(|(_, i)| *i).collect();
+        assert_eq!(seen, vec![0, 1, 2, 3, 4]);
+    }
+
+    #[tokio::test]
+    async fn a_slow_key_does_not_hold_up_others() {
+        let log = Arc::new(Mutex::new(Vec::new()));
+        let mut lanes = Lanes::new();
+        let slow = log.clone();
+        lanes.push("slow", ("slow".to_string(), 0), move |lane| {
+            record(lane, slow, Duration::from_millis(300))
+        });
+        let fast = log.clone();
+        lanes.push("fast", ("fast".to_string(), 0), move |lane| {
+            record(lane, fast, Duration::ZERO)
+        });
+        tokio::time::sleep(Duration::from_millis(100)).await;
+        assert_eq!(*log.lock().unwrap(), vec![("fast".to_string(), 0)]);
+    }
+
+    #[tokio::test]
+    async fn idle_lanes_are_retired_on_the_next_push() {
+        let log = Arc::new(Mutex::new(Vec::new()));
+        let mut lanes = Lanes::new();
+        for key in ["a", "b"] {
+            let log = log.clone();
+            lanes.push(key, (key.to_string(), 0), move |lane| {
+                record(lane, log, Duration::ZERO)
+            });
+        }
+        tokio::time::sleep(Duration::from_millis(50)).await;
+        let log2 = log.clone();
+        lanes.push("c", ("c".to_string(), 0), move |lane| {
+            record(lane, log2, Duration::ZERO)
+        });
+        assert_eq!(lanes.len(), 1);
+    }
+}
@@ -1,6 +1,10 @@
 mod bridge;
 mod config;
+mod dir_watch;
+mod lanes;
 mod omar;
+mod outbox;
+mod ratelimit;
 mod settings;
 mod slack;
 
@@ -30,7 +34,11 @@ async fn main() -> Result<()> {
     info!("omar dir:    {}", config.omar_dir.display());
 
     let slack_client = SlackClient::new(&config.bot_token, &config.app_token);
-    let omar = OmarMcp::new(config.omar_binary.clone(), config.omar_dir.clone());
+    let omar = OmarMcp::new(
+        config.omar_binary.clone(),
+        config.omar_dir.clone(),
+        config.mcp_pool_size,
+    );
 
     let bridge = Bridge::new(config, slack_client, omar);
     bridge.run().await?;
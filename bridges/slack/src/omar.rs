@@ -3,14 +3,17 @@
 //! The bridge spawns `omar mcp-server` and
 //! exchanges JSON-RPC messages over the child's stdio. Line-delimited
 //! framing is used; the omar server accepts both that and Content-Length,
-//! line-delimited is simpler here.
+//! line-delimited is simpler here. [`OmarMcp`] keeps a small pool of
+//! these children so independent calls don't serialize on one stdio pipe.
 
 use anyhow::{anyhow, Context, Result};
 use serde_json::{json, Value};
 use std::path::PathBuf;
 use std::process::Stdio;
+use std::sync::{Mutex, MutexGuard};
 use tokio::io::{AsyncBufReadExt, AsyncWriteExt, BufReader};
 use tokio::process::{Child, ChildStdin, ChildStdout, Command};
+use tokio::sync::Semaphore;
 use tokio::time::{timeout, Duration};
 use tracing::{debug, warn};
 
@@ -183,65 +186,96 @@ impl Drop for McpClient {
     }
 }
 
-/// A lazy, self-reconnecting MCP client. Every call to `post_slack_event`
-/// attempts to use the existing child; if the child has died (stdout EOF,
-/// write failure), the next call transparently respawns. The bridge keeps
-/// running across transient MCP-server crashes without losing inbound
-/// Slack messages to a permanently-broken connection.
+/// A lazily filled pool of self-reconnecting MCP clients. Each call checks
+/// out an idle `omar mcp-server` child (spawning one if none is idle and the
+/// pool has room), so a burst of inbound Slack messages runs up to
+/// `pool_size` tool calls at once instead of queueing behind one slow call.
+/// A child that errors or times out is dropped rather than returned, and
+/// the next call spawns a replacement — the bridge keeps running across
+/// transient MCP-server crashes without losing inbound Slack messages to a
+/// permanently-broken connection.
 pub struct OmarMcp {
     omar_binary: PathBuf,
     omar_dir: PathBuf,
+    /// One permit per child the pool may have checked out at once.
+    slots: Semaphore,
+    state: Mutex<PoolState>,
+}
+
+#[derive(Default)]
+struct PoolState {
     ea_id_override: Option<u32>,
+    /// Bumped whenever the EA pin changes, so children spawned for the old
+    /// pin are dropped instead of returned to `idle`.
+    generation: u64,
+    idle: Vec<McpClient>,
     /// Last value read from `[slack_bridge].active_ea`. Used to detect
     /// dashboard-side edits without re-resolving against `list_eas` on
     /// every inbound Slack message.
     last_desired_name: Option<String>,
-    client: Option<McpClient>,
 }
 
 impl OmarMcp {
-    pub fn new(omar_binary: PathBuf, omar_dir: PathBuf) -> Self {
+    pub fn new(omar_binary: PathBuf, omar_dir: PathBuf, pool_size: usize) -> Self {
         Self {
             omar_binary,
             omar_dir,
-            ea_id_override: None,
-            last_desired_name: None,
-            client: None,
+            slots: Semaphore::new(pool_size.max(1)),
+            state: Mutex::new(PoolState::default()),
         }
     }
 
-    /// Pin future MCP children to `ea_id`. Drops the current child so the
-    /// next tool call respawns with the new pinning. Pass `None` to revert
+    fn state(&self) -> MutexGuard<'_, PoolState> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    /// Pin future MCP children to `ea_id`. Drops the idle children so the
+    /// next tool calls respawn with the new pinning; children checked out
+    /// at the time are dropped when they come back. Pass `None` to revert
     /// to the dashboard's globally-active EA.
-    pub fn set_target_ea(&mut self, ea_id: Option<u32>) {
-        if self.ea_id_override != ea_id {
-            self.ea_id_override = ea_id;
-            self.client = None;
+    pub fn set_target_ea(&self, ea_id: Option<u32>) {
+        let mut state = self.state();
+        if state.ea_id_override != ea_id {
+            state.ea_id_override = ea_id;
+            state.generation += 1;
+            state.idle.clear();
         }
     }
 
     /// Cached snapshot of `[slack_bridge].active_ea` from the last
     /// successful `resolve_target_ea`. Compared against fresh toml reads
     /// to decide whether to re-resolve.
-    pub fn last_desired_name(&self) -> Option<&str> {
-        self.last_desired_name.as_deref()
+    pub fn last_desired_name(&self) -> Option<String> {
+        self.state().last_desired_name.clone()
+    }
+
+    pub fn set_last_desired_name(&self, name: Option<String>) {
+        self.state().last_desired_name = name;
     }
 
-    pub fn set_last_desired_name(&mut self, name: Option<String>) {
-        self.last_desired_name = name;
+    /// An idle child plus the pin it was spawned under, or a fresh child
+    /// when none is idle.
+    async fn checkout(&self) -> Result<(u64, McpClient)> {
+        let (generation, ea_id_override, idle) = {
+            let mut state = self.state();
+            (state.generation, state.ea_id_override, state.idle.pop())
+        };
+        let client = match idle {
+            Some(client) => client,
+            None => McpClient::start(&self.omar_binary, &self.omar_dir, ea_id_override).await?,
+        };
+        Ok((generation, client))
     }
 
-    async fn client_mut(&mut self) -> Result<&mut McpClient> {
-        if self.client.is_none() {
-            let client =
-                McpClient::start(&self.omar_binary, &self.omar_dir, self.ea_id_override).await?;
-            self.client = Some(client);
+    fn checkin(&self, generation: u64, client: McpClient) {
+        let mut state = self.state();
+        if state.generation == generation {
+            state.idle.push(client);
         }
-        Ok(self.client.as_mut().unwrap())
     }
 
     /// Fetch `(active_id, [(id, name), ...])` from the MCP `list_eas` tool.
-    pub async fn list_eas(&mut self) -> Result<(u32, Vec<(u32, String)>)> {
+    pub async fn list_eas(&self) -> Result<(u32, Vec<(u32, String)>)> {
         let result = self.try_call_with_timeout("list_eas", json!({})).await?;
         let active = result
             .get("active")
@@ -270,7 +304,7 @@ impl OmarMcp {
     }
 
     /// Post an inbound Slack message to the EA's event queue.
-    pub async fn post_slack_event(&mut self, payload: &str) -> Result<()> {
+    pub async fn post_slack_event(&self, payload: &str) -> Result<()> {
         let args = json!({
             "sender": "slack-bridge",
             "receiver": "ea",
@@ -281,34 +315,50 @@ impl OmarMcp {
             .await
         {
             warn!(
-                "MCP schedule_omar_event failed ({}); restarting MCP server and retrying",
+                "MCP schedule_omar_event failed ({}); retrying on another MCP server",
                 e
             );
-            self.client = None;
             self.try_call_with_timeout("schedule_omar_event", args)
                 .await?;
         }
         Ok(())
     }
 
-    async fn try_call_with_timeout(&mut self, name: &str, args: Value) -> Result<Value> {
-        match timeout(MCP_CALL_TIMEOUT, async {
-            self.client_mut().await?.call_tool(name, args).await
-        })
-        .await
-        {
-            Ok(result) => result,
-            Err(_) => {
-                self.client = None;
-                Err(anyhow!("MCP call '{}' timed out", name))
+    /// Run one tool call on a pooled child. The child goes back to the pool
+    /// only if the call succeeded; on error or timeout it is dropped, which
+    /// kills it.
+    async fn try_call_with_timeout(&self, name: &str, args: Value) -> Result<Value> {
+        let _slot = self
+            .slots
+            .acquire()
+            .await
+            .expect("MCP pool semaphore is never closed");
+        let call = async {
+            let (generation, mut client) = self.checkout().await?;
+            let value = client.call_tool(name, args).await?;
+            Ok::<_, anyhow::Error>((generation, client, value))
+        };
+        match timeout(MCP_CALL_TIMEOUT, call).await {
+            Ok(Ok((generation, client, value))) => {
+                self.checkin(generation, client);
+                Ok(value)
             }
+            Ok(Err(e)) => Err(e),
+            Err(_) => Err(anyhow!("MCP call '{}' timed out", name)),
         }
     }
 
     /// Best-effort startup probe so the bridge logs whether the MCP server
-    /// is reachable before any Slack traffic arrives.
-    pub async fn health_check(&mut self) -> Result<()> {
-        self.client_mut().await?;
+    /// is reachable before any Slack traffic arrives. The probed child is
+    /// kept as the pool's first idle client.
+    pub async fn health_check(&self) -> Result<()> {
+        let _slot = self
+            .slots
+            .acquire()
+            .await
+            .expect("MCP pool semaphore is never closed");
+        let (generation, client) = self.checkout().await?;
+        self.checkin(generation, client);
         Ok(())
     }
 }
@@ -0,0 +1,343 @@
+//! Delivery of `slack_reply` results queued in `~/.omar/slack_outbox/`.
+//!
+//! The MCP tool writes each reply as `<ts_ns>-<uuid>.json` via rename. A
+//! filesystem watch on the directory wakes the scanner as soon as one
+//! lands, with a slow periodic rescan as a backstop (and `stat` polling if
+//! the watch can't be set up). Every new file is handed to the lane for its
+//! `(channel, thread)`, so replies to one thread post in the order they
+//! were queued while different threads and channels post in parallel.
+//!
+//! A lane that fails keeps retrying its oldest reply — after Slack's
+//! `Retry-After` on a rate limit, with backoff otherwise — without holding
+//! up any other lane. Replies that pile up for one thread while it waits
+//! for its channel's rate budget are merged into as few posts as
+//! `max_message_length` allows.
+//!
+//! Files are deleted only once delivered, so anything still queued when
+//! the bridge stops goes out on the next run.
+
+use std::collections::{HashSet, VecDeque};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+
+use serde::Deserialize;
+use tokio::sync::{Notify, Semaphore};
+use tracing::{debug, warn};
+
+use crate::dir_watch::DirWatch;
+use crate::lanes::{LaneRx, Lanes};
+use crate::ratelimit::RateLimited;
+use crate::slack::{split_chunks, SlackClient};
+
+/// Posts in flight at once across all lanes.
+const MAX_CONCURRENT_POSTS: usize = 8;
+/// Backstop rescan interval while the directory watch is up.
+const RESCAN_INTERVAL: Duration = Duration::from_secs(5);
+/// `stat` polling interval when the directory can't be watched.
+const POLL_INTERVAL: Duration = Duration::from_millis(50);
+const MIN_RETRY_INTERVAL: Duration = Duration::from_millis(500);
+const MAX_RETRY_INTERVAL: Duration = Duration::from_secs(30);
+/// Placed between replies merged into one post.
+const BATCH_SEPARATOR: &str = "\n\n";
+
+/// A Slack reply the EA queued via the `slack_reply` MCP tool. Fields
+/// match the JSON written by `mcp::OmarMcpServer::slack_reply` — adding
+/// fields server-side should be backwards-compatible because unknown
+/// fields are ignored by serde's default behaviour.
+#[derive(Debug, Deserialize)]
+struct OutboxReply {
+    channel: String,
+    #[serde(default)]
+    thread_ts: Option<String>,
+    text: String,
+}
+
+struct Queued {
+    path: PathBuf,
+    reply: OutboxReply,
+}
+
+/// State shared by the scanner and every lane.
+struct Delivery {
+    slack: Arc<SlackClient>,
+    max_len: usize,
+    posts: Semaphore,
+    /// Files handed to a lane and not yet delivered, so rescans skip them.
+    queued: Mutex<HashSet<PathBuf>>,
+}
+
+impl Delivery {
+    fn queued(&self) -> std::sync::MutexGuard<'_, HashSet<PathBuf>> {
+        self.queued.lock().unwrap_or_else(|e| e.into_inner())
+    }
+}
+
+/// Watch `outbox_dir` and deliver everything queued in it, forever.
+pub async fn run_delivery(outbox_dir: PathBuf, slack: Arc<SlackClient>, max_len: usize) {
+    let wake = Arc::new(Notify::new());
+    let mut watch = DirWatch::new({
+        let wake = wake.clone();
+        move || wake.notify_one()
+    });
+    let watched = watch.sync(&HashSet::from([outbox_dir.clone()]));
+    if !watched {
+        warn!(
+            "Cannot watch slack outbox {:?}; falling back to polling",
+            outbox_dir
+        );
+    }
+    let delivery = Arc::new(Delivery {
+        slack,
+        max_len,
+        posts: Semaphore::new(MAX_CONCURRENT_POSTS),
+        queued: Mutex::new(HashSet::new()),
+    });
+    let mut lanes = Lanes::new();
+
+    let dir_stamp = |dir: &Path| std::fs::metadata(dir).and_then(|meta| meta.modified()).ok();
+    let mut seen_stamp = None;
+    let mut next_scan = tokio::time::Instant::now();
+    loop {
+        // Without a watch, list the directory only when its mtime moves
+        // (each rename bumps it), plus a full scan every RESCAN_INTERVAL
+        // in case two writes landed within one mtime tick.
+        let stamp = dir_stamp(&outbox_dir);
+        let now = tokio::time::Instant::now();
+        if watched || stamp != seen_stamp || now >= next_scan {
+            seen_stamp = stamp;
+            next_scan = now + RESCAN_INTERVAL;
+            scan(&outbox_dir, &delivery, &mut lanes);
+        }
+        let interval = if watched {
+            RESCAN_INTERVAL
+        } else {
+            POLL_INTERVAL
+        };
+        tokio::select! {
+            _ = wake.notified() => {}
+            _ = tokio::time::sleep(interval) => {}
+        }
+    }
+}
+
+/// Hand every reply file not already queued to its lane.
+fn scan(outbox_dir: &Path, delivery: &Arc<Delivery>, lanes: &mut Lanes<Queued>) {
+    let entries = match std::fs::read_dir(outbox_dir) {
+        Ok(entries) => entries,
+        Err(_) => return,
+    };
+
+    // Collect first, then sort by name — MCP tool writes `<ts_ns>-<uuid>.json`
+    // so lexical order is chronological.
+    let mut paths: Vec<PathBuf> = entries
+        .flatten()
+        .map(|e| e.path())
+        .filter(|p| p.extension().and_then(|s| s.to_str()) == Some("json"))
+        .collect();
+    paths.sort();
+
+    for path in paths {
+        if delivery.queued().contains(&path) {
+            continue;
+        }
+        let content = match std::fs::read_to_string(&path) {
+            Ok(c) => c,
+            Err(e) => {
+                warn!("Failed to read outbox file {:?}: {}", path, e);
+                continue;
+            }
+        };
+        let reply: OutboxReply = match serde_json::from_str(&content) {
+            Ok(r) => r,
+            Err(e) => {
+                // Malformed file — move it aside instead of retrying forever.
+                warn!("Discarding malformed outbox file {:?}: {}", path, e);
+                let bad = path.with_extension("json.bad");
+                let _ = std::fs::rename(&path, &bad);
+                continue;
+            }
+        };
+
+        delivery.queued().insert(path.clone());
+        let key = lane_key(&reply);
+        let delivery = delivery.clone();
+        lanes.push(&key, Queued { path, reply }, move |lane| {
+            deliver_lane(lane, delivery)
+        });
+    }
+}
+
+/// Replies sharing a key post strictly in order. Top-level replies in a
+/// channel share the channel's unthreaded lane.
+fn lane_key(reply: &OutboxReply) -> String {
+    format!(
+        "{}/{}",
+        reply.channel,
+        reply.thread_ts.as_deref().unwrap_or_default()
+    )
+}
+
+/// Deliver one lane's replies in order until the lane is retired.
+async fn deliver_lane(mut lane: LaneRx<Queued>, delivery: Arc<Delivery>) {
+    let mut backlog: VecDeque<Queued> = VecDeque::new();
+    while let Some(queued) = lane.recv().await {
+        backlog.push_back(queued);
+        // Chunks of the current batch already in Slack, so a retry after a
+        // partial failure resumes instead of reposting them.
+        let mut posted = 0;
+        let mut retry_interval = MIN_RETRY_INTERVAL;
+        while let Some(head) = backlog.front() {
+            let channel = head.reply.channel.clone();
+            let thread_ts = head.reply.thread_ts.clone();
+
+            // Batch whatever arrived while we waited for the channel's budget.
+            delivery.slack.post_ready(&channel).await;
+            while let Some(more) = lane.try_recv() {
+                backlog.push_back(more);
+            }
+            let count = if posted == 0 {
+                batch_len(
+                    backlog.iter().map(|q| q.reply.text.as_str()),
+                    delivery.max_len,
+                )
+            } else {
+                1
+            };
+            let text = backlog
+                .iter()
+                .take(count)
+                .map(|q| q.reply.text.as_str())
+                .collect::<Vec<_>>()
+                .join(BATCH_SEPARATOR);
+
+            let result = {
+                let _post = delivery
+                    .posts
+                    .acquire()
+                    .await
+                    .expect("outbox semaphore is never closed");
+                post_from(
+                    &delivery.slack,
+                    &channel,
+                    thread_ts.as_deref(),
+                    &split_chunks(&text, delivery.max_len),
+                    &mut posted,
+                )
+                .await
+            };
+            match result {
+                Ok(()) => {
+                    for delivered in backlog.drain(..count) {
+                        debug!("Delivered Slack reply from outbox: {:?}", delivered.path);
+                        let _ = std::fs::remove_file(&delivered.path);
+                        delivery.queued().remove(&delivered.path);
+                    }
+                    lane.done(count);
+                    posted = 0;
+                    retry_interval = MIN_RETRY_INTERVAL;
+                }
+                Err(e) => {
+                    let wait = match e.downcast_ref::<RateLimited>() {
+                        Some(limited) => limited.retry_after,
+                        None => {
+                            let wait = retry_interval;
+                            retry_interval = (retry_interval * 2).min(MAX_RETRY_INTERVAL);
+                            wait
+                        }
+                    };
+                    warn!(
+                        "Failed to deliver outbox reply to {}: {} — retrying in {:?}",
+                        channel, e, wait
+                    );
+                    tokio::time::sleep(wait).await;
+                }
+            }
+        }
+    }
+}
+
+/// Post `chunks[*posted..]`, advancing `posted` as each one lands.
+async fn post_from(
+    slack: &SlackClient,
+    channel: &str,
+    thread_ts: Option<&str>,
+    chunks: &[&str],
+    posted: &mut usize,
+) -> anyhow::Result<()> {
+    for chunk in &chunks[(*posted).min(chunks.len())..] {
+        slack.post_message(channel, chunk, thread_ts).await?;
+        *posted += 1;
+    }
+    Ok(())
+}
+
+/// How many replies from the front of a backlog go into the next post: the
+/// first always, then each following one while the merged text still fits
+/// in a single message.
+fn batch_len<'a>(texts: impl IntoIterator<Item = &'a str>, max_len: usize) -> usize {
+    let mut texts = texts.into_iter();
+    let Some(first) = texts.next() else {
+        return 0;
+    };
+    let mut len = first.len();
+    let mut count = 1;
+    for text in texts {
+        len += BATCH_SEPARATOR.len() + text.len();
+        if len > max_len {
+            break;
+        }
+        count += 1;
+    }
+    count
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn batch_len_merges_while_the_post_fits() {
+        assert_eq!(batch_len([], 10), 0);
+        assert_eq!(batch_len(["a"], 10), 1);
+        // "abc\n\nde\n\nf" is 10 bytes.
+        assert_eq!(batch_len(["abc", "de", "f", "g"], 10), 3);
+        // An oversized reply is posted alone (and chunked).
+        assert_eq!(batch_len(["abcdefghijkl", "a"], 10), 1);
+        assert_eq!(batch_len(["abc", "abcdefghijkl", "a"], 10), 1);
+    }
+
+    #[test]
+    fn replies_are_laned_per_thread() {
+        let reply = |channel: &str, thread_ts: Option<&str>| OutboxReply {
+            channel: channel.to_string(),
+            thread_ts: thread_ts.map(str::to_string),
+            text: "hi".to_string(),
+        };
+        assert_eq!(lane_key(&reply("C1", Some("1.2"))), "C1/1.2");
+        assert_eq!(lane_key(&reply("C1", None)), "C1/");
+        assert_ne!(
+            lane_key(&reply("C1", Some("1.2"))),
+            lane_key(&reply("C2", Some("1.2")))
+        );
+    }
+
+    #[test]
+    fn scan_discards_malformed_files() {
+        let dir = tempfile::tempdir().unwrap();
+        std::fs::write(dir.path().join("1-a.json"), "not json").unwrap();
+        std::fs::write(dir.path().join("2-b.json.tmp"), "{}").unwrap();
+        let delivery = Arc::new(Delivery {
+            slack: Arc::new(SlackClient::new("xoxb-test", "xapp-test")),
+            max_len: 3900,
+            posts: Semaphore::new(1),
+            queued: Mutex::new(HashSet::new()),
+        });
+        let mut lanes = Lanes::new();
+        scan(dir.path(), &delivery, &mut lanes);
+        assert!(dir.path().join("1-a.json.bad").exists());
+        assert!(dir.path().join("2-b.json.tmp").exists());
+        assert!(delivery.queued().is_empty());
+        assert_eq!(lanes.len(), 0);
+    }
+}
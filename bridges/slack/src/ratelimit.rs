@@ -0,0 +1,257 @@
+//! Client-side rate limiting for Slack Web API calls.
+//!
+//! Slack enforces per-method limits — `chat.postMessage` allows roughly one
+//! message per second per channel with short bursts, `users.info` sits in
+//! Tier 4 (100+ per minute) — and answers anything over them with HTTP 429
+//! and a `Retry-After` header. Each `(method, key)` pair gets a token bucket
+//! sized to stay under Slack's limit, so concurrent senders queue locally
+//! instead of collecting 429s, and a `Retry-After` pauses the bucket it was
+//! returned for until Slack is ready again.
+
+use std::collections::HashMap;
+use std::fmt;
+use std::sync::Mutex;
+use std::time::Duration;
+
+use tokio::time::Instant;
+
+/// Returned (inside `anyhow::Error`) when Slack rejected a call as rate
+/// limited. The bucket for the call is already paused for `retry_after`.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct RateLimited {
+    pub method: &'static str,
+    pub retry_after: Duration,
+}
+
+impl fmt::Display for RateLimited {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "{} rate limited by Slack; retry after {:?}",
+            self.method, self.retry_after
+        )
+    }
+}
+
+impl std::error::Error for RateLimited {}
+
+/// Sustained rate and burst size for one bucket.
+#[derive(Debug, Clone, Copy, PartialEq)]
+struct Limit {
+    per_sec: f64,
+    burst: f64,
+}
+
+/// The budget for `method`, or `None` for calls made too rarely to need
+/// one (`auth.test`, `apps.connections.open`).
+fn limit_for(method: &str) -> Option<Limit> {
+    match method {
+        // Keyed per channel.
+        "chat.postMessage" => Some(Limit {
+            per_sec: 1.0,
+            burst: 3.0,
+        }),
+        // Keyed per workspace.
+        "users.info" => Some(Limit {
+            per_sec: 100.0 / 60.0,
+            burst: 20.0,
+        }),
+        _ => None,
+    }
+}
+
+#[derive(Debug)]
+struct Bucket {
+    tokens: f64,
+    updated: Instant,
+    paused_until: Option<Instant>,
+}
+
+impl Bucket {
+    fn full(limit: Limit, now: Instant) -> Self {
+        Self {
+            tokens: limit.burst,
+            updated: now,
+            paused_until: None,
+        }
+    }
+
+    fn refill(&mut self, limit: Limit, now: Instant) {
+        let elapsed = now.saturating_duration_since(self.updated).as_secs_f64();
+        self.tokens = (self.tokens + elapsed * limit.per_sec).min(limit.burst);
+        self.updated = now;
+    }
+
+    /// How long until a token is available; zero when one is now.
+    fn delay(&mut self, limit: Limit, now: Instant) -> Duration {
+        if let Some(until) = self.paused_until {
+            if until > now {
+                return until - now;
+            }
+            self.paused_until = None;
+        }
+        self.refill(limit, now);
+        if self.tokens >= 1.0 {
+            Duration::ZERO
+        } else {
+            Duration::from_secs_f64((1.0 - self.tokens) / limit.per_sec)
+        }
+    }
+
+    /// Take a token if one is available, else report how long to wait.
+    fn take(&mut self, limit: Limit, now: Instant) -> Option<Duration> {
+        let wait = self.delay(limit, now);
+        if wait.is_zero() {
+            self.tokens -= 1.0;
+            None
+        } else {
+            Some(wait)
+        }
+    }
+
+    /// Block the bucket until `until`, then allow a single call through.
+    fn pause(&mut self, until: Instant) {
+        let until = self
+            .paused_until
+            .map_or(until, |current| current.max(until));
+        self.paused_until = Some(until);
+        self.tokens = 1.0;
+        self.updated = until;
+    }
+}
+
+/// Token buckets for every `(method, key)` pair the bridge calls. The lock
+/// is only held to do bucket arithmetic, never across an await.
+#[derive(Debug, Default)]
+pub struct RateLimits {
+    buckets: Mutex<HashMap<(&'static str, String), Bucket>>,
+}
+
+impl RateLimits {
+    fn with_bucket<R>(
+        &self,
+        method: &'static str,
+        key: &str,
+        f: impl FnOnce(&mut Bucket, Limit, Instant) -> R,
+    ) -> Option<R> {
+        let limit = limit_for(method)?;
+        let now = Instant::now();
+        let mut buckets = self.buckets.lock().unwrap_or_else(|e| e.into_inner());
+        let bucket = buckets
+            .entry((method, key.to_string()))
+            .or_insert_with(|| Bucket::full(limit, now));
+        Some(f(bucket, limit, now))
+    }
+
+    /// Wait for, and take, a token for one `method` call against `key`.
+    pub async fn acquire(&self, method: &'static str, key: &str) {
+        while let Some(Some(wait)) =
+            self.with_bucket(method, key, |bucket, limit, now| bucket.take(limit, now))
+        {
+            tokio::time::sleep(wait).await;
+        }
+    }
+
+    /// Wait until a token for `method` against `key` is available, without
+    /// taking it.
+    pub async fn ready(&self, method: &'static str, key: &str) {
+        loop {
+            let wait = self
+                .with_bucket(method, key, |bucket, limit, now| bucket.delay(limit, now))
+                .unwrap_or_default();
+            if wait.is_zero() {
+                return;
+            }
+            tokio::time::sleep(wait).await;
+        }
+    }
+
+    /// Hold every `method` call against `key` for `retry_after`.
+    pub fn pause(&self, method: &'static str, key: &str, retry_after: Duration) {
+        self.with_bucket(method, key, |bucket, _, now| {
+            bucket.pause(now + retry_after)
+        });
+    }
+}
+
+/// Parse a `Retry-After` header (delay in seconds), defaulting to one
+/// second when it is missing or not a plain number.
+pub fn retry_after(headers: &reqwest::header::HeaderMap) -> Duration {
+    headers
+        .get(reqwest::header::RETRY_AFTER)
+        .and_then(|value| value.to_str().ok())
+        .and_then(|value| value.trim().parse::<u64>().ok())
+        .map(Duration::from_secs)
+        .unwrap_or(Duration::from_secs(1))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const POST: Limit = Limit {
+        per_sec: 1.0,
+        burst: 3.0,
+    };
+
+    #[test]
+    fn bucket_allows_burst_then_paces() {
+        let start = Instant::now();
+        let mut bucket = Bucket::full(POST, start);
+        for _ in 0..3 {
+            assert_eq!(bucket.take(POST, start), None);
+        }
+        let wait = bucket.take(POST, start).expect("burst exhausted");
+        assert!((wait.as_secs_f64() - 1.0).abs() < 1e-6);
+
+        let later = start + Duration::from_millis(1500);
+        assert_eq!(bucket.take(POST, later), None);
+        let wait = bucket.take(POST, later).expect("half a token left");
+        assert!((wait.as_secs_f64() - 0.5).abs() < 1e-6);
+    }
+
+    #[test]
+    fn refill_is_capped_at_burst() {
+        let start = Instant::now();
+        let mut bucket = Bucket::full(POST, start);
+        let later = start + Duration::from_secs(60);
+        for _ in 0..3 {
+            assert_eq!(bucket.take(POST, later), None);
+        }
+        assert!(bucket.take(POST, later).is_some());
+    }
+
+    #[test]
+    fn pause_holds_the_bucket_until_retry_after() {
+        let start = Instant::now();
+        let mut bucket = Bucket::full(POST, start);
+        bucket.pause(start + Duration::from_secs(30));
+        // A shorter Retry-After never shortens an existing pause.
+        bucket.pause(start + Duration::from_secs(5));
+        assert_eq!(
+            bucket.delay(POST, start + Duration::from_secs(10)),
+            Duration::from_secs(20)
+        );
+        let after = start + Duration::from_secs(30);
+        assert_eq!(bucket.take(POST, after), None);
+        let wait = bucket.take(POST, after).expect("one call after a pause");
+        assert!((wait.as_secs_f64() - 1.0).abs() < 1e-6);
+    }
+
+    #[test]
+    fn unlimited_methods_never_wait() {
+        let limits = RateLimits::default();
+        assert!(limits
+            .with_bucket("auth.test", "", |bucket, limit, now| bucket
+                .take(limit, now))
+            .is_none());
+    }
+
+    #[test]
+    fn retry_after_header_parsing() {
+        let mut headers = reqwest::header::HeaderMap::new();
+        assert_eq!(retry_after(&headers), Duration::from_secs(1));
+        headers.insert(reqwest::header::RETRY_AFTER, "17".parse().unwrap());
+        assert_eq!(retry_after(&headers), Duration::from_secs(17));
+    }
+}
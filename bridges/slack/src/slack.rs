@@ -1,13 +1,18 @@
 #![allow(dead_code)]
 
+use std::collections::HashMap;
+use std::sync::Mutex;
+
 use anyhow::{Context, Result};
 use futures_util::{SinkExt, StreamExt};
-use reqwest::Client;
+use reqwest::{Client, StatusCode};
 use serde::{Deserialize, Serialize};
 use tokio::sync::mpsc;
 use tokio_tungstenite::tungstenite::Message as WsMessage;
 use tracing::{debug, error, info, warn};
 
+use crate::ratelimit::{retry_after, RateLimited, RateLimits};
+
 // ---------------------------------------------------------------------------
 // Slack Web API types
 // ---------------------------------------------------------------------------
@@ -115,12 +120,16 @@ impl SlackMessage {
 // ---------------------------------------------------------------------------
 
 /// Slack API client handling both Socket Mode WebSocket and Web API calls.
+///
+/// Every method takes `&self`: the client is shared behind an `Arc` by the
+/// inbound handlers and the outbox delivery lanes, and nothing in it is
+/// locked across an await.
 pub struct SlackClient {
     http: Client,
     bot_token: String,
     app_token: String,
-    pub bot_user_id: Option<String>,
-    user_name_cache: std::collections::HashMap<String, String>,
+    user_name_cache: Mutex<HashMap<String, String>>,
+    limits: RateLimits,
 }
 
 impl SlackClient {
@@ -129,15 +138,15 @@ impl SlackClient {
             http: Client::new(),
             bot_token: bot_token.to_string(),
             app_token: app_token.to_string(),
-            bot_user_id: None,
-            user_name_cache: std::collections::HashMap::new(),
+            user_name_cache: Mutex::new(HashMap::new()),
+            limits: RateLimits::default(),
         }
     }
 
     // -- Web API calls --
 
     /// Fetch the bot's own user ID via auth.test.
-    pub async fn auth_test(&mut self) -> Result<String> {
+    pub async fn auth_test(&self) -> Result<String> {
         let resp: AuthTestResponse = self
             .http
             .post("https://slack.com/api/auth.test")
@@ -152,18 +161,24 @@ impl SlackClient {
         }
 
         let user_id = resp.user_id.context("auth.test did not return user_id")?;
-        self.bot_user_id = Some(user_id.clone());
         info!("Authenticated as bot user: {}", user_id);
         Ok(user_id)
     }
 
     /// Post a message to a Slack channel, optionally in a thread.
+    ///
+    /// Waits for the channel's `chat.postMessage` budget first. A 429 (or a
+    /// `ratelimited` error body) pauses that budget for Slack's Retry-After
+    /// and fails with [`RateLimited`]; other Slack-side errors such as
+    /// `channel_not_found` are logged and treated as delivered, since
+    /// retrying them cannot succeed.
     pub async fn post_message(
         &self,
         channel: &str,
         text: &str,
         thread_ts: Option<&str>,
     ) -> Result<()> {
+        const METHOD: &str = "chat.postMessage";
         let mut body = serde_json::json!({
             "channel": channel,
             "text": text,
@@ -172,22 +187,51 @@ impl SlackClient {
             body["thread_ts"] = serde_json::Value::String(ts.to_string());
         }
 
-        let resp: PostMessageResponse = self
+        self.limits.acquire(METHOD, channel).await;
+        let http_resp = self
             .http
             .post("https://slack.com/api/chat.postMessage")
             .bearer_auth(&self.bot_token)
             .json(&body)
             .send()
-            .await?
-            .json()
             .await?;
+        if http_resp.status() == StatusCode::TOO_MANY_REQUESTS {
+            return Err(self
+                .rate_limited(METHOD, channel, http_resp.headers())
+                .into());
+        }
+        let headers = http_resp.headers().clone();
+        let resp: PostMessageResponse = http_resp.json().await?;
 
         if !resp.ok {
+            if resp.error.as_deref() == Some("ratelimited") {
+                return Err(self.rate_limited(METHOD, channel, &headers).into());
+            }
             warn!("chat.postMessage failed: {:?}", resp.error);
         }
         Ok(())
     }
 
+    /// Wait until `channel` has `chat.postMessage` budget, without using it.
+    /// Lets a caller batch whatever piled up while it was waiting.
+    pub async fn post_ready(&self, channel: &str) {
+        self.limits.ready("chat.postMessage", channel).await;
+    }
+
+    fn rate_limited(
+        &self,
+        method: &'static str,
+        key: &str,
+        headers: &reqwest::header::HeaderMap,
+    ) -> RateLimited {
+        let retry_after = retry_after(headers);
+        self.limits.pause(method, key, retry_after);
+        RateLimited {
+            method,
+            retry_after,
+        }
+    }
+
     /// Post a message, splitting into chunks if it exceeds max_length.
     pub async fn post_message_chunked(
         &self,
@@ -196,59 +240,58 @@ impl SlackClient {
         thread_ts: Option<&str>,
         max_length: usize,
     ) -> Result<()> {
-        if text.len() <= max_length {
-            return self.post_message(channel, text, thread_ts).await;
-        }
-
-        // Split on line boundaries when possible
-        let mut remaining = text;
-        while !remaining.is_empty() {
-            let chunk_end = if remaining.len() <= max_length {
-                remaining.len()
-            } else {
-                // Find a newline break point
-                remaining[..max_length]
-                    .rfind('\n')
-                    .map(|p| p + 1) // include the newline
-                    .unwrap_or(max_length)
-            };
-            let chunk = &remaining[..chunk_end];
+        for chunk in split_chunks(text, max_length) {
             self.post_message(channel, chunk, thread_ts).await?;
-            remaining = &remaining[chunk_end..];
         }
         Ok(())
     }
 
     /// Resolve a Slack user ID to a display name (cached).
-    pub async fn resolve_user_name(&mut self, user_id: &str) -> String {
-        if let Some(cached) = self.user_name_cache.get(user_id) {
-            return cached.clone();
+    pub async fn resolve_user_name(&self, user_id: &str) -> String {
+        if let Some(cached) = self.cached_user_name(user_id) {
+            return cached;
         }
 
         let name = match self.fetch_user_name(user_id).await {
             Ok(Some(n)) => n,
             Ok(None) => user_id.to_string(),
             Err(e) => {
+                // Not cached: a rate limit or network blip shouldn't pin
+                // the raw ID as this user's name for the bridge's lifetime.
                 debug!("Failed to resolve user {}: {}", user_id, e);
-                user_id.to_string()
+                return user_id.to_string();
             }
         };
 
         self.user_name_cache
+            .lock()
+            .unwrap_or_else(|e| e.into_inner())
             .insert(user_id.to_string(), name.clone());
         name
     }
 
+    fn cached_user_name(&self, user_id: &str) -> Option<String> {
+        self.user_name_cache
+            .lock()
+            .unwrap_or_else(|e| e.into_inner())
+            .get(user_id)
+            .cloned()
+    }
+
     async fn fetch_user_name(&self, user_id: &str) -> Result<Option<String>> {
-        let resp: UserInfoResponse = self
+        const METHOD: &str = "users.info";
+        self.limits.acquire(METHOD, "").await;
+        let http_resp = self
             .http
             .get("https://slack.com/api/users.info")
             .bearer_auth(&self.bot_token)
             .query(&[("user", user_id)])
             .send()
-            .await?
-            .json()
             .await?;
+        if http_resp.status() == StatusCode::TOO_MANY_REQUESTS {
+            return Err(self.rate_limited(METHOD, "", http_resp.headers()).into());
+        }
+        let resp: UserInfoResponse = http_resp.json().await?;
 
         if !resp.ok {
             return Ok(None);
@@ -314,6 +357,39 @@ impl SlackClient {
     }
 }
 
+/// Split `text` into pieces of at most `max_length` bytes, breaking after
+/// the last newline in each piece when there is one and never inside a
+/// UTF-8 character.
+pub fn split_chunks(text: &str, max_length: usize) -> Vec<&str> {
+    let mut chunks = Vec::new();
+    let mut remaining = text;
+    while !remaining.is_empty() {
+        let chunk_end = if remaining.len() <= max_length {
+            remaining.len()
+        } else {
+            let mut limit = max_length;
+            while limit > 0 && !remaining.is_char_boundary(limit) {
+                limit -= 1;
+            }
+            if limit == 0 {
+                // A single character wider than the limit goes out whole.
+                limit = remaining
+                    .char_indices()
+                    .nth(1)
+                    .map_or(remaining.len(), |(i, _)| i);
+            }
+            // Find a newline break point
+            remaining[..limit]
+                .rfind('\n')
+                .map(|p| p + 1) // include the newline
+                .unwrap_or(limit)
+        };
+        chunks.push(&remaining[..chunk_end]);
+        remaining = &remaining[chunk_end..];
+    }
+    chunks
+}
+
 /// How long to wait for any WebSocket message before assuming the connection is dead.
 /// Slack Socket Mode typically sends pings every ~30s, so 90s is generous.
 const WS_READ_TIMEOUT: std::time::Duration = std::time::Duration::from_secs(90);
@@ -737,6 +813,16 @@ mod tests {
         assert!(sink.sent.is_empty()); // no ack sent for unparseable envelope
     }
 
+    #[test]
+    fn test_split_chunks_prefers_newlines_and_char_boundaries() {
+        assert_eq!(split_chunks("short", 10), vec!["short"]);
+        assert_eq!(split_chunks("ab\ncdef\ngh", 8), vec!["ab\ncdef\n", "gh"]);
+        assert_eq!(split_chunks("abcdefgh", 3), vec!["abc", "def", "gh"]);
+        // "é" is two bytes; a 3-byte limit must not split it.
+        assert_eq!(split_chunks("aéé", 3), vec!["aé", "é"]);
+        assert!(split_chunks("", 10).is_empty());
+    }
+
     #[test]
     fn test_slack_message_thread_key() {
         let msg = SlackMessage {
@@ -1,8 +1,9 @@
 #![allow(dead_code)]
 
 use anyhow::Result;
+use std::cell::{Cell, Ref, RefCell};
 use std::collections::{HashMap, HashSet};
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 use std::sync::Arc;
 use std::time::Instant;
 
@@ -11,7 +12,11 @@ use crate::ea::{self, EaId, EaInfo};
 use crate::memory;
 use crate::projects::{self, Project};
 use crate::scheduler::{ScheduledEvent, Scheduler, TickerBuffer};
-use crate::tmux::{HealthChecker, HealthState, Session, TmuxClient};
+use crate::state_store;
+use crate::state_watch::LoadedFrom;
+use crate::tmux::{HealthChecker, HealthState, OutputLog, Session, TmuxClient};
+use crate::ui::PreviewText;
+use crate::warm_pool::{self, PoolTarget};
 use crate::DASHBOARD_SESSION;
 
 /// What kind of confirmation the user is being prompted for.
@@ -56,11 +61,45 @@ pub struct CommandTreeNode {
     pub is_last_sibling: bool,
     /// For each ancestor depth, whether that ancestor was the last sibling.
     /// Used to decide whether to draw "│" or " " for vertical continuation lines.
-    pub ancestor_is_last: Vec<bool>,
+    pub ancestor_is_last: AncestorFlags,
     /// Whether this node came from a non-canonical OMAR session name.
     pub is_unresolved: bool,
 }
 
+/// One "was the last sibling" bit per ancestor depth, so tree nodes carry
+/// no per-node allocation. Depths past 64 read as last siblings, which only
+/// drops their continuation lines.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct AncestorFlags(u64);
+
+impl AncestorFlags {
+    /// These flags with the ancestor at `depth` marked.
+    pub fn with(self, depth: usize, is_last: bool) -> Self {
+        match 1u64.checked_shl(depth as u32) {
+            Some(bit) if is_last => Self(self.0 | bit),
+            Some(bit) => Self(self.0 & !bit),
+            None => self,
+        }
+    }
+
+    /// Whether the ancestor at `depth` was the last sibling.
+    pub fn is_last(self, depth: usize) -> bool {
+        1u64.checked_shl(depth as u32)
+            .is_none_or(|bit| self.0 & bit != 0)
+    }
+}
+
+/// What one EA's subtree was built from, minus health. While it is
+/// unchanged between refreshes the tree is patched instead of rebuilt.
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct TreeShape {
+    ea_id: EaId,
+    ea_name: String,
+    has_manager: bool,
+    /// Session names in build order, with their unresolved flag.
+    agents: Vec<(String, bool)>,
+}
+
 /// Application state
 pub struct App {
     // EA fields
@@ -95,6 +134,9 @@ pub struct App {
     pub scheduled_events: Vec<ScheduledEvent>,
     pub ticker: TickerBuffer,
     pub ticker_offset: usize,
+    /// Set by the last render when the quote or ticker was scrolling, so
+    /// the scroll tick knows whether a redraw would change anything.
+    pub ticker_scrolling: Cell<bool>,
     pub quote_index: usize,
     pub quote_order: Vec<usize>,
     pub show_debug_console: bool,
@@ -113,6 +155,24 @@ pub struct App {
     pub focus_child_indices: Vec<usize>,
     agent_parents: HashMap<String, String>,
     worker_tasks: HashMap<String, String>,
+    /// Stamps of the state files behind `registered_eas`, `projects`,
+    /// `agent_parents` and `worker_tasks`, so refresh skips unchanged ones.
+    registry_file: LoadedFrom,
+    projects_file: LoadedFrom,
+    parents_file: LoadedFrom,
+    worker_tasks_file: LoadedFrom,
+    /// Parent mappings of every registered EA, for the multi-EA tree.
+    ea_parents: HashMap<EaId, (LoadedFrom, HashMap<String, String>)>,
+    tree_shape: Vec<TreeShape>,
+    /// Set when a refresh changed something the dashboard shows.
+    needs_redraw: bool,
+    /// Pane `#{window_activity}` by session, from the last refresh.
+    pane_activity: HashMap<String, i64>,
+    /// When refresh last swept the output logs (see
+    /// [`crate::tmux::sweep_output_logs`]).
+    output_swept_at: Option<Instant>,
+    /// The focus pane's last parsed capture (see [`App::focus_parent_preview`]).
+    focus_preview: RefCell<Option<PanePreview>>,
     /// Whether the left sidebar is focused (vs the right agent panels)
     pub sidebar_focused: bool,
     /// Which sidebar panel is active
@@ -122,6 +182,8 @@ pub struct App {
     health_threshold: i64,
     default_command: String,
     default_workdir: String,
+    /// Backend every EA's agent records are kept on (`[state] backend`).
+    state_backend: state_store::Backend,
     pub scheduler: Arc<Scheduler>,
 }
 
@@ -157,6 +219,12 @@ impl App {
 
         let state_dir = ea::ea_state_dir(active_ea, &omar_dir);
         std::fs::create_dir_all(state_dir.join("status")).ok();
+        for ea_info in &registered_eas {
+            let ea_state_dir = ea::ea_state_dir(ea_info.id, &omar_dir);
+            if let Err(e) = state_store::select_backend(&ea_state_dir, config.state.backend) {
+                eprintln!("warn: migrate state of EA {}: {:#}", ea_info.id, e);
+            }
+        }
 
         Self {
             active_ea,
@@ -186,6 +254,7 @@ impl App {
             scheduled_events: Vec::new(),
             ticker,
             ticker_offset: 0,
+            ticker_scrolling: Cell::new(false),
             quote_index: 0,
             quote_order: {
                 // Shuffle quote indices using time-seeded LCG
@@ -212,6 +281,16 @@ impl App {
             focus_child_indices: Vec::new(),
             agent_parents: HashMap::new(),
             worker_tasks: HashMap::new(),
+            registry_file: LoadedFrom::default(),
+            projects_file: LoadedFrom::default(),
+            parents_file: LoadedFrom::default(),
+            worker_tasks_file: LoadedFrom::default(),
+            ea_parents: HashMap::new(),
+            tree_shape: Vec::new(),
+            needs_redraw: true,
+            pane_activity: HashMap::new(),
+            output_swept_at: None,
+            focus_preview: RefCell::new(None),
             sidebar_focused: false,
             sidebar_panel: SidebarPanel::Projects,
             client,
@@ -219,6 +298,7 @@ impl App {
             health_threshold: config.health.idle_warning,
             default_command: config.agent.default_command.clone(),
             default_workdir: config.agent.default_workdir.clone(),
+            state_backend: config.state.backend,
             scheduler,
         }
     }
@@ -233,6 +313,60 @@ impl App {
         ea::ea_manager_session(self.active_ea, &self.base_prefix)
     }
 
+    /// Queue a memory.md rewrite from the dashboard's current view. The
+    /// agent list is cloned now; the manager pane capture and the write
+    /// happen on the background memory writer.
+    pub fn queue_memory_write(
+        &self,
+        state_dir: &Path,
+        manager: Option<AgentInfo>,
+        manager_session: String,
+        events: Vec<ScheduledEvent>,
+    ) {
+        let snapshot = memory::MemorySnapshot {
+            agents: self.agents.clone(),
+            manager,
+            manager_session,
+            client: self.client.clone(),
+            events,
+        };
+        memory::queue_memory_write(state_dir, move || snapshot);
+    }
+
+    /// Keep each registered EA's warm pool at the size `[warm_pool]` asks
+    /// for. Warm sessions launch with the same MCP context as the EA's
+    /// manager, in the default workdir spawns use unless told otherwise.
+    pub fn maintain_warm_pool(&self) -> Result<usize> {
+        if self.config.warm_pool.is_empty() {
+            return Ok(0);
+        }
+        let mut targets = Vec::new();
+        for (backend, &size) in &self.config.warm_pool {
+            let Ok(base_command) = crate::config::resolve_backend(backend) else {
+                continue;
+            };
+            targets.extend(self.registered_eas.iter().map(|ea| PoolTarget {
+                ea_id: ea.id,
+                base_command: base_command.clone(),
+                size,
+            }));
+        }
+        warm_pool::reconcile(
+            &self.base_prefix,
+            &self.default_workdir,
+            &targets,
+            |ea_id| crate::manager::McpLaunchContext {
+                omar_dir: self.omar_dir.clone(),
+                ea_id,
+                session_prefix: self.base_prefix.clone(),
+                default_command: self.default_command.clone(),
+                default_workdir: self.default_workdir.clone(),
+                health_idle_warning: self.health_threshold,
+                tmux_server: crate::manager::current_tmux_server(),
+            },
+        )
+    }
+
     fn active_session_prefix(&self) -> String {
         ea::ea_prefix(self.active_ea, &self.base_prefix)
     }
@@ -261,10 +395,21 @@ impl App {
         &self.client
     }
 
-    /// Refresh the list of agents (scoped to active EA)
+    /// Refresh the list of agents (scoped to active EA).
+    ///
+    /// Runs every dashboard tick while holding the shared `App` lock, so it
+    /// only does the work the tick actually needs: state files are
+    /// re-parsed only when their stamp changed, and the chain-of-command
+    /// tree is rebuilt only when its shape (EAs, sessions, parents) changed;
+    /// otherwise health is patched into the existing nodes. Sets the redraw
+    /// flag (see [`App::take_redraw`]) when anything visible changed.
     pub fn refresh(&mut self) -> Result<()> {
+        let _timer = crate::metrics::REFRESH.start_timer();
         self.apply_dashboard_launch_handoff()?;
-        self.registered_eas = ea::load_registry(&self.omar_dir);
+        if self.registry_file.stale(&ea::registry_path(&self.omar_dir)) {
+            self.registered_eas = ea::load_registry(&self.omar_dir);
+            self.needs_redraw = true;
+        }
 
         // Pick up out-of-band EA switches (e.g. via the MCP `switch_ea` tool)
         // that mutated `~/.omar/active_ea` while the dashboard was running.
@@ -280,28 +425,31 @@ impl App {
         // Ensure manager exists
         self.ensure_manager()?;
 
-        // Get all sessions (used for both active EA state and multi-EA CoC sidebar)
-        let all_sessions = self.client.list_all_sessions()?;
-        // Only snapshot health for OMAR-owned sessions. Every EA session name
-        // starts with `base_prefix` (e.g. "omar-agent-") and the manager is
-        // `<base_prefix>ea-<id>` — so the prefix check covers both agents and
-        // managers across all EAs. This avoids running a tmux `capture-pane`
-        // per unrelated shell session on hosts where the user has many tmux
-        // sessions for their own work.
+        // Snapshot all sessions in one tmux round-trip (used for both active
+        // EA state and multi-EA CoC sidebar). Every EA session name starts
+        // with `base_prefix` (e.g. "omar-agent-") and the manager is
+        // `<base_prefix>ea-<id>` — so the prefix covers both agents and
+        // managers across all EAs and leaves out the user's own sessions.
+        // Health comes from the snapshot's activity, so no per-session
+        // capture is needed.
+        let snapshots = self.client.snapshot_all(&self.base_prefix, 0)?;
         let mut health_snapshot: HashMap<String, HealthState> = HashMap::new();
-        for session in &all_sessions {
-            if !self.base_prefix.is_empty() && !session.name.starts_with(&self.base_prefix) {
-                continue;
-            }
+        for snapshot in &snapshots {
             health_snapshot.insert(
-                session.name.clone(),
-                self.health_checker.check(&session.name),
+                snapshot.session.name.clone(),
+                self.health_checker.check_snapshot(snapshot),
             );
         }
+        self.pane_activity = snapshots
+            .iter()
+            .map(|snapshot| (snapshot.session.name.clone(), snapshot.pane_activity))
+            .collect();
+        let all_sessions: Vec<Session> = snapshots.into_iter().map(|s| s.session).collect();
+        self.sweep_output_logs(&all_sessions);
 
-        let mut managers_by_ea: HashMap<EaId, Session> = HashMap::new();
-        let mut agents_by_ea: HashMap<EaId, Vec<Session>> = HashMap::new();
-        let mut unresolved_sessions: Vec<Session> = Vec::new();
+        let mut managers_by_ea: HashMap<EaId, &Session> = HashMap::new();
+        let mut agents_by_ea: HashMap<EaId, Vec<&Session>> = HashMap::new();
+        let mut unresolved_sessions: Vec<&Session> = Vec::new();
         for session in &all_sessions {
             if session.name == DASHBOARD_SESSION
                 || (!self.base_prefix.is_empty() && !session.name.starts_with(&self.base_prefix))
@@ -310,155 +458,171 @@ impl App {
             }
             match parse_ea_session_owner(&session.name, &self.base_prefix) {
                 Some(ParseSessionOwner::Manager(ea_id)) => {
-                    managers_by_ea.insert(ea_id, session.clone());
+                    managers_by_ea.insert(ea_id, session);
                 }
                 Some(ParseSessionOwner::Worker(ea_id)) => {
-                    agents_by_ea.entry(ea_id).or_default().push(session.clone());
+                    agents_by_ea.entry(ea_id).or_default().push(session);
                 }
                 Some(ParseSessionOwner::Unresolved) => {
-                    unresolved_sessions.push(session.clone());
+                    unresolved_sessions.push(session);
                 }
                 None => {}
             }
         }
 
-        let unresolved_names: HashSet<String> = unresolved_sessions
-            .iter()
-            .map(|session| session.name.clone())
-            .collect();
-
         // Update manager info
-        self.manager = managers_by_ea.get(&self.active_ea).cloned().map(|session| {
-            let health = health_snapshot
-                .get(&session.name)
-                .copied()
-                .unwrap_or_else(|| self.health_checker.check(&session.name));
-            AgentInfo {
-                session,
-                health,
-                is_unresolved: false,
-            }
-        });
+        let manager = managers_by_ea
+            .get(&self.active_ea)
+            .map(|session| agent_info(&mut self.health_checker, &health_snapshot, session, false));
 
         // Update agents list.
         // NOTE: We intentionally include attached sessions. When a user opens
         // the popup view (tmux display-popup + attach), the agent session
         // becomes "attached" but is still a valid agent. Filtering attached
         // sessions would cause the API to return "not found" for that agent.
-        let mut active_agents = agents_by_ea
+        let checker = &mut self.health_checker;
+        let mut agents: Vec<AgentInfo> = agents_by_ea
             .get(&self.active_ea)
-            .cloned()
-            .unwrap_or_default();
-        active_agents.extend(unresolved_sessions.clone());
-        self.agents = active_agents
             .into_iter()
-            .map(|session| {
-                let health = health_snapshot
-                    .get(&session.name)
-                    .copied()
-                    .unwrap_or_else(|| self.health_checker.check(&session.name));
-                let is_unresolved = unresolved_names.contains(&session.name);
-                AgentInfo {
-                    session,
-                    health,
-                    is_unresolved,
-                }
-            })
+            .flatten()
+            .map(|session| (*session, false))
+            .chain(unresolved_sessions.iter().map(|session| (*session, true)))
+            .map(|(session, unresolved)| agent_info(checker, &health_snapshot, session, unresolved))
             .collect();
 
         // Clean up stale frame data for sessions that no longer exist
-        let active: Vec<String> = self
-            .agents
+        let active: Vec<String> = agents
             .iter()
             .map(|a| a.session.name.clone())
-            .chain(self.manager.iter().map(|m| m.session.name.clone()))
+            .chain(manager.iter().map(|m| m.session.name.clone()))
             .collect();
         self.health_checker.retain_sessions(&active);
 
         // Apply filter if set
         if !self.filter.is_empty() {
             let filter = self.filter.to_lowercase();
-            self.agents
-                .retain(|a| a.session.name.to_lowercase().contains(&filter));
+            agents.retain(|a| a.session.name.to_lowercase().contains(&filter));
         }
 
-        // Reload projects from EA-scoped file (picks up API-side changes)
-        let state_dir = self.state_dir();
-        self.projects = projects::load_projects_from(&state_dir);
+        if !same_agents(self.manager.as_slice(), manager.as_slice())
+            || !same_agents(&self.agents, &agents)
+        {
+            self.needs_redraw = true;
+        }
+        self.manager = manager;
+        self.agents = agents;
 
-        // Load parent mappings, worker tasks, and build the chain-of-command tree
-        self.agent_parents = memory::load_agent_parents_from(&state_dir);
-        self.worker_tasks = memory::load_worker_tasks_from(&state_dir);
+        // Reload projects, parent mappings and worker tasks from the
+        // EA-scoped files when they changed (picks up API-side changes).
+        let state_dir = self.state_dir();
+        if self
+            .projects_file
+            .stale(&projects::projects_path_in(&state_dir))
+        {
+            self.projects = projects::load_projects_from(&state_dir);
+            self.needs_redraw = true;
+        }
+        if self
+            .parents_file
+            .stale(&memory::agent_parents_path(&state_dir))
+        {
+            self.agent_parents = memory::load_agent_parents_from(&state_dir);
+            self.needs_redraw = true;
+        }
+        if self
+            .worker_tasks_file
+            .stale(&memory::worker_tasks_path(&state_dir))
+        {
+            self.worker_tasks = memory::load_worker_tasks_from(&state_dir);
+            self.needs_redraw = true;
+        }
 
         // Build multi-EA CoC: all EAs sorted by ID, each with its real subtree and health.
-
-        let mut sorted_eas = self.registered_eas.clone();
+        let mut sorted_eas: Vec<&EaInfo> = self.registered_eas.iter().collect();
         sorted_eas.sort_by_key(|e| e.id);
 
-        let mut all_nodes: Vec<CommandTreeNode> = Vec::new();
+        let mut parents_changed = false;
+        self.ea_parents
+            .retain(|id, _| sorted_eas.iter().any(|e| e.id == *id));
         for ea_info in &sorted_eas {
-            let ea_prefix = ea::ea_prefix(ea_info.id, &self.base_prefix);
-            let ea_manager = ea::ea_manager_session(ea_info.id, &self.base_prefix);
             let ea_state_dir = ea::ea_state_dir(ea_info.id, &self.omar_dir);
-            let ea_parents = memory::load_agent_parents_from(&ea_state_dir);
-
-            let manager_info = managers_by_ea.get(&ea_info.id).cloned().map(|session| {
-                let health = health_snapshot
-                    .get(&session.name)
-                    .copied()
-                    .unwrap_or_else(|| self.health_checker.check(&session.name));
-                AgentInfo {
-                    session,
-                    health,
-                    is_unresolved: false,
-                }
-            });
-            let ea_agents: Vec<AgentInfo> = agents_by_ea
-                .get(&ea_info.id)
-                .cloned()
-                .unwrap_or_default()
-                .into_iter()
-                .map(|session| {
-                    let health = health_snapshot
-                        .get(&session.name)
-                        .copied()
-                        .unwrap_or_else(|| self.health_checker.check(&session.name));
-                    AgentInfo {
-                        session: session.clone(),
-                        health,
-                        is_unresolved: unresolved_names.contains(&session.name)
-                            && ea_info.id == self.active_ea,
-                    }
-                })
-                .collect();
-            let mut ea_agents = ea_agents;
-            if ea_info.id == self.active_ea {
-                ea_agents.extend(unresolved_sessions.iter().cloned().map(|session| {
-                    let health = health_snapshot
-                        .get(&session.name)
-                        .copied()
-                        .unwrap_or_else(|| self.health_checker.check(&session.name));
-                    AgentInfo {
-                        session,
-                        health,
-                        is_unresolved: true,
-                    }
-                }));
+            let (file, parents) = self.ea_parents.entry(ea_info.id).or_default();
+            if file.stale(&memory::agent_parents_path(&ea_state_dir)) {
+                *parents = memory::load_agent_parents_from(&ea_state_dir);
+                parents_changed = true;
             }
+        }
 
-            let mut nodes = build_tree(
-                &ea_agents,
-                manager_info.as_ref(),
-                &ea_parents,
-                &ea_prefix,
-                &ea_manager,
-            );
-            if let Some(root) = nodes.first_mut() {
-                root.name = ea_info.name.clone();
+        let shape: Vec<TreeShape> = sorted_eas
+            .iter()
+            .map(|ea_info| {
+                let is_active = ea_info.id == self.active_ea;
+                TreeShape {
+                    ea_id: ea_info.id,
+                    ea_name: ea_info.name.clone(),
+                    has_manager: managers_by_ea.contains_key(&ea_info.id),
+                    agents: agents_by_ea
+                        .get(&ea_info.id)
+                        .into_iter()
+                        .flatten()
+                        .map(|session| (session.name.clone(), false))
+                        .chain(
+                            unresolved_sessions
+                                .iter()
+                                .filter(|_| is_active)
+                                .map(|session| (session.name.clone(), true)),
+                        )
+                        .collect(),
+                }
+            })
+            .collect();
+
+        if parents_changed || shape != self.tree_shape {
+            let mut all_nodes: Vec<CommandTreeNode> = Vec::new();
+            for ea_info in &sorted_eas {
+                let ea_prefix = ea::ea_prefix(ea_info.id, &self.base_prefix);
+                let ea_manager = ea::ea_manager_session(ea_info.id, &self.base_prefix);
+                let is_active = ea_info.id == self.active_ea;
+
+                let manager_info = managers_by_ea.get(&ea_info.id).map(|session| {
+                    agent_info(&mut self.health_checker, &health_snapshot, session, false)
+                });
+                let checker = &mut self.health_checker;
+                let ea_agents: Vec<AgentInfo> = agents_by_ea
+                    .get(&ea_info.id)
+                    .into_iter()
+                    .flatten()
+                    .map(|session| (*session, false))
+                    .chain(
+                        unresolved_sessions
+                            .iter()
+                            .filter(|_| is_active)
+                            .map(|session| (*session, true)),
+                    )
+                    .map(|(session, unresolved)| {
+                        agent_info(checker, &health_snapshot, session, unresolved)
+                    })
+                    .collect();
+
+                let ea_parents = self.ea_parents.get(&ea_info.id).map(|(_, parents)| parents);
+                let mut nodes = build_tree(
+                    &ea_agents,
+                    manager_info.as_ref(),
+                    ea_parents.unwrap_or(&HashMap::new()),
+                    &ea_prefix,
+                    &ea_manager,
+                );
+                if let Some(root) = nodes.first_mut() {
+                    root.name = ea_info.name.clone();
+                }
+                all_nodes.extend(nodes);
             }
-            all_nodes.extend(nodes);
+            self.command_tree = all_nodes;
+            self.tree_shape = shape;
+            self.needs_redraw = true;
+        } else if patch_tree_health(&mut self.command_tree, &health_snapshot) {
+            self.needs_redraw = true;
         }
-        self.command_tree = all_nodes;
 
         // Recompute focus children indices
         self.focus_child_indices = self.compute_focus_child_indices();
@@ -474,6 +638,34 @@ impl App {
         Ok(())
     }
 
+    /// Trim every EA's output logs and drop those of sessions that are gone,
+    /// at most once per [`crate::tmux::OUTPUT_SWEEP_INTERVAL`].
+    fn sweep_output_logs(&mut self, sessions: &[Session]) {
+        if self
+            .output_swept_at
+            .is_some_and(|at| at.elapsed() < crate::tmux::OUTPUT_SWEEP_INTERVAL)
+        {
+            return;
+        }
+        self.output_swept_at = Some(Instant::now());
+        let live: HashSet<&str> = sessions.iter().map(|s| s.name.as_str()).collect();
+        let mut ea_ids: Vec<EaId> = self.registered_eas.iter().map(|e| e.id).collect();
+        if !ea_ids.contains(&self.active_ea) {
+            ea_ids.push(self.active_ea);
+        }
+        for ea_id in ea_ids {
+            crate::tmux::sweep_output_logs(&ea::ea_state_dir(ea_id, &self.omar_dir), &live);
+        }
+    }
+
+    /// Whether the dashboard needs to redraw for state changes since the
+    /// last call. Only the periodic tick consults this; keys and resizes
+    /// always redraw, and ticker scrolling redraws when something scrolls
+    /// or the focus pane has new output.
+    pub fn take_redraw(&mut self) -> bool {
+        std::mem::take(&mut self.needs_redraw)
+    }
+
     fn apply_dashboard_launch_handoff(&mut self) -> Result<()> {
         let Some(handoff) = ea::take_dashboard_launch_handoff(&self.omar_dir) else {
             return Ok(());
@@ -485,9 +677,13 @@ impl App {
         // backend's in-memory conversation for nothing.
         let backend_changed = self.default_command != handoff.default_command;
 
-        self.config.agent.default_command = handoff.default_command.clone();
+        // An invocation that hadn't detected a backend yet hands over an
+        // empty command; keep ours rather than forget it.
+        if !handoff.default_command.is_empty() {
+            self.config.agent.default_command = handoff.default_command.clone();
+            self.default_command = handoff.default_command;
+        }
         self.config.agent.default_workdir = handoff.default_workdir.clone();
-        self.default_command = handoff.default_command;
         self.default_workdir = handoff.default_workdir;
         self.activate_ea_local(handoff.active_ea)?;
         ea::save_active_ea(&self.omar_dir, handoff.active_ea)?;
@@ -522,6 +718,11 @@ impl App {
             let _ = self.client.kill_session(&manager_session);
         }
 
+        // Backend detection is still running; it refreshes once it lands.
+        if self.default_command.is_empty() {
+            return Ok(());
+        }
+
         // Reload registry on cache miss so we have the latest EA names
         self.registered_eas = ea::load_registry(&self.omar_dir);
 
@@ -587,17 +788,20 @@ impl App {
 
         let state_dir = self.state_dir();
         let events = self.scheduler.list_by_ea(self.active_ea);
-        memory::write_memory_to(
-            &state_dir,
-            &self.agents,
-            None,
-            &manager_session,
-            &self.client,
-            &events,
-        );
+        self.queue_memory_write(&state_dir, None, manager_session, events);
         Ok(())
     }
 
+    /// Adopt the background-detected backend unless one was chosen while
+    /// the probe ran (`-a` handoff).
+    pub fn set_detected_default_command(&mut self, command: String) {
+        if self.default_command.is_empty() {
+            self.config.agent.default_command = command.clone();
+            self.default_command = command;
+            self.needs_redraw = true;
+        }
+    }
+
     /// Get default command
     pub fn default_command(&self) -> &str {
         &self.default_command
@@ -613,6 +817,11 @@ impl App {
         let manager_session = self.manager_session_name();
         let mut indices = Vec::new();
         if self.focus_parent == manager_session {
+            let live: HashSet<&str> = self
+                .agents
+                .iter()
+                .map(|a| a.session.name.as_str())
+                .collect();
             // Root view: show agents that are direct children of EA, plus orphans
             for (i, agent) in self.agents.iter().enumerate() {
                 let parent = self.agent_parents.get(&agent.session.name);
@@ -620,7 +829,7 @@ impl App {
                     // Explicit child of EA (manager session)
                     Some(p) if *p == manager_session => indices.push(i),
                     // Has a live parent that is NOT the EA → belongs deeper in the tree
-                    Some(p) if self.agents.iter().any(|a| a.session.name == *p) => {}
+                    Some(p) if live.contains(p.as_str()) => {}
                     // Parent is dead or missing → show as orphan at root
                     _ => indices.push(i),
                 }
@@ -916,21 +1125,15 @@ impl App {
             // main-loop handler also cancels; this keeps kill_selected
             // self-contained for any other caller).
             self.scheduler
-                .cancel_by_receiver_and_ea(&short_name, self.active_ea);
+                .cancel_by_receiver_and_ea(&short_name, self.active_ea)?;
 
             self.client.kill_session(&name)?;
             memory::remove_agent_parent_in(&state_dir, &name);
+            let _ = std::fs::remove_dir_all(crate::tmux::output_log_dir(&state_dir, &name));
             self.status_message = Some(format!("Killed agent: {}", name));
             self.refresh()?;
             let events = self.scheduler.list_by_ea(self.active_ea);
-            memory::write_memory_to(
-                &state_dir,
-                &self.agents,
-                self.manager.as_ref(),
-                &manager_session,
-                &self.client,
-                &events,
-            );
+            self.queue_memory_write(&state_dir, self.manager.clone(), manager_session, events);
         }
         self.pending_confirm = None;
         Ok(())
@@ -950,6 +1153,9 @@ impl App {
 
     /// Spawn a new agent with default settings
     pub fn spawn_agent(&mut self) -> Result<()> {
+        if self.config.agent.default_command.is_empty() {
+            anyhow::bail!("Still detecting agent backends");
+        }
         // Refresh first to get current state
         self.refresh()?;
 
@@ -968,7 +1174,7 @@ impl App {
                 self.refresh()?;
                 continue;
             }
-            match self.client.new_session(
+            match self.client.new_agent_session(
                 &candidate,
                 &self.config.agent.default_command,
                 Some(&workdir),
@@ -1004,14 +1210,7 @@ impl App {
 
         let manager_session = self.manager_session_name();
         let events = self.scheduler.list_by_ea(self.active_ea);
-        memory::write_memory_to(
-            &state_dir,
-            &self.agents,
-            self.manager.as_ref(),
-            &manager_session,
-            &self.client,
-            &events,
-        );
+        self.queue_memory_write(&state_dir, self.manager.clone(), manager_session, events);
 
         Ok(())
     }
@@ -1095,6 +1294,52 @@ impl App {
         self.client.capture_pane(&self.focus_parent, lines)
     }
 
+    /// The last `lines` of the focus pane, as parsed by `parse`. The pane is
+    /// recaptured and reparsed only when it has produced output since the
+    /// previous call, so redrawing an unchanged dashboard costs no tmux
+    /// round-trip.
+    pub fn focus_parent_preview(
+        &self,
+        lines: i32,
+        parse: impl FnOnce(&str) -> PreviewText,
+    ) -> Ref<'_, PreviewText> {
+        let key = self.preview_key(&self.focus_parent, lines);
+        let fresh = self
+            .focus_preview
+            .borrow()
+            .as_ref()
+            .is_some_and(|preview| preview.shows(&key));
+        if !fresh {
+            let settled = key.activity.is_some_and(|activity| unix_secs() > activity);
+            let output = self.get_focus_parent_output(lines).unwrap_or_default();
+            *self.focus_preview.borrow_mut() = Some(PanePreview {
+                key,
+                settled,
+                text: parse(&output),
+            });
+        }
+        Ref::map(self.focus_preview.borrow(), |preview| {
+            &preview.as_ref().expect("preview stored above").text
+        })
+    }
+
+    /// Whether the focus pane has output its last preview doesn't show.
+    pub fn focus_preview_stale(&self) -> bool {
+        self.focus_preview.borrow().as_ref().is_some_and(|preview| {
+            !preview.shows(&self.preview_key(&preview.key.session, preview.key.lines))
+        })
+    }
+
+    fn preview_key(&self, session: &str, lines: i32) -> PreviewKey {
+        let log = OutputLog::new(crate::tmux::output_log_dir(&self.state_dir(), session));
+        PreviewKey {
+            session: session.to_string(),
+            lines,
+            activity: self.pane_activity.get(session).copied(),
+            log_end: log.end_offset(),
+        }
+    }
+
     /// Get agent pane output by session name
     pub fn get_agent_output(&self, session: &str, lines: i32) -> Result<String> {
         self.client.capture_pane(session, lines)
@@ -1107,14 +1352,7 @@ impl App {
         self.projects = projects::load_projects_from(&state_dir);
         let manager_session = self.manager_session_name();
         let events = self.scheduler.list_by_ea(self.active_ea);
-        memory::write_memory_to(
-            &state_dir,
-            &self.agents,
-            self.manager.as_ref(),
-            &manager_session,
-            &self.client,
-            &events,
-        );
+        self.queue_memory_write(&state_dir, self.manager.clone(), manager_session, events);
     }
 
     /// Complete (remove) a project by id and update memory (EA-scoped)
@@ -1142,14 +1380,7 @@ impl App {
         self.projects = projects::load_projects_from(&state_dir);
         let manager_session = self.manager_session_name();
         let events = self.scheduler.list_by_ea(self.active_ea);
-        memory::write_memory_to(
-            &state_dir,
-            &self.agents,
-            self.manager.as_ref(),
-            &manager_session,
-            &self.client,
-            &events,
-        );
+        self.queue_memory_write(&state_dir, self.manager.clone(), manager_session, events);
     }
 
     // ── Multi-EA methods ──
@@ -1198,6 +1429,8 @@ impl App {
 
         let state_dir = ea::ea_state_dir(ea_id, &self.omar_dir);
         std::fs::create_dir_all(&state_dir).ok();
+        // EAs created since startup weren't migrated with the rest.
+        state_store::select_backend(&state_dir, self.state_backend)?;
         Ok(())
     }
 
@@ -1306,6 +1539,7 @@ impl App {
         for session_name in &sessions_to_delete {
             ea_client.kill_session(session_name)?;
         }
+        warm_pool::drain(&self.base_prefix, ea_id);
 
         // Remove state directory
         let state_dir = ea::ea_state_dir(ea_id, &self.omar_dir);
@@ -1319,7 +1553,7 @@ impl App {
         }
         crate::manager::remove_omar_antigravity_mcp_config(ea_id)?;
 
-        let events_cancelled = self.scheduler.cancel_by_ea(ea_id);
+        let events_cancelled = self.scheduler.cancel_by_ea(ea_id)?;
 
         // Unregister EA
         ea::unregister_ea(&self.omar_dir, ea_id)?;
@@ -1348,6 +1582,108 @@ impl App {
     }
 }
 
+/// State files the dashboard refreshes on: the EA registry, `active_ea`,
+/// the launch handoff, and each EA's projects, parents, worker tasks and
+/// status directory (whose stamp moves when a status file is replaced).
+pub fn watched_state_files(omar_dir: &Path) -> Vec<PathBuf> {
+    let mut paths = vec![
+        ea::registry_path(omar_dir),
+        ea::active_ea_path(omar_dir),
+        ea::dashboard_handoff_path(omar_dir),
+    ];
+    let ea_dirs = std::fs::read_dir(omar_dir.join("ea")).into_iter().flatten();
+    for entry in ea_dirs.flatten() {
+        if !entry.file_type().is_ok_and(|t| t.is_dir()) {
+            continue;
+        }
+        let state_dir = entry.path();
+        paths.push(state_dir.join("tasks.md"));
+        paths.push(memory::agent_parents_path(&state_dir));
+        paths.push(memory::worker_tasks_path(&state_dir));
+        paths.push(memory::agent_status_path(&state_dir));
+    }
+    paths
+}
+
+fn agent_info(
+    health_checker: &mut HealthChecker,
+    health_snapshot: &HashMap<String, HealthState>,
+    session: &Session,
+    is_unresolved: bool,
+) -> AgentInfo {
+    AgentInfo {
+        session: session.clone(),
+        health: health_snapshot
+            .get(&session.name)
+            .copied()
+            .unwrap_or_else(|| health_checker.check(&session.name)),
+        is_unresolved,
+    }
+}
+
+/// What a pane preview was captured from. New output shows up as a later
+/// activity second from the last refresh or, for panes with an output log,
+/// straight away as a longer log.
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct PreviewKey {
+    session: String,
+    lines: i32,
+    activity: Option<i64>,
+    log_end: u64,
+}
+
+/// A parsed capture of the focus pane.
+struct PanePreview {
+    key: PreviewKey,
+    /// Taken after the key's activity second had ended. tmux counts activity
+    /// in whole seconds, so output later in the same second leaves the key
+    /// as it was; an unsettled preview is retaken on the next call.
+    settled: bool,
+    text: PreviewText,
+}
+
+impl PanePreview {
+    fn shows(&self, key: &PreviewKey) -> bool {
+        self.settled && self.key == *key
+    }
+}
+
+fn unix_secs() -> i64 {
+    std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .map(|d| d.as_secs() as i64)
+        .unwrap_or(0)
+}
+
+/// Whether two agent lists render the same.
+fn same_agents(a: &[AgentInfo], b: &[AgentInfo]) -> bool {
+    a.len() == b.len()
+        && a.iter().zip(b).all(|(a, b)| {
+            a.session.name == b.session.name
+                && a.session.attached == b.session.attached
+                && a.health == b.health
+                && a.is_unresolved == b.is_unresolved
+        })
+}
+
+/// Update node health from `health` without rebuilding the tree. Sessions
+/// missing from the snapshot (an EA without a live manager) are Idle, as in
+/// `build_tree`. Returns true if any node changed.
+fn patch_tree_health(tree: &mut [CommandTreeNode], health: &HashMap<String, HealthState>) -> bool {
+    let mut changed = false;
+    for node in tree {
+        let current = health
+            .get(&node.session_name)
+            .copied()
+            .unwrap_or(HealthState::Idle);
+        if node.health != current {
+            node.health = current;
+            changed = true;
+        }
+    }
+    changed
+}
+
 /// Build the chain-of-command tree from current agents and parent mappings.
 ///
 /// Tree structure (recursive, arbitrary depth):
@@ -1373,22 +1709,23 @@ pub fn build_tree(
         health: ea_health,
         depth: 0,
         is_last_sibling: true,
-        ancestor_is_last: vec![],
+        ancestor_is_last: AncestorFlags::default(),
         is_unresolved: false,
     });
 
     // Build a children map: parent_session -> vec of child agents
-    let mut children_map: HashMap<String, Vec<&AgentInfo>> = HashMap::new();
+    let mut children_map: HashMap<&str, Vec<&AgentInfo>> = HashMap::new();
     let mut orphans: Vec<&AgentInfo> = Vec::new();
+    let live: HashSet<&str> = agents.iter().map(|a| a.session.name.as_str()).collect();
 
     for agent in agents {
         if let Some(parent_session) = agent_parents.get(&agent.session.name) {
             // Check that the parent actually exists (either as agent or EA)
-            let parent_exists = *parent_session == manager_session
-                || agents.iter().any(|a| a.session.name == *parent_session);
+            let parent_exists =
+                *parent_session == manager_session || live.contains(parent_session.as_str());
             if parent_exists {
                 children_map
-                    .entry(parent_session.clone())
+                    .entry(parent_session.as_str())
                     .or_default()
                     .push(agent);
             } else {
@@ -1406,10 +1743,10 @@ pub fn build_tree(
     #[allow(clippy::too_many_arguments)]
     fn add_children(
         nodes: &mut Vec<CommandTreeNode>,
-        children_map: &HashMap<String, Vec<&AgentInfo>>,
+        children_map: &HashMap<&str, Vec<&AgentInfo>>,
         parent_session: &str,
         depth: usize,
-        ancestor_is_last: &[bool],
+        ancestor_is_last: AncestorFlags,
         session_prefix: &str,
         total_siblings: usize,
         start_idx: usize,
@@ -1430,24 +1767,22 @@ pub fn build_tree(
                     health: child.health,
                     depth,
                     is_last_sibling: is_last,
-                    ancestor_is_last: ancestor_is_last.to_vec(),
+                    ancestor_is_last,
                     is_unresolved: child.is_unresolved,
                 });
 
                 // Recurse into this child's children
                 let grandchildren_count = children_map
-                    .get(&child.session.name)
+                    .get(child.session.name.as_str())
                     .map(|c| c.len())
                     .unwrap_or(0);
                 if grandchildren_count > 0 {
-                    let mut next_ancestors = ancestor_is_last.to_vec();
-                    next_ancestors.push(is_last);
                     add_children(
                         nodes,
                         children_map,
                         &child.session.name,
                         depth + 1,
-                        &next_ancestors,
+                        ancestor_is_last.with(depth, is_last),
                         session_prefix,
                         grandchildren_count,
                         0,
@@ -1464,7 +1799,7 @@ pub fn build_tree(
         &children_map,
         manager_session,
         1,
-        &[true], // EA is always last at depth 0
+        AncestorFlags::default().with(0, true), // EA is always last at depth 0
         session_prefix,
         total_root_children,
         0,
@@ -1485,13 +1820,13 @@ pub fn build_tree(
                 health: orphan.health,
                 depth: 1,
                 is_last_sibling: sibling_idx == total_root_children - 1,
-                ancestor_is_last: vec![true],
+                ancestor_is_last: AncestorFlags::default().with(0, true),
                 is_unresolved: orphan.is_unresolved,
             });
 
             // Orphans can also have children
             let child_count = children_map
-                .get(&orphan.session.name)
+                .get(orphan.session.name.as_str())
                 .map(|c| c.len())
                 .unwrap_or(0);
             if child_count > 0 {
@@ -1500,7 +1835,9 @@ pub fn build_tree(
                     &children_map,
                     &orphan.session.name,
                     2,
-                    &[true, sibling_idx == total_root_children - 1],
+                    AncestorFlags::default()
+                        .with(0, true)
+                        .with(1, sibling_idx == total_root_children - 1),
                     session_prefix,
                     child_count,
                     0,
@@ -1977,6 +2314,10 @@ mod tests {
             },
             metrics: MetricsConfig::default(),
             slack_bridge: crate::config::SlackBridgeConfig::default(),
+            scheduler: crate::config::SchedulerConfig::default(),
+            state: crate::config::StateConfig::default(),
+            warm_pool: Default::default(),
+            nodes: Vec::new(),
         }
     }
 
@@ -2179,16 +2520,18 @@ mod tests {
         let scheduler = Arc::new(Scheduler::with_store(scheduler::events_store_path(
             &omar_dir,
         )));
-        scheduler.insert(ScheduledEvent {
-            id: "persisted-event".to_string(),
-            sender: "ea".to_string(),
-            receiver: "worker".to_string(),
-            timestamp: 123,
-            payload: "wake later".to_string(),
-            created_at: 100,
-            recurring_ns: Some(5_000_000_000),
-            ea_id: 1,
-        });
+        scheduler
+            .insert(ScheduledEvent {
+                id: "persisted-event".to_string(),
+                sender: "ea".to_string(),
+                receiver: "worker".to_string(),
+                timestamp: 123,
+                payload: "wake later".to_string(),
+                created_at: 100,
+                recurring_ns: Some(5_000_000_000),
+                ea_id: 1,
+            })
+            .unwrap();
 
         let config = test_config_with_prefix(format!("omar-test-resume-{}-", uuid::Uuid::new_v4()));
         let app = App::new_with_omar_dir(
@@ -2297,16 +2640,18 @@ default_workdir = "."
         let scheduler = Arc::new(Scheduler::with_store(scheduler::events_store_path(
             &omar_dir,
         )));
-        scheduler.insert(ScheduledEvent {
-            id: "home-event".to_string(),
-            sender: "ea".to_string(),
-            receiver: "worker".to_string(),
-            timestamp: 456,
-            payload: "home wake".to_string(),
-            created_at: 123,
-            recurring_ns: None,
-            ea_id: 0,
-        });
+        scheduler
+            .insert(ScheduledEvent {
+                id: "home-event".to_string(),
+                sender: "ea".to_string(),
+                receiver: "worker".to_string(),
+                timestamp: 456,
+                payload: "home wake".to_string(),
+                created_at: 123,
+                recurring_ns: None,
+                ea_id: 0,
+            })
+            .unwrap();
 
         let config = Config::load(None).unwrap();
         let app = App::new(&config, TickerBuffer::new(), scheduler.clone());
@@ -2463,6 +2808,90 @@ default_workdir = "."
         assert_eq!(tree[1].depth, 1);
     }
 
+    #[test]
+    fn test_build_tree_packs_continuation_flags() {
+        // EA -> pm (not last, has a worker) and a last orphan.
+        let agents = vec![
+            make_agent("omar-agent-pm", HealthState::Running),
+            make_agent("omar-agent-worker", HealthState::Running),
+            make_agent("omar-agent-orphan", HealthState::Idle),
+        ];
+        let ea = make_agent(TEST_MANAGER, HealthState::Running);
+        let mut parents = HashMap::new();
+        parents.insert("omar-agent-pm".to_string(), TEST_MANAGER.to_string());
+        parents.insert("omar-agent-worker".to_string(), "omar-agent-pm".to_string());
+
+        let tree = build_tree(&agents, Some(&ea), &parents, "omar-agent-", TEST_MANAGER);
+
+        let worker = tree.iter().find(|n| n.name == "worker").unwrap();
+        assert_eq!(worker.depth, 2);
+        assert!(worker.ancestor_is_last.is_last(0), "the EA is always last");
+        assert!(
+            !worker.ancestor_is_last.is_last(1),
+            "pm has a sibling below"
+        );
+
+        let flags = AncestorFlags::default().with(3, true).with(70, false);
+        assert!(flags.is_last(3) && !flags.is_last(2));
+        assert!(flags.with(3, false) == AncestorFlags::default());
+        assert!(flags.is_last(70), "depths past 64 draw as last siblings");
+    }
+
+    #[test]
+    fn test_build_tree_handles_a_thousand_agents() {
+        let mut agents = Vec::new();
+        let mut parents = HashMap::new();
+        for pm in 0..10 {
+            let pm_name = format!("omar-agent-pm{}", pm);
+            parents.insert(pm_name.clone(), TEST_MANAGER.to_string());
+            agents.push(make_agent(&pm_name, HealthState::Running));
+            for worker in 0..100 {
+                let name = format!("omar-agent-pm{}-w{}", pm, worker);
+                parents.insert(name.clone(), pm_name.clone());
+                agents.push(make_agent(&name, HealthState::Idle));
+            }
+        }
+        let ea = make_agent(TEST_MANAGER, HealthState::Running);
+
+        let tree = build_tree(&agents, Some(&ea), &parents, "omar-agent-", TEST_MANAGER);
+
+        assert_eq!(tree.len(), 1 + 10 + 1000);
+        assert_eq!(tree.iter().filter(|n| n.depth == 2).count(), 1000);
+        assert!(tree.last().unwrap().is_last_sibling);
+    }
+
+    #[test]
+    fn patch_tree_health_matches_a_rebuild() {
+        let mut agents = vec![
+            make_agent("omar-agent-a", HealthState::Running),
+            make_agent("omar-agent-b", HealthState::Idle),
+        ];
+        let ea = make_agent(TEST_MANAGER, HealthState::Running);
+        let mut parents = HashMap::new();
+        parents.insert("omar-agent-b".to_string(), "omar-agent-a".to_string());
+        let mut tree = build_tree(&agents, Some(&ea), &parents, "omar-agent-", TEST_MANAGER);
+
+        let mut health: HashMap<String, HealthState> = [
+            (TEST_MANAGER.to_string(), HealthState::Running),
+            ("omar-agent-a".to_string(), HealthState::Running),
+            ("omar-agent-b".to_string(), HealthState::Idle),
+        ]
+        .into();
+        assert!(!patch_tree_health(&mut tree, &health));
+
+        health.insert("omar-agent-b".to_string(), HealthState::Running);
+        assert!(patch_tree_health(&mut tree, &health));
+        agents[1].health = HealthState::Running;
+        let rebuilt = build_tree(&agents, Some(&ea), &parents, "omar-agent-", TEST_MANAGER);
+        let healths = |t: &[CommandTreeNode]| t.iter().map(|n| n.health).collect::<Vec<_>>();
+        assert_eq!(healths(&tree), healths(&rebuilt));
+
+        // A manager that disappeared renders as Idle, like build_tree(None).
+        health.remove(TEST_MANAGER);
+        assert!(patch_tree_health(&mut tree, &health));
+        assert_eq!(tree[0].health, HealthState::Idle);
+    }
+
     // ── focus navigation tests ──
 
     #[test]
@@ -2989,6 +3418,53 @@ default_workdir = "."
     // EA pane normalizes to "ea" (not the session name `omar-agent-ea-N`,
     // which never appears in event payloads).
 
+    #[test]
+    fn focus_preview_is_reparsed_only_after_new_output() {
+        let dir = tempfile::tempdir().unwrap();
+        let config =
+            test_config_with_prefix(format!("omar-test-preview-{}-", uuid::Uuid::new_v4()));
+        let mut app = App::new_with_omar_dir(
+            &config,
+            TickerBuffer::new(),
+            Arc::new(Scheduler::new()),
+            dir.path().to_path_buf(),
+        );
+        let focus = app.focus_parent.clone();
+        let parses = Cell::new(0);
+        let parse = |_: &str| {
+            parses.set(parses.get() + 1);
+            PreviewText::default()
+        };
+
+        app.pane_activity.insert(focus.clone(), 100);
+        app.focus_parent_preview(20, parse);
+        app.focus_parent_preview(20, parse);
+        assert_eq!(parses.get(), 1, "unchanged pane reuses the preview");
+        assert!(!app.focus_preview_stale());
+
+        app.pane_activity.insert(focus.clone(), 101);
+        assert!(app.focus_preview_stale());
+        app.focus_parent_preview(20, parse);
+        app.focus_parent_preview(30, parse);
+        assert_eq!(parses.get(), 3, "new activity or a resize recaptures");
+
+        // Output logged by the pipe counts before the next refresh does.
+        let generation =
+            crate::tmux::output_log_dir(&app.state_dir(), &focus).join(format!("{:020}", 0));
+        std::fs::create_dir_all(&generation).unwrap();
+        std::fs::write(generation.join("caaaaaa"), "output").unwrap();
+        assert!(app.focus_preview_stale());
+        app.focus_parent_preview(30, parse);
+        assert_eq!(parses.get(), 4);
+
+        // A capture taken within the pane's latest activity second may miss
+        // output later in that second, so it isn't reused.
+        app.pane_activity.insert(focus, unix_secs() + 60);
+        app.focus_parent_preview(30, parse);
+        app.focus_parent_preview(30, parse);
+        assert_eq!(parses.get(), 6);
+    }
+
     #[test]
     fn popup_receiver_name_for_worker_strips_prefix() {
         let name =
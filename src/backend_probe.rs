@@ -1,11 +1,201 @@
+//! Backend CLI availability probes (`<binary> --version` under a timeout).
+//!
+//! Startup config detection and `list_backends` each need to know which of
+//! the five backends are installed. Probing them one after another cost up
+//! to five probe timeouts before the first frame on a host where one CLI
+//! hangs on `--version`, and every short-lived `omar mcp-server` paid it
+//! again. `backends_available` probes in parallel and caches results in
+//! `~/.omar/backend_probe.json`, keyed by the resolved binary path and
+//! its length and mtime, so an unchanged install is answered by a `stat`
+//! and an upgrade re-probes on its own. `cached_backends_available` answers
+//! from that cache alone, for callers that must not wait on a probe.
+
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
 use std::process::{Command, Stdio};
 use std::thread;
-use std::time::{Duration, Instant};
+use std::time::{Duration, Instant, UNIX_EPOCH};
+
+use serde::{Deserialize, Serialize};
+
+use crate::memory;
 
 pub(crate) const BACKEND_VERSION_PROBE_TIMEOUT: Duration = Duration::from_millis(1500);
 
-pub(crate) fn backend_version_probe_succeeds(binary: &str) -> bool {
-    command_succeeds_with_timeout(binary, &["--version"], BACKEND_VERSION_PROBE_TIMEOUT)
+/// Probe cache file name under the omar dir.
+pub(crate) const PROBE_CACHE_FILE: &str = "backend_probe.json";
+
+/// How long a failed probe is trusted for an unchanged binary. A success
+/// stays valid until the binary changes, but a failure can be transient
+/// (a CLI that hung on first-run setup, a network check), so it is retried
+/// after this long even if nothing on disk moved.
+const FAILED_PROBE_TTL_SECS: i64 = 600;
+
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+struct ProbeRecord {
+    len: u64,
+    modified_ns: u64,
+    available: bool,
+    probed_at: i64,
+}
+
+/// Resolved binary path → last probe of that exact file.
+type ProbeCache = HashMap<String, ProbeRecord>;
+
+/// Probe cache location backing `backends_available`. Tests never read or
+/// write the real `~/.omar`, so they probe fresh every time.
+fn probe_cache_path() -> Option<PathBuf> {
+    if cfg!(test) {
+        return None;
+    }
+    dirs::home_dir().map(|home| home.join(".omar").join(PROBE_CACHE_FILE))
+}
+
+/// Resolve `binary` the way `execvp` would: a name with a `/` is used as
+/// is, a bare name is searched on `PATH`. `None` means the spawn would fail
+/// anyway, so the backend is unavailable without running anything.
+fn resolve_executable(binary: &str) -> Option<PathBuf> {
+    if binary.contains('/') {
+        let path = PathBuf::from(binary);
+        return path.is_file().then_some(path);
+    }
+    let paths = std::env::var_os("PATH")?;
+    std::env::split_paths(&paths)
+        .map(|dir| dir.join(binary))
+        .find(|candidate| is_executable(candidate))
+}
+
+fn is_executable(path: &Path) -> bool {
+    let Ok(meta) = std::fs::metadata(path) else {
+        return false;
+    };
+    #[cfg(unix)]
+    {
+        use std::os::unix::fs::PermissionsExt;
+        meta.is_file() && meta.permissions().mode() & 0o111 != 0
+    }
+    #[cfg(not(unix))]
+    {
+        meta.is_file()
+    }
+}
+
+/// `(len, mtime)` of the file `path` resolves to, following symlinks so a
+/// package manager swapping the target behind a stable link is noticed.
+fn binary_stamp(path: &Path) -> Option<(u64, u64)> {
+    let meta = std::fs::metadata(path).ok()?;
+    let modified = meta.modified().ok()?.duration_since(UNIX_EPOCH).ok()?;
+    Some((meta.len(), u64::try_from(modified.as_nanos()).ok()?))
+}
+
+/// Whether each of `binaries` answers `--version` successfully, in order.
+/// Cached results are used where the binary is unchanged; the rest are
+/// probed concurrently, so the call takes at most one probe timeout.
+pub(crate) fn backends_available(binaries: &[&str]) -> Vec<bool> {
+    backends_available_with_cache(binaries, probe_cache_path().as_deref())
+}
+
+/// Like [`backends_available`], but answered from the cache alone, without
+/// running anything: `None` for each binary that would need a probe.
+pub(crate) fn cached_backends_available(binaries: &[&str]) -> Vec<Option<bool>> {
+    cached_backends_available_with_cache(binaries, probe_cache_path().as_deref())
+}
+
+/// A binary whose cached probe is missing or out of date.
+struct Miss {
+    path: PathBuf,
+    key: String,
+    len: u64,
+    modified_ns: u64,
+}
+
+/// The cached answer for `binary`, or what is needed to probe it.
+fn lookup(binary: &str, cache: &ProbeCache, now: i64) -> Result<bool, Miss> {
+    let Some(path) = resolve_executable(binary) else {
+        return Ok(false);
+    };
+    let Some((len, modified_ns)) = binary_stamp(&path) else {
+        return Ok(false);
+    };
+    let key = path.to_string_lossy().into_owned();
+    match cache.get(&key) {
+        Some(record)
+            if record.len == len
+                && record.modified_ns == modified_ns
+                && (record.available || now - record.probed_at < FAILED_PROBE_TTL_SECS) =>
+        {
+            Ok(record.available)
+        }
+        _ => Err(Miss {
+            path,
+            key,
+            len,
+            modified_ns,
+        }),
+    }
+}
+
+fn cached_backends_available_with_cache(
+    binaries: &[&str],
+    cache_path: Option<&Path>,
+) -> Vec<Option<bool>> {
+    let cache: ProbeCache = cache_path.and_then(memory::read_json).unwrap_or_default();
+    let now = chrono::Utc::now().timestamp();
+    binaries
+        .iter()
+        .map(|binary| lookup(binary, &cache, now).ok())
+        .collect()
+}
+
+fn backends_available_with_cache(binaries: &[&str], cache_path: Option<&Path>) -> Vec<bool> {
+    let mut cache: ProbeCache = cache_path.and_then(memory::read_json).unwrap_or_default();
+    let now = chrono::Utc::now().timestamp();
+    let mut results = vec![false; binaries.len()];
+    let mut misses = Vec::new();
+    for (i, binary) in binaries.iter().enumerate() {
+        match lookup(binary, &cache, now) {
+            Ok(available) => results[i] = available,
+            Err(miss) => misses.push((i, miss)),
+        }
+    }
+    if misses.is_empty() {
+        return results;
+    }
+
+    let probed: Vec<bool> = thread::scope(|scope| {
+        let probes: Vec<_> = misses
+            .iter()
+            .map(|(_, miss)| {
+                scope.spawn(move || {
+                    command_succeeds_with_timeout(
+                        &miss.path.to_string_lossy(),
+                        &["--version"],
+                        BACKEND_VERSION_PROBE_TIMEOUT,
+                    )
+                })
+            })
+            .collect();
+        probes
+            .into_iter()
+            .map(|probe| probe.join().unwrap_or(false))
+            .collect()
+    });
+    for ((i, miss), available) in misses.into_iter().zip(probed) {
+        results[i] = available;
+        cache.insert(
+            miss.key,
+            ProbeRecord {
+                len: miss.len,
+                modified_ns: miss.modified_ns,
+                available,
+                probed_at: now,
+            },
+        );
+    }
+    if let Some(path) = cache_path {
+        memory::write_json(path, &cache);
+    }
+    results
 }
 
 pub(crate) fn command_succeeds_with_timeout(
@@ -96,4 +286,60 @@ mod tests {
             Duration::from_secs(2),
         ));
     }
+
+    #[cfg(unix)]
+    #[test]
+    fn backends_are_probed_in_parallel_and_cached_until_the_binary_changes() {
+        let temp = tempfile::tempdir().unwrap();
+        let cache = temp.path().join(PROBE_CACHE_FILE);
+        let slow = executable_script(temp.path(), "slow-backend", "sleep 5");
+        let marker = temp.path().join("probed");
+        let counted = executable_script(
+            temp.path(),
+            "counted-backend",
+            &format!("echo x >> '{}'", marker.display()),
+        );
+        let binaries = [
+            slow.to_str().unwrap(),
+            counted.to_str().unwrap(),
+            "omar-test-no-such-backend",
+            slow.to_str().unwrap(),
+        ];
+        let probe_count = || {
+            fs::read_to_string(&marker)
+                .map(|s| s.lines().count())
+                .unwrap_or(0)
+        };
+
+        assert_eq!(
+            cached_backends_available_with_cache(&binaries, Some(&cache)),
+            vec![None, None, Some(false), None],
+            "only a missing binary is known before any probe"
+        );
+
+        let start = Instant::now();
+        let available = backends_available_with_cache(&binaries, Some(&cache));
+        assert_eq!(available, vec![false, true, false, false]);
+        assert!(
+            start.elapsed() < BACKEND_VERSION_PROBE_TIMEOUT * 2,
+            "two hanging probes must overlap, not run back to back"
+        );
+        assert_eq!(probe_count(), 1);
+
+        // Unchanged binaries are answered from the cache, the hang included.
+        let start = Instant::now();
+        let available = backends_available_with_cache(&binaries, Some(&cache));
+        assert_eq!(available, vec![false, true, false, false]);
+        assert!(start.elapsed() < Duration::from_millis(500));
+        assert_eq!(probe_count(), 1);
+        assert_eq!(
+            cached_backends_available_with_cache(&binaries, Some(&cache)),
+            vec![Some(false), Some(true), Some(false), Some(false)]
+        );
+
+        // Replacing a binary invalidates its entry.
+        fs::write(&slow, "#!/bin/sh\nexit 0 # upgraded\n").unwrap();
+        let available = backends_available_with_cache(&binaries[..1], Some(&cache));
+        assert_eq!(available, vec![true]);
+    }
 }
@@ -0,0 +1,524 @@
+//! `omar bench`: a headless load harness for the paths that bound how large
+//! a swarm omar can drive.
+//!
+//! Each scenario exercises the real code, not a model of it: `build_tree`
+//! at the width and depth extremes, the scheduler's insert, cancel and
+//! due-event pop over a large queue, and — against a private tmux server —
+//! `spawn_agent` through the MCP dispatcher, `deliver_prompt`, and
+//! `App::refresh` over many sessions. Agents are a small bash stand-in
+//! (see [`STUB_AGENT`]) rather than a real backend, so the numbers measure
+//! omar and tmux, not a model's startup time.
+//!
+//! Results go to stdout as one JSON object per scenario (latency quantiles
+//! in µs plus throughput), so CI can keep the file as an artifact and diff
+//! runs over time. `--quick` shrinks every scenario for that purpose.
+//!
+//! The bench points `HOME` and `OMAR_TMUX_SERVER` at a throwaway directory
+//! and tmux socket before touching either, so it never sees the user's
+//! agents or state, and tears both down when done.
+
+use std::collections::HashMap;
+use std::fs;
+use std::io;
+use std::os::unix::fs::PermissionsExt;
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+use anyhow::{Context, Result};
+use serde::Serialize;
+use serde_json::{json, Value};
+
+use crate::app::{self, AgentInfo, App};
+use crate::config::Config;
+use crate::manager::McpLaunchContext;
+use crate::mcp::OmarMcpServer;
+use crate::metrics::{Histogram, HistogramSnapshot};
+use crate::scheduler::{self, ScheduledEvent, Scheduler, TickerBuffer};
+use crate::tmux::{tmux_command, DeliveryOptions, HealthState, Session, TmuxClient};
+
+/// The agent every tmux scenario runs: a banner, a prompt, and an echo of
+/// each submitted line, which is all `deliver_prompt` needs to observe a
+/// paste landing and being submitted.
+const STUB_AGENT: &str = r#"#!/usr/bin/env bash
+# Stand-in agent TUI for `omar bench`.
+printf 'omar bench agent ready\n> '
+while IFS= read -r line; do
+  printf 'received: %s\n> ' "$line"
+done
+"#;
+
+/// Scenario sizes. Full runs are for local profiling; quick runs keep CI
+/// under a minute.
+#[derive(Debug, Clone, Copy)]
+struct Sizes {
+    tree_width: usize,
+    tree_depth: usize,
+    tree_rounds: usize,
+    events: usize,
+    spawns: usize,
+    deliveries: usize,
+    refresh_sessions: usize,
+    refresh_rounds: usize,
+}
+
+impl Sizes {
+    fn new(quick: bool) -> Self {
+        if quick {
+            Self {
+                tree_width: 500,
+                tree_depth: 100,
+                tree_rounds: 20,
+                events: 1_000,
+                spawns: 10,
+                deliveries: 10,
+                refresh_sessions: 25,
+                refresh_rounds: 10,
+            }
+        } else {
+            Self {
+                tree_width: 5_000,
+                tree_depth: 500,
+                tree_rounds: 50,
+                events: 10_000,
+                spawns: 50,
+                deliveries: 50,
+                refresh_sessions: 200,
+                refresh_rounds: 50,
+            }
+        }
+    }
+}
+
+/// One scenario's outcome, as printed.
+#[derive(Debug, Serialize)]
+struct BenchResult {
+    bench: String,
+    n: u64,
+    unit: &'static str,
+    p50: u64,
+    p90: u64,
+    p99: u64,
+    max: u64,
+    mean: u64,
+    ops_per_sec: f64,
+}
+
+impl BenchResult {
+    fn new(bench: impl Into<String>, samples: &HistogramSnapshot, wall: Duration) -> Self {
+        let n = samples.count;
+        Self {
+            bench: bench.into(),
+            n,
+            unit: "us",
+            p50: samples.quantile(0.50),
+            p90: samples.quantile(0.90),
+            p99: samples.quantile(0.99),
+            max: samples.max_us,
+            mean: samples.sum_us.checked_div(n).unwrap_or(0),
+            ops_per_sec: if wall.is_zero() {
+                0.0
+            } else {
+                n as f64 / wall.as_secs_f64()
+            },
+        }
+    }
+}
+
+/// Time `op` once per item and summarize.
+fn measure<T>(
+    bench: &str,
+    items: impl IntoIterator<Item = T>,
+    mut op: impl FnMut(T),
+) -> BenchResult {
+    let histogram = Histogram::new();
+    let started = Instant::now();
+    for item in items {
+        let _timer = histogram.start_timer();
+        op(item);
+    }
+    BenchResult::new(bench, &histogram.snapshot(), started.elapsed())
+}
+
+/// Like [`measure`], for operations that can fail; the first error aborts
+/// the scenario.
+fn try_measure<T>(
+    bench: &str,
+    items: impl IntoIterator<Item = T>,
+    mut op: impl FnMut(T) -> Result<()>,
+) -> Result<BenchResult> {
+    let mut failure = None;
+    let result = measure(bench, items, |item| {
+        if failure.is_none() {
+            failure = op(item).err();
+        }
+    });
+    match failure {
+        Some(e) => Err(e.context(format!("bench {bench} failed"))),
+        None => Ok(result),
+    }
+}
+
+/// Run every scenario and print one JSON line per result.
+pub fn run(quick: bool) -> Result<()> {
+    let sizes = Sizes::new(quick);
+    let mut results = Vec::new();
+    results.extend(tree_benches(&sizes));
+    results.extend(scheduler_benches(&sizes));
+
+    if tmux_available() {
+        let sandbox = Sandbox::create()?;
+        let tmux_results = tmux_benches(&sandbox, &sizes);
+        drop(sandbox);
+        results.extend(tmux_results?);
+    } else {
+        eprintln!("omar bench: tmux not found; skipping spawn, delivery and refresh");
+    }
+
+    let stdout = io::stdout();
+    let mut out = stdout.lock();
+    for result in &results {
+        serde_json::to_writer(&mut out, result)?;
+        io::Write::write_all(&mut out, b"\n")?;
+    }
+    Ok(())
+}
+
+fn tmux_available() -> bool {
+    std::process::Command::new("tmux")
+        .arg("-V")
+        .output()
+        .is_ok_and(|output| output.status.success())
+}
+
+const TREE_PREFIX: &str = "omar-agent-";
+const TREE_MANAGER: &str = "omar-agent-ea-0";
+
+fn tree_agent(name: String) -> AgentInfo {
+    AgentInfo {
+        session: Session::new(name, 0, false, 0),
+        health: HealthState::Idle,
+        is_unresolved: false,
+    }
+}
+
+/// `build_tree` over one flat level of `width` agents and over a single
+/// chain `depth` deep, the two shapes that stress sibling handling and
+/// recursion respectively.
+fn tree_benches(sizes: &Sizes) -> Vec<BenchResult> {
+    let manager = tree_agent(TREE_MANAGER.to_string());
+
+    let wide: Vec<AgentInfo> = (0..sizes.tree_width)
+        .map(|i| tree_agent(format!("{TREE_PREFIX}w{i}")))
+        .collect();
+    let wide_parents: HashMap<String, String> = wide
+        .iter()
+        .map(|a| (a.session.name.clone(), TREE_MANAGER.to_string()))
+        .collect();
+
+    let deep: Vec<AgentInfo> = (0..sizes.tree_depth)
+        .map(|i| tree_agent(format!("{TREE_PREFIX}d{i}")))
+        .collect();
+    let deep_parents: HashMap<String, String> = deep
+        .iter()
+        .enumerate()
+        .map(|(i, a)| {
+            let parent = match i {
+                0 => TREE_MANAGER.to_string(),
+                _ => deep[i - 1].session.name.clone(),
+            };
+            (a.session.name.clone(), parent)
+        })
+        .collect();
+
+    [
+        (
+            format!("build_tree/wide_{}", sizes.tree_width),
+            &wide,
+            &wide_parents,
+        ),
+        (
+            format!("build_tree/deep_{}", sizes.tree_depth),
+            &deep,
+            &deep_parents,
+        ),
+    ]
+    .into_iter()
+    .map(|(bench, agents, parents)| {
+        measure(&bench, 0..sizes.tree_rounds, |_| {
+            let tree = app::build_tree(agents, Some(&manager), parents, TREE_PREFIX, TREE_MANAGER);
+            assert_eq!(tree.len(), agents.len() + 1);
+        })
+    })
+    .collect()
+}
+
+fn bench_event(i: usize, timestamp: u64) -> ScheduledEvent {
+    ScheduledEvent {
+        id: format!("bench-{i}"),
+        sender: "bench".to_string(),
+        receiver: format!("agent-{}", i % 100),
+        timestamp,
+        payload: "tick".to_string(),
+        created_at: i as u64,
+        recurring_ns: None,
+        ea_id: 0,
+    }
+}
+
+/// Insert, cancel and due-pop over an in-memory queue of `sizes.events`.
+/// Every due event has its own timestamp so each pop delivers exactly one,
+/// which makes its latency that of one scheduler tick at that queue size.
+fn scheduler_benches(sizes: &Sizes) -> Vec<BenchResult> {
+    let n = sizes.events;
+    let now = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .unwrap_or(Duration::ZERO)
+        .as_nanos() as u64;
+    let future = now + 3_600_000_000_000;
+    let mut results = Vec::new();
+
+    let queue = Scheduler::new();
+    results.push(measure(&format!("scheduler/insert_{n}"), 0..n, |i| {
+        queue.insert(bench_event(i, future + i as u64)).unwrap();
+    }));
+    results.push(measure(&format!("scheduler/cancel_{n}"), 0..n, |i| {
+        let _ = queue.cancel_if_ea(&format!("bench-{i}"), 0);
+    }));
+
+    let queue = Scheduler::new();
+    queue
+        .insert_many(
+            (0..n)
+                .map(|i| bench_event(i, now - (n - i) as u64))
+                .collect(),
+        )
+        .unwrap();
+    let popup = scheduler::new_popup_receiver();
+    results.push(measure(&format!("scheduler/take_due_{n}"), 0..n, |_| {
+        let delivered = queue.take_due_deliveries(&popup, TREE_PREFIX, |_, _| false);
+        assert_eq!(delivered.len(), 1);
+    }));
+    results
+}
+
+/// A throwaway `HOME` and tmux server for the tmux scenarios. Dropping it
+/// kills the server and removes the directory.
+struct Sandbox {
+    root: PathBuf,
+    server: String,
+    stub: PathBuf,
+}
+
+impl Sandbox {
+    fn create() -> Result<Self> {
+        let pid = std::process::id();
+        let root = std::env::temp_dir().join(format!("omar-bench-{pid}"));
+        let _ = fs::remove_dir_all(&root);
+        fs::create_dir_all(root.join(".omar")).context("create bench directory")?;
+        let stub = root.join("bench-agent");
+        fs::write(&stub, STUB_AGENT).context("write bench agent")?;
+        fs::set_permissions(&stub, fs::Permissions::from_mode(0o755))
+            .context("make bench agent executable")?;
+
+        let server = format!("omar-bench-{pid}");
+        // Set before anything below resolves a home directory or builds a
+        // tmux command, so no scenario can reach the user's own.
+        std::env::set_var("HOME", &root);
+        std::env::set_var("OMAR_TMUX_SERVER", &server);
+        Ok(Self { root, server, stub })
+    }
+
+    fn omar_dir(&self) -> PathBuf {
+        self.root.join(".omar")
+    }
+
+    fn stub_command(&self) -> String {
+        self.stub.display().to_string()
+    }
+}
+
+impl Drop for Sandbox {
+    fn drop(&mut self) {
+        let _ = tmux_command().arg("kill-server").output();
+        let _ = fs::remove_dir_all(&self.root);
+        std::env::remove_var("OMAR_TMUX_SERVER");
+    }
+}
+
+fn tmux_benches(sandbox: &Sandbox, sizes: &Sizes) -> Result<Vec<BenchResult>> {
+    let config = Config::default();
+    let base_prefix = config.dashboard.session_prefix.clone();
+    let client = TmuxClient::new(crate::ea::ea_prefix(0, &base_prefix));
+
+    // An existing manager session keeps `App::refresh` from starting one.
+    client.new_session(
+        &crate::ea::ea_manager_session(0, &base_prefix),
+        &sandbox.stub_command(),
+        None,
+    )?;
+
+    let mut results = vec![spawn_bench(sandbox, &base_prefix, sizes.spawns)?];
+    let sessions: Vec<String> = (0..sizes.spawns)
+        .map(|i| format!("{}bench-{i}", client.prefix()))
+        .collect();
+    results.push(delivery_bench(&client, &sessions, sizes.deliveries)?);
+    results.push(refresh_bench(sandbox, &client, config, sizes)?);
+    Ok(results)
+}
+
+/// `spawn_agent` calls through the MCP dispatcher, one JSON-RPC request
+/// per call, as a backend issues them.
+fn spawn_bench(sandbox: &Sandbox, base_prefix: &str, spawns: usize) -> Result<BenchResult> {
+    let omar_dir = sandbox.omar_dir();
+    let project_id =
+        crate::projects::add_project_in(&crate::ea::ea_state_dir(0, &omar_dir), "bench")?;
+    let server = OmarMcpServer::with_scheduler(
+        McpLaunchContext {
+            omar_dir,
+            ea_id: 0,
+            session_prefix: base_prefix.to_string(),
+            default_command: sandbox.stub_command(),
+            default_workdir: sandbox.root.display().to_string(),
+            health_idle_warning: 15,
+            tmux_server: Some(sandbox.server.clone()),
+        },
+        Arc::new(Scheduler::new()),
+    );
+
+    try_measure("mcp/spawn_agent", 0..spawns, |i| {
+        let request = json!({
+            "jsonrpc": "2.0",
+            "id": i,
+            "method": "tools/call",
+            "params": {"name": "spawn_agent", "arguments": {
+                "name": format!("bench-{i}"),
+                "project_id": project_id,
+                "task": "wait for prompts",
+            }},
+        });
+        let mut output = Vec::new();
+        server.serve_on(io::Cursor::new(format!("{request}\n")), &mut output, false)?;
+        let response: Value = serde_json::from_slice(&output).context("parse spawn response")?;
+        if response.get("error").is_some() || response["result"]["isError"] == json!(true) {
+            anyhow::bail!("spawn_agent bench-{i}: {response}");
+        }
+        Ok(())
+    })
+}
+
+/// `deliver_prompt` round trips against idle stub agents, cycling through
+/// `sessions`.
+fn delivery_bench(
+    client: &TmuxClient,
+    sessions: &[String],
+    deliveries: usize,
+) -> Result<BenchResult> {
+    let opts = DeliveryOptions::default();
+    let text = "Benchmark prompt: summarize the status of your task in one line.";
+    try_measure("tmux/deliver_prompt", 0..deliveries, |i| {
+        client.deliver_prompt(&sessions[i % sessions.len()], text, &opts)
+    })
+}
+
+/// `App::refresh` with `refresh_sessions` live agent sessions.
+fn refresh_bench(
+    sandbox: &Sandbox,
+    client: &TmuxClient,
+    mut config: Config,
+    sizes: &Sizes,
+) -> Result<BenchResult> {
+    let existing = sizes.spawns;
+    for i in existing..sizes.refresh_sessions.max(existing) {
+        client.new_session(
+            &format!("{}bench-{i}", client.prefix()),
+            &sandbox.stub_command(),
+            None,
+        )?;
+    }
+    config.agent.default_command = sandbox.stub_command();
+    let mut app = App::new(&config, TickerBuffer::new(), Arc::new(Scheduler::new()));
+    app.refresh().context("warm-up refresh")?;
+    try_measure(
+        &format!("app/refresh_{}", sizes.refresh_sessions.max(existing)),
+        0..sizes.refresh_rounds,
+        |_| app.refresh(),
+    )
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn results_report_quantiles_and_throughput() {
+        let histogram = Histogram::new();
+        for us in 1..=100 {
+            histogram.record_us(us);
+        }
+        let result = BenchResult::new("x", &histogram.snapshot(), Duration::from_millis(50));
+
+        assert_eq!(result.n, 100);
+        assert_eq!(result.mean, 50);
+        assert_eq!(result.max, 100);
+        assert!(result.p50 <= result.p90 && result.p90 <= result.p99);
+        assert_eq!(result.ops_per_sec, 2000.0);
+
+        let line: Value = serde_json::to_value(&result).unwrap();
+        for key in [
+            "bench",
+            "n",
+            "unit",
+            "p50",
+            "p90",
+            "p99",
+            "max",
+            "mean",
+            "ops_per_sec",
+        ] {
+            assert!(line.get(key).is_some(), "missing {key}");
+        }
+    }
+
+    #[test]
+    fn in_memory_scenarios_cover_every_item() {
+        let sizes = Sizes {
+            tree_width: 20,
+            tree_depth: 20,
+            tree_rounds: 3,
+            events: 50,
+            ..Sizes::new(true)
+        };
+
+        let tree = tree_benches(&sizes);
+        assert_eq!(tree.len(), 2);
+        assert!(tree.iter().all(|r| r.n == 3));
+
+        let scheduler = scheduler_benches(&sizes);
+        let names: Vec<&str> = scheduler.iter().map(|r| r.bench.as_str()).collect();
+        assert_eq!(
+            names,
+            [
+                "scheduler/insert_50",
+                "scheduler/cancel_50",
+                "scheduler/take_due_50"
+            ]
+        );
+        assert!(scheduler.iter().all(|r| r.n == 50));
+    }
+
+    #[test]
+    fn try_measure_stops_at_the_first_failure() {
+        let mut calls = 0;
+        let err = try_measure("failing", 0..5, |i| {
+            calls += 1;
+            if i == 1 {
+                anyhow::bail!("boom");
+            }
+            Ok(())
+        })
+        .unwrap_err();
+        assert_eq!(calls, 2);
+        assert!(format!("{err:#}").contains("boom"));
+    }
+}
@@ -1,10 +1,13 @@
 //! Computer use module — provides mouse, keyboard, and screenshot control
-//! via Linux desktop tools (xdotool, ImageMagick import).
+//! via Linux desktop tools (xdotool) and in-process X11 capture, with
+//! ImageMagick `import` as the screenshot fallback.
 //!
 //! Only one agent may hold the computer lock at a time.
 
 use anyhow::{Context, Result};
 use std::process::Command;
+
+use crate::screen_capture::{self, CaptureOptions, Encoding, Screenshot};
 #[cfg(test)]
 use std::sync::Arc;
 #[cfg(test)]
@@ -134,35 +137,47 @@ pub fn get_screen_size() -> Result<ScreenSize> {
     })
 }
 
-/// Take a screenshot and return it as a base64-encoded PNG.
-pub fn take_screenshot() -> Result<String> {
-    // Use ImageMagick's `import` to capture the root window to stdout as PNG
-    let output = x11_command("import")
-        .args(["-window", "root", "png:-"])
-        .output()
-        .context("Failed to run import — is ImageMagick installed?")?;
-
-    if !output.status.success() {
-        let stderr = String::from_utf8_lossy(&output.stderr);
-        anyhow::bail!("import (ImageMagick) failed: {}", stderr);
+/// Take a screenshot. Captures in-process (see `screen_capture`) and falls
+/// back to ImageMagick's `import` when that fails; the fallback honours
+/// region, size and format but always returns a full frame, never a delta.
+pub fn take_screenshot(opts: &CaptureOptions) -> Result<Screenshot> {
+    let display = detect_x11_env().map(|(display, _)| display);
+    match screen_capture::capture(display.as_deref(), opts) {
+        Ok(shot) => Ok(shot),
+        Err(_) => screenshot_via_import(opts),
     }
-
-    // Optionally downscale large images to reduce payload size.
-    // We'll pass through as-is for now; the caller can request a resize.
-    use base64::Engine;
-    Ok(base64::engine::general_purpose::STANDARD.encode(&output.stdout))
 }
 
-/// Take a screenshot, resizing to fit within `max_width x max_height`.
-pub fn take_screenshot_resized(max_width: u32, max_height: u32) -> Result<String> {
-    let output = x11_command("import")
-        .args([
-            "-window",
-            "root",
-            "-resize",
-            &format!("{}x{}>", max_width, max_height),
-            "png:-",
-        ])
+fn screenshot_via_import(opts: &CaptureOptions) -> Result<Screenshot> {
+    let size = get_screen_size()?;
+    let (area, image_width, image_height, scale) =
+        screen_capture::plan(size.width, size.height, opts)?;
+
+    let mut cmd = x11_command("import");
+    cmd.args(["-window", "root"]);
+    if (area.width, area.height) != (size.width, size.height) {
+        cmd.args([
+            "-crop",
+            &format!("{}x{}+{}+{}", area.width, area.height, area.x, area.y),
+        ]);
+    }
+    if (image_width, image_height) != (area.width, area.height) {
+        cmd.args(["-resize", &format!("{}x{}!", image_width, image_height)]);
+    }
+    let format = match opts.encoding {
+        Encoding::Png => "png:-",
+        Encoding::Jpeg => {
+            let quality = opts.quality.unwrap_or(screen_capture::DEFAULT_QUALITY);
+            cmd.args(["-quality", &quality.clamp(1, 100).to_string()]);
+            "jpeg:-"
+        }
+        Encoding::Webp => {
+            cmd.args(["-define", "webp:lossless=true"]);
+            "webp:-"
+        }
+    };
+    let output = cmd
+        .arg(format)
         .output()
         .context("Failed to run import — is ImageMagick installed?")?;
 
@@ -172,7 +187,21 @@ pub fn take_screenshot_resized(max_width: u32, max_height: u32) -> Result<String
     }
 
     use base64::Engine;
-    Ok(base64::engine::general_purpose::STANDARD.encode(&output.stdout))
+    Ok(Screenshot {
+        image_base64: Some(base64::engine::general_purpose::STANDARD.encode(&output.stdout)),
+        format: opts.encoding,
+        screen_width: size.width,
+        screen_height: size.height,
+        x: area.x,
+        y: area.y,
+        width: area.width,
+        height: area.height,
+        image_width,
+        image_height,
+        scale,
+        delta: false,
+        unchanged: false,
+    })
 }
 
 /// Move the mouse to the given coordinates.
@@ -338,13 +367,16 @@ pub fn is_available() -> bool {
         .unwrap_or(false)
 }
 
-/// Check if ImageMagick's import command is available.
+/// Check if screenshots can be taken, in-process or via ImageMagick's
+/// `import`.
 pub fn is_screenshot_available() -> bool {
-    x11_command("import")
-        .arg("-version")
-        .output()
-        .map(|o| o.status.success() || !o.stderr.is_empty())
-        .unwrap_or(false)
+    let display = detect_x11_env().map(|(display, _)| display);
+    screen_capture::available(display.as_deref())
+        || x11_command("import")
+            .arg("-version")
+            .output()
+            .map(|o| o.status.success() || !o.stderr.is_empty())
+            .unwrap_or(false)
 }
 
 #[cfg(test)]
@@ -2,6 +2,7 @@
 
 use anyhow::{Context, Result};
 use serde::{Deserialize, Serialize};
+use std::collections::BTreeMap;
 use std::path::PathBuf;
 
 use crate::backend_probe;
@@ -22,6 +23,23 @@ pub struct Config {
 
     #[serde(default)]
     pub slack_bridge: SlackBridgeConfig,
+
+    #[serde(default)]
+    pub scheduler: SchedulerConfig,
+
+    #[serde(default)]
+    pub state: StateConfig,
+
+    /// Idle, already-booted agent sessions the dashboard keeps per EA, by
+    /// backend name (as accepted by `spawn_agent`'s `backend`), e.g.
+    /// `[warm_pool]` / `claude = 2`. Empty disables the pool.
+    #[serde(default, skip_serializing_if = "BTreeMap::is_empty")]
+    pub warm_pool: BTreeMap<String, usize>,
+
+    /// Extra tmux servers agents can be placed on, besides the dashboard's
+    /// own (`OMAR_TMUX_SERVER`). See `tmux::node`.
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
+    pub nodes: Vec<NodeConfig>,
 }
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -64,8 +82,10 @@ pub struct HealthConfig {
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct AgentConfig {
-    /// Default command to run for new agents
-    #[serde(default = "default_command")]
+    /// Default command to run for new agents. Empty until backend
+    /// detection has finished (see [`Config::detect_default_command`]),
+    /// and then not saved, so the next load detects again.
+    #[serde(default = "default_command", skip_serializing_if = "String::is_empty")]
     pub default_command: String,
 
     /// Default working directory
@@ -78,6 +98,10 @@ pub struct MetricsConfig {
     /// Enable global spawn metrics sink at ~/.omar/metrics/spawn_metrics.jsonl
     #[serde(default)]
     pub spawn_metrics_enabled: bool,
+    /// Address (e.g. "127.0.0.1:9464") on which the dashboard serves
+    /// `/metrics` in the Prometheus text format. Unset serves nothing.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub prometheus_listen: Option<String>,
 }
 
 #[derive(Debug, Clone, Default, Serialize, Deserialize)]
@@ -89,6 +113,41 @@ pub struct SlackBridgeConfig {
     pub active_ea: Option<String>,
 }
 
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SchedulerConfig {
+    /// Maximum number of prompt deliveries running at once. Deliveries to
+    /// the same pane are always sequential regardless of this bound.
+    #[serde(default = "default_delivery_concurrency")]
+    pub delivery_concurrency: usize,
+}
+
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct StateConfig {
+    /// Where per-EA agent records live: `files` (one JSON file per table
+    /// plus `status/*.md`) or `journal` (one snapshot plus an append-only
+    /// transaction log). The dashboard migrates each EA's directory to
+    /// the configured backend at startup; switching back to `files`
+    /// exports the journal as the JSON files again.
+    #[serde(default)]
+    pub backend: crate::state_store::Backend,
+}
+
+/// One `[[nodes]]` entry: a tmux server that can host agent sessions.
+///
+/// The node is another tmux server on this machine. An entry named `local`
+/// without a `socket` only sets `max_agents` for the dashboard's own server.
+#[derive(Debug, Clone, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct NodeConfig {
+    pub name: String,
+    /// tmux `-L` socket name of the server. Unset uses tmux's default.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub socket: Option<String>,
+    /// Sessions the node may hold before placement skips it. Unset means
+    /// no limit.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub max_agents: Option<usize>,
+}
+
 fn default_true() -> bool {
     true
 }
@@ -101,6 +160,10 @@ fn default_session_prefix() -> String {
     "omar-agent-".to_string()
 }
 
+fn default_delivery_concurrency() -> usize {
+    crate::scheduler::DEFAULT_DELIVERY_CONCURRENCY
+}
+
 fn default_idle_warning() -> i64 {
     15
 }
@@ -118,31 +181,57 @@ fn default_error_patterns() -> Vec<String> {
     ]
 }
 
+/// Supported first-class backends in priority order: binary, command.
+const AGENT_CANDIDATES: [(&str, &str); 5] = [
+    ("claude", "claude --dangerously-skip-permissions"),
+    (
+        "codex",
+        "codex --no-alt-screen --dangerously-bypass-approvals-and-sandbox",
+    ),
+    ("cursor", "cursor agent --yolo"),
+    ("opencode", "opencode"),
+    ("agy", "agy --dangerously-skip-permissions"),
+];
+const FALLBACK_AGENT_COMMAND: &str = "claude --dangerously-skip-permissions";
+
 /// Detect which agent command is available on the system.
 /// Checks PATH for the supported first-class backends, falling back to `claude`.
-fn detect_agent_command() -> String {
-    detect_agent_command_from(&[
-        ("claude", "claude --dangerously-skip-permissions"),
-        (
-            "codex",
-            "codex --no-alt-screen --dangerously-bypass-approvals-and-sandbox",
-        ),
-        ("cursor", "cursor agent --yolo"),
-        ("opencode", "opencode"),
-        ("agy", "agy --dangerously-skip-permissions"),
-    ])
-    .unwrap_or_else(|| "claude --dangerously-skip-permissions".to_string())
+pub fn detect_agent_command() -> String {
+    detect_agent_command_from(&AGENT_CANDIDATES)
+        .unwrap_or_else(|| FALLBACK_AGENT_COMMAND.to_string())
 }
 
+/// First candidate, in priority order, whose binary is available. All
+/// candidates are probed at once (see `backend_probe`), so a hanging CLI
+/// costs one probe timeout rather than delaying every later candidate.
 fn detect_agent_command_from(candidates: &[(&str, &str)]) -> Option<String> {
+    let binaries: Vec<&str> = candidates.iter().map(|(binary, _)| *binary).collect();
     candidates
         .iter()
-        .find(|(binary, _)| backend_probe::backend_version_probe_succeeds(binary))
-        .map(|(_, command)| (*command).to_string())
+        .zip(backend_probe::backends_available(&binaries))
+        .find(|(_, available)| *available)
+        .map(|((_, command), _)| (*command).to_string())
 }
 
+/// [`detect_agent_command`] from cached probe results alone. `None` while
+/// a backend that could decide it has not been probed yet.
+fn cached_agent_command() -> Option<String> {
+    let binaries: Vec<&str> = AGENT_CANDIDATES.iter().map(|(binary, _)| *binary).collect();
+    for ((_, command), available) in AGENT_CANDIDATES
+        .iter()
+        .zip(backend_probe::cached_backends_available(&binaries))
+    {
+        if available? {
+            return Some((*command).to_string());
+        }
+    }
+    Some(FALLBACK_AGENT_COMMAND.to_string())
+}
+
+/// Loading a config never runs a probe: without a cached answer the
+/// command is left empty for [`Config::detect_default_command`].
 fn default_command() -> String {
-    detect_agent_command()
+    cached_agent_command().unwrap_or_default()
 }
 
 /// Map shorthand agent names to full commands.
@@ -195,6 +284,14 @@ impl Default for HealthConfig {
     }
 }
 
+impl Default for SchedulerConfig {
+    fn default() -> Self {
+        Self {
+            delivery_concurrency: default_delivery_concurrency(),
+        }
+    }
+}
+
 impl Default for AgentConfig {
     fn default() -> Self {
         Self {
@@ -240,6 +337,15 @@ impl Config {
         Ok(config)
     }
 
+    /// Fill in a `default_command` that cached probe results couldn't
+    /// decide at load, probing the backends. Blocks for at most one probe
+    /// timeout; the dashboard runs it off the render path instead.
+    pub fn detect_default_command(&mut self) {
+        if self.agent.default_command.is_empty() {
+            self.agent.default_command = detect_agent_command();
+        }
+    }
+
     /// Save config to its default path (~/.omar/config.toml)
     pub fn save(&self) {
         self.save_to_path(&Self::default_path());
@@ -444,6 +550,22 @@ sidebar_right = false
         );
     }
 
+    #[test]
+    fn test_detect_default_command_only_fills_unknown() {
+        let mut config = Config::default();
+        config.agent.default_command = "bash".to_string();
+        config.detect_default_command();
+        assert_eq!(config.agent.default_command, "bash");
+
+        config.agent.default_command.clear();
+        config.detect_default_command();
+        assert_eq!(config.agent.default_command, detect_agent_command());
+
+        config.agent.default_command.clear();
+        let saved = toml::to_string(&config).unwrap();
+        assert!(!saved.contains("default_command"));
+    }
+
     #[cfg(unix)]
     #[test]
     fn test_detect_agent_command_skips_hanging_probe() {
@@ -598,9 +720,81 @@ default_command = "aider --yes"
         let toml = r#"
 [metrics]
 spawn_metrics_enabled = true
+prometheus_listen = "127.0.0.1:9464"
 "#;
         let config: Config = toml::from_str(toml).unwrap();
         assert!(config.metrics.spawn_metrics_enabled);
+        assert_eq!(
+            config.metrics.prometheus_listen.as_deref(),
+            Some("127.0.0.1:9464")
+        );
+    }
+
+    #[test]
+    fn test_parse_scheduler_config() {
+        let config: Config = toml::from_str("").unwrap();
+        assert_eq!(config.scheduler.delivery_concurrency, 8);
+
+        let toml = r#"
+[scheduler]
+delivery_concurrency = 2
+"#;
+        let config: Config = toml::from_str(toml).unwrap();
+        assert_eq!(config.scheduler.delivery_concurrency, 2);
+    }
+
+    #[test]
+    fn test_parse_state_config() {
+        let config: Config = toml::from_str("").unwrap();
+        assert_eq!(config.state.backend, crate::state_store::Backend::Files);
+
+        let toml = r#"
+[state]
+backend = "journal"
+"#;
+        let config: Config = toml::from_str(toml).unwrap();
+        assert_eq!(config.state.backend, crate::state_store::Backend::Journal);
+    }
+
+    #[test]
+    fn test_parse_warm_pool_config() {
+        let config: Config = toml::from_str("").unwrap();
+        assert!(config.warm_pool.is_empty());
+        assert!(!toml::to_string_pretty(&config)
+            .unwrap()
+            .contains("warm_pool"));
+
+        let toml = r#"
+[warm_pool]
+claude = 2
+codex = 1
+"#;
+        let config: Config = toml::from_str(toml).unwrap();
+        assert_eq!(config.warm_pool.get("claude"), Some(&2));
+        assert_eq!(config.warm_pool.get("codex"), Some(&1));
+    }
+
+    #[test]
+    fn test_parse_nodes_config() {
+        let config: Config = toml::from_str("").unwrap();
+        assert!(config.nodes.is_empty());
+        assert!(!toml::to_string_pretty(&config).unwrap().contains("nodes"));
+
+        let toml = r#"
+[[nodes]]
+name = "local"
+max_agents = 40
+
+[[nodes]]
+name = "second"
+socket = "omar-2"
+max_agents = 100
+"#;
+        let config: Config = toml::from_str(toml).unwrap();
+        assert_eq!(config.nodes.len(), 2);
+        assert_eq!(config.nodes[0].name, "local");
+        assert_eq!(config.nodes[0].max_agents, Some(40));
+        assert_eq!(config.nodes[1].socket.as_deref(), Some("omar-2"));
     }
 
     #[test]
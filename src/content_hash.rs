@@ -0,0 +1,36 @@
+//! Content hashing for names that must agree across processes and builds.
+//!
+//! `DefaultHasher` is randomly keyed per process, so anything that ends up
+//! in a file or tmux session name another process has to reproduce
+//! (content-addressed launch artifacts, warm pool keys) hashes with
+//! [`content_hash`] instead.
+
+/// FNV-1a over `parts`, each terminated by a NUL so `("ab", "c")` and
+/// `("a", "bc")` hash differently.
+pub fn content_hash<'a>(parts: impl IntoIterator<Item = &'a [u8]>) -> u64 {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for part in parts {
+        for &byte in part.iter().chain(std::iter::once(&0)) {
+            hash ^= u64::from(byte);
+            hash = hash.wrapping_mul(0x0100_0000_01b3);
+        }
+    }
+    hash
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn content_hash_separates_parts() {
+        assert_ne!(
+            content_hash([b"ab".as_slice(), b"c"]),
+            content_hash([b"a".as_slice(), b"bc"])
+        );
+        assert_eq!(
+            content_hash([b"same".as_slice()]),
+            content_hash([b"same".as_slice()])
+        );
+    }
+}
@@ -0,0 +1,121 @@
+//! Directory change notification with a polling fallback.
+//!
+//! [`DirWatch`] keeps a platform watch (inotify, FSEvents, …) on a set of
+//! directories that may change over time, and calls back whenever an entry
+//! in one of them is created, written, renamed or removed. Callers still
+//! decide what changed by stat-ing the files they care about; the watch only
+//! tells them when to look, so an idle process sleeps instead of polling.
+//!
+//! When a watch can't be set up (no backend, inotify limits exhausted, a
+//! filesystem without change events), [`DirWatch::sync`] says so and the
+//! caller falls back to polling until a later `sync` succeeds.
+
+use std::collections::HashSet;
+use std::path::{Path, PathBuf};
+
+use notify::{EventKind, RecommendedWatcher, RecursiveMode, Watcher};
+
+pub struct DirWatch {
+    watcher: Option<RecommendedWatcher>,
+    watched: HashSet<PathBuf>,
+}
+
+impl DirWatch {
+    /// Call `wake` (from the watcher's own thread) on every change in a
+    /// watched directory. Events are not deduplicated: one rename may call
+    /// `wake` several times.
+    pub fn new(wake: impl Fn() + Send + 'static) -> Self {
+        let watcher = notify::recommended_watcher(move |res: notify::Result<notify::Event>| {
+            if res.is_ok_and(|event| !matches!(event.kind, EventKind::Access(_))) {
+                wake();
+            }
+        })
+        .ok();
+        Self {
+            watcher,
+            watched: HashSet::new(),
+        }
+    }
+
+    /// Watch exactly `dirs` (non-recursively), dropping watches on
+    /// directories no longer listed. True when every directory is watched;
+    /// false means changes in some of them go unreported and the caller
+    /// must poll.
+    pub fn sync(&mut self, dirs: &HashSet<PathBuf>) -> bool {
+        let Some(watcher) = self.watcher.as_mut() else {
+            return false;
+        };
+        self.watched.retain(|dir| {
+            if dirs.contains(dir) {
+                return true;
+            }
+            let _ = watcher.unwatch(dir);
+            false
+        });
+        let mut complete = true;
+        for dir in dirs {
+            if self.watched.contains(dir) {
+                continue;
+            }
+            match watcher.watch(dir, RecursiveMode::NonRecursive) {
+                Ok(()) => {
+                    self.watched.insert(dir.clone());
+                }
+                Err(_) => complete = false,
+            }
+        }
+        complete
+    }
+}
+
+/// The directory to watch for changes to `path`: its parent, or the
+/// nearest ancestor that exists yet, whose change event announces the
+/// missing directories being created.
+pub fn dir_for(path: &Path) -> Option<PathBuf> {
+    path.ancestors()
+        .skip(1)
+        .find(|dir| dir.is_dir())
+        .map(Path::to_path_buf)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::mpsc;
+    use std::time::Duration;
+
+    #[test]
+    fn missing_directories_are_watched_through_an_ancestor() {
+        let dir = tempfile::tempdir().unwrap();
+        let file = dir.path().join("ea-1").join("status").join("agent.md");
+        assert_eq!(dir_for(&file).as_deref(), Some(dir.path()));
+        std::fs::create_dir_all(file.parent().unwrap()).unwrap();
+        assert_eq!(dir_for(&file).as_deref(), file.parent());
+    }
+
+    #[test]
+    fn wakes_on_changes_in_watched_directories_only() {
+        let watched = tempfile::tempdir().unwrap();
+        let other = tempfile::tempdir().unwrap();
+        let (tx, rx) = mpsc::channel();
+        let mut watch = DirWatch::new(move || {
+            let _ = tx.send(());
+        });
+        if !watch.sync(&HashSet::from([watched.path().to_path_buf()])) {
+            eprintln!("Skipping test: no filesystem watch backend");
+            return;
+        }
+
+        std::fs::write(other.path().join("eas.json"), "[]").unwrap();
+        assert!(rx.recv_timeout(Duration::from_millis(200)).is_err());
+
+        std::fs::write(watched.path().join("eas.json"), "[]").unwrap();
+        assert!(rx.recv_timeout(Duration::from_secs(5)).is_ok());
+
+        // Unlisted directories are dropped on the next sync.
+        assert!(watch.sync(&HashSet::new()));
+        while rx.try_recv().is_ok() {}
+        std::fs::write(watched.path().join("eas.json"), "{}").unwrap();
+        assert!(rx.recv_timeout(Duration::from_millis(200)).is_err());
+    }
+}
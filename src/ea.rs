@@ -9,6 +9,8 @@ use std::path::{Path, PathBuf};
 use std::time::{SystemTime, UNIX_EPOCH};
 use uuid::Uuid;
 
+use crate::state_watch;
+
 /// EA identifier. Simple integer.
 pub type EaId = u32;
 
@@ -66,18 +68,23 @@ pub fn ea_state_dir(ea_id: EaId, base_dir: &Path) -> PathBuf {
     base_dir.join("ea").join(ea_id.to_string())
 }
 
-fn active_ea_path(base_dir: &Path) -> PathBuf {
+/// Path of the EA registry (`~/.omar/eas.json`).
+pub fn registry_path(base_dir: &Path) -> PathBuf {
+    base_dir.join("eas.json")
+}
+
+pub fn active_ea_path(base_dir: &Path) -> PathBuf {
     base_dir.join("active_ea")
 }
 
-fn dashboard_handoff_path(base_dir: &Path) -> PathBuf {
+pub fn dashboard_handoff_path(base_dir: &Path) -> PathBuf {
     base_dir.join("dashboard_handoff.json")
 }
 
 /// Load all registered EAs from ~/.omar/eas.json.
 pub fn load_registry(base_dir: &Path) -> Vec<EaInfo> {
-    let path = base_dir.join("eas.json");
-    match fs::read_to_string(&path) {
+    let path = registry_path(base_dir);
+    state_watch::cached(&path, || match fs::read_to_string(&path) {
         Ok(content) => match serde_json::from_str(&content) {
             Ok(eas) => eas,
             Err(e) => {
@@ -89,15 +96,17 @@ pub fn load_registry(base_dir: &Path) -> Vec<EaInfo> {
             }
         },
         Err(_) => Vec::new(),
-    }
+    })
 }
 
 /// Load the last active EA id persisted on disk.
 pub fn load_active_ea(base_dir: &Path) -> Option<EaId> {
     let path = active_ea_path(base_dir);
-    fs::read_to_string(&path)
-        .ok()
-        .and_then(|s| s.trim().parse::<EaId>().ok())
+    state_watch::cached(&path, || {
+        fs::read_to_string(&path)
+            .ok()
+            .and_then(|s| s.trim().parse::<EaId>().ok())
+    })
 }
 
 /// Persist the active EA id on disk for CLI/dashboard/API defaults.
@@ -293,7 +302,7 @@ pub fn unregister_ea(base_dir: &Path, ea_id: EaId) -> anyhow::Result<()> {
 }
 
 fn save_registry(base_dir: &Path, eas: &[EaInfo]) -> anyhow::Result<()> {
-    let path = base_dir.join("eas.json");
+    let path = registry_path(base_dir);
     fs::create_dir_all(base_dir)?;
     let json = serde_json::to_string_pretty(eas)?;
     // Atomic write: write to temp file, then rename
@@ -1,6 +1,8 @@
-use crossterm::event::{self, Event, KeyCode, KeyEvent, KeyModifiers};
+use crossterm::event::{Event, EventStream, KeyCode, KeyEvent, KeyModifiers};
+use futures::StreamExt;
 use std::time::Duration;
-use tokio::sync::mpsc;
+use tokio::sync::{mpsc, watch};
+use tokio::time::{Instant, Interval, MissedTickBehavior};
 
 /// Application events
 #[derive(Debug)]
@@ -14,12 +16,117 @@ pub enum AppEvent {
     /// Terminal was resized
     #[allow(dead_code)]
     Resize(u16, u16),
+    /// A watched state file changed on disk (e.g. an MCP write)
+    StateChanged,
+    /// The terminal gained (`true`) or lost (`false`) focus
+    Focus(bool),
+}
+
+/// How often the event handler wakes the dashboard, chosen by the
+/// dashboard from what it is showing (see `Cadence::choose`).
+///
+/// Input, state-file changes and pushed pane activity arrive as events at
+/// every cadence but `Paused`; the cadence only sets how often the
+/// dashboard is woken *without* a reason, so an idle dashboard costs a
+/// few wakeups a minute rather than twenty a second.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Cadence {
+    /// Agents are running, events are counting down, or the user is
+    /// interacting: `Tick` at the configured refresh interval and scroll
+    /// the ticker.
+    Active,
+    /// Nothing is running but the ticker is scrolling: slow ticks, scroll.
+    Idle,
+    /// Nothing moves on screen, or the terminal is unfocused: slow ticks,
+    /// no scroll.
+    Quiet,
+    /// A tmux popup or attached session owns the terminal: no ticks, and
+    /// input is not read so keystrokes reach the popup.
+    Paused,
+}
+
+/// How long after a keypress the dashboard counts as interacted with.
+pub const INTERACTION_WINDOW: Duration = Duration::from_secs(10);
+
+/// `Tick` period multiplier for `Cadence::Idle`.
+const IDLE_TICK_FACTOR: u32 = 5;
+
+/// `Tick` period multiplier for `Cadence::Quiet`.
+const QUIET_TICK_FACTOR: u32 = 15;
+
+const TICKER_SCROLL_PERIOD: Duration = Duration::from_millis(150);
+
+/// How long to wait after a bare Esc for the key it may prefix.
+const ESC_SEQUENCE_WAIT: Duration = Duration::from_millis(30);
+
+impl Cadence {
+    /// The cadence for a dashboard that `busy` (agents running or events
+    /// counting down), was `interacting`, is `focused`, and is showing a
+    /// `scrolling` ticker.
+    pub fn choose(busy: bool, interacting: bool, focused: bool, scrolling: bool) -> Self {
+        if busy || interacting {
+            Cadence::Active
+        } else if focused && scrolling {
+            Cadence::Idle
+        } else {
+            Cadence::Quiet
+        }
+    }
+
+    fn tick_period(self, base: Duration) -> Option<Duration> {
+        match self {
+            Cadence::Active => Some(base),
+            Cadence::Idle => Some(base * IDLE_TICK_FACTOR),
+            Cadence::Quiet => Some(base * QUIET_TICK_FACTOR),
+            Cadence::Paused => None,
+        }
+    }
+
+    fn scroll_period(self) -> Option<Duration> {
+        match self {
+            Cadence::Active | Cadence::Idle => Some(TICKER_SCROLL_PERIOD),
+            Cadence::Quiet | Cadence::Paused => None,
+        }
+    }
+
+    fn reads_input(self) -> bool {
+        self != Cadence::Paused
+    }
+}
+
+/// An interval whose first tick is one `period` away (tokio's fires
+/// immediately) and that skips ticks missed while suspended instead of
+/// bursting to catch up.
+fn timer(period: Option<Duration>) -> Option<Interval> {
+    period.map(|period| {
+        let mut interval = tokio::time::interval_at(Instant::now() + period, period);
+        interval.set_missed_tick_behavior(MissedTickBehavior::Delay);
+        interval
+    })
+}
+
+async fn next_tick(timer: &mut Option<Interval>) {
+    match timer {
+        Some(interval) => {
+            interval.tick().await;
+        }
+        None => std::future::pending().await,
+    }
+}
+
+async fn next_input(input: &mut Option<EventStream>) -> Option<std::io::Result<Event>> {
+    match input {
+        Some(stream) => stream.next().await,
+        None => std::future::pending().await,
+    }
 }
 
 fn app_event_from_crossterm(event: Event) -> Option<AppEvent> {
     match event {
         Event::Key(key) => Some(AppEvent::Key(key)),
         Event::Resize(w, h) => Some(AppEvent::Resize(w, h)),
+        Event::FocusGained => Some(AppEvent::Focus(true)),
+        Event::FocusLost => Some(AppEvent::Focus(false)),
         _ => None,
     }
 }
@@ -73,19 +180,29 @@ fn coalesce_alt_arrow(first: KeyEvent, next: Option<Event>) -> (AppEvent, Option
 /// Handles input events and tick timing
 pub struct EventHandler {
     rx: mpsc::UnboundedReceiver<AppEvent>,
-    _tx: mpsc::UnboundedSender<AppEvent>,
+    tx: mpsc::UnboundedSender<AppEvent>,
+    cadence: watch::Sender<Cadence>,
 }
 
 impl EventHandler {
-    /// Create a new event handler with the given tick rate
+    /// Create a new event handler ticking at `tick_rate` while
+    /// `Cadence::Active`. Input comes from crossterm's async event stream,
+    /// so the task sleeps until a key, a timer, or a cadence change.
     pub fn new(tick_rate: Duration) -> Self {
+        Self::spawn(tick_rate, true)
+    }
+
+    /// `read_terminal: false` serves timers only (crossterm needs a tty).
+    fn spawn(tick_rate: Duration, read_terminal: bool) -> Self {
         let (tx, rx) = mpsc::unbounded_channel();
+        let (cadence, mut cadence_rx) = watch::channel(Cadence::Active);
         let event_tx = tx.clone();
 
-        // Spawn event polling task
         tokio::spawn(async move {
-            let mut tick_interval = tokio::time::interval(tick_rate);
-            let mut ticker_interval = tokio::time::interval(Duration::from_millis(150));
+            let mut current = *cadence_rx.borrow();
+            let mut tick_timer = timer(current.tick_period(tick_rate));
+            let mut scroll_timer = timer(current.scroll_period());
+            let mut input = read_terminal.then(EventStream::new);
             let mut pending_event = None;
 
             loop {
@@ -97,36 +214,60 @@ impl EventHandler {
                 }
 
                 let event = tokio::select! {
-                    _ = tick_interval.tick() => {
-                        AppEvent::Tick
-                    }
-                    _ = ticker_interval.tick() => {
-                        AppEvent::TickerScroll
+                    changed = cadence_rx.changed() => {
+                        if changed.is_err() {
+                            break;
+                        }
+                        let next = *cadence_rx.borrow_and_update();
+                        if next.tick_period(tick_rate) != current.tick_period(tick_rate) {
+                            tick_timer = timer(next.tick_period(tick_rate));
+                        }
+                        if next.scroll_period() != current.scroll_period() {
+                            scroll_timer = timer(next.scroll_period());
+                        }
+                        // Dropping the stream stops crossterm reading the
+                        // terminal, so a popup or attached session gets
+                        // every keystroke.
+                        if !next.reads_input() {
+                            input = None;
+                        } else if input.is_none() && read_terminal {
+                            input = Some(EventStream::new());
+                        }
+                        current = next;
+                        continue;
                     }
-                    _ = tokio::time::sleep(Duration::from_millis(50)) => {
-                        // Poll for crossterm events
-                        if event::poll(Duration::from_millis(0)).unwrap_or(false) {
-                            match event::read() {
-                                Ok(Event::Key(key)) if key.code == KeyCode::Esc && key.modifiers.is_empty() => {
-                                    let next = if event::poll(Duration::from_millis(30)).unwrap_or(false) {
-                                        event::read().ok()
-                                    } else {
-                                        None
-                                    };
-                                    let (event, pending) = coalesce_alt_arrow(key, next);
-                                    pending_event = pending;
-                                    event
-                                }
-                                Ok(event) => match app_event_from_crossterm(event) {
-                                    Some(event) => event,
-                                    None => continue,
-                                },
-                                _ => continue,
-                            }
-                        } else {
+                    _ = next_tick(&mut tick_timer) => AppEvent::Tick,
+                    _ = next_tick(&mut scroll_timer) => AppEvent::TickerScroll,
+                    read = next_input(&mut input) => match read {
+                        Some(Ok(Event::Key(key))) if key.code == KeyCode::Esc && key.modifiers.is_empty() => {
+                            let next = match input.as_mut() {
+                                Some(stream) => tokio::time::timeout(ESC_SEQUENCE_WAIT, stream.next())
+                                    .await
+                                    .ok()
+                                    .flatten()
+                                    .and_then(Result::ok),
+                                None => None,
+                            };
+                            let (event, pending) = coalesce_alt_arrow(key, next);
+                            pending_event = pending;
+                            event
+                        }
+                        Some(Ok(event)) => match app_event_from_crossterm(event) {
+                            Some(event) => event,
+                            None => continue,
+                        },
+                        // No busy loop on a terminal that keeps failing
+                        // (e.g. no tty): back off to the old poll rate.
+                        Some(Err(_)) => {
+                            tokio::time::sleep(Duration::from_millis(50)).await;
                             continue;
                         }
-                    }
+                        // The terminal is gone; keep serving timers.
+                        None => {
+                            input = None;
+                            continue;
+                        }
+                    },
                 };
 
                 if event_tx.send(event).is_err() {
@@ -135,7 +276,32 @@ impl EventHandler {
             }
         });
 
-        Self { rx, _tx: tx }
+        Self { rx, tx, cadence }
+    }
+
+    /// Switch the wakeup cadence. A no-op when it is unchanged, so callers
+    /// may set it after every event.
+    pub fn set_cadence(&self, cadence: Cadence) {
+        self.cadence.send_if_modified(|current| {
+            let changed = *current != cadence;
+            *current = cadence;
+            changed
+        });
+    }
+
+    /// Emit `AppEvent::StateChanged` for each signal on `changes`. Signals
+    /// that arrive while one is already pending are folded into it, so a
+    /// burst of writes costs one refresh.
+    pub fn forward_state_changes(&self, mut changes: mpsc::UnboundedReceiver<()>) {
+        let tx = self.tx.clone();
+        tokio::spawn(async move {
+            while changes.recv().await.is_some() {
+                while changes.try_recv().is_ok() {}
+                if tx.send(AppEvent::StateChanged).is_err() {
+                    break;
+                }
+            }
+        });
     }
 
     /// Get the next event
@@ -256,4 +422,55 @@ mod tests {
         }
         assert!(pending.is_none());
     }
+
+    #[test]
+    fn cadence_is_active_while_busy_or_interacting() {
+        assert_eq!(Cadence::choose(true, false, false, false), Cadence::Active);
+        assert_eq!(Cadence::choose(false, true, true, true), Cadence::Active);
+        assert_eq!(Cadence::choose(false, false, true, true), Cadence::Idle);
+        assert_eq!(Cadence::choose(false, false, true, false), Cadence::Quiet);
+        assert_eq!(
+            Cadence::choose(false, false, false, true),
+            Cadence::Quiet,
+            "an unfocused terminal stops the ticker animation"
+        );
+    }
+
+    #[test]
+    fn slower_cadences_wake_less_often() {
+        let base = Duration::from_secs(1);
+        assert_eq!(Cadence::Active.tick_period(base), Some(base));
+        assert!(Cadence::Idle.tick_period(base) > Cadence::Active.tick_period(base));
+        assert!(Cadence::Quiet.tick_period(base) > Cadence::Idle.tick_period(base));
+        assert_eq!(Cadence::Paused.tick_period(base), None);
+        assert_eq!(Cadence::Quiet.scroll_period(), None);
+        assert!(!Cadence::Paused.reads_input());
+    }
+
+    #[tokio::test]
+    async fn paused_cadence_stops_ticks_until_resumed() {
+        let mut events = EventHandler::spawn(Duration::from_millis(20), false);
+        events.set_cadence(Cadence::Paused);
+        tokio::time::sleep(Duration::from_millis(100)).await;
+        events.drain();
+        tokio::time::sleep(Duration::from_millis(200)).await;
+        assert!(
+            !std::iter::from_fn(|| events.rx.try_recv().ok())
+                .any(|event| matches!(event, AppEvent::Tick | AppEvent::TickerScroll)),
+            "a paused handler must not tick"
+        );
+
+        events.set_cadence(Cadence::Active);
+        let event = tokio::time::timeout(Duration::from_secs(2), async {
+            loop {
+                match events.next().await {
+                    Some(AppEvent::Tick) => return true,
+                    Some(_) => continue,
+                    None => return false,
+                }
+            }
+        })
+        .await;
+        assert_eq!(event.ok(), Some(true));
+    }
 }
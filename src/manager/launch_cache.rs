@@ -0,0 +1,248 @@
+//! Per-process caches for agent launch materialization.
+//!
+//! Every spawn used to re-read and re-substitute the agent prompt, rewrite
+//! the embedded prompt files, and regenerate the per-EA MCP configs even
+//! though all agents of one EA share them byte-for-byte. Two caches remove
+//! that repeated I/O from the spawn path:
+//!
+//! - **Templates** (`template`): a prompt file is parsed once into literal
+//!   runs and `{{NAME}}` slots, and re-parsed only when its stat stamp
+//!   changes (the EA's combined prompt is rewritten on every manager start).
+//! - **Launch artifacts** (`memoized`): a materializer's output is keyed by
+//!   a content hash of everything it depends on and reused while the files
+//!   it wrote still carry the stamps recorded right after writing them. A
+//!   deleted EA dir, a user editing `~/.cursor/mcp.json`, or another
+//!   process rewriting a shared config changes a stamp and forces a rebuild,
+//!   so a hit never hands out a path that no longer holds what we wrote.
+//!
+//! Builds run outside the cache lock: they do file I/O, and one
+//! materializer may call another (`memoized` inside `memoized`). Two
+//! threads missing on the same key both build, which is what every spawn
+//! did before; the outputs are identical and the later insert wins.
+
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, OnceLock};
+
+use crate::state_watch::FileStamp;
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+enum Segment {
+    Literal(String),
+    /// A `{{NAME}}` placeholder, stored with its braces so it matches the
+    /// substitution patterns callers already pass.
+    Slot(String),
+}
+
+/// A prompt template parsed into literal runs and `{{NAME}}` slots.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(super) struct PromptTemplate {
+    segments: Vec<Segment>,
+}
+
+impl PromptTemplate {
+    pub(super) fn parse(source: &str) -> Self {
+        let mut segments = Vec::new();
+        let mut rest = source;
+        while let Some(open) = rest.find("{{") {
+            let Some(close) = rest[open + 2..].find("}}") else {
+                break;
+            };
+            let name = &rest[open + 2..open + 2 + close];
+            // Only identifier-like names are slots; anything else (prose,
+            // JSON examples) stays literal.
+            if name.is_empty() || !name.chars().all(|c| c.is_ascii_alphanumeric() || c == '_') {
+                segments.push(Segment::Literal(rest[..open + 2].to_string()));
+                rest = &rest[open + 2..];
+                continue;
+            }
+            if open > 0 {
+                segments.push(Segment::Literal(rest[..open].to_string()));
+            }
+            segments.push(Segment::Slot(rest[open..open + 4 + close].to_string()));
+            rest = &rest[open + 4 + close..];
+        }
+        if !rest.is_empty() {
+            segments.push(Segment::Literal(rest.to_string()));
+        }
+        Self { segments }
+    }
+
+    /// Render with `(pattern, replacement)` pairs whose patterns are
+    /// `{{NAME}}` placeholders. Slots without a substitution are kept
+    /// verbatim. A single pass, so a replacement that itself contains a
+    /// placeholder (a task quoting `{{EA_ID}}`) is not re-substituted.
+    pub(super) fn render(&self, substitutions: &[(&str, &str)]) -> String {
+        let mut out = String::new();
+        for segment in &self.segments {
+            match segment {
+                Segment::Literal(text) => out.push_str(text),
+                Segment::Slot(slot) => {
+                    let value = substitutions
+                        .iter()
+                        .find(|(pattern, _)| pattern == slot)
+                        .map_or(slot.as_str(), |(_, replacement)| replacement);
+                    out.push_str(value);
+                }
+            }
+        }
+        out
+    }
+}
+
+type TemplateCache = HashMap<PathBuf, (Option<FileStamp>, Arc<PromptTemplate>)>;
+
+fn templates() -> &'static Mutex<TemplateCache> {
+    static TEMPLATES: OnceLock<Mutex<TemplateCache>> = OnceLock::new();
+    TEMPLATES.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+/// The parsed template for `path`, re-read only when the file changed.
+/// A missing or unreadable file parses as empty, matching the
+/// `read_to_string(..).unwrap_or_default()` it replaces.
+pub(super) fn template(path: &Path) -> Arc<PromptTemplate> {
+    let stamp = FileStamp::of(path);
+    if let Some((cached, template)) = templates()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .get(path)
+    {
+        if *cached == stamp {
+            return Arc::clone(template);
+        }
+    }
+    let source = std::fs::read_to_string(path).unwrap_or_default();
+    let template = Arc::new(PromptTemplate::parse(&source));
+    templates()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .insert(path.to_path_buf(), (stamp, Arc::clone(&template)));
+    template
+}
+
+struct Artifact {
+    value: String,
+    files: Vec<(PathBuf, FileStamp)>,
+}
+
+type ArtifactCache = HashMap<(&'static str, u64), Artifact>;
+
+fn artifacts() -> &'static Mutex<ArtifactCache> {
+    static ARTIFACTS: OnceLock<Mutex<ArtifactCache>> = OnceLock::new();
+    ARTIFACTS.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+/// Return the cached output of materializer `kind` for inputs hashing to
+/// `key`, or run `build` and cache what it returns: the output plus the
+/// files it wrote. `None` from `build` (an I/O failure) is not cached, so
+/// the next spawn retries.
+pub(super) fn memoized(
+    kind: &'static str,
+    key: u64,
+    build: impl FnOnce() -> Option<(String, Vec<PathBuf>)>,
+) -> Option<String> {
+    if let Some(artifact) = artifacts()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .get(&(kind, key))
+    {
+        if artifact
+            .files
+            .iter()
+            .all(|(path, stamp)| FileStamp::of(path) == Some(*stamp))
+        {
+            return Some(artifact.value.clone());
+        }
+    }
+    let (value, paths) = build()?;
+    let files = paths
+        .into_iter()
+        .map(|path| FileStamp::of(&path).map(|stamp| (path, stamp)))
+        .collect::<Option<Vec<_>>>();
+    // A file that vanished straight after the build can't be validated
+    // later, so the result is returned but not cached.
+    if let Some(files) = files {
+        artifacts()
+            .lock()
+            .unwrap_or_else(|e| e.into_inner())
+            .insert(
+                (kind, key),
+                Artifact {
+                    value: value.clone(),
+                    files,
+                },
+            );
+    }
+    Some(value)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::content_hash::content_hash;
+    use std::cell::Cell;
+
+    #[test]
+    fn template_renders_slots_in_one_pass_and_keeps_unknown_text() {
+        let template = PromptTemplate::parse(
+            "Hi {{PARENT_NAME}}, do {{TASK}} for EA {{EA_ID}}. {{UNSET}} {{not a slot}} {\"a\": {{}}} {{",
+        );
+        let rendered = template.render(&[
+            ("{{PARENT_NAME}}", "ea"),
+            ("{{TASK}}", "echo {{EA_ID}} & $HOME"),
+            ("{{EA_ID}}", "3"),
+        ]);
+        assert_eq!(
+            rendered,
+            "Hi ea, do echo {{EA_ID}} & $HOME for EA 3. {{UNSET}} {{not a slot}} {\"a\": {{}}} {{"
+        );
+        assert_eq!(PromptTemplate::parse("").render(&[]), "");
+    }
+
+    #[test]
+    fn template_is_reparsed_when_the_file_changes() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("agent.md");
+        std::fs::write(&path, "one {{TASK}}").unwrap();
+        let first = template(&path);
+        assert!(Arc::ptr_eq(&first, &template(&path)));
+
+        std::fs::write(dir.path().join("next.md"), "two {{TASK}}!").unwrap();
+        std::fs::rename(dir.path().join("next.md"), &path).unwrap();
+        assert_eq!(template(&path).render(&[("{{TASK}}", "x")]), "two x!");
+    }
+
+    #[test]
+    fn memoized_reuses_output_until_a_written_file_changes() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("config.json");
+        let key = content_hash([path.to_string_lossy().as_bytes()]);
+        let builds = Cell::new(0);
+        let build = || {
+            builds.set(builds.get() + 1);
+            std::fs::write(&path, "{}").ok()?;
+            Some((path.display().to_string(), vec![path.clone()]))
+        };
+
+        assert_eq!(
+            memoized("test", key, build),
+            Some(path.display().to_string())
+        );
+        assert_eq!(
+            memoized("test", key, build),
+            Some(path.display().to_string())
+        );
+        assert_eq!(builds.get(), 1);
+
+        std::fs::remove_file(&path).unwrap();
+        memoized("test", key, build);
+        assert_eq!(builds.get(), 2, "a deleted artifact must be rebuilt");
+        assert!(path.exists());
+
+        assert_eq!(
+            memoized("test", key, || None),
+            Some(path.display().to_string())
+        );
+        assert_eq!(memoized("test", key ^ 1, || None), None);
+    }
+}
@@ -1,5 +1,6 @@
 //! Manager agent — prompt embedding, command building, and orchestration
 
+mod launch_cache;
 pub mod protocol;
 
 use anyhow::Result;
@@ -9,6 +10,7 @@ use std::thread;
 use std::time::{Duration, Instant};
 use uuid::Uuid;
 
+use crate::content_hash::content_hash;
 use crate::ea::{self, EaId};
 use crate::memory;
 use crate::metrics;
@@ -77,8 +79,13 @@ pub fn prompts_dir(omar_dir: &Path) -> PathBuf {
 
     for (name, content) in EMBEDDED_PROMPTS {
         let path = dir.join(name);
-        // Always overwrite so prompts stay in sync with the binary
-        std::fs::write(&path, content).ok();
+        // Overwrite so prompts stay in sync with the binary — once per
+        // process, and again only if something else touched the file.
+        let key = content_hash([path.as_os_str().as_encoded_bytes(), content.as_bytes()]);
+        launch_cache::memoized("embedded-prompt", key, || {
+            std::fs::write(&path, content).ok()?;
+            Some((String::new(), vec![path.clone()]))
+        });
     }
 
     dir
@@ -112,7 +119,7 @@ fn backend_native_disallowed_tools_csv() -> String {
         .join(",")
 }
 
-fn current_tmux_server() -> Option<String> {
+pub fn current_tmux_server() -> Option<String> {
     std::env::var("OMAR_TMUX_SERVER")
         .ok()
         .map(|server| server.trim().to_string())
@@ -203,16 +210,22 @@ fn ensure_codex_runtime_flags(base_command: &str) -> String {
     command
 }
 
+/// Render `prompt_file` with `{{NAME}}` substitutions from its cached,
+/// pre-parsed template. Missing files render as empty.
+pub fn render_prompt_file(prompt_file: &Path, substitutions: &[(&str, &str)]) -> String {
+    launch_cache::template(prompt_file).render(substitutions)
+}
+
+/// Write the rendered prompt to a content-addressed file in the private
+/// temp dir and return its path, so identical renders (every warm
+/// session, every agent given the same task) share one file that is
+/// written once.
 fn materialize_prompt_file(prompt_file: &Path, substitutions: &[(&str, &str)]) -> PathBuf {
     if substitutions.is_empty() {
         return prompt_file.to_path_buf();
     }
 
-    let mut content = std::fs::read_to_string(prompt_file).unwrap_or_default();
-    for (pattern, replacement) in substitutions {
-        content = content.replace(pattern, replacement);
-    }
-
+    let content = render_prompt_file(prompt_file, substitutions);
     let stem = prompt_file
         .file_stem()
         .and_then(|s| s.to_str())
@@ -221,24 +234,16 @@ fn materialize_prompt_file(prompt_file: &Path, substitutions: &[(&str, &str)]) -
         .extension()
         .and_then(|s| s.to_str())
         .unwrap_or("md");
+    let key = content_hash([stem.as_bytes(), ext.as_bytes(), content.as_bytes()]);
 
     // Backend reads this later, so no self-deleting guard; 0600 in the private dir.
-    let rendered = match crate::paths::private_temp_dir() {
-        Ok(dir) => dir.join(format!("{}-{}.{}", stem, Uuid::new_v4(), ext)),
-        Err(_) => return prompt_file.to_path_buf(),
-    };
-
-    match crate::paths::create_private_file(&rendered) {
-        Ok(mut file) => {
-            if file.write_all(content.as_bytes()).is_ok() {
-                rendered
-            } else {
-                let _ = std::fs::remove_file(&rendered);
-                prompt_file.to_path_buf()
-            }
-        }
-        Err(_) => prompt_file.to_path_buf(),
-    }
+    launch_cache::memoized("rendered-prompt", key, || {
+        let dir = crate::paths::private_temp_dir().ok()?;
+        let rendered = dir.join(format!("{}-{:016x}.{}", stem, key, ext));
+        write_private_file(&rendered, content.as_bytes()).ok()?;
+        Some((rendered.display().to_string(), vec![rendered]))
+    })
+    .map_or_else(|| prompt_file.to_path_buf(), PathBuf::from)
 }
 
 /// MCP state directory for a given EA. Stable per-EA path — avoids leaking
@@ -303,12 +308,30 @@ fn write_private_file(path: &Path, bytes: &[u8]) -> io::Result<()> {
     Ok(())
 }
 
+/// Cache key for an MCP artifact of `context`: the serialized context,
+/// the server binary it points at, and `HOME` for the configs written
+/// under it. Every agent of one EA shares the key, so the configs are
+/// generated once per EA rather than once per spawn.
+fn mcp_cache_key(context: &McpLaunchContext, server_exe: &Path) -> Option<u64> {
+    let json = serde_json::to_vec(context).ok()?;
+    let home = std::env::var_os("HOME").unwrap_or_default();
+    Some(content_hash([
+        json.as_slice(),
+        server_exe.as_os_str().as_encoded_bytes(),
+        home.as_encoded_bytes(),
+    ]))
+}
+
 fn materialize_mcp_context_file(context: &McpLaunchContext) -> Option<PathBuf> {
-    let dir = mcp_ea_dir(context)?;
-    let path = dir.join("context.json");
     let json = serde_json::to_vec(context).ok()?;
-    write_private_file(&path, &json).ok()?;
-    Some(path)
+    let key = content_hash([json.as_slice()]);
+    launch_cache::memoized("mcp-context", key, || {
+        let dir = mcp_ea_dir(context)?;
+        let path = dir.join("context.json");
+        write_private_file(&path, &json).ok()?;
+        Some((path.display().to_string(), vec![path]))
+    })
+    .map(PathBuf::from)
 }
 
 /// Strip a trailing " (deleted)" marker from an executable path.
@@ -359,6 +382,17 @@ fn omar_server_exe() -> Option<PathBuf> {
 
 fn materialize_claude_mcp_config(context: &McpLaunchContext) -> Option<PathBuf> {
     let server_exe = omar_server_exe()?;
+    let key = mcp_cache_key(context, &server_exe)?;
+    launch_cache::memoized("claude-mcp", key, || {
+        write_claude_mcp_config(context, &server_exe)
+    })
+    .map(PathBuf::from)
+}
+
+fn write_claude_mcp_config(
+    context: &McpLaunchContext,
+    server_exe: &Path,
+) -> Option<(String, Vec<PathBuf>)> {
     let context_file = materialize_mcp_context_file(context)?;
     let json = serde_json::json!({
         "mcpServers": {
@@ -373,12 +407,20 @@ fn materialize_claude_mcp_config(context: &McpLaunchContext) -> Option<PathBuf>
     let dir = mcp_ea_dir(context)?;
     let path = dir.join("claude-mcp.json");
     write_private_file(&path, &serde_json::to_vec(&json).ok()?).ok()?;
-    Some(path)
+    Some((path.display().to_string(), vec![context_file, path]))
 }
 
 fn codex_mcp_overrides(context: &McpLaunchContext) -> Option<String> {
     let server_exe = omar_server_exe()?;
-    let context_file = materialize_mcp_context_file(context)?;
+    let key = mcp_cache_key(context, &server_exe)?;
+    launch_cache::memoized("codex-mcp", key, || {
+        let context_file = materialize_mcp_context_file(context)?;
+        let overrides = codex_overrides_for(&server_exe, &context_file)?;
+        Some((overrides, vec![context_file]))
+    })
+}
+
+fn codex_overrides_for(server_exe: &Path, context_file: &Path) -> Option<String> {
     let command = serde_json::to_string(&server_exe.display().to_string()).ok()?;
     let args = serde_json::to_string(&vec![
         "mcp-server".to_string(),
@@ -397,7 +439,15 @@ fn codex_mcp_overrides(context: &McpLaunchContext) -> Option<String> {
 
 fn opencode_config_env(context: &McpLaunchContext) -> Option<String> {
     let server_exe = omar_server_exe()?;
-    let context_file = materialize_mcp_context_file(context)?;
+    let key = mcp_cache_key(context, &server_exe)?;
+    launch_cache::memoized("opencode-mcp", key, || {
+        let context_file = materialize_mcp_context_file(context)?;
+        let config = opencode_config_for(&server_exe, &context_file);
+        Some((config, vec![context_file]))
+    })
+}
+
+fn opencode_config_for(server_exe: &Path, context_file: &Path) -> String {
     // Disable every backend-native tool that overlaps an OMAR MCP tool so
     // delegation/scheduling can only flow through OMAR and stays visible in
     // the dashboard. Names that opencode does not expose are no-ops.
@@ -426,16 +476,24 @@ fn opencode_config_env(context: &McpLaunchContext) -> Option<String> {
             "doom_loop": "deny"
         }
     });
-    Some(config.to_string())
+    config.to_string()
 }
 
 fn ensure_cursor_mcp_config(context: &McpLaunchContext) -> Option<()> {
+    let server_exe = omar_server_exe()?;
+    let key = mcp_cache_key(context, &server_exe)?;
+    launch_cache::memoized("cursor-mcp", key, || {
+        write_cursor_mcp_config(context, &server_exe).map(|files| (String::new(), files))
+    })
+    .map(|_| ())
+}
+
+fn write_cursor_mcp_config(context: &McpLaunchContext, server_exe: &Path) -> Option<Vec<PathBuf>> {
     // Cursor only reads MCP servers from `~/.cursor/mcp.json`, so we have to
     // write there. Scope the key per-EA (`omar-ea-<id>`) so concurrent spawns
     // across EAs don't clobber each other, preserve every non-omar key the
     // user already has, and write via tmp+rename so partial writes under
     // concurrency can't corrupt the file.
-    let server_exe = omar_server_exe()?;
     let context_file = materialize_mcp_context_file(context)?;
     let home = std::env::var("HOME").ok()?;
     let cursor_dir = PathBuf::from(home).join(".cursor");
@@ -516,15 +574,26 @@ fn ensure_cursor_mcp_config(context: &McpLaunchContext) -> Option<()> {
         let _ = std::fs::remove_file(&tmp);
         return None;
     }
-    Some(())
+    Some(vec![context_file, path])
 }
 
 fn ensure_antigravity_mcp_config(context: &McpLaunchContext) -> Option<()> {
+    let server_exe = omar_server_exe()?;
+    let key = mcp_cache_key(context, &server_exe)?;
+    launch_cache::memoized("antigravity-mcp", key, || {
+        write_antigravity_mcp_config(context, &server_exe).map(|files| (String::new(), files))
+    })
+    .map(|_| ())
+}
+
+fn write_antigravity_mcp_config(
+    context: &McpLaunchContext,
+    server_exe: &Path,
+) -> Option<Vec<PathBuf>> {
     // Antigravity CLI loads MCP servers from native plugin bundles. Keep OMAR's
     // plugin EA-scoped so lifecycle and cleanup do not touch user plugins.
     // `agy plugin install` stages active plugins under ~/.gemini/config/plugins
     // and records them in ~/.gemini/config/import_manifest.json.
-    let server_exe = omar_server_exe()?;
     let context_file = materialize_mcp_context_file(context)?;
     let home = std::env::var("HOME").ok()?;
     let config_dir = PathBuf::from(home).join(".gemini").join("config");
@@ -623,7 +692,7 @@ fn ensure_antigravity_mcp_config(context: &McpLaunchContext) -> Option<()> {
     manifest["imports"] = serde_json::Value::Array(imports);
     let manifest_payload = serde_json::to_vec_pretty(&manifest).ok()?;
     write_private_file(&manifest_path, &manifest_payload).ok()?;
-    Some(())
+    Some(vec![context_file, plugin_path, config_path, manifest_path])
 }
 
 fn antigravity_config_dir() -> Option<PathBuf> {
@@ -1292,7 +1361,7 @@ fn spawn_worker(
     );
 
     // Create worker session — system prompt set at process start
-    client.new_session(
+    client.new_agent_session(
         &session_name,
         &cmd,
         Some(&std::env::current_dir()?.to_string_lossy()),
@@ -1546,6 +1615,45 @@ mod tests {
         assert!(cmd.contains("Load the '/tmp/"));
     }
 
+    #[test]
+    fn test_build_agent_command_cursor_reuses_content_addressed_prompt() {
+        let _env_lock = global_home_env_lock();
+        let dir = tempfile::tempdir().unwrap();
+        let _home = EnvVarGuard::set("HOME", dir.path());
+        let prompt = dir.path().join("agent.md");
+        std::fs::write(&prompt, "Task: {{TASK}} (EA {{EA_ID}})").unwrap();
+        let context = test_mcp_context(dir.path());
+        let build = |task: &str| {
+            build_agent_command(
+                "cursor agent",
+                &prompt,
+                &[("{{TASK}}", task), ("{{EA_ID}}", "0")],
+                &context,
+            )
+        };
+
+        let first = build("ship it");
+        assert_eq!(first, build("ship it"), "identical renders share one file");
+        assert_ne!(first, build("something else"));
+        let rendered = first
+            .split("Load the '")
+            .nth(1)
+            .and_then(|rest| rest.split('\'').next())
+            .map(PathBuf::from)
+            .unwrap();
+        assert_eq!(
+            std::fs::read_to_string(&rendered).unwrap(),
+            "Task: ship it (EA 0)"
+        );
+
+        // A removed artifact is rebuilt rather than handed out stale.
+        std::fs::remove_file(&rendered).unwrap();
+        std::fs::remove_dir_all(dir.path().join("mcp")).unwrap();
+        assert_eq!(build("ship it"), first);
+        assert!(rendered.exists());
+        assert!(dir.path().join("mcp/ea-0/context.json").exists());
+    }
+
     #[test]
     fn test_build_agent_command_agy() {
         let _env_lock = global_home_env_lock();
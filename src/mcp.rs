@@ -6,10 +6,11 @@ use anyhow::{anyhow, Context, Result};
 use regex::Regex;
 use serde::{Deserialize, Serialize};
 use serde_json::{json, Value};
+use std::collections::HashMap;
 use std::fs::{self, OpenOptions};
 use std::io::{self, BufRead, BufReader, Write};
 use std::path::{Path, PathBuf};
-use std::sync::OnceLock;
+use std::sync::{mpsc, Arc, Mutex, OnceLock};
 use std::thread;
 use std::time::{Duration, SystemTime, UNIX_EPOCH};
 use uuid::Uuid;
@@ -20,12 +21,16 @@ use crate::computer;
 use crate::config;
 use crate::ea::{self, EaId};
 use crate::manager::{self, McpLaunchContext};
+use crate::mcp_daemon;
 use crate::memory;
 use crate::metrics;
-use crate::process::{pid_alive, pid_file_is_stale};
+use crate::process::pid_alive;
 use crate::projects;
 use crate::scheduler::{self, ScheduledEvent};
-use crate::tmux::{DeliveryOptions, HealthChecker, TmuxClient};
+use crate::screen_capture::{CaptureOptions, Encoding, Rect};
+use crate::state_lock::{self, StateLock};
+use crate::tmux::{DeliveryOptions, HealthChecker, OutputLog, TmuxClient};
+use crate::warm_pool;
 
 const JSONRPC_VERSION: &str = "2.0";
 const PROTOCOL_VERSION: &str = "2024-11-05";
@@ -262,6 +267,189 @@ fn supports_initial_prompt_delivery(backend_name: &str) -> bool {
     backend_name != "unknown"
 }
 
+/// `get_agent_output` window without `max_bytes`, and its upper bound.
+const DEFAULT_OUTPUT_BYTES: u64 = 16 * 1024;
+const MAX_OUTPUT_BYTES: u64 = 256 * 1024;
+/// Most items one batch tool call may carry.
+const MAX_BATCH_ITEMS: usize = 256;
+/// Sessions a `spawn_agents` call creates at once.
+const SPAWN_PARALLELISM: usize = 8;
+/// Agents a `send_inputs` call types into at once.
+const SEND_PARALLELISM: usize = 16;
+
+#[derive(Deserialize)]
+struct SpawnAgentArgs {
+    name: String,
+    #[serde(deserialize_with = "flex_int::deserialize_usize")]
+    project_id: usize,
+    task: Option<String>,
+    workdir: Option<String>,
+    command: Option<String>,
+    backend: Option<String>,
+    model: Option<String>,
+    reasoning_effort: Option<String>,
+    parent: Option<String>,
+}
+
+/// A validated spawn: everything needed to start the session and record it.
+struct SpawnPlan {
+    session_name: String,
+    short_name: String,
+    project_id: usize,
+    project_name: String,
+    task: String,
+    parent_session: String,
+    prompt_parent: String,
+    base_command: String,
+    backend_name: String,
+    supports_prompt_delivery: bool,
+    workdir: String,
+}
+
+impl SpawnPlan {
+    fn spawned_agent(&self) -> memory::SpawnedAgent<'_> {
+        memory::SpawnedAgent {
+            session: &self.session_name,
+            parent: &self.parent_session,
+            task: &self.task,
+            project_id: self.project_id,
+        }
+    }
+}
+
+fn spawn_result(plan: &SpawnPlan, warm_start: bool, initial_prompt_delivery: String) -> Value {
+    json!({
+        "project_id": plan.project_id,
+        "project_name": plan.project_name,
+        "agent_name": plan.short_name,
+        "status": "running",
+        "warm_start": warm_start,
+        "initial_prompt_delivery": initial_prompt_delivery,
+    })
+}
+
+#[derive(Deserialize)]
+struct SendInputArgs {
+    name: String,
+    text: String,
+    #[serde(default)]
+    enter: bool,
+}
+
+fn send_text(client: &TmuxClient, session_name: &str, text: &str, enter: bool) -> Result<()> {
+    client.send_keys_literal(session_name, text)?;
+    if enter {
+        thread::sleep(Duration::from_millis(100));
+        client.send_keys(session_name, "Enter")?;
+    }
+    Ok(())
+}
+
+fn scheduled_event_json(event: &ScheduledEvent) -> Value {
+    json!({
+        "id": event.id,
+        "sender": event.sender,
+        "receiver": event.receiver,
+        "timestamp_ns": event.timestamp,
+        "recurring_ns": event.recurring_ns,
+    })
+}
+
+fn check_batch_len(tool: &str, len: usize) -> Result<()> {
+    if len == 0 {
+        return Err(anyhow!("{} needs at least one item", tool));
+    }
+    if len > MAX_BATCH_ITEMS {
+        return Err(anyhow!(
+            "{} takes at most {} items per call, got {}",
+            tool,
+            MAX_BATCH_ITEMS,
+            len
+        ));
+    }
+    Ok(())
+}
+
+/// The result entry of a batch item that failed.
+fn batch_error(index: usize, err: &anyhow::Error) -> Value {
+    json!({ "index": index, "ok": false, "error": format!("{:#}", err) })
+}
+
+/// Map `f` over `items` on up to `workers` scoped threads, keeping input
+/// order in the output. tmux commands are subprocesses, so the work is
+/// waiting, not CPU.
+fn parallel_map<T: Sync, R: Send>(
+    items: &[T],
+    workers: usize,
+    f: impl Fn(&T) -> R + Sync,
+) -> Vec<R> {
+    let workers = workers.clamp(1, items.len().max(1));
+    if workers == 1 {
+        return items.iter().map(f).collect();
+    }
+    let next = std::sync::atomic::AtomicUsize::new(0);
+    let mut indexed: Vec<(usize, R)> = thread::scope(|scope| {
+        let handles: Vec<_> = (0..workers)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut out = Vec::new();
+                    loop {
+                        let i = next.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+                        let Some(item) = items.get(i) else {
+                            return out;
+                        };
+                        out.push((i, f(item)));
+                    }
+                })
+            })
+            .collect();
+        handles
+            .into_iter()
+            .flat_map(|handle| handle.join().expect("parallel_map worker panicked"))
+            .collect()
+    });
+    indexed.sort_by_key(|(i, _)| *i);
+    indexed.into_iter().map(|(_, r)| r).collect()
+}
+
+/// Start a batch whose item `i` may have an earlier item `parents[i]` as
+/// its parent. Items start in parallel waves by depth, so a child only
+/// starts once its parent has; a child whose parent failed is failed
+/// without being started rather than left running under a session that
+/// doesn't exist.
+fn start_in_waves<T: Sync, R: Send>(
+    items: &[T],
+    parents: &[Option<usize>],
+    workers: usize,
+    start: impl Fn(&T) -> Result<R> + Sync,
+) -> Vec<Result<R>> {
+    let mut depths: Vec<usize> = Vec::with_capacity(items.len());
+    for parent in parents {
+        let depth = parent.map_or(0, |p| depths[p] + 1);
+        depths.push(depth);
+    }
+    let mut results: Vec<Option<Result<R>>> = items.iter().map(|_| None).collect();
+    for depth in 0..=depths.iter().copied().max().unwrap_or(0) {
+        let mut wave = Vec::new();
+        for i in (0..items.len()).filter(|&i| depths[i] == depth) {
+            match parents[i] {
+                Some(p) if !matches!(results[p], Some(Ok(_))) => {
+                    results[i] = Some(Err(anyhow!("Not started: its parent failed to start")));
+                }
+                _ => wave.push(i),
+            }
+        }
+        let started = parallel_map(&wave, workers, |&i| start(&items[i]));
+        for (i, result) in wave.into_iter().zip(started) {
+            results[i] = Some(result);
+        }
+    }
+    results
+        .into_iter()
+        .map(|result| result.expect("every depth up to the deepest item is started"))
+        .collect()
+}
+
 fn validate_model_name(model: &str) -> Result<()> {
     if !model
         .chars()
@@ -312,7 +500,7 @@ fn apply_spawn_agent_command_overrides(
     Ok(base_command)
 }
 
-fn append_debug_log(context: &McpLaunchContext, line: &str) {
+pub(crate) fn append_debug_log(context: &McpLaunchContext, line: &str) {
     let state_dir = ea::ea_state_dir(context.ea_id, &context.omar_dir);
     if std::fs::create_dir_all(&state_dir).is_err() {
         return;
@@ -353,12 +541,11 @@ fn clean_human_output(output: &str) -> String {
     control_re.replace_all(&output, "").to_string()
 }
 
-fn backend_available_from_command(command: &str, fallback_executable: &str) -> bool {
-    let executable = command
+fn backend_executable<'a>(command: &'a str, fallback_executable: &'a str) -> &'a str {
+    command
         .split_whitespace()
         .next()
-        .unwrap_or(fallback_executable);
-    backend_probe::backend_version_probe_succeeds(executable)
+        .unwrap_or(fallback_executable)
 }
 
 #[cfg(test)]
@@ -383,10 +570,6 @@ fn health_from_activity(activity: i64, idle_warning: i64) -> &'static str {
     }
 }
 
-fn lock_path_for_state_dir(state_dir: &Path) -> PathBuf {
-    state_dir.join(".mcp-state.lock")
-}
-
 #[derive(Debug, Serialize, Deserialize)]
 struct LockFile {
     pid: u32,
@@ -399,44 +582,6 @@ struct LockInfo {
     owner: String,
 }
 
-struct FileLock {
-    path: PathBuf,
-}
-
-impl FileLock {
-    fn acquire(path: PathBuf) -> Result<Self> {
-        if let Some(parent) = path.parent() {
-            fs::create_dir_all(parent)
-                .with_context(|| format!("Failed to create lock directory {:?}", parent))?;
-        }
-        for _ in 0..500 {
-            match OpenOptions::new().write(true).create_new(true).open(&path) {
-                Ok(mut file) => {
-                    let _ = writeln!(file, "{}", std::process::id());
-                    return Ok(Self { path });
-                }
-                Err(err) if err.kind() == io::ErrorKind::AlreadyExists => {
-                    if pid_file_is_stale(&path) {
-                        let _ = fs::remove_file(&path);
-                        continue;
-                    }
-                    thread::sleep(Duration::from_millis(10));
-                }
-                Err(err) => {
-                    return Err(err).with_context(|| format!("Failed to acquire {:?}", path))
-                }
-            }
-        }
-        Err(anyhow!("Timed out waiting for lock {:?}", path))
-    }
-}
-
-impl Drop for FileLock {
-    fn drop(&mut self) {
-        let _ = fs::remove_file(&self.path);
-    }
-}
-
 pub fn run_server_from_context_file(path: PathBuf) -> Result<()> {
     let context: McpLaunchContext = serde_json::from_str(
         &fs::read_to_string(&path)
@@ -444,6 +589,15 @@ pub fn run_server_from_context_file(path: PathBuf) -> Result<()> {
     )
     .with_context(|| format!("Failed to parse MCP context file {}", path.display()))?;
     apply_context_environment(&context);
+    serve_context(context)
+}
+
+/// Serve `context` over stdio: through the shared daemon when it takes the
+/// connection, otherwise in this process.
+fn serve_context(context: McpLaunchContext) -> Result<()> {
+    if mcp_daemon::forward(&context) {
+        return Ok(());
+    }
     OmarMcpServer::new(context).run()
 }
 
@@ -468,8 +622,9 @@ pub fn run_server_with_default_context() -> Result<()> {
                 .join(".omar")
         });
     let config_path = omar_dir.join("config.toml").to_string_lossy().into_owned();
-    let config = crate::config::Config::load(Some(&config_path))
+    let mut config = crate::config::Config::load(Some(&config_path))
         .with_context(|| format!("Failed to load omar config for {}", omar_dir.display()))?;
+    config.detect_default_command();
     let registered = ea::ensure_default_ea(&omar_dir)?;
     let ea_id = resolve_default_context_ea(&omar_dir, &registered)?;
     let context = McpLaunchContext {
@@ -484,7 +639,7 @@ pub fn run_server_with_default_context() -> Result<()> {
             .map(|server| server.trim().to_string())
             .filter(|server| !server.is_empty()),
     };
-    OmarMcpServer::new(context).run()
+    serve_context(context)
 }
 
 /// Pick the EA id for a default-context server. Honors `OMAR_EA_ID` so
@@ -509,21 +664,78 @@ fn resolve_default_context_ea(omar_dir: &Path, registered: &[ea::EaInfo]) -> Res
     Ok(ea::resolve_active_ea(omar_dir, registered))
 }
 
-struct OmarMcpServer {
+/// Set to answer every tool call in arrival order on one worker.
+pub(crate) const SERIAL_DISPATCH_ENV: &str = "OMAR_MCP_SERIAL";
+/// Workers for read-only tool calls.
+const READ_ONLY_WORKERS: usize = 4;
+
+/// Tools that only read state, so they can run next to each other and next
+/// to a mutating call. Everything else is serialised: those tools take
+/// state locks, type into panes or move the shared mouse, and concurrent
+/// calls from one backend are rarely what it meant.
+fn is_read_only_tool(name: &str) -> bool {
+    matches!(
+        name,
+        "list_backends"
+            | "list_eas"
+            | "get_active_ea"
+            | "list_agents"
+            | "get_agent"
+            | "get_agent_output"
+            | "get_agent_summary"
+            | "list_projects"
+            | "list_events"
+            | "computer_status"
+            | "computer_screenshot"
+            | "computer_screen_size"
+            | "computer_mouse_position"
+    )
+}
+
+/// One `tool_latency` line per tool in `tools`, e.g.
+/// `tool_latency name=list_events count=3 p50_ms=0.4 p99_ms=1.2 max_ms=1.2`.
+fn latency_summary(tools: &metrics::LabeledHistogram) -> Vec<String> {
+    let ms = |us: u64| us as f64 / 1000.0;
+    tools
+        .snapshots()
+        .into_iter()
+        .map(|(tool, latency)| {
+            format!(
+                "tool_latency name={} count={} p50_ms={:.1} p99_ms={:.1} max_ms={:.1}",
+                tool,
+                latency.count,
+                ms(latency.quantile(0.5)),
+                ms(latency.quantile(0.99)),
+                ms(latency.max_us)
+            )
+        })
+        .collect()
+}
+
+pub(crate) struct OmarMcpServer {
     context: McpLaunchContext,
     state_dir: PathBuf,
     session_prefix: String,
     manager_session: String,
-    scheduler: scheduler::Scheduler,
+    scheduler: Arc<scheduler::Scheduler>,
 }
 
 impl OmarMcpServer {
     fn new(context: McpLaunchContext) -> Self {
+        let scheduler = Arc::new(scheduler::Scheduler::with_store(
+            scheduler::events_store_path(&context.omar_dir),
+        ));
+        Self::with_scheduler(context, scheduler)
+    }
+
+    /// A server sharing `scheduler` with others, as the daemon's are.
+    pub(crate) fn with_scheduler(
+        context: McpLaunchContext,
+        scheduler: Arc<scheduler::Scheduler>,
+    ) -> Self {
         let state_dir = ea::ea_state_dir(context.ea_id, &context.omar_dir);
         let session_prefix = ea::ea_prefix(context.ea_id, &context.session_prefix);
         let manager_session = ea::ea_manager_session(context.ea_id, &context.session_prefix);
-        let scheduler =
-            scheduler::Scheduler::with_store(scheduler::events_store_path(&context.omar_dir));
         Self {
             context,
             state_dir,
@@ -534,42 +746,132 @@ impl OmarMcpServer {
     }
 
     fn run(&self) -> Result<()> {
+        let result = self.serve();
+        // Tool calls only queue memory.md rewrites; land them before exit.
+        memory::flush_memory_writes();
+        metrics::flush();
+        result
+    }
+
+    fn serve(&self) -> Result<()> {
         let stdin = io::stdin();
-        let stdout = io::stdout();
-        let mut reader = BufReader::new(stdin.lock());
-        let mut writer = stdout.lock();
+        let reader = BufReader::new(stdin.lock());
+        let concurrent = std::env::var_os(SERIAL_DISPATCH_ENV).is_none();
+        let result = self.serve_on(reader, io::stdout(), concurrent);
+        self.log_latency();
+        result
+    }
 
-        while let Some(message) = read_message(&mut reader)? {
-            match message {
-                McpRead::Request(request, framing) => {
+    /// Write this process's per-tool latency summary, from
+    /// [`metrics::MCP_TOOL`], to the debug log.
+    pub(crate) fn log_latency(&self) {
+        for line in latency_summary(&metrics::MCP_TOOL) {
+            append_debug_log(&self.context, &line);
+        }
+    }
+
+    /// Answer requests from `reader` until EOF. With `concurrent`, read-only
+    /// tool calls run on a small worker pool while every other tool call
+    /// runs, in arrival order, on one serial worker; responses are written
+    /// as they complete, which JSON-RPC allows since each carries its id.
+    /// Protocol methods (`initialize`, `tools/list`, `ping`) are answered
+    /// inline. Without `concurrent`, every tool call goes to the serial
+    /// worker, which answers in arrival order.
+    pub(crate) fn serve_on(
+        &self,
+        mut reader: impl BufRead,
+        writer: impl Write + Send,
+        concurrent: bool,
+    ) -> Result<()> {
+        type Job = (JsonRpcRequest, MessageFraming);
+        let (response_tx, response_rx) = mpsc::channel::<(JsonRpcResponse, MessageFraming)>();
+        let (serial_tx, serial_rx) = mpsc::channel::<Job>();
+        let (read_tx, read_rx) = mpsc::channel::<Job>();
+        let read_rx = Mutex::new(read_rx);
+
+        thread::scope(|scope| {
+            let writer_thread = scope.spawn(move || -> Result<()> {
+                let mut writer = writer;
+                for (response, framing) in response_rx {
                     append_debug_log(
                         &self.context,
-                        &format!("request method={} id={:?}", request.method, request.id),
+                        &format!(
+                            "response id={} has_error={}",
+                            response.id,
+                            response.error.is_some()
+                        ),
                     );
-                    let maybe_response = self.handle_request(request);
-                    if let Some(response) = maybe_response {
-                        append_debug_log(
-                            &self.context,
-                            &format!(
-                                "response id={} has_error={}",
-                                response.id,
-                                response.error.is_some()
-                            ),
-                        );
-                        write_message(&mut writer, &response, framing)?;
-                        writer.flush()?;
-                    }
-                }
-                McpRead::ParseError { message, framing } => {
-                    append_debug_log(&self.context, &format!("parse_error err={}", message));
-                    let response = error_response(Value::Null, -32700, &message);
                     write_message(&mut writer, &response, framing)?;
                     writer.flush()?;
                 }
+                Ok(())
+            });
+
+            let run_job = |(request, framing): Job, response_tx: &mpsc::Sender<_>| {
+                if let Some(response) = self.handle_request(request) {
+                    let _ = response_tx.send((response, framing));
+                }
+            };
+            {
+                let response_tx = response_tx.clone();
+                scope.spawn(move || {
+                    for job in serial_rx {
+                        run_job(job, &response_tx);
+                    }
+                });
+            }
+            for _ in 0..READ_ONLY_WORKERS {
+                let response_tx = response_tx.clone();
+                let read_rx = &read_rx;
+                scope.spawn(move || loop {
+                    // Hold the queue lock only to take a job, not to run it.
+                    let job = read_rx.lock().unwrap().recv();
+                    match job {
+                        Ok(job) => run_job(job, &response_tx),
+                        Err(_) => break,
+                    }
+                });
             }
-        }
 
-        Ok(())
+            let read_result = (|| -> Result<()> {
+                while let Some(message) = read_message(&mut reader)? {
+                    match message {
+                        McpRead::Request(request, framing) => {
+                            append_debug_log(
+                                &self.context,
+                                &format!("request method={} id={:?}", request.method, request.id),
+                            );
+                            if request.method != "tools/call" {
+                                run_job((request, framing), &response_tx);
+                                continue;
+                            }
+                            let read_only = concurrent
+                                && request.params["name"]
+                                    .as_str()
+                                    .is_some_and(is_read_only_tool);
+                            let queue = if read_only { &read_tx } else { &serial_tx };
+                            let _ = queue.send((request, framing));
+                        }
+                        McpRead::ParseError { message, framing } => {
+                            append_debug_log(
+                                &self.context,
+                                &format!("parse_error err={}", message),
+                            );
+                            let response = error_response(Value::Null, -32700, &message);
+                            let _ = response_tx.send((response, framing));
+                        }
+                    }
+                }
+                Ok(())
+            })();
+
+            // Let the workers drain their queues, then the writer.
+            drop(serial_tx);
+            drop(read_tx);
+            drop(response_tx);
+            let write_result = writer_thread.join().expect("MCP writer panicked");
+            read_result.and(write_result)
+        })
     }
 
     fn handle_request(&self, request: JsonRpcRequest) -> Option<JsonRpcResponse> {
@@ -613,6 +915,7 @@ impl OmarMcpServer {
             &self.context,
             &format!("tool_call name={} args={}", call.name, call.arguments),
         );
+        let started = std::time::Instant::now();
         let result = match call.name.as_str() {
             "list_backends" => self.list_backends(),
             "list_eas" => self.list_eas(),
@@ -622,15 +925,19 @@ impl OmarMcpServer {
             "delete_ea" => self.delete_ea(call.arguments),
             "list_agents" => self.list_agents(),
             "get_agent" => self.get_agent(call.arguments),
+            "get_agent_output" => self.get_agent_output(call.arguments),
             "get_agent_summary" => self.get_agent_summary(call.arguments),
             "update_agent_status" => self.update_agent_status(call.arguments),
             "spawn_agent" => self.spawn_agent(call.arguments),
+            "spawn_agents" => self.spawn_agents(call.arguments),
             "kill_agent" => self.kill_agent(call.arguments),
             "send_input" => self.send_input(call.arguments),
+            "send_inputs" => self.send_inputs(call.arguments),
             "list_projects" => self.list_projects(),
             "add_project" => self.add_project(call.arguments),
             "complete_project" => self.complete_project(call.arguments),
             "schedule_omar_event" => self.schedule_omar_event(call.arguments),
+            "schedule_omar_events" => self.schedule_omar_events(call.arguments),
             "list_events" => self.list_events(),
             "cancel_event" => self.cancel_event(call.arguments),
             "log_justification" => self.log_justification(call.arguments),
@@ -646,15 +953,21 @@ impl OmarMcpServer {
             other => Err(anyhow!("Unknown tool '{}'", other)),
         };
 
+        let elapsed = started.elapsed();
+        metrics::MCP_TOOL.record(&call.name, elapsed);
+        let ms = elapsed.as_millis();
         match result {
             Ok(value) => {
-                append_debug_log(&self.context, &format!("tool_ok name={}", call.name));
+                append_debug_log(
+                    &self.context,
+                    &format!("tool_ok name={} ms={}", call.name, ms),
+                );
                 tool_success_for(&call.name, value)
             }
             Err(err) => {
                 append_debug_log(
                     &self.context,
-                    &format!("tool_err name={} err={}", call.name, err),
+                    &format!("tool_err name={} ms={} err={}", call.name, ms, err),
                 );
                 tool_error(err)
             }
@@ -701,50 +1014,61 @@ impl OmarMcpServer {
         &self.scheduler
     }
 
-    fn refresh_memory_locked(&self) -> Result<()> {
-        let state_dir = self.state_dir();
-        let prefix = self.session_prefix();
-        let manager_session = self.manager_session();
-        let client = TmuxClient::new(prefix);
-        let mut checker = HealthChecker::new(client.clone(), self.context.health_idle_warning);
-        let sessions = client.list_sessions().unwrap_or_default();
-        let mut manager = None;
-        let mut agents = Vec::new();
-        for session in sessions {
-            let info = AgentInfo {
-                session: session.clone(),
-                health: checker.check(&session.name),
-                is_unresolved: false,
-            };
-            if session.name == manager_session {
-                manager = Some(info);
-            } else {
-                agents.push(info);
+    /// Queue a memory.md rewrite. The session listing, health checks and
+    /// pane capture run on the background memory writer, so tool calls
+    /// return without waiting on tmux, and a burst of calls costs one write.
+    fn refresh_memory(&self) {
+        let prefix = self.session_prefix().to_string();
+        let manager_session = self.manager_session().to_string();
+        let idle_warning = self.context.health_idle_warning;
+        let scheduler = self.scheduler.clone();
+        let ea_id = self.ea_id();
+        memory::queue_memory_write(self.state_dir(), move || {
+            let client = TmuxClient::new(prefix);
+            let mut checker = HealthChecker::new(client.clone(), idle_warning);
+            let sessions = client.list_sessions().unwrap_or_default();
+            let mut manager = None;
+            let mut agents = Vec::new();
+            for session in sessions {
+                let info = AgentInfo {
+                    session: session.clone(),
+                    health: checker.check(&session.name),
+                    is_unresolved: false,
+                };
+                if session.name == manager_session {
+                    manager = Some(info);
+                } else {
+                    agents.push(info);
+                }
             }
-        }
-        memory::write_memory_to(
-            state_dir,
-            &agents,
-            manager.as_ref(),
-            manager_session,
-            &client,
-            &self.scheduler().list_by_ea(self.ea_id()),
-        );
-        Ok(())
+            memory::MemorySnapshot {
+                agents,
+                manager,
+                manager_session,
+                client,
+                events: scheduler.list_by_ea(ea_id),
+            }
+        });
     }
 
     fn list_backends(&self) -> Result<Value> {
-        let backends = ["claude", "codex", "cursor", "opencode", "agy"];
+        let backends: Vec<(&str, String)> = ["claude", "codex", "cursor", "opencode", "agy"]
+            .into_iter()
+            .filter_map(|name| Some((name, config::resolve_backend(name).ok()?)))
+            .collect();
+        let executables: Vec<&str> = backends
+            .iter()
+            .map(|(name, command)| backend_executable(command, name))
+            .collect();
         let infos: Vec<Value> = backends
             .iter()
-            .filter_map(|name| {
-                let command = config::resolve_backend(name).ok()?;
-                let available = backend_available_from_command(&command, name);
-                Some(json!({
+            .zip(backend_probe::backends_available(&executables))
+            .map(|((name, command), available)| {
+                json!({
                     "name": name,
                     "available": available,
                     "command": command,
-                }))
+                })
             })
             .collect();
         Ok(json!({ "backends": infos }))
@@ -869,6 +1193,7 @@ impl OmarMcpServer {
                 .map_err(|e| anyhow!("Failed to kill session '{}': {}", session_name, e))?;
             killed += 1;
         }
+        warm_pool::drain(&self.context.session_prefix, args.ea_id);
         let state_dir = ea::ea_state_dir(args.ea_id, &self.context.omar_dir);
         if state_dir.exists() {
             fs::remove_dir_all(&state_dir)
@@ -892,7 +1217,7 @@ impl OmarMcpServer {
                 .map_err(|e| anyhow!("Failed to remove mcp dir {:?}: {}", mcp_dir, e))?;
         }
         manager::remove_omar_antigravity_mcp_config(args.ea_id)?;
-        let events_cancelled = self.scheduler().cancel_by_ea(args.ea_id);
+        let events_cancelled = self.scheduler().cancel_by_ea(args.ea_id)?;
         ea::unregister_ea(&self.context.omar_dir, args.ea_id)?;
         Ok(json!({
             "deleted_ea": args.ea_id,
@@ -904,16 +1229,16 @@ impl OmarMcpServer {
     fn list_agents(&self) -> Result<Value> {
         let client = self.client();
         let manager_session = self.manager_session();
-        let sessions = client.list_sessions()?;
-        let agents: Vec<Value> = sessions
+        // One batched snapshot instead of a capture round-trip per agent.
+        let snapshots = client.snapshot_all(self.session_prefix(), 50)?;
+        let agents: Vec<Value> = snapshots
             .iter()
-            .filter(|s| s.name != manager_session)
+            .filter(|s| s.session.name != manager_session)
             .map(|s| {
-                let output =
-                    clean_human_output(&client.capture_pane_plain(&s.name, 50).unwrap_or_default());
+                let output = clean_human_output(&s.tail);
                 json!({
-                    "id": self.display_name(&s.name),
-                    "health": health_from_activity(s.activity, self.context.health_idle_warning),
+                    "id": self.display_name(&s.session.name),
+                    "health": health_from_activity(s.session.activity, self.context.health_idle_warning),
                     "last_output": last_output_line(&output),
                 })
             })
@@ -942,35 +1267,105 @@ impl OmarMcpServer {
         }))
     }
 
-    fn get_agent_summary(&self, args: Value) -> Result<Value> {
+    /// Output `name` printed since `since_offset`, from its output log.
+    /// Without a cursor, returns the latest `max_bytes`. Offsets only grow,
+    /// so `next_offset` is the cursor for the following call.
+    fn get_agent_output(&self, args: Value) -> Result<Value> {
         #[derive(Deserialize)]
         struct Args {
             name: String,
+            #[serde(default, deserialize_with = "flex_int::deserialize_opt_u64")]
+            since_offset: Option<u64>,
+            #[serde(default, deserialize_with = "flex_int::deserialize_opt_u64")]
+            max_bytes: Option<u64>,
         }
         let args: Args = serde_json::from_value(args)?;
-        let state_dir = self.state_dir();
         let client = self.client();
         let session_name = self.qualified_session_name(&args.name)?;
         if !client.has_session(&session_name).unwrap_or(false) {
             return Err(anyhow!("Agent '{}' not found", args.name));
         }
+        let log = self.output_log(&session_name);
+        // Sessions spawned before output logging, and the EA manager, are
+        // attached on first use.
+        if !log.attach(&client, &session_name)? {
+            return Err(anyhow!(
+                "Agent '{}' output is piped elsewhere; use get_agent instead",
+                args.name
+            ));
+        }
+
+        let max_bytes = args
+            .max_bytes
+            .unwrap_or(DEFAULT_OUTPUT_BYTES)
+            .clamp(1, MAX_OUTPUT_BYTES) as usize;
+        let since = args
+            .since_offset
+            .unwrap_or_else(|| log.end_offset().saturating_sub(max_bytes as u64));
+        let mut read = log.read(since, max_bytes);
+        // Resume at a character boundary: leading continuation bytes belong
+        // to a character the previous read returned or the ring dropped,
+        // and an incomplete trailing character is returned next time.
+        let skip = read
+            .data
+            .iter()
+            .take(3)
+            .take_while(|byte| (**byte & 0xc0) == 0x80)
+            .count();
+        let complete = match std::str::from_utf8(&read.data[skip..]) {
+            Err(err) if err.error_len().is_none() => skip + err.valid_up_to(),
+            _ => read.data.len(),
+        };
+        read.next_offset -= (read.data.len() - complete) as u64;
+        let text = String::from_utf8_lossy(&read.data[skip..complete]);
+
+        let markers = log.markers();
+        Ok(json!({
+            "id": self.display_name(&session_name),
+            "offset": read.offset,
+            "next_offset": read.next_offset,
+            "dropped_bytes": read.dropped,
+            "output": clean_human_output(&text),
+            "task_complete_offset": markers.last_marker_end,
+            "ready_to_complete": markers.ready_to_complete(),
+        }))
+    }
+
+    fn output_log(&self, session_name: &str) -> OutputLog {
+        OutputLog::new(crate::tmux::output_log_dir(self.state_dir(), session_name))
+    }
+
+    fn get_agent_summary(&self, args: Value) -> Result<Value> {
+        #[derive(Deserialize)]
+        struct Args {
+            name: String,
+        }
+        let args: Args = serde_json::from_value(args)?;
+        let state_dir = self.state_dir();
+        let client = self.client();
+        let session_name = self.qualified_session_name(&args.name)?;
+        // Existence, children and activity all come from one snapshot. It
+        // is unfiltered because the manager does not carry the worker prefix.
+        let snapshots = client.snapshot_all("", 0)?;
+        let Some(activity) = snapshots
+            .iter()
+            .find(|s| s.session.name == session_name)
+            .map(|s| s.pane_activity)
+        else {
+            return Err(anyhow!("Agent '{}' not found", args.name));
+        };
         let short_name = self.display_name(&session_name).to_string();
         let task = memory::load_worker_tasks_from(state_dir)
             .remove(&session_name)
             .filter(|text| !text.trim().is_empty());
-        let agent_parents = memory::load_agent_parents_from(state_dir);
-        let children: Vec<String> = client
-            .list_sessions()?
+        let children: Vec<String> = memory::load_agent_children_in(state_dir, &session_name)
             .into_iter()
-            .filter_map(|session| {
-                if agent_parents.get(&session.name) == Some(&session_name) {
-                    Some(self.display_name(&session.name).to_string())
-                } else {
-                    None
-                }
+            .filter(|child| {
+                child.starts_with(self.session_prefix())
+                    && snapshots.iter().any(|s| &s.session.name == child)
             })
+            .map(|child| self.display_name(&child).to_string())
             .collect();
-        let activity = client.get_pane_activity(&session_name).unwrap_or(0);
         let health = health_from_activity(activity, self.context.health_idle_warning);
         Ok(json!({
             "id": short_name,
@@ -989,44 +1384,216 @@ impl OmarMcpServer {
         }
         let args: Args = serde_json::from_value(args)?;
         let state_dir = self.state_dir();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
+        // Status files are replaced atomically and never read-modify-written,
+        // so no state lock is needed here.
         let session_name = self.qualified_session_name(&args.name)?;
         let client = self.client();
         if !client.has_session(&session_name).unwrap_or(false) {
             return Err(anyhow!("Agent '{}' not found", args.name));
         }
         memory::save_agent_status_in(state_dir, &session_name, &args.status);
-        self.refresh_memory_locked()?;
+        self.refresh_memory();
         Ok(json!({ "status": "updated" }))
     }
 
-    /// The single MCP spawn path. Requires an existing `project_id`.
+    /// Full session name for a spawn's `name`; an empty name gets the next
+    /// free number.
+    fn spawn_session_name(&self, name: &str, reserved: &[String]) -> String {
+        let prefix = self.session_prefix();
+        match name.trim() {
+            n if !n.is_empty() => {
+                let stripped = n.strip_prefix(prefix).unwrap_or(n);
+                format!("{}{}", prefix, stripped)
+            }
+            _ => generate_agent_name_in_ea(prefix, reserved),
+        }
+    }
+
+    /// Spawn one agent. Requires an existing `project_id`; `spawn_agents` is
+    /// the same path for a batch.
     fn spawn_agent(&self, args: Value) -> Result<Value> {
+        let args: SpawnAgentArgs = serde_json::from_value(args)?;
+        let spawn_start = std::time::Instant::now();
+        let state_dir = self.state_dir();
+        let session_name = self.spawn_session_name(&args.name, &[]);
+
+        // Spawns of different agents only contend on project membership,
+        // and only while validating and recording it (see `state_lock`).
+        let lock_wait_start = std::time::Instant::now();
+        let _agent_lock =
+            StateLock::acquire(state_dir, &state_lock::agent_lock_name(&session_name))?;
+        let projects_lock = StateLock::acquire(state_dir, state_lock::PROJECTS)?;
+        let spawn_lock_wait_ms = lock_wait_start.elapsed().as_millis() as u64;
+
+        let plan = self.plan_spawn(args, session_name, &HashMap::new())?;
+        let tmux_spawn_start = std::time::Instant::now();
+        let warm_start = self.start_spawn(&plan)?;
+        let tmux_spawn_ms = tmux_spawn_start.elapsed().as_millis() as u64;
+
+        memory::save_spawned_agents_in(state_dir, &[plan.spawned_agent()]);
+        drop(projects_lock);
+
+        let initial_prompt_delivery = match self.deliver_initial_prompt(&plan) {
+            Some(delivery) => delivery
+                .recv_timeout(INITIAL_PROMPT_DELIVERY_STATUS_TIMEOUT)
+                .unwrap_or_else(|_| "pending_background_delivery".to_string()),
+            None => "metadata_only".to_string(),
+        };
+
+        self.record_spawn_metric(
+            &plan,
+            spawn_lock_wait_ms,
+            tmux_spawn_ms,
+            warm_start,
+            spawn_start,
+        );
+        self.refresh_memory();
+        Ok(spawn_result(&plan, warm_start, initial_prompt_delivery))
+    }
+
+    /// `spawn_agent` for many agents at once. Items are validated in order
+    /// as if they were separate calls (a later item may name an earlier one
+    /// as its parent), the locks and metadata writes are taken once for the
+    /// batch, and sessions start in parallel. Each item gets its own result;
+    /// one item failing doesn't stop the others.
+    fn spawn_agents(&self, args: Value) -> Result<Value> {
         #[derive(Deserialize)]
         struct Args {
-            name: String,
-            #[serde(deserialize_with = "flex_int::deserialize_usize")]
-            project_id: usize,
-            task: Option<String>,
-            workdir: Option<String>,
-            command: Option<String>,
-            backend: Option<String>,
-            model: Option<String>,
-            reasoning_effort: Option<String>,
-            parent: Option<String>,
+            agents: Vec<Value>,
         }
         let args: Args = serde_json::from_value(args)?;
+        check_batch_len("spawn_agents", args.agents.len())?;
         let spawn_start = std::time::Instant::now();
         let state_dir = self.state_dir();
-        let ea_id = self.ea_id();
-        let prefix = self.session_prefix();
-        let manager_session = self.manager_session();
-        let client = self.client();
 
+        let mut reserved = Vec::new();
+        let requests: Vec<Result<(SpawnAgentArgs, String)>> = args
+            .agents
+            .into_iter()
+            .map(|item| {
+                let args: SpawnAgentArgs = serde_json::from_value(item)?;
+                let session_name = self.spawn_session_name(&args.name, &reserved);
+                reserved.push(session_name.clone());
+                Ok((args, session_name))
+            })
+            .collect();
+
+        // Agent locks in sorted order, so overlapping batches can't deadlock.
+        let names: std::collections::BTreeSet<&str> = requests
+            .iter()
+            .filter_map(|request| request.as_ref().ok())
+            .map(|(_, session_name)| session_name.as_str())
+            .collect();
         let lock_wait_start = std::time::Instant::now();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
+        let _agent_locks = names
+            .iter()
+            .map(|name| StateLock::acquire(state_dir, &state_lock::agent_lock_name(name)))
+            .collect::<Result<Vec<_>>>()?;
+        let projects_lock = StateLock::acquire(state_dir, state_lock::PROJECTS)?;
         let spawn_lock_wait_ms = lock_wait_start.elapsed().as_millis() as u64;
 
+        let mut results = vec![Value::Null; requests.len()];
+        let mut pending = HashMap::new();
+        let mut planned = Vec::new();
+        for (index, request) in requests.into_iter().enumerate() {
+            let plan = request
+                .and_then(|(args, session_name)| self.plan_spawn(args, session_name, &pending));
+            match plan {
+                Ok(plan) => {
+                    pending.insert(plan.session_name.clone(), plan.project_id);
+                    planned.push((index, plan));
+                }
+                Err(err) => results[index] = batch_error(index, &err),
+            }
+        }
+
+        // plan_spawn only accepts in-batch parents planned earlier, so a
+        // parent always precedes its children here.
+        let batch_sessions: HashMap<&str, usize> = planned
+            .iter()
+            .enumerate()
+            .map(|(i, (_, plan))| (plan.session_name.as_str(), i))
+            .collect();
+        let parents: Vec<Option<usize>> = planned
+            .iter()
+            .map(|(_, plan)| batch_sessions.get(plan.parent_session.as_str()).copied())
+            .collect();
+        let started = start_in_waves(&planned, &parents, SPAWN_PARALLELISM, |(_, plan)| {
+            let tmux_spawn_start = std::time::Instant::now();
+            self.start_spawn(plan)
+                .map(|warm_start| (warm_start, tmux_spawn_start.elapsed().as_millis() as u64))
+        });
+        let mut spawned = Vec::new();
+        for ((index, plan), started) in planned.into_iter().zip(started) {
+            match started {
+                Ok((warm_start, tmux_spawn_ms)) => {
+                    spawned.push((index, plan, warm_start, tmux_spawn_ms))
+                }
+                Err(err) => results[index] = batch_error(index, &err),
+            }
+        }
+
+        let records: Vec<memory::SpawnedAgent> = spawned
+            .iter()
+            .map(|(_, plan, ..)| plan.spawned_agent())
+            .collect();
+        memory::save_spawned_agents_in(state_dir, &records);
+        drop(projects_lock);
+
+        let deliveries: Vec<_> = spawned
+            .iter()
+            .map(|(_, plan, ..)| self.deliver_initial_prompt(plan))
+            .collect();
+        let delivery_deadline = std::time::Instant::now() + INITIAL_PROMPT_DELIVERY_STATUS_TIMEOUT;
+        let spawned_count = spawned.len();
+        for ((index, plan, warm_start, tmux_spawn_ms), delivery) in
+            spawned.into_iter().zip(deliveries)
+        {
+            let initial_prompt_delivery = match delivery {
+                Some(delivery) => delivery
+                    .recv_timeout(
+                        delivery_deadline.saturating_duration_since(std::time::Instant::now()),
+                    )
+                    .unwrap_or_else(|_| "pending_background_delivery".to_string()),
+                None => "metadata_only".to_string(),
+            };
+            self.record_spawn_metric(
+                &plan,
+                spawn_lock_wait_ms,
+                tmux_spawn_ms,
+                warm_start,
+                spawn_start,
+            );
+            let mut result = spawn_result(&plan, warm_start, initial_prompt_delivery);
+            result["index"] = json!(index);
+            result["ok"] = json!(true);
+            results[index] = result;
+        }
+
+        if spawned_count > 0 {
+            self.refresh_memory();
+        }
+        Ok(json!({
+            "spawned": spawned_count,
+            "failed": results.len() - spawned_count,
+            "results": results,
+        }))
+    }
+
+    /// Validate a spawn request and resolve everything needed to start it.
+    /// Callers hold the agent's lock and the project membership lock.
+    /// `pending` maps sessions planned earlier in the same batch to their
+    /// project; they count as running.
+    fn plan_spawn(
+        &self,
+        args: SpawnAgentArgs,
+        session_name: String,
+        pending: &HashMap<String, usize>,
+    ) -> Result<SpawnPlan> {
+        let state_dir = self.state_dir();
+        let manager_session = self.manager_session();
+        let short_name = self.display_name(&session_name).to_string();
+
         // Project must already exist. add_project owns creation; this path
         // never auto-creates.
         let project = projects::find_project_in(state_dir, args.project_id).ok_or_else(|| {
@@ -1035,8 +1602,6 @@ impl OmarMcpServer {
                 args.project_id
             )
         })?;
-        let project_id = project.id;
-        let project_name = project.name.clone();
 
         let task = args
             .task
@@ -1051,16 +1616,8 @@ impl OmarMcpServer {
             Some(parent) => Some(parent.to_string()),
             None => None,
         };
-        self.validate_spawn_parent(project_id, parent.as_deref())?;
+        self.validate_spawn_parent(project.id, parent.as_deref(), pending)?;
 
-        let session_name = match args.name.trim() {
-            n if !n.is_empty() => {
-                let stripped = n.strip_prefix(prefix).unwrap_or(n);
-                format!("{}{}", prefix, stripped)
-            }
-            _ => generate_agent_name_in_ea(prefix),
-        };
-        let short_name = self.display_name(&session_name).to_string();
         let parent_session = match parent.as_deref() {
             Some("ea") | None => manager_session.to_string(),
             Some(p) => self.qualified_session_name(p)?,
@@ -1095,139 +1652,197 @@ impl OmarMcpServer {
         let workdir = args
             .workdir
             .unwrap_or_else(|| self.context.default_workdir.clone());
-        let command = if supports_prompt_delivery {
+
+        if pending.contains_key(&session_name)
+            || self.client().has_session(&session_name).unwrap_or(false)
+        {
+            return Err(anyhow!("Agent '{}' already exists", short_name));
+        }
+
+        Ok(SpawnPlan {
+            session_name,
+            short_name,
+            project_id: project.id,
+            project_name: project.name.clone(),
+            task,
+            parent_session,
+            prompt_parent,
+            base_command,
+            backend_name,
+            supports_prompt_delivery,
+            workdir,
+        })
+    }
+
+    /// Create the planned session, from the warm pool when one matches.
+    /// Returns whether it was a warm start.
+    fn start_spawn(&self, plan: &SpawnPlan) -> Result<bool> {
+        // A warm session already booted the backend; only agents whose
+        // identity arrives in the first message can use one.
+        let warm_start = plan.supports_prompt_delivery
+            && warm_pool::claim(
+                &self.context.session_prefix,
+                self.ea_id(),
+                &plan.base_command,
+                &plan.workdir,
+                &plan.session_name,
+            );
+        if warm_start {
+            self.start_output_log(&plan.session_name);
+            return Ok(true);
+        }
+        let command = if plan.supports_prompt_delivery {
             let prompt_file = manager::prompts_dir(&self.context.omar_dir).join("agent.md");
             manager::build_agent_command(
-                &base_command,
+                &plan.base_command,
                 &prompt_file,
                 &[
-                    ("{{PARENT_NAME}}", &prompt_parent),
-                    ("{{TASK}}", &task),
-                    ("{{EA_ID}}", &ea_id.to_string()),
+                    ("{{PARENT_NAME}}", &plan.prompt_parent),
+                    ("{{TASK}}", &plan.task),
+                    ("{{EA_ID}}", &self.ea_id().to_string()),
                 ],
                 &self.context,
             )
         } else {
-            base_command.clone()
+            plan.base_command.clone()
         };
+        self.client()
+            .new_agent_session(&plan.session_name, &command, Some(&plan.workdir))?;
+        self.start_output_log(&plan.session_name);
+        metrics::record_backend_bootstrap(&plan.backend_name);
+        Ok(false)
+    }
 
-        if client.has_session(&session_name).unwrap_or(false) {
-            return Err(anyhow!("Agent '{}' already exists", short_name));
-        }
-        let tmux_spawn_start = std::time::Instant::now();
-        client.new_session(&session_name, &command, Some(&workdir))?;
-        let tmux_spawn_ms = tmux_spawn_start.elapsed().as_millis() as u64;
-        metrics::record_backend_bootstrap(&backend_name);
-
-        memory::save_agent_parent_in(state_dir, &session_name, &parent_session);
-        memory::save_worker_task_in(state_dir, &session_name, &task);
-        memory::save_agent_project_in(state_dir, &session_name, project_id);
+    /// Log a new session's output from its first byte. Failure only costs
+    /// `get_agent_output` its history, so it doesn't fail the spawn.
+    fn start_output_log(&self, session_name: &str) {
+        let _ = self
+            .output_log(session_name)
+            .attach(&self.client(), session_name);
+    }
 
-        let initial_prompt_delivery = if !supports_prompt_delivery {
-            "metadata_only".to_string()
-        } else {
-            let client2 = client.clone();
-            let session2 = session_name.clone();
-            let header = format!(
-                "YOUR NAME: {}\nYOUR PARENT: {}\nYOUR TASK: {}",
-                short_name, prompt_parent, task
+    /// Deliver the initial task prompt from a background thread once the
+    /// backend is ready. The receiver yields the delivery status; `None`
+    /// for raw command sessions, which get no prompt.
+    fn deliver_initial_prompt(
+        &self,
+        plan: &SpawnPlan,
+    ) -> Option<std::sync::mpsc::Receiver<String>> {
+        if !plan.supports_prompt_delivery {
+            return None;
+        }
+        let ea_id = self.ea_id();
+        let client2 = self.client();
+        let session2 = plan.session_name.clone();
+        let header = format!(
+            "YOUR NAME: {}\nYOUR PARENT: {}\nYOUR TASK: {}",
+            plan.short_name, plan.prompt_parent, plan.task
+        );
+        // opencode has no system-prompt flag, so build_agent_command
+        // spawns it bare. Inline the rendered agent.md content here so
+        // the worker receives instructions plus the YOUR NAME header
+        // in a single user message. Other backends already received
+        // agent.md via their respective system-prompt flags.
+        let first_message = if plan.backend_name == "opencode" {
+            let prompt_file = manager::prompts_dir(&self.context.omar_dir).join("agent.md");
+            let content = manager::render_prompt_file(
+                &prompt_file,
+                &[
+                    ("{{PARENT_NAME}}", &plan.prompt_parent),
+                    ("{{TASK}}", &plan.task),
+                    ("{{EA_ID}}", &ea_id.to_string()),
+                ],
             );
-            // opencode has no system-prompt flag, so build_agent_command
-            // spawns it bare. Inline the rendered agent.md content here so
-            // the worker receives instructions plus the YOUR NAME header
-            // in a single user message. Other backends already received
-            // agent.md via their respective system-prompt flags.
-            let first_message = if backend_name == "opencode" {
-                let prompt_file = manager::prompts_dir(&self.context.omar_dir).join("agent.md");
-                let content = std::fs::read_to_string(&prompt_file)
-                    .unwrap_or_default()
-                    .replace("{{PARENT_NAME}}", &prompt_parent)
-                    .replace("{{TASK}}", &task)
-                    .replace("{{EA_ID}}", &ea_id.to_string());
-                format!("{}\n\n---\n\n{}", content, header)
-            } else {
-                header
-            };
-            let backend_name2 = backend_name.clone();
-            let readiness_markers = crate::tmux::backend_readiness_markers(&backend_name).to_vec();
-            let (delivery_tx, delivery_rx) = std::sync::mpsc::channel();
-            thread::spawn(move || {
-                let delivery_start = std::time::Instant::now();
-                let readiness = if !readiness_markers.is_empty() {
-                    let ready = client2.wait_for_markers(
-                        &session2,
-                        &readiness_markers,
-                        Duration::from_secs(45),
-                        Duration::from_millis(250),
-                    );
-                    if ready {
-                        Ok(())
-                    } else {
-                        Err(anyhow!("backend readiness markers timed out"))
-                    }
-                } else {
-                    client2.wait_for_stable(
-                        &session2,
-                        Duration::from_millis(500),
-                        Duration::from_secs(8),
-                        Duration::from_millis(120),
-                        false,
-                    )
-                };
-                let opts = DeliveryOptions::default();
-                let delivery = client2.deliver_prompt(&session2, &first_message, &opts);
-                let delivery_ok = delivery.is_ok();
-                metrics::record_prompt_delivery(
-                    ea_id,
+            format!("{}\n\n---\n\n{}", content, header)
+        } else {
+            header
+        };
+        let backend_name2 = plan.backend_name.clone();
+        let readiness_markers = crate::tmux::backend_readiness_markers(&plan.backend_name).to_vec();
+        let (delivery_tx, delivery_rx) = std::sync::mpsc::channel();
+        thread::spawn(move || {
+            let delivery_start = std::time::Instant::now();
+            let readiness = if !readiness_markers.is_empty() {
+                let ready = client2.wait_for_markers(
                     &session2,
-                    &backend_name2,
-                    delivery_start.elapsed().as_millis() as u64,
-                    delivery_ok,
+                    &readiness_markers,
+                    Duration::from_secs(45),
+                    Duration::from_millis(250),
                 );
-                let status = match (readiness, delivery) {
-                    (Ok(()), Ok(())) => "delivered".to_string(),
-                    (Err(readiness_err), Ok(())) => {
-                        format!("delivered_after_readiness_warning: {}", readiness_err)
-                    }
-                    (_, Err(delivery_err)) => format!("failed: {}", delivery_err),
-                };
-                let _ = delivery_tx.send(status);
-            });
-            delivery_rx
-                .recv_timeout(INITIAL_PROMPT_DELIVERY_STATUS_TIMEOUT)
-                .unwrap_or_else(|_| "pending_background_delivery".to_string())
-        };
+                if ready {
+                    Ok(())
+                } else {
+                    Err(anyhow!("backend readiness markers timed out"))
+                }
+            } else {
+                client2.wait_for_stable(
+                    &session2,
+                    Duration::from_millis(500),
+                    Duration::from_secs(8),
+                    Duration::from_millis(120),
+                    false,
+                )
+            };
+            let opts = DeliveryOptions::default();
+            let delivery = client2.deliver_prompt(&session2, &first_message, &opts);
+            let delivery_ok = delivery.is_ok();
+            metrics::record_prompt_delivery(
+                ea_id,
+                &session2,
+                &backend_name2,
+                delivery_start.elapsed().as_millis() as u64,
+                delivery_ok,
+            );
+            let status = match (readiness, delivery) {
+                (Ok(()), Ok(())) => "delivered".to_string(),
+                (Err(readiness_err), Ok(())) => {
+                    format!("delivered_after_readiness_warning: {}", readiness_err)
+                }
+                (_, Err(delivery_err)) => format!("failed: {}", delivery_err),
+            };
+            let _ = delivery_tx.send(status);
+        });
+        Some(delivery_rx)
+    }
 
+    fn record_spawn_metric(
+        &self,
+        plan: &SpawnPlan,
+        spawn_lock_wait_ms: u64,
+        tmux_spawn_ms: u64,
+        warm_start: bool,
+        spawn_start: std::time::Instant,
+    ) {
         metrics::record_agent_spawn(metrics::AgentSpawnMetric {
-            ea_id,
-            session: &session_name,
-            short_name: &short_name,
-            backend: &backend_name,
-            has_task: supports_prompt_delivery,
+            ea_id: self.ea_id(),
+            session: &plan.session_name,
+            short_name: &plan.short_name,
+            backend: &plan.backend_name,
+            has_task: plan.supports_prompt_delivery,
             spawn_lock_wait_ms,
             tmux_spawn_ms,
+            warm_start,
             total_spawn_ms: spawn_start.elapsed().as_millis() as u64,
         });
-
-        self.refresh_memory_locked()?;
-        Ok(json!({
-            "project_id": project_id,
-            "project_name": project_name,
-            "agent_name": short_name,
-            "status": "running",
-            "initial_prompt_delivery": initial_prompt_delivery,
-        }))
     }
 
-    fn validate_spawn_parent(&self, project_id: usize, parent: Option<&str>) -> Result<()> {
+    fn validate_spawn_parent(
+        &self,
+        project_id: usize,
+        parent: Option<&str>,
+        pending: &HashMap<String, usize>,
+    ) -> Result<()> {
         let client = self.client();
-        let agent_projects = memory::load_agent_projects_from(self.state_dir());
+        let mut agent_projects = memory::load_agent_projects_from(self.state_dir());
+        agent_projects.extend(pending.iter().map(|(session, id)| (session.clone(), *id)));
         if let Some(parent) = parent {
             if parent == "ea" {
                 return Ok(());
             }
             let parent_session = self.qualified_session_name(parent)?;
-            if !client.has_session(&parent_session).unwrap_or(false) {
+            if !pending.contains_key(&parent_session)
+                && !client.has_session(&parent_session).unwrap_or(false)
+            {
                 return Err(anyhow!(
                     "Parent agent '{}' is not running. Use an active parent in project '{}' or pass parent='ea' for an intentional EA-owned worker.",
                     parent,
@@ -1249,7 +1864,7 @@ impl OmarMcpServer {
                 )),
             }
         } else {
-            let supervisors = self.active_project_supervisors(project_id, &agent_projects);
+            let supervisors = self.active_project_supervisors(project_id, &agent_projects, pending);
             if supervisors.is_empty() {
                 Ok(())
             } else {
@@ -1265,7 +1880,8 @@ impl OmarMcpServer {
     fn active_project_supervisors(
         &self,
         project_id: usize,
-        agent_projects: &std::collections::HashMap<String, usize>,
+        agent_projects: &HashMap<String, usize>,
+        pending: &HashMap<String, usize>,
     ) -> Vec<String> {
         let client = self.client();
         let mut supervisors = Vec::new();
@@ -1277,7 +1893,9 @@ impl OmarMcpServer {
             if !looks_like_supervisor_name(short_name) {
                 continue;
             }
-            if client.has_session(session_name).unwrap_or(false) {
+            if pending.contains_key(session_name)
+                || client.has_session(session_name).unwrap_or(false)
+            {
                 supervisors.push(short_name.to_string());
             }
         }
@@ -1292,23 +1910,24 @@ impl OmarMcpServer {
         }
         let args: Args = serde_json::from_value(args)?;
         let state_dir = self.state_dir();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
         let client = self.client();
         let session_name = self.qualified_session_name(&args.name)?;
         let manager_session = self.manager_session();
         if session_name == manager_session {
             return Err(anyhow!("Cannot kill manager via MCP"));
         }
+        let _agent_lock =
+            StateLock::acquire(state_dir, &state_lock::agent_lock_name(&session_name))?;
         let _session = client.ensure_session_not_attached(&session_name)?;
         client.kill_session(&session_name)?;
-        memory::remove_agent_parent_in(state_dir, &session_name);
-        memory::remove_agent_project_in(state_dir, &session_name);
+        memory::forget_agent_in(state_dir, &session_name);
+        let _ = fs::remove_dir_all(self.output_log(&session_name).dir());
         let short_name = self.display_name(&session_name).to_string();
         let events_cancelled = self
             .scheduler()
-            .cancel_by_receiver_and_ea(&short_name, self.ea_id());
+            .cancel_by_receiver_and_ea(&short_name, self.ea_id())?;
 
-        self.refresh_memory_locked()?;
+        self.refresh_memory();
         Ok(json!({
             "status": "killed",
             "events_cancelled": events_cancelled,
@@ -1316,28 +1935,129 @@ impl OmarMcpServer {
     }
 
     fn send_input(&self, args: Value) -> Result<Value> {
+        let args: SendInputArgs = serde_json::from_value(args)?;
+        let client = self.client();
+        let session_name = self.qualified_session_name(&args.name)?;
+        if !client.has_session(&session_name).unwrap_or(false) {
+            return Err(anyhow!("Agent '{}' not found", args.name));
+        }
+        send_text(&client, &session_name, &args.text, args.enter)?;
+        Ok(json!({ "status": "sent" }))
+    }
+
+    /// `send_input` for many agents at once. Targets are checked against
+    /// one session listing; inputs to different agents are sent in
+    /// parallel, inputs to the same agent in the order given.
+    fn send_inputs(&self, args: Value) -> Result<Value> {
         #[derive(Deserialize)]
         struct Args {
-            name: String,
-            text: String,
-            #[serde(default)]
-            enter: bool,
+            inputs: Vec<Value>,
         }
         let args: Args = serde_json::from_value(args)?;
+        check_batch_len("send_inputs", args.inputs.len())?;
         let client = self.client();
-        let session_name = self.qualified_session_name(&args.name)?;
-        if !client.has_session(&session_name).unwrap_or(false) {
-            return Err(anyhow!("Agent '{}' not found", args.name));
+        let live: std::collections::HashSet<String> = client
+            .list_all_sessions()?
+            .into_iter()
+            .map(|session| session.name)
+            .collect();
+
+        let mut results = vec![Value::Null; args.inputs.len()];
+        // (session, [(index, input)]) in order of first appearance.
+        let mut groups: Vec<(String, Vec<(usize, SendInputArgs)>)> = Vec::new();
+        for (index, item) in args.inputs.into_iter().enumerate() {
+            let target = serde_json::from_value::<SendInputArgs>(item)
+                .map_err(anyhow::Error::from)
+                .and_then(|input| {
+                    let session_name = self.qualified_session_name(&input.name)?;
+                    if !live.contains(&session_name) {
+                        return Err(anyhow!("Agent '{}' not found", input.name));
+                    }
+                    Ok((session_name, input))
+                });
+            match target {
+                Ok((session_name, input)) => {
+                    match groups.iter_mut().find(|(name, _)| *name == session_name) {
+                        Some((_, inputs)) => inputs.push((index, input)),
+                        None => groups.push((session_name, vec![(index, input)])),
+                    }
+                }
+                Err(err) => results[index] = batch_error(index, &err),
+            }
         }
-        client.send_keys_literal(&session_name, &args.text)?;
-        if args.enter {
-            thread::sleep(Duration::from_millis(100));
-            client.send_keys(&session_name, "Enter")?;
+
+        let sent = parallel_map(&groups, SEND_PARALLELISM, |(session_name, inputs)| {
+            inputs
+                .iter()
+                .map(|(index, input)| {
+                    match send_text(&client, session_name, &input.text, input.enter) {
+                        Ok(()) => json!({ "index": index, "ok": true, "status": "sent" }),
+                        Err(err) => batch_error(*index, &err),
+                    }
+                })
+                .collect::<Vec<_>>()
+        });
+        for result in sent.into_iter().flatten() {
+            let index = result["index"].as_u64().unwrap_or_default() as usize;
+            results[index] = result;
         }
-        Ok(json!({ "status": "sent" }))
+
+        let sent_count = results.iter().filter(|result| result["ok"] == true).count();
+        Ok(json!({
+            "sent": sent_count,
+            "failed": results.len() - sent_count,
+            "results": results,
+        }))
     }
 
     fn schedule_omar_event(&self, args: Value) -> Result<Value> {
+        let event = self.build_event(args, now_ns())?;
+        self.scheduler().insert(event.clone())?;
+        self.refresh_memory();
+        Ok(scheduled_event_json(&event))
+    }
+
+    /// `schedule_omar_event` for many events at once: one scheduler round
+    /// trip and one memory refresh. Relative delays are measured from the
+    /// same instant for every event.
+    fn schedule_omar_events(&self, args: Value) -> Result<Value> {
+        #[derive(Deserialize)]
+        struct Args {
+            events: Vec<Value>,
+        }
+        let args: Args = serde_json::from_value(args)?;
+        check_batch_len("schedule_omar_events", args.events.len())?;
+        let base = now_ns();
+        let mut results = vec![Value::Null; args.events.len()];
+        let mut events = Vec::new();
+        for (index, item) in args.events.into_iter().enumerate() {
+            match self.build_event(item, base) {
+                Ok(event) => {
+                    let mut result = scheduled_event_json(&event);
+                    result["index"] = json!(index);
+                    result["ok"] = json!(true);
+                    results[index] = result;
+                    events.push(event);
+                }
+                Err(err) => results[index] = batch_error(index, &err),
+            }
+        }
+
+        let scheduled = events.len();
+        if scheduled > 0 {
+            self.scheduler().insert_many(events)?;
+            self.refresh_memory();
+        }
+        Ok(json!({
+            "scheduled": scheduled,
+            "failed": results.len() - scheduled,
+            "results": results,
+        }))
+    }
+
+    /// Build an event of this EA from `schedule_omar_event` arguments,
+    /// with relative delays counted from `base`.
+    fn build_event(&self, args: Value, base: u64) -> Result<ScheduledEvent> {
         #[derive(Deserialize)]
         struct Args {
             receiver: String,
@@ -1355,12 +2075,11 @@ impl OmarMcpServer {
             recurring_ns: Option<u64>,
         }
         let args: Args = serde_json::from_value(args)?;
-        let base = now_ns();
         let delay_ns =
             scheduler::combine_seconds_and_ns(args.delay_seconds, args.delay_ns).unwrap_or(0);
         let recurring_ns =
             scheduler::combine_seconds_and_ns(args.recurring_seconds, args.recurring_ns);
-        let event = ScheduledEvent {
+        Ok(ScheduledEvent {
             id: Uuid::new_v4().to_string(),
             sender: args.sender.unwrap_or_else(|| "ea".to_string()),
             receiver: args.receiver,
@@ -1371,18 +2090,7 @@ impl OmarMcpServer {
             created_at: base,
             recurring_ns,
             ea_id: self.ea_id(),
-        };
-        self.scheduler().insert(event.clone());
-        let state_dir = self.state_dir();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
-        self.refresh_memory_locked()?;
-        Ok(json!({
-            "id": event.id,
-            "sender": event.sender,
-            "receiver": event.receiver,
-            "timestamp_ns": event.timestamp,
-            "recurring_ns": event.recurring_ns,
-        }))
+        })
     }
 
     fn list_events(&self) -> Result<Value> {
@@ -1411,11 +2119,9 @@ impl OmarMcpServer {
         }
         let args: Args = serde_json::from_value(args)?;
         let scheduler = self.scheduler();
-        match scheduler.cancel_if_ea(&args.event_id, self.ea_id()) {
+        match scheduler.cancel_if_ea(&args.event_id, self.ea_id())? {
             Ok(event) => {
-                let state_dir = self.state_dir();
-                let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
-                self.refresh_memory_locked()?;
+                self.refresh_memory();
                 Ok(json!({
                     "id": event.id,
                     "status": "cancelled",
@@ -1449,9 +2155,8 @@ impl OmarMcpServer {
             return Err(anyhow!("Project name must not be empty"));
         }
         let state_dir = self.state_dir();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
         let project_id = projects::add_project_in(state_dir, name)?;
-        self.refresh_memory_locked()?;
+        self.refresh_memory();
         Ok(json!({
             "project_id": project_id,
             "name": name,
@@ -1466,7 +2171,9 @@ impl OmarMcpServer {
         }
         let args: Args = serde_json::from_value(args)?;
         let state_dir = self.state_dir();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
+        // Hold project membership so no agent joins between the check for
+        // active sessions and the removal.
+        let _projects_lock = StateLock::acquire(state_dir, state_lock::PROJECTS)?;
         let project = projects::find_project_in(state_dir, args.project_id)
             .ok_or_else(|| anyhow!("Project '{}' not found", args.project_id))?;
         let client = self.client();
@@ -1496,7 +2203,7 @@ impl OmarMcpServer {
                 args.project_id
             ));
         }
-        self.refresh_memory_locked()?;
+        self.refresh_memory();
         Ok(json!({
             "project_id": project.id,
             "name": project.name,
@@ -1553,7 +2260,7 @@ impl OmarMcpServer {
         }
         let args: Args = serde_json::from_value(args)?;
         let state_dir = self.state_dir();
-        let _lock = FileLock::acquire(lock_path_for_state_dir(state_dir))?;
+        let _lock = StateLock::acquire(state_dir, state_lock::ACTION_LOG)?;
         let path = state_dir.join("action_log.jsonl");
         fs::create_dir_all(state_dir).ok();
         let line = serde_json::to_string(&json!({
@@ -1730,23 +2437,42 @@ impl OmarMcpServer {
             agent: String,
             max_width: Option<u32>,
             max_height: Option<u32>,
+            #[serde(default)]
+            format: Encoding,
+            quality: Option<u8>,
+            region: Option<Rect>,
+            #[serde(default)]
+            changed_only: bool,
         }
         let args: Args = serde_json::from_value(args)?;
         self.verify_computer_lock(&args.agent)?;
-        let image_base64 = if let (Some(w), Some(h)) = (args.max_width, args.max_height) {
-            computer::take_screenshot_resized(w, h)?
-        } else {
-            computer::take_screenshot()?
-        };
-        let size = computer::get_screen_size().unwrap_or(computer::ScreenSize {
-            width: 0,
-            height: 0,
-        });
+        let shot = computer::take_screenshot(&CaptureOptions {
+            max_width: args.max_width,
+            max_height: args.max_height,
+            region: args.region,
+            encoding: args.format,
+            quality: args.quality,
+            // Per agent, so a new lock holder starts from a full frame.
+            delta_key: args
+                .changed_only
+                .then(|| format!("{}:{}", self.ea_id(), args.agent)),
+        })?;
         Ok(json!({
-            "image_base64": image_base64,
-            "width": size.width,
-            "height": size.height,
-            "format": "png",
+            "image_base64": shot.image_base64,
+            "width": shot.screen_width,
+            "height": shot.screen_height,
+            "format": shot.format,
+            "region": {
+                "x": shot.x,
+                "y": shot.y,
+                "width": shot.width,
+                "height": shot.height,
+            },
+            "image_width": shot.image_width,
+            "image_height": shot.image_height,
+            "scale": shot.scale,
+            "delta": shot.delta,
+            "unchanged": shot.unchanged,
         }))
     }
 
@@ -1823,9 +2549,14 @@ impl OmarMcpServer {
     }
 }
 
-fn generate_agent_name_in_ea(prefix: &str) -> String {
+/// First free `<prefix><n>`. `reserved` holds names a batch has already
+/// handed out but not created yet.
+fn generate_agent_name_in_ea(prefix: &str, reserved: &[String]) -> String {
     for i in 1..1000 {
         let name = format!("{}{}", prefix, i);
+        if reserved.contains(&name) {
+            continue;
+        }
         let result = crate::tmux::tmux_command()
             .args(["has-session", "-t", &name])
             .output();
@@ -2084,6 +2815,20 @@ fn tool_definitions() -> Vec<Value> {
                 "additionalProperties":false
             }),
         ),
+        tool(
+            "get_agent_output",
+            "Get only the output an agent printed since a cursor, from OMAR's per-agent output log. Use for repeated monitoring instead of polling get_agent: pass the previous result's next_offset as since_offset to receive just the new bytes. Omit since_offset for the latest max_bytes. The log keeps about the last 1 MiB per agent; dropped_bytes reports output that aged out before it was read. task_complete_offset and ready_to_complete report the most recent [TASK COMPLETE] marker without rescanning old output. Output is raw terminal text with escape sequences removed, so TUI backends can repeat redrawn lines. Read-only and safe to retry. Fails if the agent is not running in this EA.",
+            json!({
+                "type":"object",
+                "properties":{
+                    "name":{"type":"string","description":"Short agent name without the session prefix."},
+                    "since_offset":{"type":"integer","description":"Cursor from a previous call's next_offset. Omit to read the latest output."},
+                    "max_bytes":{"type":"integer","description":"Most bytes to return. Defaults to 16384; at most 262144."}
+                },
+                "required":["name"],
+                "additionalProperties":false
+            }),
+        ),
         tool(
             "get_agent_summary",
             "Get one agent's tracked task, self-reported status, health, and child-agent summary without the full output tail. Use for lightweight monitoring. Read-only and safe to retry. Fails if the agent is not running in this EA.",
@@ -2110,22 +2855,12 @@ fn tool_definitions() -> Vec<Value> {
         tool(
             "spawn_agent",
             "Spawn one tracked agent session in the current EA. Use for delegated work, PM/worker decomposition, or raw demo/bash windows. Requires an existing project_id; call list_projects/add_project first because spawn_agent never auto-creates projects. Side effects: creates a tmux session, records task/project/parent metadata, and delivers the initial task prompt unless command starts a raw session. Not retry-safe with the same name after success; retry only after checking list_agents/get_agent. Common failures: project not found, duplicate agent name, invalid parent/project relationship, backend unavailable, or both backend and command set.",
-            json!({
-                "type":"object",
-                "properties":{
-                    "name":{"type":"string","description":"Short agent name (session prefix is added automatically)."},
-                    "project_id":{"type":"integer","description":"Existing project id from add_project or list_projects. Required — spawn_agent does not auto-create projects."},
-                    "task":{"type":"string","description":"Delivered to the agent as their initial task and shown in the dashboard. What to build or do — no [TASK COMPLETE] or parent-wakeup instructions; those are already in every agent's system prompt."},
-                    "command":{"type":"string","description":"Raw command to run instead of a backend agent (e.g. 'bash' for a demo window). Mutually exclusive with backend."},
-                    "backend":{"type":"string","enum":["claude","codex","cursor","opencode","agy"],"description":"Backend agent command to launch. Mutually exclusive with command."},
-                    "model":{"type":"string","description":"Optional backend model override. Allowed characters are alphanumeric plus '-', '_', '.', '/'."},
-                    "reasoning_effort":{"type":"string","enum":["low","medium","high","xhigh"],"description":"Optional Codex reasoning effort override. Supported only with backend='codex'; appends a Codex config override such as -c model_reasoning_effort='\"high\"'."},
-                    "workdir":{"type":"string","description":"Working directory for the new session. Defaults to this MCP server's launch workdir."},
-                    "parent":{"type":"string","description":"Parent agent name for hierarchy tracking. Omit only for new EA-owned top-level work; use your own name for child tasks. Pass 'ea' only for intentional EA-owned work."}
-                },
-                "required":["name","project_id","task"],
-                "additionalProperties":false
-            }),
+            spawn_agent_schema(),
+        ),
+        tool(
+            "spawn_agents",
+            "Spawn several tracked agents in one call, e.g. a PM's whole first wave of workers. Each item takes exactly the spawn_agent arguments and is validated in order as if spawn_agent were called once per item, so a later item may name an earlier one as its parent. Sessions start in parallel and metadata is written once, which is much faster than repeated spawn_agent calls. One item failing does not stop the others: the result lists each item by index with either the spawn_agent result or its error. Not retry-safe for items that succeeded; retry only the failed ones.",
+            batch_schema("agents", spawn_agent_schema()),
         ),
         tool(
             "kill_agent",
@@ -2140,16 +2875,12 @@ fn tool_definitions() -> Vec<Value> {
         tool(
             "send_input",
             "Send text to a running agent or raw demo session. Use for follow-up instructions, concrete unblocking messages, or demo commands. Side effect: injects text into the target tmux pane and optionally presses Enter. Not generally retry-safe because duplicate input may execute twice. Fails if the target agent is not running.",
-            json!({
-                "type":"object",
-                "properties":{
-                    "name":{"type":"string","description":"Short target agent/session name."},
-                    "text":{"type":"string","description":"Literal text to send."},
-                    "enter":{"type":"boolean","description":"Whether to press Enter after text. Defaults to false."}
-                },
-                "required":["name","text"],
-                "additionalProperties":false
-            }),
+            send_input_schema(),
+        ),
+        tool(
+            "send_inputs",
+            "Send text to several running agents in one call. Each item takes exactly the send_input arguments. Inputs to different agents are sent in parallel; inputs to the same agent are sent in the order given. The result lists each item by index with its status or error; one missing agent does not stop the others. Not generally retry-safe because duplicate input may execute twice; retry only the failed items.",
+            batch_schema("inputs", send_input_schema()),
         ),
         tool(
             "list_projects",
@@ -2183,21 +2914,12 @@ fn tool_definitions() -> Vec<Value> {
         tool(
             "schedule_omar_event",
             "Enqueue an event in OMAR's persistent event queue to wake an agent or the EA at a chosen time. The event queue is OMAR's central coordination primitive: every timed check-in, parent completion notification, future nudge, and recurring cron-style task flows through it. Use this instead of sleep loops or any backend-native timer/reminder tool. Side effect: appends a scheduled event visible in the dashboard via list_events and durable across restarts. Not retry-safe unless duplicate delivery is acceptable; use list_events/cancel_event after uncertain results. For immediate parent notification after completion, set receiver to the parent name, payload to '[CHILD COMPLETE] {your_name}: {summary}', and delay_seconds to 0.",
-            json!({
-                "type":"object",
-                "properties":{
-                    "receiver":{"type":"string","description":"Target agent short name, or 'ea' for the Executive Assistant."},
-                    "payload":{"type":"string","description":"Message text injected into the receiver's session."},
-                    "sender":{"type":"string","description":"Optional sender label. Defaults to 'ea'."},
-                    "delay_seconds":{"type":"integer","description":"Deliver this many seconds from now. Preferred over timestamp_ns for simplicity."},
-                    "timestamp_ns":{"type":"integer","description":"Absolute logical timestamp in nanoseconds. Use delay_seconds instead unless you need precise coordination."},
-                    "delay_ns":{"type":"integer","description":"Deliver this many nanoseconds from now. Use for sub-second precision."},
-                    "recurring_seconds":{"type":"integer","description":"Auto-reschedule every N seconds after each delivery (cron job)."},
-                    "recurring_ns":{"type":"integer","description":"Auto-reschedule every N nanoseconds after each delivery."}
-                },
-                "required":["receiver","payload"],
-                "additionalProperties":false
-            }),
+            schedule_omar_event_schema(),
+        ),
+        tool(
+            "schedule_omar_events",
+            "Enqueue several events in OMAR's event queue in one call, e.g. a check-in for every worker of a wave. Each item takes exactly the schedule_omar_event arguments; delay_seconds and delay_ns count from the same instant for every item. The result lists each item by index with its event id or error; invalid items do not stop the others. Not retry-safe unless duplicate delivery is acceptable; use list_events after uncertain results.",
+            batch_schema("events", schedule_omar_event_schema()),
         ),
         tool(
             "list_events",
@@ -2275,7 +2997,22 @@ fn tool_definitions() -> Vec<Value> {
                 "properties":{
                     "agent":{"type":"string","description":"Your own agent name — proves you hold the lock."},
                     "max_width":{"type":"integer","description":"Resize screenshot to at most this width in pixels."},
-                    "max_height":{"type":"integer","description":"Resize screenshot to at most this height in pixels."}
+                    "max_height":{"type":"integer","description":"Resize screenshot to at most this height in pixels."},
+                    "format":{"type":"string","enum":["png","jpeg","webp"],"description":"Image encoding. jpeg is smallest; webp is lossless. Default png."},
+                    "quality":{"type":"integer","minimum":1,"maximum":100,"description":"JPEG quality. Default 80."},
+                    "region":{
+                        "type":"object",
+                        "description":"Capture only this screen rectangle, in screen pixels.",
+                        "properties":{
+                            "x":{"type":"integer"},
+                            "y":{"type":"integer"},
+                            "width":{"type":"integer"},
+                            "height":{"type":"integer"}
+                        },
+                        "required":["x","y","width","height"],
+                        "additionalProperties":false
+                    },
+                    "changed_only":{"type":"boolean","description":"Return only the area that changed since your previous changed_only screenshot, as a patch at region x/y (scaled by scale). unchanged=true with no image when nothing changed. The first call returns a full frame."}
                 },
                 "required":["agent"],
                 "additionalProperties":false
@@ -2329,6 +3066,73 @@ fn tool_definitions() -> Vec<Value> {
         .clone()
 }
 
+fn spawn_agent_schema() -> Value {
+    json!({
+        "type":"object",
+        "properties":{
+            "name":{"type":"string","description":"Short agent name (session prefix is added automatically)."},
+            "project_id":{"type":"integer","description":"Existing project id from add_project or list_projects. Required — spawn_agent does not auto-create projects."},
+            "task":{"type":"string","description":"Delivered to the agent as their initial task and shown in the dashboard. What to build or do — no [TASK COMPLETE] or parent-wakeup instructions; those are already in every agent's system prompt."},
+            "command":{"type":"string","description":"Raw command to run instead of a backend agent (e.g. 'bash' for a demo window). Mutually exclusive with backend."},
+            "backend":{"type":"string","enum":["claude","codex","cursor","opencode","agy"],"description":"Backend agent command to launch. Mutually exclusive with command."},
+            "model":{"type":"string","description":"Optional backend model override. Allowed characters are alphanumeric plus '-', '_', '.', '/'."},
+            "reasoning_effort":{"type":"string","enum":["low","medium","high","xhigh"],"description":"Optional Codex reasoning effort override. Supported only with backend='codex'; appends a Codex config override such as -c model_reasoning_effort='\"high\"'."},
+            "workdir":{"type":"string","description":"Working directory for the new session. Defaults to this MCP server's launch workdir."},
+            "parent":{"type":"string","description":"Parent agent name for hierarchy tracking. Omit only for new EA-owned top-level work; use your own name for child tasks. Pass 'ea' only for intentional EA-owned work."}
+        },
+        "required":["name","project_id","task"],
+        "additionalProperties":false
+    })
+}
+
+fn send_input_schema() -> Value {
+    json!({
+        "type":"object",
+        "properties":{
+            "name":{"type":"string","description":"Short target agent/session name."},
+            "text":{"type":"string","description":"Literal text to send."},
+            "enter":{"type":"boolean","description":"Whether to press Enter after text. Defaults to false."}
+        },
+        "required":["name","text"],
+        "additionalProperties":false
+    })
+}
+
+fn schedule_omar_event_schema() -> Value {
+    json!({
+        "type":"object",
+        "properties":{
+            "receiver":{"type":"string","description":"Target agent short name, or 'ea' for the Executive Assistant."},
+            "payload":{"type":"string","description":"Message text injected into the receiver's session."},
+            "sender":{"type":"string","description":"Optional sender label. Defaults to 'ea'."},
+            "delay_seconds":{"type":"integer","description":"Deliver this many seconds from now. Preferred over timestamp_ns for simplicity."},
+            "timestamp_ns":{"type":"integer","description":"Absolute logical timestamp in nanoseconds. Use delay_seconds instead unless you need precise coordination."},
+            "delay_ns":{"type":"integer","description":"Deliver this many nanoseconds from now. Use for sub-second precision."},
+            "recurring_seconds":{"type":"integer","description":"Auto-reschedule every N seconds after each delivery (cron job)."},
+            "recurring_ns":{"type":"integer","description":"Auto-reschedule every N nanoseconds after each delivery."}
+        },
+        "required":["receiver","payload"],
+        "additionalProperties":false
+    })
+}
+
+/// Schema of a batch tool: `key` holds a list of `item` argument objects.
+fn batch_schema(key: &str, item: Value) -> Value {
+    json!({
+        "type":"object",
+        "properties":{
+            key:{
+                "type":"array",
+                "items":item,
+                "minItems":1,
+                "maxItems":MAX_BATCH_ITEMS,
+            }
+        },
+        "required":[key],
+        "additionalProperties":false
+    })
+}
+
 fn tool(name: &str, description: &str, input_schema: Value) -> Value {
     json!({
         "name": name,
@@ -2557,6 +3361,192 @@ mod tests {
         );
     }
 
+    #[test]
+    fn parallel_map_keeps_input_order() {
+        let items: Vec<u64> = (0..50).collect();
+        let out = parallel_map(&items, 8, |i| {
+            thread::sleep(Duration::from_millis(50 - i));
+            i * 2
+        });
+        assert_eq!(out, (0..50).map(|i| i * 2).collect::<Vec<_>>());
+        assert!(parallel_map(&Vec::<u64>::new(), 8, |i| *i).is_empty());
+    }
+
+    #[test]
+    fn start_in_waves_skips_children_of_failed_parents() {
+        // 0 <- 1 <- 2, and 3 <- 4; item 3 fails to start.
+        let items: Vec<usize> = (0..6).collect();
+        let parents = [None, Some(0), Some(1), None, Some(3), Some(0)];
+        let order = Mutex::new(Vec::new());
+        let results = start_in_waves(&items, &parents, 8, |&i| {
+            order.lock().unwrap().push(i);
+            if i == 3 {
+                Err(anyhow!("boom"))
+            } else {
+                Ok(i)
+            }
+        });
+        let ok: Vec<Option<usize>> = results.iter().map(|r| r.as_ref().ok().copied()).collect();
+        assert_eq!(ok, vec![Some(0), Some(1), Some(2), None, None, Some(5)]);
+        assert!(format!("{:#}", results[4].as_ref().unwrap_err()).contains("parent"));
+
+        let order = order.into_inner().unwrap();
+        assert!(
+            !order.contains(&4),
+            "a child of a failed parent never starts"
+        );
+        let pos = |i| order.iter().position(|&x| x == i).unwrap();
+        assert!(pos(0) < pos(1) && pos(1) < pos(2) && pos(0) < pos(5));
+    }
+
+    #[test]
+    fn spawn_agents_reports_each_failed_item() {
+        let server = OmarMcpServer::new(test_context());
+        let project = server.add_project(json!({"name": "batch"})).unwrap();
+        let project_id = project["project_id"].clone();
+
+        let result = server
+            .spawn_agents(json!({"agents": [
+                {"name": "a", "project_id": 99, "task": "x"},
+                {"name": "b"},
+                {"name": "c", "project_id": project_id, "task": "  "},
+            ]}))
+            .unwrap();
+        assert_eq!(result["spawned"], json!(0));
+        assert_eq!(result["failed"], json!(3));
+        let results = result["results"].as_array().unwrap();
+        assert!(results.iter().all(|item| item["ok"] == json!(false)));
+        assert_eq!(results[1]["index"], json!(1));
+        assert!(results[0]["error"].as_str().unwrap().contains("not found"));
+        assert!(results[2]["error"].as_str().unwrap().contains("task"));
+
+        assert!(server.spawn_agents(json!({"agents": []})).is_err());
+        let _ = std::fs::remove_dir_all(&server.context.omar_dir);
+    }
+
+    #[test]
+    fn schedule_omar_events_inserts_valid_items_in_one_batch() {
+        let server = OmarMcpServer::new(test_context());
+        let result = server
+            .schedule_omar_events(json!({"events": [
+                {"receiver": "w1", "payload": "check in", "delay_seconds": 60},
+                {"receiver": "w2"},
+                {"receiver": "w3", "payload": "check in", "delay_seconds": 60},
+            ]}))
+            .unwrap();
+        assert_eq!(result["scheduled"], json!(2));
+        assert_eq!(result["results"][1]["ok"], json!(false));
+        assert_eq!(
+            result["results"][0]["timestamp_ns"], result["results"][2]["timestamp_ns"],
+            "delays count from one instant"
+        );
+
+        let listed = server.list_events().unwrap();
+        let mut receivers: Vec<&str> = listed["events"]
+            .as_array()
+            .unwrap()
+            .iter()
+            .map(|event| event["receiver"].as_str().unwrap())
+            .collect();
+        // Same due time, so list_events has no order between them.
+        receivers.sort();
+        assert_eq!(receivers, vec!["w1", "w3"]);
+        let _ = std::fs::remove_dir_all(&server.context.omar_dir);
+    }
+
+    fn response_ids(output: &[u8]) -> Vec<Value> {
+        String::from_utf8_lossy(output)
+            .lines()
+            .map(|line| serde_json::from_str::<Value>(line).unwrap()["id"].clone())
+            .collect()
+    }
+
+    #[test]
+    fn concurrent_dispatch_answers_every_request_once() {
+        let server = OmarMcpServer::new(test_context());
+        let input = [
+            json!({"jsonrpc":"2.0","id":1,"method":"ping"}).to_string(),
+            json!({"jsonrpc":"2.0","id":2,"method":"tools/call","params":{"name":"list_events","arguments":{}}}).to_string(),
+            json!({"jsonrpc":"2.0","id":3,"method":"tools/call","params":{"name":"add_project","arguments":{"name":"p"}}}).to_string(),
+            json!({"jsonrpc":"2.0","id":4,"method":"tools/call","params":{"name":"list_projects","arguments":{}}}).to_string(),
+            json!({"jsonrpc":"2.0","method":"notifications/initialized"}).to_string(),
+            "{not json".to_string(),
+            json!({"jsonrpc":"2.0","id":5,"method":"tools/call","params":{"name":"list_projects","arguments":{}}}).to_string(),
+        ]
+        .join("\n")
+            + "\n";
+        let mut output = Vec::new();
+        server
+            .serve_on(io::Cursor::new(input), &mut output, true)
+            .unwrap();
+
+        let mut ids: Vec<String> = response_ids(&output)
+            .iter()
+            .map(|id| id.to_string())
+            .collect();
+        ids.sort();
+        assert_eq!(ids, vec!["1", "2", "3", "4", "5", "null"]);
+        let tools = server.latency.summary();
+        assert!(tools
+            .iter()
+            .any(|line| line.starts_with("tool_latency name=list_projects count=2")));
+        let _ = std::fs::remove_dir_all(&server.context.omar_dir);
+    }
+
+    #[test]
+    fn serial_dispatch_answers_tool_calls_in_order() {
+        let server = OmarMcpServer::new(test_context());
+        let input: String = (1..=6)
+            .map(|id| {
+                let name = if id % 2 == 0 { "list_events" } else { "list_projects" };
+                json!({"jsonrpc":"2.0","id":id,"method":"tools/call","params":{"name":name,"arguments":{}}})
+                    .to_string()
+                    + "\n"
+            })
+            .collect();
+        let mut output = Vec::new();
+        server
+            .serve_on(io::Cursor::new(input), &mut output, false)
+            .unwrap();
+        assert_eq!(
+            response_ids(&output),
+            (1..=6).map(|id| json!(id)).collect::<Vec<_>>()
+        );
+        let _ = std::fs::remove_dir_all(&server.context.omar_dir);
+    }
+
+    #[test]
+    fn read_only_tools_exist_and_exclude_mutations() {
+        let names: Vec<String> = tool_definitions()
+            .iter()
+            .map(|tool| tool["name"].as_str().unwrap().to_string())
+            .collect();
+        let read_only: Vec<&String> = names.iter().filter(|n| is_read_only_tool(n)).collect();
+        assert_eq!(read_only.len(), 13, "every read-only tool is defined");
+        for mutating in [
+            "spawn_agent",
+            "send_input",
+            "schedule_omar_event",
+            "computer_mouse",
+            "kill_agent",
+        ] {
+            assert!(!is_read_only_tool(mutating));
+        }
+    }
+
+    #[test]
+    fn latency_summary_reports_quantiles_per_tool() {
+        let latency = metrics::LabeledHistogram::new("tool");
+        latency.record("t", Duration::from_micros(300));
+        latency.record("t", Duration::from_millis(5));
+        latency.record("t", Duration::from_millis(7));
+        latency.record("t", Duration::from_secs(60));
+        let summary = latency_summary(&latency);
+        assert_eq!(summary.len(), 1);
+        assert!(summary[0].starts_with("tool_latency name=t count=4 p50_ms=5."));
+        assert!(summary[0].ends_with(" p99_ms=60000.0 max_ms=60000.0"));
+    }
+
     #[test]
     fn slack_reply_queues_file_in_outbox() {
         let server = OmarMcpServer::new(test_context());
@@ -2851,20 +3841,6 @@ mod tests {
         );
     }
 
-    #[cfg(unix)]
-    #[test]
-    fn file_lock_reclaims_stale_pid_lock() {
-        let dir = tempfile::tempdir().unwrap();
-        let path = dir.path().join(".mcp-state.lock");
-        std::fs::write(&path, u32::MAX.to_string()).unwrap();
-
-        let lock = FileLock::acquire(path.clone()).expect("stale lock should be reclaimed");
-
-        assert!(path.exists());
-        drop(lock);
-        assert!(!path.exists());
-    }
-
     #[cfg(unix)]
     #[test]
     fn list_backends_probe_treats_hanging_command_as_unavailable() {
@@ -2880,9 +3856,12 @@ mod tests {
         fs::set_permissions(&slow, perms).unwrap();
 
         let start = Instant::now();
-        let available = backend_available_from_command(slow.to_str().unwrap(), "slow-backend");
+        let available = backend_probe::backends_available(&[backend_executable(
+            slow.to_str().unwrap(),
+            "slow-backend",
+        )]);
 
-        assert!(!available);
+        assert_eq!(available, vec![false]);
         assert!(
             start.elapsed() < Duration::from_secs(3),
             "list_backends should not block indefinitely on backend --version"
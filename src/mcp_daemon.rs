@@ -0,0 +1,573 @@
+//! Shared MCP daemon.
+//!
+//! Every agent backend launches its own `omar mcp-server`, so a hundred
+//! agents used to mean a hundred server processes, each with its own
+//! scheduler handle, lock traffic and tmux forks. Now the first of them
+//! starts `omar mcp-daemon`, one long-lived process per OMAR directory and
+//! tmux server, and each `mcp-server` becomes a shim that forwards its
+//! stdio over a Unix socket. The daemon keeps one tool server per launch
+//! context alive across connections and shares one scheduler between all
+//! of them.
+//!
+//! Wire protocol: the shim sends one JSON line, `{"version", "build",
+//! "context"}`, and the daemon answers `{"ok": true}` or `{"ok": false,
+//! "error"}`. After that the connection carries the MCP stream unchanged,
+//! in both directions. A daemon for another OMAR dir or tmux server
+//! refuses the handshake, and the shim then serves in process as before.
+//! So does a shim started with `OMAR_MCP_DAEMON=0`.
+//!
+//! `build` identifies the binary (path, size and mtime), so a rebuild or
+//! reinstall without a version bump still counts as a different omar. When
+//! a shim's build differs and the daemon's own binary has changed on disk
+//! since it started, the daemon retires: it unlinks its socket, releases
+//! its lock, answers `"retired": true`, and serves its open connections to
+//! the end. The shim then starts a daemon from the current binary. A
+//! mismatch against a daemon whose binary is unchanged (an old shim still
+//! running) is refused as before.
+//!
+//! The daemon exits once it has had no connection for [`IDLE_TIMEOUT`], or
+//! when its socket is removed (the OMAR dir was deleted).
+
+use anyhow::{anyhow, Context, Result};
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::io::{self, BufRead, BufReader, Read, Write};
+use std::net::Shutdown;
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::os::unix::process::CommandExt;
+use std::path::{Path, PathBuf};
+use std::process::{Command, Stdio};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::thread;
+use std::time::{Duration, Instant, UNIX_EPOCH};
+
+use crate::manager::McpLaunchContext;
+use crate::mcp::{append_debug_log, OmarMcpServer, SERIAL_DISPATCH_ENV};
+use crate::memory;
+use crate::metrics;
+use crate::scheduler;
+use crate::state_lock::StateLock;
+
+/// Set to `0` to serve in the `mcp-server` process, without the daemon.
+pub const DAEMON_ENV: &str = "OMAR_MCP_DAEMON";
+/// How long an idle daemon stays up for the next connection.
+pub const IDLE_TIMEOUT: Duration = Duration::from_secs(10 * 60);
+/// How long a shim waits for a daemon it started to accept connections.
+const STARTUP_TIMEOUT: Duration = Duration::from_secs(3);
+/// Accept poll period: a shim's first connection waits at most this long.
+const ACCEPT_POLL_INTERVAL: Duration = Duration::from_millis(25);
+const VERSION: &str = env!("CARGO_PKG_VERSION");
+
+#[derive(Serialize, Deserialize)]
+struct Hello {
+    version: String,
+    #[serde(default)]
+    build: String,
+    context: McpLaunchContext,
+}
+
+#[derive(Serialize, Deserialize)]
+struct HelloReply {
+    ok: bool,
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    error: Option<String>,
+    /// The daemon's binary is stale and it has stopped taking connections.
+    #[serde(default, skip_serializing_if = "std::ops::Not::not")]
+    retired: bool,
+}
+
+/// Identity of the binary at `exe`: its path, size and mtime.
+fn build_id(exe: &Path) -> Option<String> {
+    let meta = std::fs::metadata(exe).ok()?;
+    let mtime = meta.modified().ok()?.duration_since(UNIX_EPOCH).ok()?;
+    Some(format!(
+        "{}:{}:{}",
+        exe.display(),
+        meta.len(),
+        mtime.as_nanos()
+    ))
+}
+
+/// This process's binary and its [`build_id`] as of the first call.
+fn current_build() -> &'static (Option<PathBuf>, String) {
+    static BUILD: OnceLock<(Option<PathBuf>, String)> = OnceLock::new();
+    BUILD.get_or_init(|| {
+        let exe = std::env::current_exe().ok();
+        let build = exe.as_deref().and_then(build_id).unwrap_or_default();
+        (exe, build)
+    })
+}
+
+/// Directory holding the daemon's socket and lock.
+fn daemon_dir(omar_dir: &Path) -> PathBuf {
+    omar_dir.join("mcp")
+}
+
+/// One daemon per tmux server, since tool calls reach tmux through the
+/// process-wide `OMAR_TMUX_SERVER`.
+fn daemon_name(tmux_server: Option<&str>) -> String {
+    match tmux_server {
+        Some(server) => format!(
+            "daemon-{}",
+            server
+                .chars()
+                .map(|c| {
+                    if c.is_ascii_alphanumeric() || c == '-' {
+                        c
+                    } else {
+                        '_'
+                    }
+                })
+                .collect::<String>()
+        ),
+        None => "daemon".to_string(),
+    }
+}
+
+fn socket_path(omar_dir: &Path, tmux_server: Option<&str>) -> PathBuf {
+    daemon_dir(omar_dir).join(format!("{}.sock", daemon_name(tmux_server)))
+}
+
+fn tmux_server_from_env() -> Option<String> {
+    std::env::var("OMAR_TMUX_SERVER")
+        .ok()
+        .map(|server| server.trim().to_string())
+        .filter(|server| !server.is_empty())
+}
+
+/// Hand this process's stdio to the daemon for `context`, starting the
+/// daemon if none is running. Returns once the session is over, or false
+/// straight away when no daemon takes the connection; the caller then
+/// serves in process.
+pub fn forward(context: &McpLaunchContext) -> bool {
+    if std::env::var(DAEMON_ENV).as_deref() == Ok("0") {
+        return false;
+    }
+    let stream = match connect(context) {
+        Ok(stream) => stream,
+        Err(err) => {
+            append_debug_log(context, &format!("daemon_unavailable err={:#}", err));
+            return false;
+        }
+    };
+    if let Err(err) = proxy(stream) {
+        append_debug_log(context, &format!("daemon_proxy_err err={:#}", err));
+    }
+    true
+}
+
+/// A daemon connection for `context` that has accepted the handshake.
+fn connect(context: &McpLaunchContext) -> Result<UnixStream> {
+    match handshake(context)? {
+        // The stale daemon has unlinked its socket; the retry starts one
+        // from the current binary.
+        None => handshake(context)?.ok_or_else(|| anyhow!("Daemon retired twice")),
+        Some(stream) => Ok(stream),
+    }
+}
+
+/// One connection attempt; `None` when the daemon retired instead of
+/// accepting.
+fn handshake(context: &McpLaunchContext) -> Result<Option<UnixStream>> {
+    let socket = socket_path(&context.omar_dir, context.tmux_server.as_deref());
+    let stream = match UnixStream::connect(&socket) {
+        Ok(stream) => stream,
+        Err(_) => {
+            start_daemon(context)?;
+            let deadline = Instant::now() + STARTUP_TIMEOUT;
+            loop {
+                match UnixStream::connect(&socket) {
+                    Ok(stream) => break stream,
+                    Err(err) if Instant::now() >= deadline => {
+                        return Err(err)
+                            .with_context(|| format!("No daemon listening on {:?}", socket));
+                    }
+                    Err(_) => thread::sleep(Duration::from_millis(20)),
+                }
+            }
+        }
+    };
+
+    let mut line = serde_json::to_string(&Hello {
+        version: VERSION.to_string(),
+        build: current_build().1.clone(),
+        context: context.clone(),
+    })?;
+    line.push('\n');
+    (&stream).write_all(line.as_bytes())?;
+    let mut reply = String::new();
+    BufReader::new(&stream).read_line(&mut reply)?;
+    let reply: HelloReply = serde_json::from_str(&reply).context("Bad daemon handshake")?;
+    if reply.retired {
+        return Ok(None);
+    }
+    if !reply.ok {
+        return Err(anyhow!(
+            "Daemon refused: {}",
+            reply.error.unwrap_or_default()
+        ));
+    }
+    Ok(Some(stream))
+}
+
+/// Launch `omar mcp-daemon` for `context`'s OMAR dir and tmux server, in
+/// its own process group so closing the agent's pane doesn't signal it.
+fn start_daemon(context: &McpLaunchContext) -> Result<()> {
+    let exe = std::env::current_exe().context("Failed to locate the omar binary")?;
+    let mut command = Command::new(exe);
+    command
+        .arg("mcp-daemon")
+        .env("OMAR_DIR", &context.omar_dir)
+        .env_remove(SERIAL_DISPATCH_ENV)
+        .stdin(Stdio::null())
+        .stdout(Stdio::null())
+        .stderr(Stdio::null())
+        .process_group(0);
+    match context.tmux_server.as_deref() {
+        Some(server) => command.env("OMAR_TMUX_SERVER", server),
+        None => command.env_remove("OMAR_TMUX_SERVER"),
+    };
+    command.spawn().context("Failed to start omar mcp-daemon")?;
+    Ok(())
+}
+
+/// Copy stdin to the daemon and the daemon's replies to stdout until the
+/// daemon closes the connection.
+fn proxy(stream: UnixStream) -> Result<()> {
+    let mut upstream = stream.try_clone()?;
+    thread::spawn(move || {
+        let _ = io::copy(&mut io::stdin().lock(), &mut upstream);
+        // EOF on stdin: the daemon finishes what is in flight, then closes.
+        let _ = upstream.shutdown(Shutdown::Write);
+    });
+    let mut downstream = stream;
+    let mut stdout = io::stdout().lock();
+    let mut buf = [0u8; 16 * 1024];
+    loop {
+        let n = downstream.read(&mut buf)?;
+        if n == 0 {
+            return Ok(());
+        }
+        stdout.write_all(&buf[..n])?;
+        // stdout is line-buffered; Content-Length frames end without one.
+        stdout.flush()?;
+    }
+}
+
+/// Run the daemon for the OMAR dir in `OMAR_DIR` (default `~/.omar`) and
+/// the tmux server in `OMAR_TMUX_SERVER`. Returns straight away when
+/// another daemon already serves them.
+pub fn run_daemon() -> Result<()> {
+    let omar_dir = std::env::var_os("OMAR_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(|| {
+            dirs::home_dir()
+                .unwrap_or_else(|| PathBuf::from("."))
+                .join(".omar")
+        });
+    let (exe, build) = current_build().clone();
+    let Some(daemon) = Daemon::bind(omar_dir, tmux_server_from_env(), exe, build)? else {
+        return Ok(());
+    };
+    daemon.run(IDLE_TIMEOUT);
+    Ok(())
+}
+
+struct Daemon {
+    omar_dir: PathBuf,
+    tmux_server: Option<String>,
+    socket: PathBuf,
+    listener: UnixListener,
+    scheduler: Arc<scheduler::Scheduler>,
+    /// Tool servers by serialized launch context.
+    servers: Mutex<HashMap<String, Arc<OmarMcpServer>>>,
+    /// The binary the daemon runs and its [`build_id`] at startup.
+    exe: Option<PathBuf>,
+    build: String,
+    /// Set once the binary changed on disk and the daemon stopped taking
+    /// connections.
+    retired: AtomicBool,
+    /// Held until the daemon exits or retires, so only one binds the
+    /// socket.
+    lock: Mutex<Option<StateLock>>,
+}
+
+impl Daemon {
+    /// Take the daemon lock and listen on the socket. `None` when another
+    /// daemon holds the lock.
+    fn bind(
+        omar_dir: PathBuf,
+        tmux_server: Option<String>,
+        exe: Option<PathBuf>,
+        build: String,
+    ) -> Result<Option<Arc<Self>>> {
+        let dir = daemon_dir(&omar_dir);
+        let Some(lock) = StateLock::try_acquire(&dir, &daemon_name(tmux_server.as_deref()))? else {
+            return Ok(None);
+        };
+        // Whatever socket is left belongs to a daemon that no longer holds
+        // the lock, so it is dead.
+        let socket = socket_path(&omar_dir, tmux_server.as_deref());
+        let _ = std::fs::remove_file(&socket);
+        let listener =
+            UnixListener::bind(&socket).with_context(|| format!("Failed to bind {:?}", socket))?;
+        let scheduler = Arc::new(scheduler::Scheduler::with_store(
+            scheduler::events_store_path(&omar_dir),
+        ));
+        Ok(Some(Arc::new(Self {
+            omar_dir,
+            tmux_server,
+            socket,
+            listener,
+            scheduler,
+            servers: Mutex::default(),
+            exe,
+            build,
+            retired: AtomicBool::new(false),
+            lock: Mutex::new(Some(lock)),
+        })))
+    }
+
+    /// Accept connections until idle for `idle_timeout` or the socket is
+    /// gone, then let open connections finish. Accepting polls, so that
+    /// an unlinked socket, which nothing can connect to, still stops it.
+    fn run(self: Arc<Self>, idle_timeout: Duration) {
+        let _ = self.listener.set_nonblocking(true);
+        let mut handlers: Vec<thread::JoinHandle<()>> = Vec::new();
+        let mut idle_since = Instant::now();
+        loop {
+            // An error is WouldBlock, or a connection reset before it was
+            // accepted; either way, fall through to the idle check.
+            if let Ok((stream, _)) = self.listener.accept() {
+                // Accepted sockets inherit non-blocking mode on BSDs.
+                let _ = stream.set_nonblocking(false);
+                let daemon = self.clone();
+                handlers.push(thread::spawn(move || {
+                    let _ = daemon.handle(stream);
+                }));
+                continue;
+            }
+            handlers.retain(|handler| !handler.is_finished());
+            if !handlers.is_empty() {
+                idle_since = Instant::now();
+            } else if idle_since.elapsed() >= idle_timeout
+                || !self.socket.exists()
+                || self.retired.load(Ordering::Acquire)
+            {
+                break;
+            }
+            thread::sleep(ACCEPT_POLL_INTERVAL);
+        }
+        // A retired daemon's socket path may already be its successor's.
+        if !self.retired.load(Ordering::Acquire) && self.socket.exists() {
+            let _ = std::fs::remove_file(&self.socket);
+        }
+        for server in self.servers.lock().unwrap().values() {
+            server.log_latency();
+        }
+        memory::flush_memory_writes();
+        metrics::flush();
+    }
+
+    fn handle(&self, stream: UnixStream) -> Result<()> {
+        let mut reader = BufReader::new(stream.try_clone()?);
+        let mut line = String::new();
+        reader.read_line(&mut line)?;
+        let server = serde_json::from_str::<Hello>(&line)
+            .map_err(anyhow::Error::from)
+            .and_then(|hello| self.server_for(hello));
+        let reply = match &server {
+            Ok(_) => HelloReply {
+                ok: true,
+                error: None,
+                retired: false,
+            },
+            Err(err) => HelloReply {
+                ok: false,
+                error: Some(format!("{:#}", err)),
+                retired: self.retired.load(Ordering::Acquire),
+            },
+        };
+        let mut reply = serde_json::to_string(&reply)?;
+        reply.push('\n');
+        (&stream).write_all(reply.as_bytes())?;
+        let server = server?;
+
+        let concurrent = std::env::var_os(SERIAL_DISPATCH_ENV).is_none();
+        let result = server.serve_on(reader, &stream, concurrent);
+        let _ = stream.shutdown(Shutdown::Both);
+        result
+    }
+
+    /// Stop taking connections if the binary this daemon started from has
+    /// been rebuilt or replaced since. The socket goes before the lock, so
+    /// a successor that takes the lock never has its socket unlinked.
+    fn retire_if_stale(&self) {
+        let stale = match &self.exe {
+            Some(exe) => build_id(exe).as_deref() != Some(self.build.as_str()),
+            None => false,
+        };
+        if stale && !self.retired.swap(true, Ordering::AcqRel) {
+            let _ = std::fs::remove_file(&self.socket);
+            self.lock.lock().unwrap().take();
+        }
+    }
+
+    /// The tool server for a handshake, created on first use.
+    fn server_for(&self, hello: Hello) -> Result<Arc<OmarMcpServer>> {
+        if hello.version != VERSION || hello.build != self.build {
+            self.retire_if_stale();
+            return Err(anyhow!(
+                "daemon runs omar {} ({}), shim is {} ({})",
+                VERSION,
+                self.build,
+                hello.version,
+                hello.build
+            ));
+        }
+        let context = hello.context;
+        if context.omar_dir != self.omar_dir || context.tmux_server != self.tmux_server {
+            return Err(anyhow!("context belongs to another daemon"));
+        }
+        let key = serde_json::to_string(&context)?;
+        let mut servers = self.servers.lock().unwrap();
+        let server = servers.entry(key).or_insert_with(|| {
+            Arc::new(OmarMcpServer::with_scheduler(
+                context,
+                self.scheduler.clone(),
+            ))
+        });
+        Ok(server.clone())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn context(omar_dir: &Path) -> McpLaunchContext {
+        McpLaunchContext {
+            omar_dir: omar_dir.to_path_buf(),
+            ea_id: 0,
+            session_prefix: "omar-daemon-test-".to_string(),
+            default_command: "claude".to_string(),
+            default_workdir: ".".to_string(),
+            health_idle_warning: 15,
+            tmux_server: None,
+        }
+    }
+
+    fn bind(omar_dir: &Path) -> Option<Arc<Daemon>> {
+        let (exe, build) = current_build().clone();
+        Daemon::bind(omar_dir.to_path_buf(), None, exe, build).unwrap()
+    }
+
+    fn hello(stream: &UnixStream, context: &McpLaunchContext) -> HelloReply {
+        hello_from(stream, context, &current_build().1)
+    }
+
+    fn hello_from(stream: &UnixStream, context: &McpLaunchContext, build: &str) -> HelloReply {
+        let mut line = serde_json::to_string(&Hello {
+            version: VERSION.to_string(),
+            build: build.to_string(),
+            context: context.clone(),
+        })
+        .unwrap();
+        line.push('\n');
+        (&*stream).write_all(line.as_bytes()).unwrap();
+        let mut reply = String::new();
+        BufReader::new(stream).read_line(&mut reply).unwrap();
+        serde_json::from_str(&reply).unwrap()
+    }
+
+    #[test]
+    fn daemon_serves_shims_from_one_shared_server() {
+        let dir = tempfile::tempdir().unwrap();
+        let omar_dir = dir.path().join(".omar");
+        let daemon = bind(&omar_dir).unwrap();
+        assert!(
+            bind(&omar_dir).is_none(),
+            "one daemon per OMAR dir and tmux server"
+        );
+        let runner = {
+            let daemon = daemon.clone();
+            thread::spawn(move || daemon.run(Duration::from_millis(300)))
+        };
+
+        let socket = socket_path(&omar_dir, None);
+        for id in 1..=2 {
+            let stream = UnixStream::connect(&socket).unwrap();
+            assert!(hello(&stream, &context(&omar_dir)).ok);
+            let request = serde_json::json!({"jsonrpc":"2.0","id":id,"method":"ping"});
+            (&stream)
+                .write_all(format!("{}\n", request).as_bytes())
+                .unwrap();
+            stream.shutdown(Shutdown::Write).unwrap();
+            let mut response = String::new();
+            BufReader::new(&stream).read_line(&mut response).unwrap();
+            let response: serde_json::Value = serde_json::from_str(&response).unwrap();
+            assert_eq!(response["id"], serde_json::json!(id));
+        }
+        assert_eq!(daemon.servers.lock().unwrap().len(), 1);
+
+        let mut foreign = context(&omar_dir);
+        foreign.tmux_server = Some("other".to_string());
+        let stream = UnixStream::connect(&socket).unwrap();
+        let reply = hello(&stream, &foreign);
+        assert!(!reply.ok);
+        drop(stream);
+
+        runner.join().unwrap();
+        assert!(
+            !socket.exists(),
+            "an idle daemon exits and removes its socket"
+        );
+        drop(daemon);
+        assert!(bind(&omar_dir).is_some());
+    }
+
+    #[test]
+    fn daemon_retires_when_its_binary_changes() {
+        let dir = tempfile::tempdir().unwrap();
+        let omar_dir = dir.path().join(".omar");
+        let exe = dir.path().join("omar");
+        std::fs::write(&exe, "old build").unwrap();
+        let build = build_id(&exe).unwrap();
+        let daemon = Daemon::bind(omar_dir.clone(), None, Some(exe.clone()), build)
+            .unwrap()
+            .unwrap();
+        let runner = {
+            let daemon = daemon.clone();
+            thread::spawn(move || daemon.run(Duration::from_secs(60)))
+        };
+        let socket = socket_path(&omar_dir, None);
+
+        // An old shim against an unchanged daemon is refused, nothing more.
+        let stream = UnixStream::connect(&socket).unwrap();
+        let reply = hello_from(&stream, &context(&omar_dir), "older build");
+        assert!(!reply.ok && !reply.retired);
+        drop(stream);
+        assert!(socket.exists());
+
+        // Rebuilt in place: the next mismatching shim retires the daemon.
+        std::fs::write(&exe, "new build!").unwrap();
+        let stream = UnixStream::connect(&socket).unwrap();
+        let reply = hello_from(&stream, &context(&omar_dir), "new build");
+        assert!(!reply.ok && reply.retired);
+        drop(stream);
+        assert!(!socket.exists());
+        assert!(
+            bind(&omar_dir).is_some(),
+            "the lock is free for a successor"
+        );
+
+        runner.join().unwrap();
+    }
+
+    #[test]
+    fn daemon_names_are_per_tmux_server() {
+        assert_eq!(daemon_name(None), "daemon");
+        assert_eq!(daemon_name(Some("omar-test/1")), "daemon-omar-test_1");
+    }
+}
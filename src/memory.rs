@@ -3,28 +3,28 @@
 //! Writes a human-readable markdown snapshot of the current OMAR state
 //! so a newly created manager session can resume seamlessly.
 //! All functions take a `state_dir` parameter for EA-scoped isolation.
+//!
+//! State-changing paths don't write the snapshot themselves: they hand
+//! [`queue_memory_write`] a closure that gathers it, and one background
+//! writer coalesces bursts per state directory into a single rewrite.
 
 use std::collections::HashMap;
 use std::fs;
 use std::path::{Path, PathBuf};
-use std::sync::Mutex;
+use std::sync::{Condvar, Mutex, OnceLock};
+use std::time::{Duration, Instant};
 
 use crate::app::AgentInfo;
 use crate::ea::EaId;
 use crate::projects;
 use crate::scheduler::ScheduledEvent;
+use crate::state_store::{self, Change, Table};
 use crate::tmux::TmuxClient;
+use serde_json::Value;
 use uuid::Uuid;
 
-/// Per-file-type mutexes to serialize concurrent read-modify-write operations.
-/// These are process-global (not per-EA) which is sufficient since all EAs
-/// run in the same process and operate on separate state_dir paths.
-static WORKER_TASKS_LOCK: Mutex<()> = Mutex::new(());
-static AGENT_PARENTS_LOCK: Mutex<()> = Mutex::new(());
-static AGENT_PROJECTS_LOCK: Mutex<()> = Mutex::new(());
-
 /// Generic JSON helpers
-fn read_json<T: serde::de::DeserializeOwned>(path: &Path) -> Option<T> {
+pub(crate) fn read_json<T: serde::de::DeserializeOwned>(path: &Path) -> Option<T> {
     fs::read_to_string(path)
         .ok()
         .and_then(|c| serde_json::from_str(&c).ok())
@@ -32,13 +32,13 @@ fn read_json<T: serde::de::DeserializeOwned>(path: &Path) -> Option<T> {
 
 /// Write JSON atomically: write to a unique sibling temp file then rename into place.
 /// This prevents partial writes from being visible to concurrent readers.
-fn write_json<T: serde::Serialize>(path: &Path, data: &T) {
+pub(crate) fn write_json<T: serde::Serialize>(path: &Path, data: &T) {
     if let Ok(json) = serde_json::to_string_pretty(data) {
         write_text_atomic(path, &json);
     }
 }
 
-fn write_text_atomic(path: &Path, text: &str) {
+pub(crate) fn write_text_atomic(path: &Path, text: &str) {
     if let Some(parent) = path.parent() {
         let _ = fs::create_dir_all(parent);
     }
@@ -56,109 +56,148 @@ fn write_text_atomic(path: &Path, text: &str) {
     }
 }
 
+/// Apply `changes` to the EA's store. Best effort, like every write here:
+/// agent metadata is advisory and a failed write must not fail the spawn
+/// or kill that produced it.
+fn apply_changes(state_dir: &Path, changes: &[Change]) {
+    if let Err(e) = state_store::open(state_dir).apply(changes) {
+        eprintln!("warn: state write in {:?} failed: {:#}", state_dir, e);
+    }
+}
+
+/// A table's string-valued records.
+fn load_strings(state_dir: &Path, table: Table) -> HashMap<String, String> {
+    state_store::open(state_dir)
+        .records(table)
+        .into_iter()
+        .filter_map(|(key, value)| match value {
+            Value::String(text) => Some((key, text)),
+            _ => None,
+        })
+        .collect()
+}
+
 /// Save a worker's task description (upsert)
 pub fn save_worker_task_in(state_dir: &Path, session: &str, task: &str) {
-    let path = state_dir.join("worker_tasks.json");
-    let _guard = WORKER_TASKS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
-    let mut tasks = load_worker_tasks_inner(state_dir);
-    tasks.insert(session.to_string(), task.to_string());
-    write_json(&path, &tasks);
+    save_worker_tasks_in(state_dir, &[(session, task)]);
 }
 
-/// Load all worker task mappings for an EA
-pub fn load_worker_tasks_from(state_dir: &Path) -> HashMap<String, String> {
-    let _guard = WORKER_TASKS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
-    load_worker_tasks_inner(state_dir)
+/// Upsert several worker tasks in one write.
+pub fn save_worker_tasks_in(state_dir: &Path, entries: &[(&str, &str)]) {
+    let changes: Vec<Change> = entries
+        .iter()
+        .map(|(session, task)| Change::put(Table::WorkerTasks, session, *task))
+        .collect();
+    apply_changes(state_dir, &changes);
 }
 
-/// Inner (lock-free) loader — only call while holding `WORKER_TASKS_LOCK`.
-fn load_worker_tasks_inner(state_dir: &Path) -> HashMap<String, String> {
-    let path = state_dir.join("worker_tasks.json");
-    read_json(&path).unwrap_or_default()
+/// Load all worker task mappings for an EA
+pub fn load_worker_tasks_from(state_dir: &Path) -> HashMap<String, String> {
+    load_strings(state_dir, Table::WorkerTasks)
 }
 
-/// Save an agent->project mapping (upsert)
-pub fn save_agent_project_in(state_dir: &Path, session: &str, project_id: usize) {
-    let path = state_dir.join("agent_projects.json");
-    let _guard = AGENT_PROJECTS_LOCK
-        .lock()
-        .unwrap_or_else(|e| e.into_inner());
-    let mut projects = load_agent_projects_inner(state_dir);
-    projects.insert(session.to_string(), project_id);
-    write_json(&path, &projects);
+/// Path whose changes signal a change to an EA's worker tasks.
+pub fn worker_tasks_path(state_dir: &Path) -> PathBuf {
+    state_store::open(state_dir).watch_path(Table::WorkerTasks)
 }
 
 /// Load all agent->project mappings for an EA
 pub fn load_agent_projects_from(state_dir: &Path) -> HashMap<String, usize> {
-    let _guard = AGENT_PROJECTS_LOCK
-        .lock()
-        .unwrap_or_else(|e| e.into_inner());
-    load_agent_projects_inner(state_dir)
-}
-
-/// Inner (lock-free) loader — only call while holding `AGENT_PROJECTS_LOCK`.
-fn load_agent_projects_inner(state_dir: &Path) -> HashMap<String, usize> {
-    let path = state_dir.join("agent_projects.json");
-    read_json(&path).unwrap_or_default()
+    state_store::open(state_dir)
+        .records(Table::AgentProjects)
+        .into_iter()
+        .filter_map(|(key, value)| Some((key, value.as_u64()? as usize)))
+        .collect()
 }
 
-/// Remove an agent->project mapping
-pub fn remove_agent_project_in(state_dir: &Path, session: &str) {
-    let path = state_dir.join("agent_projects.json");
-    let _guard = AGENT_PROJECTS_LOCK
-        .lock()
-        .unwrap_or_else(|e| e.into_inner());
-    let mut projects = load_agent_projects_inner(state_dir);
-    projects.remove(session);
-    write_json(&path, &projects);
+/// Path whose changes signal a change to an EA's child->parent mappings.
+pub fn agent_parents_path(state_dir: &Path) -> PathBuf {
+    state_store::open(state_dir).watch_path(Table::AgentParents)
 }
 
 /// Save a child->parent mapping (upsert)
 pub fn save_agent_parent_in(state_dir: &Path, child: &str, parent: &str) {
-    let path = state_dir.join("agent_parents.json");
-    let _guard = AGENT_PARENTS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
-    let mut parents = load_agent_parents_inner(state_dir);
-    parents.insert(child.to_string(), parent.to_string());
-    write_json(&path, &parents);
+    save_agent_parents_in(state_dir, &[(child, parent)]);
+}
+
+/// Upsert several child->parent mappings in one write.
+pub fn save_agent_parents_in(state_dir: &Path, entries: &[(&str, &str)]) {
+    let changes: Vec<Change> = entries
+        .iter()
+        .map(|(child, parent)| Change::put(Table::AgentParents, child, *parent))
+        .collect();
+    apply_changes(state_dir, &changes);
 }
 
 /// Load all child->parent mappings for an EA
 pub fn load_agent_parents_from(state_dir: &Path) -> HashMap<String, String> {
-    let _guard = AGENT_PARENTS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
-    load_agent_parents_inner(state_dir)
+    load_strings(state_dir, Table::AgentParents)
 }
 
-/// Inner (lock-free) loader — only call while holding `AGENT_PARENTS_LOCK`.
-fn load_agent_parents_inner(state_dir: &Path) -> HashMap<String, String> {
-    let path = state_dir.join("agent_parents.json");
-    read_json(&path).unwrap_or_default()
+/// Sessions whose recorded parent is `parent`, sorted.
+pub fn load_agent_children_in(state_dir: &Path, parent: &str) -> Vec<String> {
+    state_store::open(state_dir).children_of(parent)
 }
 
 /// Remove a child->parent mapping
 pub fn remove_agent_parent_in(state_dir: &Path, child: &str) {
-    let path = state_dir.join("agent_parents.json");
-    let _guard = AGENT_PARENTS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
-    let mut parents = load_agent_parents_inner(state_dir);
-    parents.remove(child);
-    write_json(&path, &parents);
+    apply_changes(state_dir, &[Change::delete(Table::AgentParents, child)]);
+}
+
+/// What a spawn records about each new agent.
+pub struct SpawnedAgent<'a> {
+    pub session: &'a str,
+    pub parent: &'a str,
+    pub task: &'a str,
+    pub project_id: usize,
+}
+
+/// Record the parent, task and project of freshly spawned agents in one
+/// write (one transaction on the journal backend).
+pub fn save_spawned_agents_in(state_dir: &Path, agents: &[SpawnedAgent<'_>]) {
+    let changes: Vec<Change> = agents
+        .iter()
+        .flat_map(|agent| {
+            [
+                Change::put(Table::AgentParents, agent.session, agent.parent),
+                Change::put(Table::WorkerTasks, agent.session, agent.task),
+                Change::put(Table::AgentProjects, agent.session, agent.project_id),
+            ]
+        })
+        .collect();
+    apply_changes(state_dir, &changes);
+}
+
+/// Drop a killed agent's parent and project records together.
+pub fn forget_agent_in(state_dir: &Path, session: &str) {
+    apply_changes(
+        state_dir,
+        &[
+            Change::delete(Table::AgentParents, session),
+            Change::delete(Table::AgentProjects, session),
+        ],
+    );
 }
 
 /// Load an agent's self-reported status
 pub fn load_agent_status_in(state_dir: &Path, session_name: &str) -> Option<String> {
-    let path = state_dir
-        .join("status")
-        .join(format!("{}.md", session_name));
-    fs::read_to_string(&path)
-        .ok()
+    state_store::open(state_dir)
+        .get(Table::Statuses, session_name)
+        .and_then(|value| value.as_str().map(str::to_string))
         .filter(|s| !s.trim().is_empty())
 }
 
 /// Save an agent's status
 pub fn save_agent_status_in(state_dir: &Path, session_name: &str, status: &str) {
-    let dir = state_dir.join("status");
-    fs::create_dir_all(&dir).ok();
-    let path = dir.join(format!("{}.md", session_name));
-    write_text_atomic(&path, status);
+    apply_changes(
+        state_dir,
+        &[Change::put(Table::Statuses, session_name, status)],
+    );
+}
+
+/// Path whose changes signal a change to an EA's agent statuses.
+pub fn agent_status_path(state_dir: &Path) -> PathBuf {
+    state_store::open(state_dir).watch_path(Table::Statuses)
 }
 
 /// Load the memory file contents (empty string if missing)
@@ -236,10 +275,7 @@ pub fn write_memory_to(
     // Read task metadata without pruning. Session discovery can lag tmux
     // creation during large fan-outs; pruning here can erase valid tasks.
     // Explicit kill/delete paths own cleanup.
-    let worker_tasks = {
-        let _guard = WORKER_TASKS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
-        load_worker_tasks_inner(state_dir)
-    };
+    let worker_tasks = load_worker_tasks_from(state_dir);
 
     let mut out = String::from("# OMAR State\n\n");
 
@@ -319,6 +355,186 @@ pub fn write_memory_to(
     write_text_atomic(&path, &out);
 }
 
+/// Everything [`write_memory_to`] needs, owned so it can be handed to the
+/// background writer.
+pub struct MemorySnapshot {
+    pub agents: Vec<AgentInfo>,
+    pub manager: Option<AgentInfo>,
+    pub manager_session: String,
+    pub client: TmuxClient,
+    pub events: Vec<ScheduledEvent>,
+}
+
+type SnapshotFn = Box<dyn FnOnce() -> MemorySnapshot + Send>;
+
+/// Quiet period after the last request before memory.md is rewritten, so a
+/// fan-out of spawns or a run of status updates produces one write.
+const WRITE_DEBOUNCE: Duration = Duration::from_millis(250);
+/// Upper bound on how long a steady stream of requests can postpone the
+/// write.
+const WRITE_MAX_DELAY: Duration = Duration::from_secs(2);
+
+struct PendingWrite {
+    snapshot: SnapshotFn,
+    first: Instant,
+    last: Instant,
+}
+
+impl PendingWrite {
+    fn due_at(&self) -> Instant {
+        (self.last + WRITE_DEBOUNCE).min(self.first + WRITE_MAX_DELAY)
+    }
+}
+
+/// Pending snapshot per state directory. A newer request replaces the
+/// older closure but keeps its first-request time for [`WRITE_MAX_DELAY`].
+#[derive(Default)]
+struct WriteQueue {
+    pending: HashMap<PathBuf, PendingWrite>,
+    /// Batches taken by the writer thread and not yet on disk.
+    in_flight: usize,
+}
+
+impl WriteQueue {
+    fn push(&mut self, state_dir: &Path, snapshot: SnapshotFn, now: Instant) {
+        let first = self
+            .pending
+            .get(state_dir)
+            .map_or(now, |pending| pending.first);
+        self.pending.insert(
+            state_dir.to_path_buf(),
+            PendingWrite {
+                snapshot,
+                first,
+                last: now,
+            },
+        );
+    }
+
+    fn next_due(&self) -> Option<Instant> {
+        self.pending.values().map(PendingWrite::due_at).min()
+    }
+
+    fn take_due(&mut self, now: Instant) -> Vec<(PathBuf, SnapshotFn)> {
+        let due: Vec<PathBuf> = self
+            .pending
+            .iter()
+            .filter(|(_, pending)| pending.due_at() <= now)
+            .map(|(dir, _)| dir.clone())
+            .collect();
+        due.into_iter()
+            .filter_map(|dir| {
+                let pending = self.pending.remove(&dir)?;
+                Some((dir, pending.snapshot))
+            })
+            .collect()
+    }
+}
+
+struct MemoryWriter {
+    queue: Mutex<WriteQueue>,
+    changed: Condvar,
+}
+
+impl MemoryWriter {
+    fn lock(&self) -> std::sync::MutexGuard<'_, WriteQueue> {
+        self.queue.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn run(&self) {
+        let mut queue = self.lock();
+        loop {
+            let now = Instant::now();
+            let due = queue.take_due(now);
+            if due.is_empty() {
+                queue = match queue.next_due() {
+                    Some(at) => {
+                        self.changed
+                            .wait_timeout(queue, at.saturating_duration_since(now))
+                            .unwrap_or_else(|e| e.into_inner())
+                            .0
+                    }
+                    None => self.changed.wait(queue).unwrap_or_else(|e| e.into_inner()),
+                };
+                continue;
+            }
+            queue.in_flight += 1;
+            drop(queue);
+            for (state_dir, snapshot) in due {
+                write_snapshot(&state_dir, snapshot());
+            }
+            queue = self.lock();
+            queue.in_flight -= 1;
+            self.changed.notify_all();
+        }
+    }
+}
+
+static MEMORY_WRITER: OnceLock<MemoryWriter> = OnceLock::new();
+
+fn memory_writer() -> &'static MemoryWriter {
+    MEMORY_WRITER.get_or_init(|| {
+        std::thread::spawn(|| memory_writer().run());
+        MemoryWriter {
+            queue: Mutex::new(WriteQueue::default()),
+            changed: Condvar::new(),
+        }
+    })
+}
+
+/// Ask for `state_dir`'s memory.md to be rewritten. Returns immediately:
+/// `snapshot` runs later on the writer thread, once requests for this
+/// directory have been quiet for [`WRITE_DEBOUNCE`], so any tmux queries it
+/// makes, the manager pane capture and the file write all stay out of the
+/// caller's critical section. Only the latest closure per directory runs.
+pub fn queue_memory_write(
+    state_dir: &Path,
+    snapshot: impl FnOnce() -> MemorySnapshot + Send + 'static,
+) {
+    let writer = memory_writer();
+    writer
+        .lock()
+        .push(state_dir, Box::new(snapshot), Instant::now());
+    writer.changed.notify_all();
+}
+
+/// Write every pending snapshot now, on the calling thread, after any
+/// write already in progress finishes. Called before a process exits so
+/// the last state change isn't lost with the writer thread.
+pub fn flush_memory_writes() {
+    let Some(writer) = MEMORY_WRITER.get() else {
+        return;
+    };
+    let mut queue = writer.lock();
+    while queue.in_flight > 0 {
+        queue = writer
+            .changed
+            .wait(queue)
+            .unwrap_or_else(|e| e.into_inner());
+    }
+    let pending: Vec<(PathBuf, PendingWrite)> = queue.pending.drain().collect();
+    drop(queue);
+    for (state_dir, pending) in pending {
+        write_snapshot(&state_dir, (pending.snapshot)());
+    }
+}
+
+/// A request can outlive its EA (or a test's temp dir); don't recreate a
+/// state directory that was deleted in the meantime.
+fn write_snapshot(state_dir: &Path, snapshot: MemorySnapshot) {
+    if !state_dir.is_dir() {
+        return;
+    }
+    write_memory_to(
+        state_dir,
+        &snapshot.agents,
+        snapshot.manager.as_ref(),
+        &snapshot.manager_session,
+        &snapshot.client,
+        &snapshot.events,
+    );
+}
+
 /// Clear runtime/transient EA state that should not leak across dashboard sessions.
 /// Keeps durable artifacts such as projects, task metadata, hierarchy, memory,
 /// scheduled events, and manager notes intact so the dashboard can resume.
@@ -418,4 +634,72 @@ mod tests {
         assert!(line.contains("payload: check deployment status"));
         assert!(line.contains("id=abc-123"));
     }
+
+    fn empty_snapshot() -> MemorySnapshot {
+        MemorySnapshot {
+            agents: Vec::new(),
+            manager: None,
+            manager_session: "omar-agent-ea-0".to_string(),
+            client: TmuxClient::new("omar-agent-0-"),
+            events: Vec::new(),
+        }
+    }
+
+    #[test]
+    fn write_queue_coalesces_bursts_per_state_dir() {
+        let start = Instant::now();
+        let mut queue = WriteQueue::default();
+        let runs = std::sync::Arc::new(std::sync::atomic::AtomicUsize::new(0));
+        for i in 0..100 {
+            let runs = runs.clone();
+            queue.push(
+                Path::new("/state/ea0"),
+                Box::new(move || {
+                    runs.fetch_add(1, std::sync::atomic::Ordering::SeqCst);
+                    empty_snapshot()
+                }),
+                start + Duration::from_millis(i),
+            );
+        }
+        queue.push(Path::new("/state/ea1"), Box::new(empty_snapshot), start);
+
+        let last = start + Duration::from_millis(99);
+        assert!(queue.take_due(last).is_empty(), "still inside the debounce");
+        assert_eq!(queue.next_due(), Some(start + WRITE_DEBOUNCE));
+
+        let due = queue.take_due(last + WRITE_DEBOUNCE);
+        assert_eq!(due.len(), 2, "one write per state dir");
+        for (_, snapshot) in due {
+            snapshot();
+        }
+        assert_eq!(runs.load(std::sync::atomic::Ordering::SeqCst), 1);
+        assert!(queue.pending.is_empty());
+    }
+
+    #[test]
+    fn write_queue_bounds_how_long_a_stream_defers_the_write() {
+        let start = Instant::now();
+        let mut queue = WriteQueue::default();
+        let mut now = start;
+        while now < start + WRITE_MAX_DELAY {
+            queue.push(Path::new("/state/ea0"), Box::new(empty_snapshot), now);
+            now += WRITE_DEBOUNCE / 2;
+        }
+        assert_eq!(queue.next_due(), Some(start + WRITE_MAX_DELAY));
+        assert_eq!(queue.take_due(start + WRITE_MAX_DELAY).len(), 1);
+    }
+
+    #[test]
+    fn flush_writes_pending_snapshots_and_skips_deleted_dirs() {
+        let dir = tempfile::tempdir().unwrap();
+        let gone = dir.path().join("deleted-ea");
+        queue_memory_write(dir.path(), empty_snapshot);
+        queue_memory_write(&gone, empty_snapshot);
+        flush_memory_writes();
+
+        let memory = std::fs::read_to_string(dir.path().join("memory.md")).unwrap();
+        assert!(memory.starts_with("# OMAR State"));
+        assert!(memory.contains("- Status: Not running"));
+        assert!(!gone.exists());
+    }
 }
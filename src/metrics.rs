@@ -1,27 +1,67 @@
-use std::fs::OpenOptions;
-use std::io::Write;
-use std::path::PathBuf;
-use std::sync::atomic::{AtomicBool, Ordering};
-use std::sync::{Mutex, OnceLock};
-use std::time::{SystemTime, UNIX_EPOCH};
+//! Process metrics: counters and latency histograms kept in atomics, and
+//! the spawn event log.
+//!
+//! Recording is a few relaxed atomic adds, so hot paths (every tmux call,
+//! every state lock) record unconditionally. Files belong to one
+//! background thread: it appends queued event lines to
+//! `spawn_metrics.jsonl` through a single buffered handle, and, while
+//! snapshots are on, rewrites `metrics/processes/<pid>.json` with this
+//! process's values whenever they change. With `[metrics]
+//! prometheus_listen` set, the dashboard serves `/metrics` in the
+//! Prometheus text format, merging the snapshots of every live omar
+//! process under a `process` label.
+
+use anyhow::{Context, Result};
+use serde::{Deserialize, Serialize};
+use std::collections::BTreeMap;
+use std::fs::{File, OpenOptions};
+use std::io::{BufRead, BufReader, BufWriter, Write};
+use std::net::{TcpListener, TcpStream};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{mpsc, Arc, OnceLock, RwLock};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+use crate::config::MetricsConfig;
 
 static METRICS_ENABLED: AtomicBool = AtomicBool::new(false);
-static METRICS_LOCK: OnceLock<Mutex<()>> = OnceLock::new();
+static SNAPSHOTS_ENABLED: AtomicBool = AtomicBool::new(false);
+static PROCESS_ROLE: OnceLock<String> = OnceLock::new();
+static FLUSHER: OnceLock<mpsc::Sender<FlushMessage>> = OnceLock::new();
+
+/// How often the background thread flushes events and rewrites the
+/// process snapshot.
+const FLUSH_INTERVAL: Duration = Duration::from_secs(5);
 
-pub fn configure(enabled: bool) {
-    METRICS_ENABLED.store(enabled, Ordering::Relaxed);
+/// Turn the event log and snapshots on or off for this process. `role`
+/// names the process in scraped metrics (e.g. "dashboard", "mcp-daemon").
+pub fn configure(config: &MetricsConfig, role: &str) {
+    METRICS_ENABLED.store(config.spawn_metrics_enabled, Ordering::Relaxed);
+    let snapshots = config.spawn_metrics_enabled || config.prometheus_listen.is_some();
+    SNAPSHOTS_ENABLED.store(snapshots, Ordering::Relaxed);
+    let _ = PROCESS_ROLE.set(role.to_string());
+    if snapshots {
+        flusher();
+    }
 }
 
 fn enabled() -> bool {
     METRICS_ENABLED.load(Ordering::Relaxed)
 }
 
-fn sink_path() -> PathBuf {
+fn metrics_dir() -> PathBuf {
     dirs::home_dir()
         .unwrap_or_else(|| PathBuf::from("."))
         .join(".omar")
         .join("metrics")
-        .join("spawn_metrics.jsonl")
+}
+
+fn sink_path() -> PathBuf {
+    metrics_dir().join("spawn_metrics.jsonl")
+}
+
+fn snapshots_dir(metrics_dir: &Path) -> PathBuf {
+    metrics_dir.join("processes")
 }
 
 fn now_unix_ns() -> u128 {
@@ -31,23 +71,641 @@ fn now_unix_ns() -> u128 {
         .as_nanos()
 }
 
-fn write_metric(event: &str, payload: serde_json::Value) {
-    if !enabled() {
-        return;
+// ── Counters and histograms ──
+
+/// A monotonically increasing count.
+pub struct Counter(AtomicU64);
+
+impl Counter {
+    pub const fn new() -> Self {
+        Self(AtomicU64::new(0))
     }
 
-    let lock = METRICS_LOCK.get_or_init(|| Mutex::new(()));
-    let _guard = match lock.lock() {
-        Ok(g) => g,
-        Err(_) => return,
+    pub fn inc(&self) {
+        self.add(1);
+    }
+
+    pub fn add(&self, n: u64) {
+        self.0.fetch_add(n, Ordering::Relaxed);
+    }
+
+    pub fn get(&self) -> u64 {
+        self.0.load(Ordering::Relaxed)
+    }
+}
+
+impl Default for Counter {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Values below this many microseconds get a bucket each.
+const LINEAR_BUCKETS: usize = 16;
+/// Above that, each power of two splits into `1 << SUB_BITS` buckets, so a
+/// bucket is at most 12.5% wide, HDR-histogram style.
+const SUB_BITS: u32 = 3;
+const SUB_BUCKETS: usize = 1 << SUB_BITS;
+const BUCKETS: usize = LINEAR_BUCKETS + (64 - 4) * SUB_BUCKETS;
+
+fn bucket_of(us: u64) -> usize {
+    if us < LINEAR_BUCKETS as u64 {
+        return us as usize;
+    }
+    let exponent = 63 - us.leading_zeros();
+    let sub = (us >> (exponent - SUB_BITS)) as usize & (SUB_BUCKETS - 1);
+    LINEAR_BUCKETS + (exponent as usize - 4) * SUB_BUCKETS + sub
+}
+
+/// Largest value, in microseconds, that lands in bucket `index`.
+fn bucket_max(index: usize) -> u64 {
+    if index < LINEAR_BUCKETS {
+        return index as u64;
+    }
+    let exponent = ((index - LINEAR_BUCKETS) / SUB_BUCKETS + 4) as u32;
+    let sub = ((index - LINEAR_BUCKETS) % SUB_BUCKETS) as u64;
+    let width = 1u64 << (exponent - SUB_BITS);
+    ((SUB_BUCKETS as u64 + sub) << (exponent - SUB_BITS)) + (width - 1)
+}
+
+/// A latency histogram at microsecond resolution with log-linear buckets.
+pub struct Histogram {
+    buckets: [AtomicU64; BUCKETS],
+    count: AtomicU64,
+    sum_us: AtomicU64,
+    max_us: AtomicU64,
+}
+
+impl Histogram {
+    #[allow(clippy::declare_interior_mutable_const)]
+    pub const fn new() -> Self {
+        const ZERO: AtomicU64 = AtomicU64::new(0);
+        Self {
+            buckets: [ZERO; BUCKETS],
+            count: ZERO,
+            sum_us: ZERO,
+            max_us: ZERO,
+        }
+    }
+
+    pub fn record(&self, elapsed: Duration) {
+        self.record_us(elapsed.as_micros().min(u64::MAX as u128) as u64);
+    }
+
+    pub fn record_us(&self, us: u64) {
+        self.buckets[bucket_of(us)].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum_us.fetch_add(us, Ordering::Relaxed);
+        self.max_us.fetch_max(us, Ordering::Relaxed);
+    }
+
+    /// Time from now until the returned guard is dropped.
+    pub fn start_timer(&self) -> Timer<'_> {
+        Timer {
+            histogram: self,
+            started: Instant::now(),
+        }
+    }
+
+    pub fn snapshot(&self) -> HistogramSnapshot {
+        HistogramSnapshot {
+            count: self.count.load(Ordering::Relaxed),
+            sum_us: self.sum_us.load(Ordering::Relaxed),
+            max_us: self.max_us.load(Ordering::Relaxed),
+            buckets: self
+                .buckets
+                .iter()
+                .enumerate()
+                .filter_map(|(index, bucket)| {
+                    let n = bucket.load(Ordering::Relaxed);
+                    (n > 0).then(|| (bucket_max(index), n))
+                })
+                .collect(),
+        }
+    }
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// Records its lifetime into a histogram on drop.
+pub struct Timer<'a> {
+    histogram: &'a Histogram,
+    started: Instant,
+}
+
+impl Drop for Timer<'_> {
+    fn drop(&mut self) {
+        self.histogram.record(self.started.elapsed());
+    }
+}
+
+/// A point-in-time copy of a histogram: its non-empty buckets as
+/// (largest value in µs, count), in order.
+#[derive(Debug, Clone, Default, PartialEq, Serialize, Deserialize)]
+pub struct HistogramSnapshot {
+    pub count: u64,
+    pub sum_us: u64,
+    pub max_us: u64,
+    pub buckets: Vec<(u64, u64)>,
+}
+
+impl HistogramSnapshot {
+    /// Upper bound, in µs, of the bucket holding the `q` quantile.
+    pub fn quantile(&self, q: f64) -> u64 {
+        let rank = ((self.count as f64) * q.clamp(0.0, 1.0)).ceil().max(1.0) as u64;
+        let mut seen = 0;
+        for &(max, n) in &self.buckets {
+            seen += n;
+            if seen >= rank {
+                return max.min(self.max_us);
+            }
+        }
+        self.max_us
+    }
+
+    /// How many values were at most `bound_us`. Buckets straddling the
+    /// bound count above it.
+    fn count_at_most(&self, bound_us: u64) -> u64 {
+        self.buckets
+            .iter()
+            .take_while(|&&(max, _)| max <= bound_us)
+            .map(|&(_, n)| n)
+            .sum()
+    }
+}
+
+/// Histograms keyed by one label value (e.g. the MCP tool name). The map
+/// lock is taken for writing only the first time a label is seen.
+pub struct LabeledHistogram {
+    label: &'static str,
+    series: RwLock<BTreeMap<String, Arc<Histogram>>>,
+}
+
+impl LabeledHistogram {
+    pub const fn new(label: &'static str) -> Self {
+        Self {
+            label,
+            series: RwLock::new(BTreeMap::new()),
+        }
+    }
+
+    pub fn record(&self, value: &str, elapsed: Duration) {
+        let existing = self.series.read().unwrap().get(value).cloned();
+        let histogram = existing.unwrap_or_else(|| {
+            self.series
+                .write()
+                .unwrap()
+                .entry(value.to_string())
+                .or_insert_with(|| Arc::new(Histogram::new()))
+                .clone()
+        });
+        histogram.record(elapsed);
+    }
+
+    /// Every label value seen so far with a snapshot of its histogram, in
+    /// label order.
+    pub fn snapshots(&self) -> Vec<(String, HistogramSnapshot)> {
+        self.series
+            .read()
+            .unwrap()
+            .iter()
+            .map(|(value, histogram)| (value.clone(), histogram.snapshot()))
+            .collect()
+    }
+}
+
+/// Wall time of every tmux command, over control mode or exec.
+pub static TMUX_CALL: Histogram = Histogram::new();
+/// Time spent blocked taking a state file lock.
+pub static LOCK_WAIT: Histogram = Histogram::new();
+/// Prompt delivery attempts, including the first of each delivery.
+pub static DELIVERY_ATTEMPTS: Counter = Counter::new();
+/// Attempts after the first, i.e. retries.
+pub static DELIVERY_RETRIES: Counter = Counter::new();
+/// Deliveries that gave up unverified.
+pub static DELIVERY_FAILURES: Counter = Counter::new();
+/// How late scheduled events fire: fire time minus due time.
+pub static SCHEDULER_LAG: Histogram = Histogram::new();
+/// Duration of a dashboard state refresh.
+pub static REFRESH: Histogram = Histogram::new();
+/// MCP tool call latency by tool.
+pub static MCP_TOOL: LabeledHistogram = LabeledHistogram::new("tool");
+
+// ── Snapshots ──
+
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+#[serde(tag = "kind", rename_all = "snake_case")]
+enum Sample {
+    Counter { value: u64 },
+    Histogram(HistogramSnapshot),
+}
+
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+struct Series {
+    #[serde(default, skip_serializing_if = "Vec::is_empty")]
+    labels: Vec<(String, String)>,
+    #[serde(flatten)]
+    value: Sample,
+}
+
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+struct Family {
+    name: String,
+    help: String,
+    series: Vec<Series>,
+}
+
+/// One process's metrics as written to `processes/<pid>.json`.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+struct ProcessSnapshot {
+    process: String,
+    pid: u32,
+    families: Vec<Family>,
+}
+
+fn counter_family(name: &str, help: &str, counter: &Counter) -> Family {
+    Family {
+        name: name.to_string(),
+        help: help.to_string(),
+        series: vec![Series {
+            labels: Vec::new(),
+            value: Sample::Counter {
+                value: counter.get(),
+            },
+        }],
+    }
+}
+
+fn histogram_family(name: &str, help: &str, histogram: &Histogram) -> Family {
+    Family {
+        name: name.to_string(),
+        help: help.to_string(),
+        series: vec![Series {
+            labels: Vec::new(),
+            value: Sample::Histogram(histogram.snapshot()),
+        }],
+    }
+}
+
+fn labeled_family(name: &str, help: &str, histograms: &LabeledHistogram) -> Family {
+    Family {
+        name: name.to_string(),
+        help: help.to_string(),
+        series: histograms
+            .snapshots()
+            .into_iter()
+            .map(|(value, snapshot)| Series {
+                labels: vec![(histograms.label.to_string(), value)],
+                value: Sample::Histogram(snapshot),
+            })
+            .collect(),
+    }
+}
+
+fn snapshot() -> ProcessSnapshot {
+    ProcessSnapshot {
+        process: PROCESS_ROLE
+            .get()
+            .cloned()
+            .unwrap_or_else(|| "omar".to_string()),
+        pid: std::process::id(),
+        families: vec![
+            histogram_family(
+                "omar_tmux_call_seconds",
+                "Wall time of tmux commands.",
+                &TMUX_CALL,
+            ),
+            histogram_family(
+                "omar_lock_wait_seconds",
+                "Time blocked taking a state file lock.",
+                &LOCK_WAIT,
+            ),
+            counter_family(
+                "omar_delivery_attempts_total",
+                "Prompt delivery attempts.",
+                &DELIVERY_ATTEMPTS,
+            ),
+            counter_family(
+                "omar_delivery_retries_total",
+                "Prompt delivery attempts after the first.",
+                &DELIVERY_RETRIES,
+            ),
+            counter_family(
+                "omar_delivery_failures_total",
+                "Prompt deliveries that were never verified.",
+                &DELIVERY_FAILURES,
+            ),
+            histogram_family(
+                "omar_scheduler_lag_seconds",
+                "How long after its due time a scheduled event fired.",
+                &SCHEDULER_LAG,
+            ),
+            histogram_family(
+                "omar_refresh_seconds",
+                "Duration of a dashboard state refresh.",
+                &REFRESH,
+            ),
+            labeled_family("omar_mcp_tool_seconds", "MCP tool call latency.", &MCP_TOOL),
+        ],
+    }
+}
+
+/// Whether any metric in `snapshot` has recorded something.
+fn has_data(snapshot: &ProcessSnapshot) -> bool {
+    snapshot.families.iter().any(|family| {
+        family.series.iter().any(|series| match &series.value {
+            Sample::Counter { value } => *value > 0,
+            Sample::Histogram(histogram) => histogram.count > 0,
+        })
+    })
+}
+
+fn write_snapshot(metrics_dir: &Path, snapshot: &ProcessSnapshot) -> Result<()> {
+    let dir = snapshots_dir(metrics_dir);
+    std::fs::create_dir_all(&dir)
+        .with_context(|| format!("Failed to create metrics directory {:?}", dir))?;
+    let path = dir.join(format!("{}.json", snapshot.pid));
+    let tmp = dir.join(format!(".{}.json.tmp", snapshot.pid));
+    std::fs::write(&tmp, serde_json::to_vec(snapshot)?)?;
+    std::fs::rename(&tmp, &path)?;
+    Ok(())
+}
+
+/// Snapshots of live processes. Snapshots left by processes that have
+/// exited are removed.
+fn load_snapshots(metrics_dir: &Path) -> Vec<ProcessSnapshot> {
+    let mut snapshots: Vec<ProcessSnapshot> = std::fs::read_dir(snapshots_dir(metrics_dir))
+        .into_iter()
+        .flatten()
+        .flatten()
+        .filter_map(|entry| {
+            let path = entry.path();
+            if path.extension().is_none_or(|ext| ext != "json") {
+                return None;
+            }
+            let snapshot: ProcessSnapshot =
+                serde_json::from_slice(&std::fs::read(&path).ok()?).ok()?;
+            if !crate::process::pid_alive(snapshot.pid) {
+                let _ = std::fs::remove_file(&path);
+                return None;
+            }
+            Some(snapshot)
+        })
+        .collect();
+    snapshots.sort_by_key(|snapshot| snapshot.pid);
+    snapshots
+}
+
+// ── Prometheus text format ──
+
+/// `le` bounds, in seconds, of the exported histogram buckets.
+const EXPORT_BOUNDS_SECONDS: [f64; 16] = [
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0,
+    60.0,
+];
+
+fn escape_label(value: &str) -> String {
+    value
+        .replace('\\', "\\\\")
+        .replace('"', "\\\"")
+        .replace('\n', "\\n")
+}
+
+fn label_set(labels: &[(String, String)], extra: Option<(&str, &str)>) -> String {
+    let pairs: Vec<String> = labels
+        .iter()
+        .map(|(k, v)| (k.as_str(), v.as_str()))
+        .chain(extra)
+        .map(|(k, v)| format!("{}=\"{}\"", k, escape_label(v)))
+        .collect();
+    if pairs.is_empty() {
+        String::new()
+    } else {
+        format!("{{{}}}", pairs.join(","))
+    }
+}
+
+/// Render `snapshots` in the Prometheus text exposition format, one family
+/// per metric with every process's series under it.
+fn render_prometheus(snapshots: &[ProcessSnapshot]) -> String {
+    let mut families: BTreeMap<&str, (&str, bool, Vec<String>)> = BTreeMap::new();
+    for snapshot in snapshots {
+        let pid = snapshot.pid.to_string();
+        for family in &snapshot.families {
+            for series in &family.series {
+                let mut labels = series.labels.clone();
+                labels.push(("process".to_string(), snapshot.process.clone()));
+                labels.push(("pid".to_string(), pid.clone()));
+                let is_histogram = matches!(series.value, Sample::Histogram(_));
+                let entry = families
+                    .entry(family.name.as_str())
+                    .or_insert_with(|| (family.help.as_str(), is_histogram, Vec::new()));
+                match &series.value {
+                    Sample::Counter { value } => {
+                        entry.2.push(format!(
+                            "{}{} {}",
+                            family.name,
+                            label_set(&labels, None),
+                            value
+                        ));
+                    }
+                    Sample::Histogram(histogram) => {
+                        for bound in EXPORT_BOUNDS_SECONDS {
+                            let bound_us = (bound * 1_000_000.0) as u64;
+                            entry.2.push(format!(
+                                "{}_bucket{} {}",
+                                family.name,
+                                label_set(&labels, Some(("le", &bound.to_string()))),
+                                histogram.count_at_most(bound_us)
+                            ));
+                        }
+                        entry.2.push(format!(
+                            "{}_bucket{} {}",
+                            family.name,
+                            label_set(&labels, Some(("le", "+Inf"))),
+                            histogram.count
+                        ));
+                        entry.2.push(format!(
+                            "{}_sum{} {}",
+                            family.name,
+                            label_set(&labels, None),
+                            histogram.sum_us as f64 / 1_000_000.0
+                        ));
+                        entry.2.push(format!(
+                            "{}_count{} {}",
+                            family.name,
+                            label_set(&labels, None),
+                            histogram.count
+                        ));
+                    }
+                }
+            }
+        }
+    }
+
+    let mut out = String::new();
+    for (name, (help, is_histogram, lines)) in families {
+        out.push_str(&format!("# HELP {} {}\n", name, help));
+        out.push_str(&format!(
+            "# TYPE {} {}\n",
+            name,
+            if is_histogram { "histogram" } else { "counter" }
+        ));
+        for line in lines {
+            out.push_str(&line);
+            out.push('\n');
+        }
+    }
+    out
+}
+
+/// Serve `GET /metrics` on `listen` from a background thread, for the
+/// live processes' snapshots under the OMAR metrics directory.
+pub fn serve_prometheus(listen: &str) -> Result<()> {
+    serve_prometheus_from(listen, metrics_dir()).map(|_| ())
+}
+
+fn serve_prometheus_from(listen: &str, metrics_dir: PathBuf) -> Result<std::net::SocketAddr> {
+    let listener = TcpListener::bind(listen)
+        .with_context(|| format!("Failed to bind metrics endpoint {}", listen))?;
+    let addr = listener.local_addr()?;
+    std::thread::spawn(move || {
+        for stream in listener.incoming().flatten() {
+            let _ = answer_scrape(stream, &metrics_dir);
+        }
+    });
+    Ok(addr)
+}
+
+fn answer_scrape(stream: TcpStream, metrics_dir: &Path) -> Result<()> {
+    stream.set_read_timeout(Some(Duration::from_secs(2)))?;
+    let mut reader = BufReader::new(&stream);
+    let mut request_line = String::new();
+    reader.read_line(&mut request_line)?;
+    // Drain the headers; the request has no body we care about.
+    let mut header = String::new();
+    while reader.read_line(&mut header)? > 2 {
+        header.clear();
+    }
+
+    let mut parts = request_line.split_whitespace();
+    let (status, content_type, body) = match (parts.next(), parts.next()) {
+        (Some("GET"), Some("/metrics")) => {
+            // Our own values are rendered live rather than read back.
+            let own = snapshot();
+            let mut snapshots: Vec<ProcessSnapshot> = load_snapshots(metrics_dir)
+                .into_iter()
+                .filter(|snapshot| snapshot.pid != own.pid)
+                .collect();
+            snapshots.push(own);
+            (
+                "200 OK",
+                "text/plain; version=0.0.4",
+                render_prometheus(&snapshots),
+            )
+        }
+        _ => ("404 Not Found", "text/plain", "not found\n".to_string()),
     };
+    let mut stream = &stream;
+    write!(
+        stream,
+        "HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+        status,
+        content_type,
+        body.len(),
+        body
+    )?;
+    Ok(())
+}
 
-    let path = sink_path();
-    if let Some(parent) = path.parent() {
-        if std::fs::create_dir_all(parent).is_err() {
-            return;
+// ── Background flushing ──
+
+enum FlushMessage {
+    Event(String),
+    /// Write everything out now and acknowledge.
+    Flush(mpsc::Sender<()>),
+}
+
+fn flusher() -> &'static mpsc::Sender<FlushMessage> {
+    FLUSHER.get_or_init(|| {
+        let (tx, rx) = mpsc::channel();
+        std::thread::spawn(move || run_flusher(rx, sink_path(), metrics_dir()));
+        tx
+    })
+}
+
+fn run_flusher(rx: mpsc::Receiver<FlushMessage>, sink: PathBuf, metrics_dir: PathBuf) {
+    let mut out: Option<BufWriter<File>> = None;
+    let mut last_snapshot: Option<ProcessSnapshot> = None;
+    let mut next_flush = Instant::now() + FLUSH_INTERVAL;
+    loop {
+        let wait = next_flush.saturating_duration_since(Instant::now());
+        let ack = match rx.recv_timeout(wait) {
+            Ok(FlushMessage::Event(line)) => {
+                if out.is_none() {
+                    out = open_sink(&sink);
+                }
+                if let Some(out) = out.as_mut() {
+                    let _ = writeln!(out, "{}", line);
+                }
+                continue;
+            }
+            Ok(FlushMessage::Flush(ack)) => Some(ack),
+            Err(mpsc::RecvTimeoutError::Timeout) => None,
+            Err(mpsc::RecvTimeoutError::Disconnected) => return,
+        };
+
+        if let Some(out) = out.as_mut() {
+            let _ = out.flush();
+        }
+        if SNAPSHOTS_ENABLED.load(Ordering::Relaxed) {
+            let current = snapshot();
+            if has_data(&current) && last_snapshot.as_ref() != Some(&current) {
+                let _ = write_snapshot(&metrics_dir, &current);
+                last_snapshot = Some(current);
+            }
+        }
+        next_flush = Instant::now() + FLUSH_INTERVAL;
+        if let Some(ack) = ack {
+            let _ = ack.send(());
         }
     }
+}
+
+fn open_sink(path: &Path) -> Option<BufWriter<File>> {
+    if let Some(parent) = path.parent() {
+        std::fs::create_dir_all(parent).ok()?;
+    }
+    OpenOptions::new()
+        .create(true)
+        .append(true)
+        .open(path)
+        .ok()
+        .map(BufWriter::new)
+}
+
+/// Write out queued events and this process's snapshot. Called before a
+/// process exits so its last events aren't lost with the flusher thread.
+pub fn flush() {
+    let Some(tx) = FLUSHER.get() else {
+        return;
+    };
+    let (ack_tx, ack_rx) = mpsc::channel();
+    if tx.send(FlushMessage::Flush(ack_tx)).is_ok() {
+        let _ = ack_rx.recv_timeout(Duration::from_secs(2));
+    }
+}
+
+// ── Spawn events ──
+
+fn write_metric(event: &str, payload: serde_json::Value) {
+    if !enabled() {
+        return;
+    }
 
     let mut entry = serde_json::Map::new();
     entry.insert(
@@ -72,13 +730,7 @@ fn write_metric(event: &str, payload: serde_json::Value) {
         Ok(s) => s,
         Err(_) => return,
     };
-
-    let mut file = match OpenOptions::new().create(true).append(true).open(&path) {
-        Ok(f) => f,
-        Err(_) => return,
-    };
-
-    let _ = writeln!(file, "{}", line);
+    let _ = flusher().send(FlushMessage::Event(line));
 }
 
 pub fn record_backend_bootstrap(backend: &str) {
@@ -110,6 +762,8 @@ pub struct AgentSpawnMetric<'a> {
     pub has_task: bool,
     pub spawn_lock_wait_ms: u64,
     pub tmux_spawn_ms: u64,
+    /// Claimed a pre-booted session from the warm pool.
+    pub warm_start: bool,
     pub total_spawn_ms: u64,
 }
 
@@ -124,6 +778,7 @@ pub fn record_agent_spawn(metric: AgentSpawnMetric<'_>) {
             "has_task": metric.has_task,
             "spawn_lock_wait_ms": metric.spawn_lock_wait_ms,
             "tmux_spawn_ms": metric.tmux_spawn_ms,
+            "warm_start": metric.warm_start,
             "total_spawn_ms": metric.total_spawn_ms
         }),
     );
@@ -147,3 +802,125 @@ pub fn record_prompt_delivery(
         }),
     );
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Read;
+
+    #[test]
+    fn buckets_are_ordered_and_within_an_eighth() {
+        let mut last = None;
+        for us in (0..5_000u64).chain([1 << 20, (1 << 40) + 12_345, u64::MAX]) {
+            let index = bucket_of(us);
+            assert!(bucket_max(index) >= us, "{} above its bucket", us);
+            if index >= LINEAR_BUCKETS {
+                assert!(bucket_max(index) - us <= us / 8, "{} bucket too wide", us);
+            }
+            if let Some(last) = last {
+                assert!(index >= last);
+            }
+            last = Some(index);
+        }
+        assert_eq!(bucket_of(u64::MAX), BUCKETS - 1);
+    }
+
+    #[test]
+    fn histogram_reports_quantiles_and_bounds() {
+        let histogram = Histogram::new();
+        for ms in 1..=100u64 {
+            histogram.record(Duration::from_millis(ms));
+        }
+        let snapshot = histogram.snapshot();
+        assert_eq!(snapshot.count, 100);
+        assert_eq!(snapshot.max_us, 100_000);
+        assert_eq!(snapshot.sum_us, 5050 * 1000);
+        let p50 = snapshot.quantile(0.5);
+        assert!((50_000..=56_250).contains(&p50), "p50 {}", p50);
+        assert_eq!(snapshot.quantile(1.0), 100_000);
+        assert_eq!(snapshot.count_at_most(10_000), 9, "10ms straddles a bucket");
+        assert_eq!(snapshot.count_at_most(1_000_000), 100);
+    }
+
+    #[test]
+    fn prometheus_output_merges_processes_per_family() {
+        let tool = LabeledHistogram::new("tool");
+        tool.record("list_agents", Duration::from_millis(3));
+        let attempts = Counter::new();
+        attempts.add(2);
+        let process = |role: &str, pid: u32| ProcessSnapshot {
+            process: role.to_string(),
+            pid,
+            families: vec![
+                counter_family("omar_delivery_attempts_total", "Attempts.", &attempts),
+                labeled_family("omar_mcp_tool_seconds", "Tool latency.", &tool),
+            ],
+        };
+
+        let text = render_prometheus(&[process("dashboard", 1), process("mcp-daemon", 2)]);
+
+        assert_eq!(
+            text.matches("# TYPE omar_mcp_tool_seconds histogram")
+                .count(),
+            1
+        );
+        assert_eq!(
+            text.matches("# TYPE omar_delivery_attempts_total counter")
+                .count(),
+            1
+        );
+        assert!(text.contains("omar_delivery_attempts_total{process=\"mcp-daemon\",pid=\"2\"} 2\n"));
+        assert!(text.contains(
+            "omar_mcp_tool_seconds_bucket{tool=\"list_agents\",process=\"dashboard\",pid=\"1\",le=\"0.0025\"} 0\n"
+        ));
+        assert!(text.contains(
+            "omar_mcp_tool_seconds_bucket{tool=\"list_agents\",process=\"dashboard\",pid=\"1\",le=\"0.005\"} 1\n"
+        ));
+        assert!(text.contains(
+            "omar_mcp_tool_seconds_count{tool=\"list_agents\",process=\"dashboard\",pid=\"1\"} 1\n"
+        ));
+    }
+
+    #[test]
+    fn endpoint_serves_live_snapshots_and_drops_dead_ones() {
+        let dir = tempfile::tempdir().unwrap();
+        let other = ProcessSnapshot {
+            process: "mcp-daemon".to_string(),
+            // Stands in for another live omar process.
+            pid: std::os::unix::process::parent_id(),
+            families: vec![counter_family(
+                "omar_delivery_retries_total",
+                "Retries.",
+                &Counter::new(),
+            )],
+        };
+        write_snapshot(dir.path(), &other).unwrap();
+        let dead = ProcessSnapshot {
+            pid: u32::MAX - 1,
+            ..other.clone()
+        };
+        write_snapshot(dir.path(), &dead).unwrap();
+
+        let addr = serve_prometheus_from("127.0.0.1:0", dir.path().to_path_buf()).unwrap();
+        let mut stream = TcpStream::connect(addr).unwrap();
+        stream
+            .write_all(b"GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n")
+            .unwrap();
+        let mut response = String::new();
+        stream.read_to_string(&mut response).unwrap();
+
+        assert!(response.starts_with("HTTP/1.1 200 OK\r\n"));
+        assert!(response.contains(&format!(
+            "process=\"mcp-daemon\",pid=\"{}\"",
+            std::os::unix::process::parent_id()
+        )));
+        assert!(response.contains(&format!("pid=\"{}\"", std::process::id())));
+        assert!(!response.contains(&format!("pid=\"{}\"", u32::MAX - 1)));
+        assert!(
+            !snapshots_dir(dir.path())
+                .join(format!("{}.json", u32::MAX - 1))
+                .exists(),
+            "a dead process's snapshot is removed"
+        );
+    }
+}
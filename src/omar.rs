@@ -1,11 +1,15 @@
 mod app;
 mod backend_probe;
+mod bench;
 mod computer;
 mod config;
+mod content_hash;
+mod dir_watch;
 mod ea;
 mod event;
 mod manager;
 mod mcp;
+mod mcp_daemon;
 mod memory;
 mod metrics;
 mod panic_hook;
@@ -13,8 +17,13 @@ mod paths;
 mod process;
 mod projects;
 mod scheduler;
+mod screen_capture;
+mod state_lock;
+mod state_store;
+mod state_watch;
 mod tmux;
 mod ui;
+mod warm_pool;
 
 use std::io;
 use std::path::PathBuf;
@@ -25,8 +34,8 @@ use anyhow::Result;
 use clap::{Parser, Subcommand};
 use crossterm::{
     event::{
-        KeyCode, KeyModifiers, KeyboardEnhancementFlags, PopKeyboardEnhancementFlags,
-        PushKeyboardEnhancementFlags,
+        DisableFocusChange, EnableFocusChange, KeyCode, KeyModifiers, KeyboardEnhancementFlags,
+        PopKeyboardEnhancementFlags, PushKeyboardEnhancementFlags,
     },
     execute,
     terminal::{
@@ -39,7 +48,7 @@ use tokio::sync::Mutex;
 
 use app::App;
 use config::Config;
-use event::{AppEvent, EventHandler};
+use event::{AppEvent, Cadence, EventHandler};
 use tmux::{tmux_command, TmuxClient};
 
 #[cfg(test)]
@@ -133,6 +142,20 @@ enum Commands {
         #[arg(long)]
         context_file: Option<String>,
     },
+
+    /// Run the shared MCP daemon that `mcp-server` processes forward to.
+    /// Started on demand by the first of them; exits when idle.
+    #[command(hide = true)]
+    McpDaemon,
+
+    /// Run the load benchmarks against a private tmux server and print one
+    /// JSON result per line
+    #[command(hide = true)]
+    Bench {
+        /// Smaller scenarios, sized for CI
+        #[arg(long)]
+        quick: bool,
+    },
 }
 
 #[derive(Subcommand)]
@@ -220,7 +243,22 @@ async fn async_main() -> Result<()> {
         config.metrics.spawn_metrics_enabled = true;
         config.save_to_path(&Config::resolve_path(cli.config.as_deref()));
     }
-    metrics::configure(config.metrics.spawn_metrics_enabled);
+    // Load only consults cached probe results; commands that launch an
+    // agent right away can't do without a backend, so they probe here.
+    if matches!(
+        cli.command,
+        Some(Commands::Spawn { command: None, .. }) | Some(Commands::Manager { .. })
+    ) {
+        config.detect_default_command();
+    }
+    let role = match cli.command {
+        None => "dashboard",
+        Some(Commands::McpServer { .. }) => "mcp-server",
+        Some(Commands::McpDaemon) => "mcp-daemon",
+        Some(_) => "cli",
+    };
+    metrics::configure(&config.metrics, role);
+    tmux::configure_nodes(&config.nodes);
     let omar_dir = omar_dir();
     let defer_active_ea_save = cli.command.is_none() && cli.agent.is_some();
 
@@ -331,6 +369,8 @@ async fn async_main() -> Result<()> {
             Some(path) => mcp::run_server_from_context_file(PathBuf::from(path)),
             None => mcp::run_server_with_default_context(),
         },
+        Some(Commands::McpDaemon) => mcp_daemon::run_daemon(),
+        Some(Commands::Bench { quick }) => bench::run(quick),
         None => {
             if cli.agent.is_some() {
                 let (target, created) =
@@ -473,7 +513,7 @@ fn spawn_agent(
         anyhow::bail!("Session '{}' already exists", name);
     }
 
-    client.new_session(&full_name, command, workdir)?;
+    client.new_agent_session(&full_name, command, workdir)?;
     println!("Spawned agent: {}", name);
     Ok(())
 }
@@ -492,7 +532,7 @@ fn kill_agent(
     let _ = client.ensure_session_not_attached(&full_name)?;
 
     client.kill_session(&full_name)?;
-    let _ = scheduler.cancel_by_receiver_and_ea(name, ea_id);
+    scheduler.cancel_by_receiver_and_ea(name, ea_id)?;
     println!("Killed agent: {}", name);
     Ok(())
 }
@@ -532,7 +572,7 @@ fn schedule_cli_event(
         recurring_ns,
         ea_id,
     };
-    scheduler.insert(event.clone());
+    scheduler.insert(event.clone())?;
     println!(
         "Scheduled event: {} -> {} at {}",
         event.sender, event.receiver, event.timestamp
@@ -571,7 +611,7 @@ fn cancel_cli_event(
     ea_id: ea::EaId,
     event_id: &str,
 ) -> Result<()> {
-    match scheduler.cancel_if_ea(event_id, ea_id) {
+    match scheduler.cancel_if_ea(event_id, ea_id)? {
         Ok(event) => {
             println!("Cancelled event: {}", event.id);
             Ok(())
@@ -696,29 +736,73 @@ const TMUX_EXTRA_LINES: &[(&str, &str, &str)] = &[
 ];
 
 /// Check if any recommended tmux settings are missing.
+///
+/// Queries every option through one tmux client (`show-options` chained
+/// with `;`) rather than forking once per option. A failed query ends the
+/// chain and leaves its value and every later one empty, which reads as
+/// "needed" — the same answer the per-option check gave for that failure.
 fn tmux_setup_needed() -> bool {
-    for &(opt, cmd, _) in TMUX_RECOMMENDED
+    let recommended: Vec<&(&str, &str, &str)> = TMUX_RECOMMENDED
         .iter()
         .chain(TMUX_PLATFORM_RECOMMENDED.iter())
-    {
+        .collect();
+    let mut args = Vec::with_capacity(recommended.len() * 4);
+    for (i, &&(opt, _, _)) in recommended.iter().enumerate() {
+        if i > 0 {
+            args.push(";");
+        }
+        args.extend(["show-options", "-gv", opt]);
+    }
+    let Ok(out) = tmux_command().args(&args).output() else {
+        return false;
+    };
+    let stdout = String::from_utf8_lossy(&out.stdout);
+    let mut values = stdout.lines();
+    recommended.iter().any(|&&(_, cmd, _)| {
         // Extract expected value from the command string (last word)
         let expected = cmd.split_whitespace().last().unwrap_or("on");
-        if let Ok(out) = tmux_command().args(["show-options", "-gv", opt]).output() {
-            let val = String::from_utf8_lossy(&out.stdout);
-            if val.trim() != expected {
-                return true;
-            }
+        values.next().unwrap_or_default().trim() != expected
+    })
+}
+
+/// Run the tmux setup check off the render path and apply its warning
+/// when it finishes, so neither the first frame nor a tick waits on tmux
+/// while holding the `App` lock.
+fn spawn_tmux_setup_check(shared_app: Arc<Mutex<App>>) {
+    tokio::spawn(async move {
+        let Ok(needed) = tokio::task::spawn_blocking(tmux_setup_needed).await else {
+            return;
+        };
+        let mut app = shared_app.lock().await;
+        if needed {
+            app.set_persistent_warning_if_clear_or_same(TMUX_SETUP_WARNING);
+        } else {
+            app.clear_persistent_warning_if(TMUX_SETUP_WARNING);
         }
-    }
-    false
+    });
 }
 
-fn sync_tmux_setup_warning(app: &mut app::App) {
-    if tmux_setup_needed() {
-        app.set_persistent_warning_if_clear_or_same(TMUX_SETUP_WARNING);
-    } else {
-        app.clear_persistent_warning_if(TMUX_SETUP_WARNING);
+/// Probe for the default backend off the render path when cached results
+/// couldn't decide it at load. The dashboard draws without a manager until
+/// the probe lands; the refresh that follows starts it.
+fn spawn_backend_detection(shared_app: Arc<Mutex<App>>, config: &Config) {
+    if !config.agent.default_command.is_empty() {
+        return;
     }
+    tokio::spawn(async move {
+        shared_app
+            .lock()
+            .await
+            .set_status("Detecting agent backends…");
+        let Ok(command) = tokio::task::spawn_blocking(config::detect_agent_command).await else {
+            return;
+        };
+        let mut app = shared_app.lock().await;
+        app.set_detected_default_command(command);
+        if let Err(e) = app.refresh() {
+            app.set_status(format!("Error: {}", e));
+        }
+    });
 }
 
 /// Interactive tmux configuration setup.
@@ -944,9 +1028,7 @@ async fn run_dashboard(config: Config) -> Result<()> {
     // Create the ticker buffer and scheduler, then spawn the event loop
     let ticker = scheduler::TickerBuffer::new();
     let omar_dir = omar_dir();
-    let scheduler = Arc::new(scheduler::Scheduler::with_store(
-        scheduler::events_store_path(&omar_dir),
-    ));
+    let scheduler = scheduler::Scheduler::own_store(scheduler::events_store_path(&omar_dir));
     let popup_receiver = scheduler::new_popup_receiver();
     let base_prefix = config.dashboard.session_prefix.clone();
     tokio::spawn(scheduler::run_event_loop(
@@ -954,6 +1036,7 @@ async fn run_dashboard(config: Config) -> Result<()> {
         ticker.clone(),
         popup_receiver.clone(),
         base_prefix,
+        config.scheduler.delivery_concurrency,
     ));
 
     // Create SINGLE shared App instance for the dashboard/runtime state.
@@ -963,6 +1046,13 @@ async fn run_dashboard(config: Config) -> Result<()> {
         scheduler.clone(),
     )));
 
+    // Scrape endpoint for every live omar process's metrics, if configured.
+    let metrics_error = config
+        .metrics
+        .prometheus_listen
+        .as_deref()
+        .and_then(|listen| metrics::serve_prometheus(listen).err());
+
     // Spawn Slack bridge if configured
     let mut slack_bridge = spawn_slack_bridge();
 
@@ -973,6 +1063,9 @@ async fn run_dashboard(config: Config) -> Result<()> {
     enable_raw_mode()?;
     let mut stdout = io::stdout();
     execute!(stdout, EnterAlternateScreen)?;
+    // Focus reports let an unfocused dashboard drop to its quiet cadence;
+    // terminals without them just stay "focused".
+    let _ = execute!(stdout, EnableFocusChange);
     // Enable keyboard enhancement where supported (improves key reporting).
     let keyboard_enhanced = supports_keyboard_enhancement().unwrap_or(false);
     if keyboard_enhanced {
@@ -993,13 +1086,14 @@ async fn run_dashboard(config: Config) -> Result<()> {
             (false, true) => app.set_status("Computer bridge started"),
             _ => {}
         }
+        if let Some(err) = &metrics_error {
+            app.set_status(format!("Metrics endpoint disabled: {:#}", err));
+        }
     }
 
     // Warn if tmux config is missing recommended settings
-    {
-        let mut app = shared_app.lock().await;
-        sync_tmux_setup_warning(&mut app);
-    }
+    spawn_tmux_setup_check(Arc::clone(&shared_app));
+    spawn_backend_detection(Arc::clone(&shared_app), &config);
 
     // Initial refresh
     {
@@ -1013,14 +1107,31 @@ async fn run_dashboard(config: Config) -> Result<()> {
     // The lock is NOT held across events.next().await so API calls proceed.
     let tick_rate = Duration::from_secs(config.dashboard.refresh_interval);
     let mut events = EventHandler::new(tick_rate);
+    // Refresh as soon as an MCP server or the CLI rewrites shared state,
+    // rather than waiting for the next tick.
+    {
+        let omar_dir = shared_app.lock().await.omar_dir.clone();
+        events.forward_state_changes(state_watch::subscribe(move || {
+            app::watched_state_files(&omar_dir)
+        }));
+    }
+    // ...and as soon as tmux pushes pane activity, so a slow idle cadence
+    // never delays noticing an agent that started or stopped working.
+    events.forward_state_changes(tmux::subscribe_activity());
     let mut tick_count: u64 = 0;
+    let mut focused = true;
+    let mut last_input = std::time::Instant::now();
+    // Ticks and scroll ticks redraw only when they changed something (or
+    // countdowns are showing); every other event redraws.
+    let mut redraw = true;
 
     loop {
         // Phase 1: Render (brief lock — read-only access to App)
-        {
+        if redraw {
             let app = shared_app.lock().await;
             terminal.draw(|f| ui::render(f, &app))?;
         }
+        redraw = true;
         // Lock released — API calls can proceed during event wait
 
         // Phase 2: Wait for event (no lock held)
@@ -1030,6 +1141,7 @@ async fn run_dashboard(config: Config) -> Result<()> {
         if let Some(event) = event {
             match event {
                 AppEvent::Key(key) => {
+                    last_input = std::time::Instant::now();
                     let mut app = shared_app.lock().await;
 
                     // Handle project input mode
@@ -1096,7 +1208,11 @@ async fn run_dashboard(config: Config) -> Result<()> {
                                     if let Err(e) = app.kill_selected() {
                                         app.set_status(format!("Error: {}", e));
                                     } else if let Some(name) = short_name {
-                                        scheduler.cancel_by_receiver_and_ea(&name, app.active_ea);
+                                        if let Err(e) = scheduler
+                                            .cancel_by_receiver_and_ea(&name, app.active_ea)
+                                        {
+                                            app.set_status(format!("Error: {}", e));
+                                        }
                                     }
                                 }
                                 app::ConfirmAction::ResetQuit => {
@@ -1350,6 +1466,9 @@ async fn run_dashboard(config: Config) -> Result<()> {
 
                             // Release App lock before blocking popup call
                             drop(app);
+                            // Stop ticking and reading input while the popup
+                            // or attached session owns the terminal.
+                            events.set_cadence(Cadence::Paused);
 
                             if std::env::var("TMUX").is_ok() {
                                 // Inside tmux: use display-popup overlay.
@@ -1474,11 +1593,12 @@ async fn run_dashboard(config: Config) -> Result<()> {
                 }
                 AppEvent::Tick => {
                     let mut app = shared_app.lock().await;
+                    let status_before = app.status_message.clone();
                     // Rotate quotes every ~30 ticks
                     tick_count += 1;
                     if tick_count.is_multiple_of(30) {
                         app.quote_index = app.quote_index.wrapping_add(1);
-                        sync_tmux_setup_warning(&mut app);
+                        spawn_tmux_setup_check(Arc::clone(&shared_app));
                     }
 
                     // Fix V2: EA-scoped events instead of global list
@@ -1496,23 +1616,51 @@ async fn run_dashboard(config: Config) -> Result<()> {
 
                     // Keep system_state.md reasonably fresh without capturing
                     // the manager pane and rewriting JSON on every dashboard
-                    // tick. State-changing actions still write immediately.
+                    // tick. State-changing actions queue their own writes;
+                    // the writer coalesces them with this one.
                     if tick_count.is_multiple_of(3) && !app.has_popup() {
                         let state_dir = app.state_dir();
                         let manager_session = app.manager_session_name();
-                        memory::write_memory_to(
+                        app.queue_memory_write(
                             &state_dir,
-                            &app.agents,
-                            app.manager.as_ref(),
-                            &manager_session,
-                            app.client(),
-                            &app.scheduled_events,
+                            app.manager.clone(),
+                            manager_session,
+                            app.scheduled_events.clone(),
                         );
                     }
+
+                    // Refill warm pools as spawns claim sessions. Best effort:
+                    // a spawn that finds its pool empty just starts cold.
+                    if tick_count.is_multiple_of(5) {
+                        let _ = app.maintain_warm_pool();
+                    }
+
+                    redraw = app.take_redraw()
+                        || app.status_message != status_before
+                        || !app.scheduled_events.is_empty()
+                        || tick_count.is_multiple_of(30);
+                }
+                AppEvent::StateChanged => {
+                    let mut app = shared_app.lock().await;
+                    let status_before = app.status_message.clone();
+                    if !app.has_popup() {
+                        if let Err(e) = app.refresh() {
+                            app.set_status(format!("Error: {}", e));
+                        }
+                    }
+                    redraw = app.take_redraw() || app.status_message != status_before;
                 }
                 AppEvent::TickerScroll => {
                     let mut app = shared_app.lock().await;
                     app.ticker_offset = app.ticker_offset.wrapping_add(1);
+                    // Redraw only when something moves: a scrolling quote or
+                    // ticker, or new output in the focus pane. Terminal::draw
+                    // then writes just the cells that changed.
+                    redraw = app.ticker_scrolling.get() || app.focus_preview_stale();
+                }
+                AppEvent::Focus(gained) => {
+                    focused = gained;
+                    redraw = false;
                 }
                 AppEvent::Resize(_, _) => {
                     // Terminal will handle resize automatically
@@ -1520,9 +1668,15 @@ async fn run_dashboard(config: Config) -> Result<()> {
             }
         }
 
-        // Check quit flag
+        // Check quit flag, and pick how often to wake without an event
         let should_quit = {
             let app = shared_app.lock().await;
+            events.set_cadence(Cadence::choose(
+                app.health_counts().0 > 0 || !app.scheduled_events.is_empty(),
+                app.has_popup() || last_input.elapsed() < event::INTERACTION_WINDOW,
+                focused,
+                app.ticker_scrolling.get(),
+            ));
             app.should_quit
         };
         if should_quit {
@@ -1534,9 +1688,15 @@ async fn run_dashboard(config: Config) -> Result<()> {
     if keyboard_enhanced {
         let _ = execute!(terminal.backend_mut(), PopKeyboardEnhancementFlags);
     }
+    let _ = execute!(terminal.backend_mut(), DisableFocusChange);
     disable_raw_mode()?;
     execute!(terminal.backend_mut(), LeaveAlternateScreen)?;
 
+    // Land queued memory.md writes while the manager pane can still be
+    // captured.
+    memory::flush_memory_writes();
+    metrics::flush();
+
     // Kill ALL OMAR EA sessions on quit (managers + workers), even if
     // registry and tmux are temporarily out of sync.
     {
@@ -1585,7 +1745,9 @@ fn purge_persisted_runtime_state_on_quit(omar_dir: &std::path::Path) -> Result<(
         "eas.json",
         "eas.json.tmp",
         "scheduled_events.json",
+        "scheduled_events.journal",
         "scheduled_events.lock",
+        "scheduled_events.sock",
         "scheduled_events.tmp",
     ] {
         remove_file_if_exists(omar_dir.join(file))?;
@@ -1,41 +1,13 @@
-//! User-private temp files for payloads handed off to tmux / backend CLIs.
-//! Files live in a per-user dir (0700) and are created 0600 with `create_new`,
-//! so other accounts on a shared host can't read the payloads.
+//! User-private temp paths for payloads handed off to tmux / backend CLIs.
+//! Everything lives in a per-user dir (0700), so other accounts on a shared
+//! host can't read the payloads. Named pipes for streaming pane output are
+//! created 0600 inside it.
 
-use std::fs::{File, OpenOptions};
-use std::io::{self, Write};
+use std::io;
 use std::path::{Path, PathBuf};
 
 use uuid::Uuid;
 
-/// A 0600 temp file that deletes itself on drop (even on panic / early return).
-pub struct PrivateTempFile {
-    path: PathBuf,
-    file: File,
-}
-
-impl PrivateTempFile {
-    pub fn path(&self) -> &Path {
-        &self.path
-    }
-}
-
-impl Write for PrivateTempFile {
-    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
-        self.file.write(buf)
-    }
-
-    fn flush(&mut self) -> io::Result<()> {
-        self.file.flush()
-    }
-}
-
-impl Drop for PrivateTempFile {
-    fn drop(&mut self) {
-        let _ = std::fs::remove_file(&self.path);
-    }
-}
-
 /// Per-user dir (mode 0700): `$XDG_RUNTIME_DIR` if set, else `temp_dir()`,
 /// with an `omar-<user>` subdir so the `/tmp` fallback isn't shared.
 pub fn private_temp_dir() -> io::Result<PathBuf> {
@@ -64,26 +36,50 @@ fn sanitize_user(raw: &str) -> String {
     }
 }
 
-/// Self-deleting 0600 temp file under [`private_temp_dir`], named
-/// `<prefix>-<uuid>.<ext>`.
-pub fn create_private_temp_file(prefix: &str, ext: &str) -> io::Result<PrivateTempFile> {
-    let dir = private_temp_dir()?;
-    let path = dir.join(format!("{prefix}-{}.{ext}", Uuid::new_v4()));
-    let file = create_private_file(&path)?;
-    Ok(PrivateTempFile { path, file })
+/// A 0600 named pipe that is unlinked on drop.
+#[cfg(unix)]
+pub struct PrivateFifo {
+    path: PathBuf,
 }
 
-/// New 0600 file at `path` (no self-delete), for files that outlive the scope.
-/// `create_new` fails rather than truncate or follow a planted symlink.
-pub fn create_private_file(path: &Path) -> io::Result<File> {
-    let mut opts = OpenOptions::new();
-    opts.write(true).create_new(true);
-    #[cfg(unix)]
-    {
-        use std::os::unix::fs::OpenOptionsExt;
-        opts.mode(0o600);
+#[cfg(unix)]
+impl PrivateFifo {
+    pub fn path(&self) -> &Path {
+        &self.path
     }
-    opts.open(path)
+}
+
+#[cfg(unix)]
+impl Drop for PrivateFifo {
+    fn drop(&mut self) {
+        let _ = std::fs::remove_file(&self.path);
+    }
+}
+
+/// Self-deleting 0600 named pipe under [`private_temp_dir`], named
+/// `<prefix>-<uuid>.fifo`. `mkfifo` is called directly rather than by
+/// forking `mkfifo(1)`; like `create_new`, it fails on an existing path.
+#[cfg(unix)]
+pub fn create_private_fifo(prefix: &str) -> io::Result<PrivateFifo> {
+    use std::os::raw::{c_char, c_int};
+    use std::os::unix::ffi::OsStrExt;
+
+    #[cfg(any(target_os = "macos", target_os = "ios", target_os = "freebsd"))]
+    type Mode = u16;
+    #[cfg(not(any(target_os = "macos", target_os = "ios", target_os = "freebsd")))]
+    type Mode = u32;
+    extern "C" {
+        fn mkfifo(path: *const c_char, mode: Mode) -> c_int;
+    }
+
+    let path = private_temp_dir()?.join(format!("{prefix}-{}.fifo", Uuid::new_v4()));
+    let c_path = std::ffi::CString::new(path.as_os_str().as_bytes())
+        .map_err(|err| io::Error::new(io::ErrorKind::InvalidInput, err))?;
+    // SAFETY: `c_path` is a valid NUL-terminated string for the call.
+    if unsafe { mkfifo(c_path.as_ptr(), 0o600) } != 0 {
+        return Err(io::Error::last_os_error());
+    }
+    Ok(PrivateFifo { path })
 }
 
 /// Ensure `dir` exists at mode 0700. An existing dir is tightened back to 0700,
@@ -131,34 +127,16 @@ mod tests {
     }
 
     #[test]
-    fn create_private_temp_file_is_mode_0600() {
-        let mut tmp = create_private_temp_file("omar-test", "txt").expect("temp file");
-        tmp.write_all(b"secret payload").expect("write");
-        assert!(tmp.path().exists());
-        #[cfg(unix)]
-        {
-            use std::os::unix::fs::PermissionsExt;
-            let mode = std::fs::metadata(tmp.path()).unwrap().permissions().mode() & 0o777;
-            assert_eq!(mode, 0o600, "private temp file must be owner-only");
-        }
-    }
-
-    #[test]
-    fn create_private_temp_file_deletes_on_drop() {
-        let path = {
-            let tmp = create_private_temp_file("omar-test-drop", "txt").expect("temp file");
-            tmp.path().to_path_buf()
-        };
-        assert!(!path.exists(), "file must be removed when guard is dropped");
-    }
-
-    #[test]
-    fn create_private_file_refuses_existing_path() {
-        let mut tmp = create_private_temp_file("omar-test-excl", "txt").expect("temp file");
-        tmp.write_all(b"original").expect("write");
-        // create_new must fail rather than truncate an existing file.
-        let err = create_private_file(tmp.path()).expect_err("must not clobber existing file");
-        assert_eq!(err.kind(), io::ErrorKind::AlreadyExists);
+    #[cfg(unix)]
+    fn create_private_fifo_is_a_0600_pipe_removed_on_drop() {
+        use std::os::unix::fs::{FileTypeExt, PermissionsExt};
+        let fifo = create_private_fifo("omar-test-fifo").expect("fifo");
+        let meta = std::fs::metadata(fifo.path()).unwrap();
+        assert!(meta.file_type().is_fifo());
+        assert_eq!(meta.permissions().mode() & 0o777, 0o600);
+        let path = fifo.path().to_path_buf();
+        drop(fifo);
+        assert!(!path.exists());
     }
 
     #[test]
@@ -2,22 +2,25 @@ use std::fs;
 use std::path::Path;
 
 /// Return true if a process with the given PID currently exists. Uses
-/// `kill -0 <pid>`, the standard POSIX no-op signal check. On non-Unix
-/// platforms, conservatively assume the process is still alive rather than
-/// reclaiming a lock we shouldn't.
+/// `kill(pid, 0)`, the standard POSIX no-op signal check, called directly
+/// rather than by forking `kill -0`; `EPERM` means the process exists but
+/// belongs to someone else. On non-Unix platforms, conservatively assume
+/// the process is still alive rather than reclaiming a lock we shouldn't.
 pub(crate) fn pid_alive(pid: u32) -> bool {
     #[cfg(unix)]
     {
-        if pid > i32::MAX as u32 {
+        extern "C" {
+            fn kill(pid: i32, sig: std::os::raw::c_int) -> std::os::raw::c_int;
+        }
+        // 0 and negative pids address process groups, not one process.
+        if pid == 0 || pid > i32::MAX as u32 {
             return false;
         }
-        std::process::Command::new("kill")
-            .args(["-0", &pid.to_string()])
-            .stdout(std::process::Stdio::null())
-            .stderr(std::process::Stdio::null())
-            .status()
-            .map(|s| s.success())
-            .unwrap_or(true)
+        // SAFETY: signal 0 performs only the existence/permission check.
+        if unsafe { kill(pid as i32, 0) } == 0 {
+            return true;
+        }
+        std::io::Error::last_os_error().kind() == std::io::ErrorKind::PermissionDenied
     }
     #[cfg(not(unix))]
     {
@@ -52,6 +55,20 @@ mod tests {
         assert!(pid_file_is_stale(file.path()));
     }
 
+    #[cfg(unix)]
+    #[test]
+    fn pid_alive_checks_without_forking() {
+        assert!(super::pid_alive(std::process::id()));
+        // pid 1 exists but usually isn't ours to signal (EPERM).
+        assert!(super::pid_alive(1));
+
+        let mut child = std::process::Command::new("true").spawn().unwrap();
+        let pid = child.id();
+        child.wait().unwrap();
+        assert!(!super::pid_alive(pid), "reaped child is gone");
+        assert!(!super::pid_alive(0));
+    }
+
     #[test]
     fn pid_file_with_pid_zero_is_treated_as_stale() {
         let mut file = NamedTempFile::new().expect("temp lock file");
@@ -11,7 +11,11 @@ use std::path::{Path, PathBuf};
 use std::sync::Mutex;
 use uuid::Uuid;
 
-/// Mutex to serialize concurrent read-modify-write on tasks.md.
+use crate::state_lock::{self, StateLock};
+use crate::state_watch;
+
+/// Mutex to serialize concurrent read-modify-write on tasks.md within this
+/// process; the `TASKS_MD` state lock does the same across processes.
 /// Same pattern as WORKER_TASKS_LOCK in memory.rs.
 static PROJECTS_LOCK: Mutex<()> = Mutex::new(());
 
@@ -30,11 +34,10 @@ pub fn projects_path_in(state_dir: &Path) -> PathBuf {
 /// Load projects from an EA's state directory
 pub fn load_projects_from(state_dir: &Path) -> Vec<Project> {
     let path = projects_path_in(state_dir);
-    let content = match fs::read_to_string(&path) {
-        Ok(c) => c,
-        Err(_) => return Vec::new(),
-    };
-    parse_projects(&content)
+    state_watch::cached(&path, || match fs::read_to_string(&path) {
+        Ok(content) => parse_projects(&content),
+        Err(_) => Vec::new(),
+    })
 }
 
 /// Parse project lines from content
@@ -95,6 +98,7 @@ pub fn save_projects_to(state_dir: &Path, projects: &[Project]) -> Result<()> {
 /// Add a project to an EA, returns new id
 pub fn add_project_in(state_dir: &Path, name: &str) -> Result<usize> {
     let _guard = PROJECTS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
+    let _file_lock = StateLock::acquire(state_dir, state_lock::TASKS_MD)?;
     let mut projects = load_projects_from(state_dir);
     let id = projects.iter().map(|p| p.id).max().unwrap_or(0) + 1;
     projects.push(Project {
@@ -115,6 +119,7 @@ pub fn find_project_in(state_dir: &Path, id: usize) -> Option<Project> {
 /// Remove a project by id from an EA, returns whether it was found
 pub fn remove_project_in(state_dir: &Path, id: usize) -> Result<bool> {
     let _guard = PROJECTS_LOCK.lock().unwrap_or_else(|e| e.into_inner());
+    let _file_lock = StateLock::acquire(state_dir, state_lock::TASKS_MD)?;
     let mut projects = load_projects_from(state_dir);
     if let Some(pos) = projects.iter().position(|p| p.id == id) {
         projects.remove(pos);
@@ -0,0 +1,122 @@
+//! Request/response IPC to the process that owns the scheduler store.
+//!
+//! The owner (the dashboard, which also runs the event loop) listens on
+//! `scheduled_events.sock` next to the store. Other processes — the CLI and
+//! per-agent MCP servers — send one JSON request line per connection and
+//! read one JSON response line back. A missing or refusing socket means no
+//! owner is running, and callers fall back to the locked file store.
+
+use anyhow::{Context, Result};
+use serde::{Deserialize, Serialize};
+use std::io::{BufRead, BufReader, Write};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::path::{Path, PathBuf};
+use std::sync::Weak;
+use std::time::Duration;
+
+use super::{ScheduledEvent, Scheduler};
+
+const IPC_TIMEOUT: Duration = Duration::from_secs(5);
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(tag = "op", rename_all = "snake_case")]
+pub(crate) enum Request {
+    Insert { event: ScheduledEvent },
+    InsertMany { events: Vec<ScheduledEvent> },
+    CancelIfEa { event_id: String, ea_id: u32 },
+    ListByEa { ea_id: u32 },
+    CancelByEa { ea_id: u32 },
+    CancelByReceiverAndEa { receiver: String, ea_id: u32 },
+}
+
+impl Request {
+    pub fn is_write(&self) -> bool {
+        !matches!(self, Request::ListByEa { .. })
+    }
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(tag = "result", rename_all = "snake_case")]
+pub(crate) enum Response {
+    Done,
+    Cancelled {
+        event: Option<ScheduledEvent>,
+        wrong_ea: bool,
+    },
+    Events {
+        events: Vec<ScheduledEvent>,
+    },
+    Count {
+        count: usize,
+    },
+}
+
+pub(crate) fn socket_path(store_path: &Path) -> PathBuf {
+    store_path.with_extension("sock")
+}
+
+/// True when an owner is accepting connections on `socket`.
+pub(crate) fn owner_reachable(socket: &Path) -> bool {
+    UnixStream::connect(socket).is_ok()
+}
+
+/// Send `request` to the owner. `Ok(None)` when no owner is listening; the
+/// caller then applies the request to the file store itself. An owner that
+/// accepted the connection but did not answer is an error, not a fallback:
+/// it still holds the store, so a local write would never be persisted.
+pub(crate) fn call(socket: &Path, request: &Request) -> Result<Option<Response>> {
+    let Ok(mut stream) = UnixStream::connect(socket) else {
+        return Ok(None);
+    };
+    stream.set_read_timeout(Some(IPC_TIMEOUT))?;
+    stream.set_write_timeout(Some(IPC_TIMEOUT))?;
+    let mut line = serde_json::to_string(request)?;
+    line.push('\n');
+    stream
+        .write_all(line.as_bytes())
+        .context("scheduler owner did not accept the request")?;
+    let mut reply = String::new();
+    BufReader::new(stream)
+        .read_line(&mut reply)
+        .context("scheduler owner did not answer")?;
+    let response = serde_json::from_str(&reply)
+        .with_context(|| format!("bad reply from scheduler owner: {:?}", reply.trim_end()))?;
+    Ok(Some(response))
+}
+
+/// Serve requests against `scheduler` until it is dropped. Each connection
+/// is handled on its own thread, so a client that connects and then stalls
+/// holds up only itself for [`IPC_TIMEOUT`]; the requests themselves are
+/// still applied one at a time under the queue lock.
+pub(crate) fn serve(listener: UnixListener, scheduler: Weak<Scheduler>) {
+    std::thread::spawn(move || {
+        for stream in listener.incoming() {
+            let Some(scheduler) = scheduler.upgrade() else {
+                break;
+            };
+            if let Ok(stream) = stream {
+                std::thread::spawn(move || handle(&scheduler, stream));
+            }
+        }
+    });
+}
+
+fn handle(scheduler: &Scheduler, stream: UnixStream) {
+    let _ = stream.set_read_timeout(Some(IPC_TIMEOUT));
+    let _ = stream.set_write_timeout(Some(IPC_TIMEOUT));
+    let mut reader = BufReader::new(&stream);
+    let mut line = String::new();
+    if reader.read_line(&mut line).is_err() {
+        return;
+    }
+    let Ok(request) = serde_json::from_str::<Request>(&line) else {
+        return;
+    };
+    let Ok(response) = scheduler.execute(request) else {
+        return;
+    };
+    if let Ok(mut reply) = serde_json::to_string(&response) {
+        reply.push('\n');
+        let _ = (&stream).write_all(reply.as_bytes());
+    }
+}
@@ -0,0 +1,207 @@
+//! Append-only journal for the scheduler store.
+//!
+//! The owning process keeps the queue in memory and persists each mutation
+//! as one JSON line in `scheduled_events.journal` instead of rewriting the
+//! whole `scheduled_events.json` snapshot. Loading replays the journal on
+//! top of the snapshot; compaction folds it back into the snapshot.
+//!
+//! Every record is idempotent against a snapshot that already contains it
+//! (inserts replace by id, cancels/fires remove by id, re-arms set an
+//! absolute timestamp), so a crash between
+//! writing a compacted snapshot and truncating the journal loses nothing.
+
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::fs::{self, File, OpenOptions};
+use std::io::Write;
+use std::path::{Path, PathBuf};
+
+use super::ScheduledEvent;
+
+/// Journal records since the last compaction before the owner rewrites the
+/// snapshot.
+pub(crate) const COMPACT_EVERY: usize = 1024;
+
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq, Eq)]
+#[serde(tag = "op", rename_all = "snake_case")]
+pub(crate) enum JournalRecord {
+    /// Event added, or an existing id deferred to a new timestamp.
+    Insert {
+        event: ScheduledEvent,
+    },
+    Cancel {
+        id: String,
+    },
+    /// One-shot event delivered and removed.
+    Fire {
+        id: String,
+    },
+    /// Recurring event fired and re-armed in place for `timestamp`.
+    Rearm {
+        id: String,
+        timestamp: u64,
+    },
+}
+
+pub(crate) fn journal_path(store_path: &Path) -> PathBuf {
+    store_path.with_extension("journal")
+}
+
+/// Apply `journal`'s records to the `snapshot` events. Unparseable lines
+/// (e.g. a record torn by a crash mid-append) are skipped.
+pub(crate) fn replay(snapshot: Vec<ScheduledEvent>, journal: &str) -> Vec<ScheduledEvent> {
+    if journal.is_empty() {
+        return snapshot;
+    }
+    let mut events: HashMap<String, ScheduledEvent> = snapshot
+        .into_iter()
+        .map(|event| (event.id.clone(), event))
+        .collect();
+    for line in journal.lines() {
+        match serde_json::from_str::<JournalRecord>(line) {
+            Ok(JournalRecord::Insert { event }) => {
+                events.insert(event.id.clone(), event);
+            }
+            Ok(JournalRecord::Cancel { id } | JournalRecord::Fire { id }) => {
+                events.remove(&id);
+            }
+            Ok(JournalRecord::Rearm { id, timestamp }) => {
+                if let Some(event) = events.get_mut(&id) {
+                    event.timestamp = timestamp;
+                }
+            }
+            Err(_) => {}
+        }
+    }
+    events.into_values().collect()
+}
+
+/// Empty the journal after its records were folded into a fresh snapshot.
+/// Truncates rather than unlinking so an owner's open append handle keeps
+/// pointing at the live file.
+pub(crate) fn truncate(store_path: &Path) {
+    if let Ok(file) = OpenOptions::new()
+        .write(true)
+        .open(journal_path(store_path))
+    {
+        let _ = file.set_len(0);
+    }
+}
+
+/// The owner's open journal.
+pub(crate) struct Journal {
+    file: File,
+    since_compaction: usize,
+}
+
+impl Journal {
+    pub fn open(store_path: &Path) -> std::io::Result<Self> {
+        let file = OpenOptions::new()
+            .create(true)
+            .append(true)
+            .open(journal_path(store_path))?;
+        Ok(Self {
+            file,
+            since_compaction: 0,
+        })
+    }
+
+    /// Append `records` in one write. Returns true once enough records have
+    /// accumulated that the caller should compact.
+    pub fn append(&mut self, records: &[JournalRecord]) -> bool {
+        let mut lines = String::new();
+        for record in records {
+            if let Ok(line) = serde_json::to_string(record) {
+                lines.push_str(&line);
+                lines.push('\n');
+            }
+        }
+        if let Err(err) = self.file.write_all(lines.as_bytes()) {
+            eprintln!(
+                "scheduler: WARNING: failed to append to event journal ({}); \
+                 change kept in memory until the next compaction",
+                err
+            );
+            // Force a snapshot so the change still reaches disk.
+            return true;
+        }
+        self.since_compaction += records.len();
+        self.since_compaction >= COMPACT_EVERY
+    }
+
+    pub fn compacted(&mut self) {
+        self.since_compaction = 0;
+    }
+}
+
+/// Read the journal next to `store_path`, if any.
+pub(crate) fn read(store_path: &Path) -> String {
+    fs::read_to_string(journal_path(store_path)).unwrap_or_default()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn event(id: &str, timestamp: u64) -> ScheduledEvent {
+        ScheduledEvent {
+            id: id.to_string(),
+            sender: "s".to_string(),
+            receiver: "r".to_string(),
+            timestamp,
+            payload: String::new(),
+            created_at: 0,
+            recurring_ns: None,
+            ea_id: 0,
+        }
+    }
+
+    fn line(record: JournalRecord) -> String {
+        serde_json::to_string(&record).unwrap() + "\n"
+    }
+
+    #[test]
+    fn replay_applies_records_and_skips_torn_tail() {
+        let journal = [
+            line(JournalRecord::Insert {
+                event: event("b", 20),
+            }),
+            line(JournalRecord::Insert {
+                event: event("a", 99),
+            }),
+            line(JournalRecord::Fire { id: "c".into() }),
+            line(JournalRecord::Cancel { id: "b".into() }),
+            "{\"op\":\"insert\",\"event\":{\"id\":".to_string(),
+        ]
+        .concat();
+
+        let mut events = replay(vec![event("a", 10), event("c", 30)], &journal);
+        events.sort_by_key(|e| e.timestamp);
+        assert_eq!(events.len(), 1);
+        assert_eq!(events[0].id, "a");
+        assert_eq!(events[0].timestamp, 99, "insert of a known id replaces it");
+    }
+
+    #[test]
+    fn replay_is_idempotent_over_compacted_snapshot() {
+        let journal = [
+            line(JournalRecord::Fire { id: "old".into() }),
+            line(JournalRecord::Insert {
+                event: event("next", 50),
+            }),
+            line(JournalRecord::Rearm {
+                id: "cron".into(),
+                timestamp: 70,
+            }),
+        ]
+        .concat();
+        let by_id = |mut events: Vec<ScheduledEvent>| {
+            events.sort_by(|a, b| a.id.cmp(&b.id));
+            events
+        };
+        let once = by_id(replay(vec![event("old", 10), event("cron", 40)], &journal));
+        assert!(once.iter().any(|e| e.id == "cron" && e.timestamp == 70));
+        let twice = by_id(replay(once.clone(), &journal));
+        assert_eq!(once, twice);
+    }
+}
@@ -1,8 +1,16 @@
 pub mod event;
+mod ipc;
+mod journal;
+pub mod pipeline;
+mod queue;
+mod wheel;
 
 pub use event::ScheduledEvent;
+pub use pipeline::DeliveryStats;
+pub use wheel::CronStats;
 
-use std::collections::{BinaryHeap, HashMap, VecDeque};
+use std::borrow::Cow;
+use std::collections::{HashMap, VecDeque};
 use std::fs;
 use std::path::{Path, PathBuf};
 use std::sync::{Arc, Mutex};
@@ -10,8 +18,13 @@ use std::time::{Instant, SystemTime, UNIX_EPOCH};
 use tokio::sync::Notify;
 
 use crate::ea;
+use crate::metrics;
 use crate::process::pid_file_is_stale;
 use crate::tmux::DeliveryOptions;
+use ipc::{Request, Response};
+use journal::{Journal, JournalRecord};
+use pipeline::{DeliveryJob, DeliveryPipeline};
+use queue::EventQueue;
 
 /// A ticker message with its creation time.
 struct TickerEntry {
@@ -92,9 +105,32 @@ pub fn combine_seconds_and_ns(seconds: Option<u64>, extra_ns: Option<u64>) -> Op
 }
 
 pub struct Scheduler {
-    queue: Mutex<BinaryHeap<ScheduledEvent>>,
+    queue: Mutex<EventQueue>,
     notify: Notify,
-    store_path: Option<PathBuf>,
+    store: Store,
+    delivery_stats: Arc<DeliveryStats>,
+    cron_stats: Mutex<CronStats>,
+}
+
+/// Where the authoritative queue lives.
+enum Store {
+    /// In-process only (tests).
+    Memory,
+    /// `scheduled_events.json` shared through the store lock: every
+    /// operation reloads and (for writes) rewrites the file. Operations are
+    /// forwarded over IPC instead whenever an owner is running.
+    Shared(PathBuf),
+    /// This process owns the store: the in-memory queue is authoritative and
+    /// mutations are appended to the journal.
+    Owner(OwnedStore),
+}
+
+struct OwnedStore {
+    store_path: PathBuf,
+    journal: Mutex<Journal>,
+    /// Held for the owner's lifetime so no process rewrites the snapshot
+    /// behind the journal.
+    _lock: StoreLock,
 }
 
 struct StoreLock {
@@ -154,220 +190,396 @@ fn store_lock_path(store_path: &Path) -> PathBuf {
 }
 
 fn load_events_from_store(store_path: &Path) -> Vec<ScheduledEvent> {
-    fs::read_to_string(store_path)
+    let snapshot = fs::read_to_string(store_path)
         .ok()
         .and_then(|content| serde_json::from_str(&content).ok())
-        .unwrap_or_default()
+        .unwrap_or_default();
+    journal::replay(snapshot, &journal::read(store_path))
 }
 
-fn save_events_to_store(store_path: &Path, queue: &BinaryHeap<ScheduledEvent>) {
-    let mut events: Vec<ScheduledEvent> = queue.iter().cloned().collect();
-    events.sort_by_key(|event| (event.timestamp, event.created_at));
+/// Write `queue` as the snapshot and empty the journal it supersedes.
+fn save_events_to_store(store_path: &Path, queue: &EventQueue) {
+    let events: Vec<&ScheduledEvent> = queue.iter().collect();
     if let Some(parent) = store_path.parent() {
         let _ = fs::create_dir_all(parent);
     }
     let tmp = store_path.with_extension("tmp");
     if let Ok(content) = serde_json::to_string_pretty(&events) {
         if fs::write(&tmp, content).is_ok() {
-            let _ = fs::rename(&tmp, store_path);
+            if fs::rename(&tmp, store_path).is_ok() {
+                journal::truncate(store_path);
+            }
         } else {
             let _ = fs::remove_file(&tmp);
         }
     }
 }
 
+/// Apply one scheduler operation to `queue`, recording its effect in
+/// `journal`. Shared by every storage mode and by the IPC server.
+fn apply(queue: &mut EventQueue, journal: &mut Vec<JournalRecord>, request: Request) -> Response {
+    match request {
+        Request::Insert { event } => {
+            journal.push(JournalRecord::Insert {
+                event: event.clone(),
+            });
+            queue.push(event);
+            Response::Done
+        }
+        Request::InsertMany { events } => {
+            for event in events {
+                journal.push(JournalRecord::Insert {
+                    event: event.clone(),
+                });
+                queue.push(event);
+            }
+            Response::Done
+        }
+        Request::CancelIfEa { event_id, ea_id } => {
+            let (event, wrong_ea) = match queue.get(&event_id) {
+                Some(event) if event.ea_id == ea_id => (queue.remove(&event_id), false),
+                Some(_) => (None, true),
+                None => (None, false),
+            };
+            if event.is_some() {
+                journal.push(JournalRecord::Cancel { id: event_id });
+            }
+            Response::Cancelled { event, wrong_ea }
+        }
+        Request::ListByEa { ea_id } => Response::Events {
+            events: queue.list_by_ea(ea_id),
+        },
+        Request::CancelByEa { ea_id } => Response::Count {
+            count: journal_cancels(journal, queue.remove_by_ea(ea_id)),
+        },
+        Request::CancelByReceiverAndEa { receiver, ea_id } => Response::Count {
+            count: journal_cancels(journal, queue.remove_by_receiver(&receiver, ea_id)),
+        },
+    }
+}
+
+fn journal_cancels(journal: &mut Vec<JournalRecord>, cancelled: Vec<ScheduledEvent>) -> usize {
+    let count = cancelled.len();
+    journal.extend(
+        cancelled
+            .into_iter()
+            .map(|event| JournalRecord::Cancel { id: event.id }),
+    );
+    count
+}
+
 impl Scheduler {
-    #[cfg(test)]
+    /// A scheduler with no backing store, for tests and `omar bench`.
     pub fn new() -> Self {
         Self {
-            queue: Mutex::new(BinaryHeap::new()),
+            queue: Mutex::new(EventQueue::new()),
             notify: Notify::new(),
-            store_path: None,
+            store: Store::Memory,
+            delivery_stats: Arc::default(),
+            cron_stats: Mutex::default(),
         }
     }
 
     pub fn with_store(store_path: PathBuf) -> Self {
-        let mut queue = BinaryHeap::new();
-        for event in load_events_from_store(&store_path) {
-            queue.push(event);
-        }
+        let queue = load_events_from_store(&store_path).into_iter().collect();
         Self {
             queue: Mutex::new(queue),
             notify: Notify::new(),
-            store_path: Some(store_path),
+            store: Store::Shared(store_path),
+            delivery_stats: Arc::default(),
+            cron_stats: Mutex::default(),
         }
     }
 
-    pub fn is_persistent(&self) -> bool {
-        self.store_path.is_some()
+    /// Open the store as its owning process: keep the queue in memory, persist
+    /// through the append-only journal, and serve other processes over IPC.
+    ///
+    /// Falls back to [`Scheduler::with_store`] when another owner is already
+    /// running or the socket cannot be bound, so a second dashboard still
+    /// works — its operations are forwarded to the first.
+    pub fn own_store(store_path: PathBuf) -> Arc<Self> {
+        let socket = ipc::socket_path(&store_path);
+        if ipc::owner_reachable(&socket) {
+            return Arc::new(Self::with_store(store_path));
+        }
+        if let Some(parent) = store_path.parent() {
+            let _ = fs::create_dir_all(parent);
+        }
+        let Ok(lock) = StoreLock::acquire(store_lock_path(&store_path)) else {
+            return Arc::new(Self::with_store(store_path));
+        };
+        // Any socket file left now belongs to a dead owner: its lock was
+        // stale or we could not have acquired it.
+        let _ = fs::remove_file(&socket);
+        let listener = match std::os::unix::net::UnixListener::bind(&socket) {
+            Ok(listener) => listener,
+            Err(err) => {
+                eprintln!(
+                    "scheduler: failed to bind {:?} ({}); using shared file store",
+                    socket, err
+                );
+                drop(lock);
+                return Arc::new(Self::with_store(store_path));
+            }
+        };
+
+        let queue: EventQueue = load_events_from_store(&store_path).into_iter().collect();
+        // Start from a compacted snapshot and an empty journal.
+        save_events_to_store(&store_path, &queue);
+        let journal = match Journal::open(&store_path) {
+            Ok(journal) => journal,
+            Err(err) => {
+                eprintln!(
+                    "scheduler: failed to open event journal ({}); using shared file store",
+                    err
+                );
+                drop(listener);
+                let _ = fs::remove_file(&socket);
+                drop(lock);
+                return Arc::new(Self::with_store(store_path));
+            }
+        };
+
+        let scheduler = Arc::new(Self {
+            queue: Mutex::new(queue),
+            notify: Notify::new(),
+            store: Store::Owner(OwnedStore {
+                store_path,
+                journal: Mutex::new(journal),
+                _lock: lock,
+            }),
+            delivery_stats: Arc::default(),
+            cron_stats: Mutex::default(),
+        });
+        ipc::serve(listener, Arc::downgrade(&scheduler));
+        scheduler
+    }
+
+    /// Queue depth and in-flight counts of the delivery pipeline driven by
+    /// `run_event_loop`.
+    pub fn delivery_stats(&self) -> &DeliveryStats {
+        &self.delivery_stats
+    }
+
+    /// Fire, coalescing and drift statistics for recurring events delivered
+    /// by this process.
+    pub fn cron_stats(&self) -> CronStats {
+        *self.cron_stats.lock().unwrap()
+    }
+
+    /// True when other processes may change the queue without notifying this
+    /// one, so the event loop must poll. An owner hears about every change
+    /// through IPC.
+    pub fn polls_store(&self) -> bool {
+        matches!(self.store, Store::Shared(_))
+    }
+
+    /// True when this is a shared-store handle and another process owns the
+    /// store. Such a handle must not run deliveries itself.
+    fn remote_owner_live(&self) -> bool {
+        match &self.store {
+            Store::Shared(store_path) => ipc::owner_reachable(&ipc::socket_path(store_path)),
+            _ => false,
+        }
     }
 
+    /// [`Scheduler::try_transaction`] for the delivery side, which has no
+    /// caller to report a failure to: if a shared store's lock cannot be
+    /// taken, the change is applied to the in-memory queue only and will be
+    /// overwritten by the next transaction that reloads from disk. Still
+    /// preferable to panicking the event loop.
     fn transaction<R>(
         &self,
         persist: bool,
-        f: impl FnOnce(&mut BinaryHeap<ScheduledEvent>) -> R,
+        f: impl FnOnce(&mut EventQueue, &mut Vec<JournalRecord>) -> R,
     ) -> R {
-        match &self.store_path {
-            Some(store_path) => {
-                // If the on-disk lock can't be acquired (stuck peer, slow FS),
-                // degrade to an in-memory operation rather than panicking the
-                // caller — the event loop or any other thread holding a live
-                // Scheduler would otherwise take down the whole process.
-                // Consequence on a write op: the change only lands in the
-                // in-memory heap and will be overwritten by the next
-                // successful `transaction` (which reloads from disk), so the
-                // event is effectively lost if the dashboard restarts or
-                // another writer succeeds first. Still preferable to a crash.
+        let mut f = Some(f);
+        match self.try_transaction(persist, |queue, records| {
+            (f.take().expect("transaction body runs once"))(queue, records)
+        }) {
+            Ok(result) => result,
+            Err(err) => {
+                eprintln!(
+                    "scheduler: WARNING: {:#}; write applied to in-memory cache only — \
+                     NOT persisted to disk and may be lost on restart",
+                    err
+                );
+                let mut queue = self.queue.lock().unwrap();
+                (f.take().expect("transaction body not run"))(&mut queue, &mut Vec::new())
+            }
+        }
+    }
+
+    /// Apply `f` to the queue and persist the result when `persist` is set.
+    /// Fails without running `f` when a write cannot be persisted: the
+    /// shared store's lock is held by a stuck peer or a live owner.
+    fn try_transaction<R>(
+        &self,
+        persist: bool,
+        f: impl FnOnce(&mut EventQueue, &mut Vec<JournalRecord>) -> R,
+    ) -> anyhow::Result<R> {
+        let mut records = Vec::new();
+        match &self.store {
+            Store::Shared(store_path) => {
                 let _store_lock = match StoreLock::acquire(store_lock_path(store_path)) {
                     Ok(lock) => lock,
+                    Err(err) if persist => {
+                        anyhow::bail!("failed to acquire scheduler store lock ({})", err)
+                    }
                     Err(err) => {
-                        if persist {
-                            eprintln!(
-                                "scheduler: WARNING: failed to acquire store lock ({}); \
-                                 write applied to in-memory cache only — NOT persisted to disk \
-                                 and may be lost on restart",
-                                err
-                            );
-                        } else {
-                            eprintln!(
-                                "scheduler: failed to acquire store lock ({}); \
-                                 read returned from (potentially stale) in-memory cache",
-                                err
-                            );
-                        }
+                        eprintln!(
+                            "scheduler: failed to acquire store lock ({}); \
+                             read returned from (potentially stale) in-memory cache",
+                            err
+                        );
                         let mut queue = self.queue.lock().unwrap();
-                        return f(&mut queue);
+                        return Ok(f(&mut queue, &mut records));
                     }
                 };
-                let mut queue = BinaryHeap::new();
-                for event in load_events_from_store(store_path) {
-                    queue.push(event);
-                }
-                let result = f(&mut queue);
+                let mut queue: EventQueue =
+                    load_events_from_store(store_path).into_iter().collect();
+                let result = f(&mut queue, &mut records);
                 if persist {
                     save_events_to_store(store_path, &queue);
                 }
                 *self.queue.lock().unwrap() = queue;
-                result
+                Ok(result)
             }
-            None => {
+            Store::Owner(owned) => {
                 let mut queue = self.queue.lock().unwrap();
-                f(&mut queue)
+                let result = f(&mut queue, &mut records);
+                if !records.is_empty() {
+                    // Appending under the queue lock keeps journal order equal
+                    // to the order mutations were applied.
+                    let mut journal = owned.journal.lock().unwrap();
+                    if journal.append(&records) {
+                        save_events_to_store(&owned.store_path, &queue);
+                        journal.compacted();
+                    }
+                }
+                Ok(result)
+            }
+            Store::Memory => {
+                let mut queue = self.queue.lock().unwrap();
+                Ok(f(&mut queue, &mut records))
             }
         }
     }
 
-    pub fn insert(&self, event: ScheduledEvent) {
-        self.transaction(true, |queue| {
-            queue.push(event);
-        });
-        // `notify_one` (not `notify_waiters`) stores a permit so the event
-        // loop wakes up even if it isn't currently parked on
-        // `notified().await`. All queue mutations follow this convention so
-        // a cancellation that removed the next-due event can't leave the
-        // loop sleeping until the stale deadline.
-        self.notify.notify_one();
+    /// Run one operation: forwarded to the owner when this is a shared-store
+    /// handle and an owner answers, otherwise applied here. Fails when the
+    /// operation could not be applied durably — an owner is running but did
+    /// not answer, or the store lock is unavailable for a write.
+    pub(crate) fn execute(&self, request: Request) -> anyhow::Result<Response> {
+        let write = request.is_write();
+        let forwarded = match &self.store {
+            Store::Shared(store_path) => ipc::call(&ipc::socket_path(store_path), &request)?,
+            _ => None,
+        };
+        let response = match forwarded {
+            Some(response) => response,
+            None => self.try_transaction(write, |queue, journal| apply(queue, journal, request))?,
+        };
+        if write {
+            // `notify_one` (not `notify_waiters`) stores a permit so the event
+            // loop wakes up even if it isn't currently parked on
+            // `notified().await`. All queue mutations follow this convention
+            // so a cancellation that removed the next-due event can't leave
+            // the loop sleeping until the stale deadline.
+            self.notify.notify_one();
+        }
+        Ok(response)
+    }
+
+    pub fn insert(&self, event: ScheduledEvent) -> anyhow::Result<()> {
+        self.execute(Request::Insert { event })?;
+        Ok(())
+    }
+
+    /// Insert several events as one operation: a single IPC round trip or
+    /// store transaction, and one journal append.
+    pub fn insert_many(&self, events: Vec<ScheduledEvent>) -> anyhow::Result<()> {
+        if !events.is_empty() {
+            self.execute(Request::InsertMany { events })?;
+        }
+        Ok(())
     }
 
     /// Cancel an event only if it belongs to the specified EA.
     /// Fix S1: Atomic EA-scoped cancellation — no TOCTOU window where the event
     /// is temporarily absent from the queue (as happens with cancel + re-insert).
-    /// Returns:
+    /// Returns (inside the store's own `Result`):
     ///   Ok(event) if found and ea_id matches (event removed)
     ///   Err(true)  if found but ea_id doesn't match (event stays in queue)
     ///   Err(false) if not found
-    pub fn cancel_if_ea(&self, event_id: &str, ea_id: u32) -> Result<ScheduledEvent, bool> {
-        let result = self.transaction(true, |queue| {
-            let events: Vec<ScheduledEvent> = queue.drain().collect();
-            let mut cancelled = None;
-            let mut wrong_ea = false;
-            let mut remaining = BinaryHeap::new();
-            for ev in events {
-                if ev.id == event_id && cancelled.is_none() {
-                    if ev.ea_id == ea_id {
-                        cancelled = Some(ev);
-                    } else {
-                        wrong_ea = true;
-                        remaining.push(ev);
-                    }
-                } else {
-                    remaining.push(ev);
-                }
-            }
-            *queue = remaining;
-            match cancelled {
-                Some(ev) => Ok(ev),
-                None => Err(wrong_ea),
-            }
-        });
-        self.notify.notify_one();
-        result
+    pub fn cancel_if_ea(
+        &self,
+        event_id: &str,
+        ea_id: u32,
+    ) -> anyhow::Result<Result<ScheduledEvent, bool>> {
+        Ok(
+            match self.execute(Request::CancelIfEa {
+                event_id: event_id.to_string(),
+                ea_id,
+            })? {
+                Response::Cancelled {
+                    event: Some(event), ..
+                } => Ok(event),
+                Response::Cancelled { wrong_ea, .. } => Err(wrong_ea),
+                _ => Err(false),
+            },
+        )
     }
 
-    /// List events for a specific EA only.
+    /// List events for a specific EA only. A read never fails: without an
+    /// answer from the store it returns the last events this handle saw.
     pub fn list_by_ea(&self, ea_id: u32) -> Vec<ScheduledEvent> {
-        self.transaction(false, |queue| {
-            queue.iter().filter(|e| e.ea_id == ea_id).cloned().collect()
-        })
+        match self.execute(Request::ListByEa { ea_id }) {
+            Ok(Response::Events { events }) => events,
+            Ok(_) => Vec::new(),
+            Err(err) => {
+                eprintln!("scheduler: {:#}; listing cached events", err);
+                self.queue.lock().unwrap().list_by_ea(ea_id)
+            }
+        }
     }
 
     /// Cancel all events for a specific EA. Returns the number cancelled.
-    pub fn cancel_by_ea(&self, ea_id: u32) -> usize {
-        let count = self.transaction(true, |queue| {
-            let events: Vec<ScheduledEvent> = queue.drain().collect();
-            let mut count = 0;
-            let mut remaining = BinaryHeap::new();
-            for ev in events {
-                if ev.ea_id == ea_id {
-                    count += 1;
-                } else {
-                    remaining.push(ev);
-                }
-            }
-            *queue = remaining;
-            count
-        });
-        self.notify.notify_one();
-        count
+    pub fn cancel_by_ea(&self, ea_id: u32) -> anyhow::Result<usize> {
+        Ok(match self.execute(Request::CancelByEa { ea_id })? {
+            Response::Count { count } => count,
+            _ => 0,
+        })
     }
 
     /// Cancel all events for a given receiver within a specific EA only.
     /// Fix V5: EA-scoped receiver cancellation prevents cross-EA event leaks.
-    pub fn cancel_by_receiver_and_ea(&self, receiver: &str, ea_id: u32) -> usize {
-        let count = self.transaction(true, |queue| {
-            let events: Vec<ScheduledEvent> = queue.drain().collect();
-            let mut count = 0;
-            let mut remaining = BinaryHeap::new();
-            for ev in events {
-                if ev.receiver == receiver && ev.ea_id == ea_id {
-                    count += 1;
-                } else {
-                    remaining.push(ev);
-                }
-            }
-            *queue = remaining;
-            count
-        });
-        self.notify.notify_one();
-        count
+    pub fn cancel_by_receiver_and_ea(&self, receiver: &str, ea_id: u32) -> anyhow::Result<usize> {
+        Ok(
+            match self.execute(Request::CancelByReceiverAndEa {
+                receiver: receiver.to_string(),
+                ea_id,
+            })? {
+                Response::Count { count } => count,
+                _ => 0,
+            },
+        )
     }
 
     /// Pop all events matching the given receiver, EA, and timestamp.
     /// Fix V7: EA-scoped batching prevents cross-EA event delivery.
     #[cfg(test)]
     pub fn pop_batch(&self, receiver: &str, ea_id: u32, timestamp: u64) -> Vec<ScheduledEvent> {
-        let batch = self.transaction(true, |queue| {
-            let events: Vec<ScheduledEvent> = queue.drain().collect();
-            let mut batch = Vec::new();
-            let mut remaining = BinaryHeap::new();
-            for ev in events {
-                if ev.receiver == receiver && ev.ea_id == ea_id && ev.timestamp == timestamp {
-                    batch.push(ev);
-                } else {
-                    remaining.push(ev);
-                }
+        let batch = self.transaction(true, |queue, journal| {
+            let batch: Vec<ScheduledEvent> = queue
+                .list_by_receiver(receiver, ea_id)
+                .into_iter()
+                .filter(|ev| ev.timestamp == timestamp)
+                .filter_map(|ev| queue.remove(&ev.id))
+                .collect();
+            for ev in &batch {
+                journal.push(JournalRecord::Fire { id: ev.id.clone() });
             }
-            *queue = remaining;
             batch
         });
         self.notify.notify_one();
@@ -375,124 +587,273 @@ impl Scheduler {
     }
 
     fn next_timestamp(&self) -> Option<u64> {
-        self.transaction(false, |queue| queue.peek().map(|event| event.timestamp))
-    }
-
-    fn take_due_deliveries(
+        // With an owner running, it alone delivers; a second dashboard's event
+        // loop just idles.
+        if self.remote_owner_live() {
+            return None;
+        }
+        self.transaction(false, |queue, _| queue.peek_timestamp())
+    }
+
+    /// Hand the event loop everything due now.
+    ///
+    /// Two phases, so no tmux call runs inside a store transaction (which
+    /// holds the store lock and, for an owner, the queue every IPC request
+    /// needs):
+    ///
+    /// 1. **Claim** (`claim_due`, under the lock): ordinary groups are fired
+    ///    and journaled as before. Groups whose receiver has the popup open
+    ///    are only claimed — their events stay queued and durable, since
+    ///    whether they fire depends on a draft we have not read yet.
+    /// 2. **Deliver** (here, outside the lock): each claim's draft is
+    ///    captured, then `settle_claim` either defers the claim or fires it
+    ///    in a short second transaction, and only then is the line cleared
+    ///    with `C-u`. An event cancelled or rescheduled while the pane was
+    ///    being read is dropped from the claim, and a claim that ends up
+    ///    empty never touches the user's draft.
+    ///
+    /// The event loop is the only caller, so nothing else can claim the same
+    /// events between the two phases.
+    ///
+    /// `lane_busy(receiver, ea_id)` reports whether an earlier delivery to
+    /// that pane is still queued or in flight. Such a claim is not settled:
+    /// its draft capture would read the in-flight prompt, and `C-u` would
+    /// wipe it. It is pushed back `BUSY_LANE_DEFER_NS` instead and retried
+    /// once the lane has drained.
+    pub(crate) fn take_due_deliveries(
         &self,
         popup_receiver: &PopupReceiver,
         base_prefix: &str,
+        lane_busy: impl Fn(&str, u32) -> bool,
     ) -> Vec<DueDelivery> {
-        self.transaction(true, |queue| {
-            let Some(earliest_ts) = queue.peek().map(|event| event.timestamp) else {
-                return Vec::new();
+        let (mut deliveries, claims) = self.claim_due(popup_receiver);
+        for claim in claims {
+            if lane_busy(&claim.receiver, claim.ea_id) {
+                deliveries.extend(self.defer_claim(claim, BUSY_LANE_DEFER_NS));
+                continue;
+            }
+            // If the pane cannot be read, defer rather than risk wiping
+            // text we cannot put back.
+            let input = get_pane_input(base_prefix, &claim.receiver, claim.ea_id);
+            let Some(delivery) = self.settle_claim(claim, input) else {
+                continue;
             };
-            if earliest_ts > now_ns() {
-                return Vec::new();
+            if !delivery.deferred_for_popup {
+                // The draft is captured (or trivial); clear the line before
+                // normal event delivery.
+                let target = pane_target_name(&delivery.receiver, delivery.ea_id, base_prefix);
+                let _ = crate::tmux::TmuxClient::new("").send_keys(&target, "C-u");
+            }
+            deliveries.push(delivery);
+        }
+        deliveries
+    }
+
+    /// Phase one of `take_due_deliveries`: fire every due group except those
+    /// addressed to the open popup, which are returned as claims.
+    fn claim_due(&self, popup_receiver: &PopupReceiver) -> (Vec<DueDelivery>, Vec<DraftClaim>) {
+        self.transaction(true, |queue, journal| {
+            let Some(earliest_ts) = queue.peek_timestamp() else {
+                return (Vec::new(), Vec::new());
+            };
+            let now = now_ns();
+            if earliest_ts > now {
+                return (Vec::new(), Vec::new());
             }
 
-            let mut remaining = BinaryHeap::new();
             let mut groups: Vec<((String, u32), Vec<ScheduledEvent>)> = Vec::new();
             let mut group_indices: HashMap<(String, u32), usize> = HashMap::new();
 
-            for event in queue.drain() {
-                if event.timestamp == earliest_ts {
-                    let key = (event.receiver.clone(), event.ea_id);
-                    let idx = *group_indices.entry(key.clone()).or_insert_with(|| {
-                        groups.push((key, Vec::new()));
-                        groups.len() - 1
-                    });
-                    groups[idx].1.push(event);
-                } else {
-                    remaining.push(event);
-                }
+            // Only the earliest-due one-shot events leave the queue; anything
+            // not delivered this tick is pushed back below. Recurring events
+            // in a due wheel slot stay queued and are re-armed in place, and
+            // joining the per-receiver groups coalesces same-slot heartbeats
+            // into one delivery.
+            let mut due = queue.take_at(earliest_ts);
+            due.extend(queue.due_recurring(now));
+            for event in due {
+                let key = (event.receiver.clone(), event.ea_id);
+                let idx = *group_indices.entry(key.clone()).or_insert_with(|| {
+                    groups.push((key, Vec::new()));
+                    groups.len() - 1
+                });
+                groups[idx].1.push(event);
             }
 
             const MAX_EVENTS_PER_EA_PER_TICK: usize = 10;
             let mut ea_delivery_count: HashMap<u32, usize> = HashMap::new();
             let mut deliveries = Vec::new();
+            let mut claims = Vec::new();
 
             for ((receiver, ea_id), batch) in groups {
                 let delivered_so_far = *ea_delivery_count.get(&ea_id).unwrap_or(&0);
                 if delivered_so_far >= MAX_EVENTS_PER_EA_PER_TICK {
                     for event in batch {
-                        remaining.push(event);
+                        queue.push(event);
                     }
                     continue;
                 }
 
-                let mut restore_input = None;
-                if should_defer_for_popup(popup_receiver, &receiver, ea_id) {
-                    // If the user has a meaningful draft, preserve it across
-                    // event delivery: capture input, let the normal delivery
-                    // path clear/submit the event, then restore the draft.
-                    // If the pane cannot be read, defer rather than risk
-                    // wiping text we cannot put back.
-                    let Some(input) = get_pane_input(base_prefix, &receiver, ea_id) else {
-                        let defer_until = now_ns() + POPUP_DEFER_NS;
-                        for mut event in batch {
-                            event.timestamp = defer_until;
-                            remaining.push(event);
-                        }
-                        deliveries.push(DueDelivery {
-                            receiver,
-                            ea_id,
-                            timestamp: earliest_ts,
-                            batch: Vec::new(),
-                            deferred_for_popup: true,
-                            restore_input: None,
-                        });
-                        continue;
-                    };
-
-                    if pane_input_should_restore(&input) {
-                        restore_input = Some(input);
-                    }
-                    // Input is empty/trivial or has been captured for restore.
-                    // Clear the current line before normal event delivery.
-                    let target = pane_target_name(&receiver, ea_id, base_prefix);
-                    let _ = crate::tmux::TmuxClient::new("").send_keys(&target, "C-u");
-                }
-
                 let remaining_quota = MAX_EVENTS_PER_EA_PER_TICK - delivered_so_far;
                 let (batch, deferred_batch) = split_batch_for_quota(batch, remaining_quota);
                 for event in deferred_batch {
-                    remaining.push(event);
+                    queue.push(event);
                 }
                 if batch.is_empty() {
                     continue;
                 }
-
+                // A claim reserves its share of the quota even if it is
+                // deferred later, as the inline capture used to.
                 *ea_delivery_count.entry(ea_id).or_insert(0) += batch.len();
-                for event in &batch {
-                    if let Some(interval) = event.recurring_ns {
-                        let now = now_ns();
-                        remaining.push(ScheduledEvent {
-                            id: uuid::Uuid::new_v4().to_string(),
-                            sender: event.sender.clone(),
-                            receiver: event.receiver.clone(),
-                            timestamp: now + interval,
-                            payload: event.payload.clone(),
-                            created_at: now,
-                            recurring_ns: Some(interval),
-                            ea_id: event.ea_id,
-                        });
+
+                if should_defer_for_popup(popup_receiver, &receiver, ea_id) {
+                    // Put the one-shots straight back: with no journal
+                    // record the claim costs nothing durable, and a crash
+                    // before `settle_claim` simply leaves them due.
+                    for event in &batch {
+                        if event.recurring_ns.is_none() {
+                            queue.push(event.clone());
+                        }
                     }
+                    claims.push(DraftClaim {
+                        receiver,
+                        ea_id,
+                        timestamp: earliest_ts,
+                        batch,
+                    });
+                    continue;
                 }
+
+                self.commit_fired(queue, journal, &batch);
                 deliveries.push(DueDelivery {
                     receiver,
                     ea_id,
                     timestamp: earliest_ts,
                     batch,
                     deferred_for_popup: false,
-                    restore_input,
+                    restore_input: None,
                 });
             }
 
-            *queue = remaining;
-            deliveries
+            (deliveries, claims)
+        })
+    }
+
+    /// Phase two of `take_due_deliveries`: resolve a popup claim once its
+    /// draft has been read (`None` when the pane could not be). Only events
+    /// still queued exactly as claimed take part; `None` is returned when
+    /// none are left.
+    fn settle_claim(&self, claim: DraftClaim, input: Option<String>) -> Option<DueDelivery> {
+        let Some(input) = input else {
+            return self.defer_claim(claim, POPUP_DEFER_NS);
+        };
+        let DraftClaim {
+            receiver,
+            ea_id,
+            timestamp,
+            batch,
+        } = claim;
+        self.transaction(true, |queue, journal| {
+            let batch = still_claimed(queue, batch);
+            if batch.is_empty() {
+                return None;
+            }
+
+            // Preserve a meaningful draft across delivery: the caller clears
+            // the line, the pipeline submits the event, then pastes it back.
+            for event in &batch {
+                if event.recurring_ns.is_none() {
+                    queue.remove(&event.id);
+                }
+            }
+            self.commit_fired(queue, journal, &batch);
+            Some(DueDelivery {
+                receiver,
+                ea_id,
+                timestamp,
+                batch,
+                deferred_for_popup: false,
+                restore_input: pane_input_should_restore(&input).then_some(input),
+            })
+        })
+    }
+
+    /// Push a popup claim's still-queued events `delay_ns` into the future
+    /// without touching the pane. `None` when none are left.
+    fn defer_claim(&self, claim: DraftClaim, delay_ns: u64) -> Option<DueDelivery> {
+        let DraftClaim {
+            receiver,
+            ea_id,
+            timestamp,
+            batch,
+        } = claim;
+        self.transaction(true, |queue, journal| {
+            let batch = still_claimed(queue, batch);
+            if batch.is_empty() {
+                return None;
+            }
+            let defer_until = now_ns() + delay_ns;
+            for mut event in batch {
+                event.timestamp = defer_until;
+                journal.push(JournalRecord::Insert {
+                    event: event.clone(),
+                });
+                queue.push(event);
+            }
+            Some(DueDelivery {
+                receiver,
+                ea_id,
+                timestamp,
+                batch: Vec::new(),
+                deferred_for_popup: true,
+                restore_input: None,
+            })
         })
     }
+
+    /// Record `batch` as fired: one-shots (already out of the queue) get a
+    /// `Fire` record, recurring events are re-armed in place.
+    fn commit_fired(
+        &self,
+        queue: &mut EventQueue,
+        journal: &mut Vec<JournalRecord>,
+        batch: &[ScheduledEvent],
+    ) {
+        let fired_at = now_ns();
+        for event in batch {
+            metrics::SCHEDULER_LAG.record_us(fired_at.saturating_sub(event.timestamp) / 1_000);
+        }
+        let mut cron_stats = self.cron_stats.lock().unwrap();
+        let mut recurring_in_batch: u64 = 0;
+        for event in batch {
+            let Some(interval) = event.recurring_ns else {
+                journal.push(JournalRecord::Fire {
+                    id: event.id.clone(),
+                });
+                continue;
+            };
+            let next = wheel::next_fire(event.timestamp, interval, fired_at);
+            queue.rearm(&event.id, next);
+            journal.push(JournalRecord::Rearm {
+                id: event.id.clone(),
+                timestamp: next,
+            });
+            cron_stats.record_fire(event.timestamp, fired_at);
+            recurring_in_batch += 1;
+        }
+        cron_stats.coalesced += recurring_in_batch.saturating_sub(1);
+    }
+}
+
+impl Drop for Scheduler {
+    fn drop(&mut self) {
+        // No final compaction: the journal already holds every change, and
+        // rewriting the snapshot here could resurrect state that a quit-time
+        // reset has just purged. The lock file goes with `OwnedStore::_lock`.
+        if let Store::Owner(owned) = &self.store {
+            let _ = fs::remove_file(ipc::socket_path(&owned.store_path));
+        }
+    }
 }
 
 /// Build the tmux session name for a receiver.
@@ -586,20 +947,16 @@ fn extract_claude_input_from_capture(content: &str) -> String {
         .lines()
         .rev()
         .find_map(extract_claude_prompt_line)
+        .map(Cow::into_owned)
         .unwrap_or_default()
 }
 
-fn extract_claude_prompt_line(line: &str) -> Option<String> {
+fn extract_claude_prompt_line(line: &str) -> Option<Cow<'_, str>> {
     let (_, after_prompt) = line.split_once('❯')?;
-    if input_starts_suggestion_styled(after_prompt) {
-        return Some(String::new());
-    }
-    let stripped = strip_ansi(after_prompt);
-    let input = stripped.trim();
-    if is_claude_input_chrome(input) {
-        return Some(String::new());
-    }
-    Some(input.to_string())
+    Some(non_chrome_input(
+        scan_prompt_input(after_prompt),
+        is_claude_input_chrome,
+    ))
 }
 
 fn extract_prefixed_input_from_capture(
@@ -611,121 +968,153 @@ fn extract_prefixed_input_from_capture(
         .lines()
         .rev()
         .find_map(|line| extract_prefixed_input_line(line, prefix, &is_chrome))
+        .map(Cow::into_owned)
         .unwrap_or_default()
 }
 
-fn extract_prefixed_input_line(
-    line: &str,
+fn extract_prefixed_input_line<'a>(
+    line: &'a str,
     prefix: &str,
     is_chrome: &impl Fn(&str) -> bool,
-) -> Option<String> {
-    let trimmed = line.trim_start();
-    let after_prefix = trimmed.strip_prefix(prefix)?;
-    if input_starts_suggestion_styled(after_prefix) {
-        return Some(String::new());
-    }
-    let stripped = strip_ansi(after_prefix);
-    let input = stripped.trim();
-    if is_chrome(input) {
-        return Some(String::new());
-    }
-    Some(input.to_string())
+) -> Option<Cow<'a, str>> {
+    let after_prefix = line.trim_start().strip_prefix(prefix)?;
+    Some(non_chrome_input(scan_prompt_input(after_prefix), is_chrome))
 }
 
-fn strip_ansi(input: &str) -> String {
-    let mut output = String::with_capacity(input.len());
-    let mut chars = input.chars().peekable();
-    while let Some(ch) = chars.next() {
-        if ch == '\x1b' && chars.peek() == Some(&'[') {
-            chars.next();
-            for code in chars.by_ref() {
-                if ('@'..='~').contains(&code) {
-                    break;
-                }
-            }
-            continue;
-        }
-        output.push(ch);
+fn non_chrome_input<'a>(input: Cow<'a, str>, is_chrome: impl Fn(&str) -> bool) -> Cow<'a, str> {
+    if is_chrome(&input) {
+        Cow::Borrowed("")
+    } else {
+        input
     }
-    output
 }
 
-fn input_starts_suggestion_styled(input: &str) -> bool {
-    let bytes = input.as_bytes();
+/// The user's text after a prompt marker, in one pass over the bytes.
+///
+/// Equivalent to stripping every CSI sequence and trimming whitespace, except
+/// that text whose first visible character is drawn dim, gray or in reverse
+/// video — a backend's autocomplete suggestion or placeholder, not something
+/// the user typed — yields `""`. SGR state is only tracked up to that first
+/// visible character, and the result borrows from `after_prompt` unless an
+/// escape sequence sits between visible characters (a highlighted word), the
+/// one case that has to be copied out.
+fn scan_prompt_input(after_prompt: &str) -> Cow<'_, str> {
+    let bytes = after_prompt.as_bytes();
+    let mut style = SuggestionStyle::default();
+    // Byte range of the visible text, from its first to its last
+    // non-whitespace character.
+    let mut span: Option<(usize, usize)> = None;
+    let mut escape_since_visible = false;
+    let mut interleaved = false;
     let mut i = 0;
-    let mut dimmed = false;
-    let mut reverse_video = false;
-
     while i < bytes.len() {
-        if let Some(ch) = input[i..].chars().next() {
-            if ch.is_whitespace() {
-                i += ch.len_utf8();
-                continue;
+        if let Some(end) = csi_end(bytes, i) {
+            if span.is_none() && bytes[end] == b'm' {
+                style.apply(&after_prompt[i + 2..end]);
             }
+            escape_since_visible |= span.is_some();
+            i = end + 1;
+            continue;
         }
-
-        if bytes[i] == 0x1b && i + 1 < bytes.len() && bytes[i + 1] == b'[' {
-            if let Some((end, is_sgr)) = ansi_sequence_end(bytes, i + 2) {
-                if is_sgr {
-                    update_suggestion_style_state(
-                        &input[i + 2..end],
-                        &mut dimmed,
-                        &mut reverse_video,
-                    );
+        if bytes[i] == 0x1b && bytes.get(i + 1) == Some(&b'[') {
+            // Unterminated sequence: it swallows the rest of the line.
+            break;
+        }
+        let ch = after_prompt[i..].chars().next().unwrap_or_default();
+        let next = i + ch.len_utf8();
+        if !ch.is_whitespace() {
+            match &mut span {
+                None if style.is_suggestion() => return Cow::Borrowed(""),
+                None => span = Some((i, next)),
+                Some((_, last)) => {
+                    interleaved |= escape_since_visible;
+                    escape_since_visible = false;
+                    *last = next;
                 }
-                i = end + 1;
-                continue;
             }
         }
-
-        return dimmed || reverse_video;
+        i = next;
     }
 
-    false
-}
-
-fn ansi_sequence_end(bytes: &[u8], mut i: usize) -> Option<(usize, bool)> {
+    let Some((start, end)) = span else {
+        return Cow::Borrowed("");
+    };
+    let visible = &after_prompt[start..end];
+    if !interleaved {
+        return Cow::Borrowed(visible);
+    }
+    let mut out = String::with_capacity(visible.len());
+    let bytes = visible.as_bytes();
+    let mut run_start = 0;
+    let mut i = 0;
     while i < bytes.len() {
-        let byte = bytes[i];
-        if (0x40..=0x7e).contains(&byte) {
-            return Some((i, byte == b'm'));
+        match csi_end(bytes, i) {
+            Some(seq_end) => {
+                out.push_str(&visible[run_start..i]);
+                i = seq_end + 1;
+                run_start = i;
+            }
+            None => i += 1,
         }
-        i += 1;
     }
-    None
+    out.push_str(&visible[run_start..]);
+    Cow::Owned(out)
 }
 
-fn update_suggestion_style_state(params: &str, dimmed: &mut bool, reverse_video: &mut bool) {
-    let codes: Vec<u16> = if params.is_empty() {
-        vec![0]
-    } else {
-        params
+/// Index of the final byte of the CSI sequence (`ESC [ … final`) starting
+/// at `i`, or `None` when `i` does not start a terminated one. Final bytes
+/// are ASCII, so this never stops inside a multi-byte character.
+fn csi_end(bytes: &[u8], i: usize) -> Option<usize> {
+    if bytes.get(i) != Some(&0x1b) || bytes.get(i + 1) != Some(&b'[') {
+        return None;
+    }
+    bytes[i + 2..]
+        .iter()
+        .position(|byte| (0x40..=0x7e).contains(byte))
+        .map(|offset| i + 2 + offset)
+}
+
+/// SGR attributes that mark prompt text as a suggestion rather than input.
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+struct SuggestionStyle {
+    dimmed: bool,
+    reverse_video: bool,
+}
+
+impl SuggestionStyle {
+    fn is_suggestion(self) -> bool {
+        self.dimmed || self.reverse_video
+    }
+
+    /// Apply the parameters of one SGR sequence (`params` is the text
+    /// between `ESC [` and `m`). Unparseable parameters are skipped.
+    fn apply(&mut self, params: &str) {
+        if params.is_empty() {
+            *self = Self::default();
+            return;
+        }
+        let mut codes = params
             .split(';')
             .filter_map(|part| part.parse::<u16>().ok())
-            .collect()
-    };
-    let mut i = 0;
-    while i < codes.len() {
-        match codes[i] {
-            0 => {
-                *dimmed = false;
-                *reverse_video = false;
-            }
-            22 | 39 => *dimmed = false,
-            7 => *reverse_video = true,
-            27 => *reverse_video = false,
-            2 | 90 => *dimmed = true,
-            38 if codes.get(i + 1) == Some(&5) => {
-                if let Some(color) = codes.get(i + 2) {
-                    if *color == 8 || (232..=255).contains(color) {
-                        *dimmed = true;
+            .peekable();
+        while let Some(code) = codes.next() {
+            match code {
+                0 => *self = Self::default(),
+                22 | 39 => self.dimmed = false,
+                7 => self.reverse_video = true,
+                27 => self.reverse_video = false,
+                2 | 90 => self.dimmed = true,
+                38 if codes.peek() == Some(&5) => {
+                    codes.next();
+                    if let Some(color) = codes.next() {
+                        if color == 8 || (232..=255).contains(&color) {
+                            self.dimmed = true;
+                        }
                     }
                 }
-                i += 2;
+                _ => {}
             }
-            _ => {}
         }
-        i += 1;
     }
 }
 
@@ -957,6 +1346,19 @@ fn split_batch_for_quota(
     (batch, deferred)
 }
 
+/// The events of a claim that are still queued exactly as claimed; ones
+/// cancelled or rescheduled while the pane was being read drop out.
+fn still_claimed(queue: &EventQueue, batch: Vec<ScheduledEvent>) -> Vec<ScheduledEvent> {
+    batch
+        .into_iter()
+        .filter(|claimed| {
+            queue
+                .get(&claimed.id)
+                .is_some_and(|current| current.timestamp == claimed.timestamp)
+        })
+        .collect()
+}
+
 /// Shared state: the (short name, ea_id) of the agent whose popup is currently open, if any.
 /// Both fields are required so suppression is scoped per-EA and does not affect same-named
 /// agents in other EAs.
@@ -971,7 +1373,15 @@ pub fn new_popup_receiver() -> PopupReceiver {
 /// no unbounded fan-out, one event stays one event.
 pub(crate) const POPUP_DEFER_NS: u64 = 30_000_000_000;
 
-struct DueDelivery {
+/// How long to push a popup claim out while an earlier delivery to the same
+/// pane is still running.
+pub(crate) const BUSY_LANE_DEFER_NS: u64 = 1_000_000_000;
+
+/// Default bound on concurrent prompt deliveries (`[scheduler]
+/// delivery_concurrency` in config.toml).
+pub const DEFAULT_DELIVERY_CONCURRENCY: usize = 8;
+
+pub(crate) struct DueDelivery {
     receiver: String,
     ea_id: u32,
     timestamp: u64,
@@ -980,6 +1390,16 @@ struct DueDelivery {
     restore_input: Option<String>,
 }
 
+/// Due events for the open popup's receiver, claimed by
+/// `Scheduler::claim_due` and still queued until `Scheduler::settle_claim`
+/// fires or defers them.
+struct DraftClaim {
+    receiver: String,
+    ea_id: u32,
+    timestamp: u64,
+    batch: Vec<ScheduledEvent>,
+}
+
 /// Decide whether to defer an event for `(receiver, ea_id)` because the user
 /// has an agent popup open on that exact pane. Scoped per-EA so same-named
 /// workers in other EAs deliver as normal.
@@ -1017,14 +1437,34 @@ pub async fn run_event_loop(
     ticker: TickerBuffer,
     popup_receiver: PopupReceiver,
     base_prefix: String,
+    delivery_concurrency: usize,
 ) {
+    let pipeline = {
+        let ticker = ticker.clone();
+        let base_prefix = base_prefix.clone();
+        DeliveryPipeline::new(
+            delivery_concurrency,
+            scheduler.delivery_stats.clone(),
+            ticker.clone(),
+            move |job: &DeliveryJob| {
+                deliver_to_tmux(
+                    job.ea_id,
+                    &job.receiver,
+                    &job.message,
+                    &base_prefix,
+                    &ticker,
+                    job.restore_input.as_deref(),
+                );
+            },
+        )
+    };
     let external_poll_interval = std::time::Duration::from_millis(500);
     loop {
         let next_ts = scheduler.next_timestamp();
 
         match next_ts {
             None => {
-                if scheduler.is_persistent() {
+                if scheduler.polls_store() {
                     tokio::time::sleep(external_poll_interval).await;
                 } else {
                     scheduler.notify.notified().await;
@@ -1036,7 +1476,7 @@ pub async fn run_event_loop(
                 if ts > now {
                     let sleep_ns = ts - now;
                     let mut duration = std::time::Duration::from_nanos(sleep_ns);
-                    if scheduler.is_persistent() {
+                    if scheduler.polls_store() {
                         duration = duration.min(external_poll_interval);
                     }
                     tokio::select! {
@@ -1049,7 +1489,10 @@ pub async fn run_event_loop(
                     }
                 }
 
-                for delivery in scheduler.take_due_deliveries(&popup_receiver, &base_prefix) {
+                let due = scheduler.take_due_deliveries(&popup_receiver, &base_prefix, |r, e| {
+                    pipeline.is_busy(r, e)
+                });
+                for delivery in due {
                     let DueDelivery {
                         receiver,
                         ea_id,
@@ -1066,36 +1509,14 @@ pub async fn run_event_loop(
                         continue;
                     }
 
-                    let message = format_delivery(&batch, timestamp);
-                    let receiver_name = receiver.clone();
-                    let base_prefix_clone = base_prefix.clone();
-                    let ticker_clone = ticker.clone();
-                    let delivery_result = tokio::task::spawn_blocking(move || {
-                        deliver_to_tmux(
-                            ea_id,
-                            &receiver_name,
-                            &message,
-                            &base_prefix_clone,
-                            &ticker_clone,
-                            restore_input.as_deref(),
-                        );
-                    })
-                    .await;
-                    if let Err(e) = delivery_result {
-                        ticker.push(format!(
-                            "delivery task failed for {} (ea {}): {}",
-                            receiver, ea_id, e
-                        ));
-                    }
-
-                    let lag_ns = now_ns().saturating_sub(timestamp);
-                    let lag_ms = lag_ns as f64 / 1_000_000.0;
-                    ticker.push(format!(
-                        "delivered {} event(s) to {}, lag={:.2}ms",
-                        batch.len(),
+                    pipeline.submit(DeliveryJob {
+                        message: format_delivery(&batch, timestamp),
                         receiver,
-                        lag_ms
-                    ));
+                        ea_id,
+                        timestamp,
+                        event_count: batch.len(),
+                        restore_input,
+                    });
                 }
             }
         }
@@ -1122,8 +1543,12 @@ mod tests {
     #[test]
     fn test_insert_and_peek() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 200, "hello"));
-        sched.insert(make_event("bob", "alice", 100, "earlier"));
+        sched
+            .insert(make_event("bob", "alice", 200, "hello"))
+            .unwrap();
+        sched
+            .insert(make_event("bob", "alice", 100, "earlier"))
+            .unwrap();
 
         let min_ts = sched.list_by_ea(0).iter().map(|e| e.timestamp).min();
         assert_eq!(min_ts, Some(100));
@@ -1134,10 +1559,12 @@ mod tests {
         let sched = Scheduler::new();
         let ev = make_event("bob", "alice", 100, "cancel me");
         let id = ev.id.clone();
-        sched.insert(ev);
-        sched.insert(make_event("bob", "alice", 200, "keep"));
+        sched.insert(ev).unwrap();
+        sched
+            .insert(make_event("bob", "alice", 200, "keep"))
+            .unwrap();
 
-        let cancelled = sched.cancel_if_ea(&id, 0).ok();
+        let cancelled = sched.cancel_if_ea(&id, 0).unwrap().ok();
         assert!(cancelled.is_some());
         assert_eq!(cancelled.unwrap().payload, "cancel me");
         assert_eq!(sched.list_by_ea(0).len(), 1);
@@ -1146,17 +1573,25 @@ mod tests {
     #[test]
     fn test_cancel_nonexistent() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 100, "keep"));
-        assert!(sched.cancel_if_ea("no-such-id", 0).is_err());
+        sched
+            .insert(make_event("bob", "alice", 100, "keep"))
+            .unwrap();
+        assert!(sched.cancel_if_ea("no-such-id", 0).unwrap().is_err());
         assert_eq!(sched.list_by_ea(0).len(), 1);
     }
 
     #[test]
     fn test_list_by_receiver() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 100, "for bob"));
-        sched.insert(make_event("carol", "alice", 200, "for carol"));
-        sched.insert(make_event("bob", "dave", 300, "also for bob"));
+        sched
+            .insert(make_event("bob", "alice", 100, "for bob"))
+            .unwrap();
+        sched
+            .insert(make_event("carol", "alice", 200, "for carol"))
+            .unwrap();
+        sched
+            .insert(make_event("bob", "dave", 300, "also for bob"))
+            .unwrap();
 
         let bob_events: Vec<_> = sched
             .list_by_ea(0)
@@ -1183,9 +1618,9 @@ mod tests {
         ev2.ea_id = 1;
         let mut ev3 = make_event("dave", "alice", 300, "ea0 too");
         ev3.ea_id = 0;
-        sched.insert(ev1);
-        sched.insert(ev2);
-        sched.insert(ev3);
+        sched.insert(ev1).unwrap();
+        sched.insert(ev2).unwrap();
+        sched.insert(ev3).unwrap();
 
         assert_eq!(sched.list_by_ea(0).len(), 2);
         assert_eq!(sched.list_by_ea(1).len(), 1);
@@ -1199,10 +1634,10 @@ mod tests {
         ev1.ea_id = 0;
         let mut ev2 = make_event("carol", "alice", 200, "ea1");
         ev2.ea_id = 1;
-        sched.insert(ev1);
-        sched.insert(ev2);
+        sched.insert(ev1).unwrap();
+        sched.insert(ev2).unwrap();
 
-        let count = sched.cancel_by_ea(0);
+        let count = sched.cancel_by_ea(0).unwrap();
         assert_eq!(count, 1);
         assert_eq!(sched.list_by_ea(1).len(), 1);
         assert_eq!(sched.list_by_ea(1)[0].ea_id, 1);
@@ -1211,10 +1646,12 @@ mod tests {
     #[test]
     fn test_pop_batch() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 100, "a"));
-        sched.insert(make_event("bob", "carol", 100, "b"));
-        sched.insert(make_event("bob", "dave", 200, "c"));
-        sched.insert(make_event("carol", "alice", 100, "d"));
+        sched.insert(make_event("bob", "alice", 100, "a")).unwrap();
+        sched.insert(make_event("bob", "carol", 100, "b")).unwrap();
+        sched.insert(make_event("bob", "dave", 200, "c")).unwrap();
+        sched
+            .insert(make_event("carol", "alice", 100, "d"))
+            .unwrap();
 
         let batch = sched.pop_batch("bob", 0, 100);
         assert_eq!(batch.len(), 2);
@@ -1234,8 +1671,8 @@ mod tests {
         ev0.ea_id = 0;
         let mut ev1 = make_event("auth", "bob", 100, "ea1-event");
         ev1.ea_id = 1;
-        sched.insert(ev0);
-        sched.insert(ev1);
+        sched.insert(ev0).unwrap();
+        sched.insert(ev1).unwrap();
 
         // Pop only EA 0's auth events at timestamp 100
         let batch = sched.pop_batch("auth", 0, 100);
@@ -1253,12 +1690,14 @@ mod tests {
     #[test]
     fn test_cancel_by_receiver() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 100, "a"));
-        sched.insert(make_event("bob", "carol", 200, "b"));
-        sched.insert(make_event("carol", "alice", 300, "c"));
-        sched.insert(make_event("bob", "dave", 400, "d"));
-
-        let cancelled = sched.cancel_by_receiver_and_ea("bob", 0);
+        sched.insert(make_event("bob", "alice", 100, "a")).unwrap();
+        sched.insert(make_event("bob", "carol", 200, "b")).unwrap();
+        sched
+            .insert(make_event("carol", "alice", 300, "c"))
+            .unwrap();
+        sched.insert(make_event("bob", "dave", 400, "d")).unwrap();
+
+        let cancelled = sched.cancel_by_receiver_and_ea("bob", 0).unwrap();
         assert_eq!(cancelled, 3);
         let remaining = sched.list_by_ea(0);
         assert_eq!(remaining.len(), 1);
@@ -1268,8 +1707,8 @@ mod tests {
     #[test]
     fn test_cancel_by_receiver_none() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 100, "a"));
-        let cancelled = sched.cancel_by_receiver_and_ea("nobody", 0);
+        sched.insert(make_event("bob", "alice", 100, "a")).unwrap();
+        let cancelled = sched.cancel_by_receiver_and_ea("nobody", 0).unwrap();
         assert_eq!(cancelled, 0);
         assert_eq!(sched.list_by_ea(0).len(), 1);
     }
@@ -1288,13 +1727,13 @@ mod tests {
         // EA 0 has "bob" events
         let mut ev4 = make_event("bob", "alice", 400, "ea0-bob");
         ev4.ea_id = 0;
-        sched.insert(ev1);
-        sched.insert(ev2);
-        sched.insert(ev3);
-        sched.insert(ev4);
+        sched.insert(ev1).unwrap();
+        sched.insert(ev2).unwrap();
+        sched.insert(ev3).unwrap();
+        sched.insert(ev4).unwrap();
 
         // Cancel only EA 0's "auth" events — EA 1's "auth" and EA 0's "bob" survive
-        let cancelled = sched.cancel_by_receiver_and_ea("auth", 0);
+        let cancelled = sched.cancel_by_receiver_and_ea("auth", 0).unwrap();
         assert_eq!(cancelled, 2);
         let remaining_ea0 = sched.list_by_ea(0);
         let remaining_ea1 = sched.list_by_ea(1);
@@ -1311,10 +1750,10 @@ mod tests {
         let mut ev = make_event("auth", "alice", 100, "ea0-event");
         ev.ea_id = 0;
         let id = ev.id.clone();
-        sched.insert(ev);
+        sched.insert(ev).unwrap();
 
         // Cancel with correct EA — should succeed
-        let result = sched.cancel_if_ea(&id, 0);
+        let result = sched.cancel_if_ea(&id, 0).unwrap();
         assert!(result.is_ok());
         assert_eq!(result.unwrap().payload, "ea0-event");
         assert_eq!(sched.list_by_ea(0).len(), 0);
@@ -1326,10 +1765,10 @@ mod tests {
         let mut ev = make_event("auth", "alice", 100, "ea0-event");
         ev.ea_id = 0;
         let id = ev.id.clone();
-        sched.insert(ev);
+        sched.insert(ev).unwrap();
 
         // Cancel with wrong EA — should fail and leave event in queue
-        let result = sched.cancel_if_ea(&id, 1);
+        let result = sched.cancel_if_ea(&id, 1).unwrap();
         assert!(result.is_err());
         assert!(result.unwrap_err()); // true = wrong EA (event exists but wrong owner)
                                       // Event must still be in the queue (atomic — no TOCTOU window)
@@ -1341,10 +1780,12 @@ mod tests {
     #[test]
     fn test_cancel_if_ea_not_found() {
         let sched = Scheduler::new();
-        sched.insert(make_event("bob", "alice", 100, "keep"));
+        sched
+            .insert(make_event("bob", "alice", 100, "keep"))
+            .unwrap();
 
         // Cancel nonexistent event
-        let result = sched.cancel_if_ea("no-such-id", 0);
+        let result = sched.cancel_if_ea("no-such-id", 0).unwrap();
         assert!(result.is_err());
         assert!(!result.unwrap_err()); // false = not found at all
         assert_eq!(sched.list_by_ea(0).len(), 1);
@@ -1748,6 +2189,26 @@ mod tests {
         assert!(!pane_input_should_restore(&input));
     }
 
+    #[test]
+    fn prompt_scan_strips_escapes_and_borrows_contiguous_input() {
+        let plain = scan_prompt_input(" \x1b[0m hello world \x1b[0m ");
+        assert!(matches!(plain, Cow::Borrowed("hello world")));
+
+        let highlighted = scan_prompt_input("\x1b[1mhello\x1b[0m \x1b[32mworld\x1b[0m");
+        assert!(matches!(&highlighted, Cow::Owned(s) if s == "hello world"));
+
+        // Only the style at the first visible character matters.
+        assert_eq!(
+            scan_prompt_input("\x1b[7m \x1b[0mdraft \x1b[2mtail"),
+            "draft tail"
+        );
+        assert_eq!(scan_prompt_input("\x1b[38;5;240mghost text"), "");
+        assert_eq!(scan_prompt_input("\x1b[38;5;12mtyped"), "typed");
+        assert_eq!(scan_prompt_input("\x1b[7mselected"), "");
+        assert_eq!(scan_prompt_input("typed \x1b[2"), "typed");
+        assert_eq!(scan_prompt_input("  \x1b[0m  "), "");
+    }
+
     #[test]
     fn shell_fallback_ignores_agent_status_line() {
         let input = r#"
@@ -1893,7 +2354,7 @@ mod tests {
             for i in 0..3 {
                 let mut ev = make_event("popup-target", "sender", due_ts, &format!("batch-{}", i));
                 ev.ea_id = 5;
-                scheduler.insert(ev);
+                scheduler.insert(ev).unwrap();
             }
 
             let loop_handle = tokio::spawn(run_event_loop(
@@ -1901,6 +2362,7 @@ mod tests {
                 ticker.clone(),
                 popup_receiver.clone(),
                 "omar-agent-".to_string(),
+                DEFAULT_DELIVERY_CONCURRENCY,
             ));
             tokio::time::sleep(std::time::Duration::from_millis(200)).await;
             loop_handle.abort();
@@ -1941,13 +2403,14 @@ mod tests {
             "hi",
         );
         ev.ea_id = 42;
-        scheduler.insert(ev);
+        scheduler.insert(ev).unwrap();
 
         let loop_handle = tokio::spawn(run_event_loop(
             scheduler.clone(),
             ticker.clone(),
             popup_receiver.clone(),
             "omar-agent-".to_string(),
+            DEFAULT_DELIVERY_CONCURRENCY,
         ));
         tokio::time::sleep(std::time::Duration::from_millis(200)).await;
         loop_handle.abort();
@@ -1990,13 +2453,14 @@ mod tests {
             "hi",
         );
         ev.ea_id = 1;
-        scheduler.insert(ev);
+        scheduler.insert(ev).unwrap();
 
         let loop_handle = tokio::spawn(run_event_loop(
             scheduler.clone(),
             ticker.clone(),
             popup_receiver.clone(),
             "omar-agent-".to_string(),
+            DEFAULT_DELIVERY_CONCURRENCY,
         ));
 
         // Run the loop for long enough to see multiple defer decisions.
@@ -2030,6 +2494,155 @@ mod tests {
         );
     }
 
+    #[test]
+    fn popup_claim_stays_queued_until_settled() {
+        let scheduler = Scheduler::new();
+        let popup = new_popup_receiver();
+        *popup.lock().unwrap() = Some(("alice".to_string(), 0));
+        let due = now_ns().saturating_sub(1_000_000);
+        let claim_one = |scheduler: &Scheduler| {
+            let (deliveries, mut claims) = scheduler.claim_due(&popup);
+            assert!(deliveries.is_empty());
+            assert_eq!(claims.len(), 1);
+            claims.pop().unwrap()
+        };
+
+        // Unreadable pane: the claimed event is pushed out, not lost.
+        let ev = make_event("alice", "sender", due, "one");
+        scheduler.insert(ev.clone()).unwrap();
+        let claim = claim_one(&scheduler);
+        assert_eq!(scheduler.list_by_ea(0).len(), 1, "a claim stays queued");
+        let deferred = scheduler.settle_claim(claim, None).unwrap();
+        assert!(deferred.deferred_for_popup);
+        let queued = scheduler.list_by_ea(0);
+        assert_eq!(queued.len(), 1);
+        assert!(queued[0].timestamp > now_ns() + POPUP_DEFER_NS / 2);
+        scheduler.cancel_if_ea(&ev.id, 0).unwrap().unwrap();
+
+        // Cancelled while the draft was being read: nothing to deliver.
+        let ev = make_event("alice", "sender", due, "two");
+        scheduler.insert(ev.clone()).unwrap();
+        let claim = claim_one(&scheduler);
+        scheduler.cancel_if_ea(&ev.id, 0).unwrap().unwrap();
+        assert!(scheduler
+            .settle_claim(claim, Some("a long draft".to_string()))
+            .is_none());
+
+        // Readable pane: fired, with the draft kept for restore.
+        scheduler
+            .insert(make_event("alice", "sender", due, "three"))
+            .unwrap();
+        let claim = claim_one(&scheduler);
+        let delivery = scheduler
+            .settle_claim(claim, Some("a long draft".to_string()))
+            .unwrap();
+        assert!(!delivery.deferred_for_popup);
+        assert_eq!(delivery.batch.len(), 1);
+        assert_eq!(delivery.restore_input.as_deref(), Some("a long draft"));
+        assert!(scheduler.list_by_ea(0).is_empty());
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 2)]
+    async fn popup_claim_waits_for_earlier_delivery_to_the_same_pane() {
+        // Two back-to-back events for the popup pane: the first is being
+        // delivered when the second falls due. Capturing the "draft" now
+        // would read the in-flight prompt and `C-u` would wipe it, so the
+        // second claim must be pushed back without touching the pane.
+        let scheduler = Scheduler::new();
+        let popup = new_popup_receiver();
+        *popup.lock().unwrap() = Some(("alice".to_string(), 0));
+        let release = Arc::new(std::sync::Barrier::new(2));
+        let gate = release.clone();
+        let pipeline = DeliveryPipeline::new(
+            4,
+            Arc::new(DeliveryStats::default()),
+            TickerBuffer::new(),
+            move |_| {
+                gate.wait();
+            },
+        );
+        pipeline.submit(DeliveryJob {
+            receiver: "alice".to_string(),
+            ea_id: 0,
+            timestamp: now_ns(),
+            event_count: 1,
+            message: "first".to_string(),
+            restore_input: None,
+        });
+
+        let ev = make_event(
+            "alice",
+            "sender",
+            now_ns().saturating_sub(1_000_000),
+            "second",
+        );
+        scheduler.insert(ev.clone()).unwrap();
+        let checked_lane = std::sync::atomic::AtomicBool::new(false);
+        let deliveries = scheduler.take_due_deliveries(&popup, "omar-agent-", |r, e| {
+            checked_lane.store(true, std::sync::atomic::Ordering::SeqCst);
+            pipeline.is_busy(r, e)
+        });
+        assert!(checked_lane.load(std::sync::atomic::Ordering::SeqCst));
+        assert_eq!(deliveries.len(), 1);
+        assert!(deliveries[0].deferred_for_popup);
+        assert!(deliveries[0].batch.is_empty());
+        let queued = scheduler.list_by_ea(0);
+        assert_eq!(queued.len(), 1, "the second event stays queued");
+        assert_eq!(queued[0].id, ev.id);
+        assert!(queued[0].timestamp > now_ns());
+        assert!(queued[0].timestamp <= now_ns() + BUSY_LANE_DEFER_NS);
+
+        // Once the first delivery finishes the lane is free again.
+        release.wait();
+        for _ in 0..200 {
+            if !pipeline.is_busy("alice", 0) {
+                break;
+            }
+            tokio::time::sleep(std::time::Duration::from_millis(5)).await;
+        }
+        assert!(!pipeline.is_busy("alice", 0));
+    }
+
+    #[test]
+    fn recurring_events_coalesce_per_receiver_and_rearm_in_place() {
+        let scheduler = Scheduler::new();
+        let slot_start = (wheel::tick_of(now_ns()) - 1) * wheel::SLOT_NS;
+        let interval = 30_000_000_000;
+        let mut ids = Vec::new();
+        for (offset, receiver) in [(100, "alice"), (200_000_000, "alice"), (300, "bob")] {
+            let mut ev = make_event(receiver, "cron", slot_start + offset, "heartbeat");
+            ev.recurring_ns = Some(interval);
+            ids.push(ev.id.clone());
+            scheduler.insert(ev).unwrap();
+        }
+
+        let popup = new_popup_receiver();
+        let deliveries = scheduler.take_due_deliveries(&popup, "omar-agent-", |_, _| false);
+        let sizes: Vec<(&str, usize)> = deliveries
+            .iter()
+            .map(|d| (d.receiver.as_str(), d.batch.len()))
+            .collect();
+        assert_eq!(sizes, vec![("alice", 2), ("bob", 1)]);
+
+        // Same ids, moved one interval on from their scheduled time.
+        let events = scheduler.list_by_ea(0);
+        let mut queued_ids: Vec<String> = events.iter().map(|e| e.id.clone()).collect();
+        queued_ids.sort();
+        ids.sort();
+        assert_eq!(queued_ids, ids);
+        assert!(events
+            .iter()
+            .all(|e| e.timestamp > now_ns() && e.timestamp <= slot_start + 200_000_000 + interval));
+        assert!(scheduler
+            .take_due_deliveries(&popup, "omar-agent-", |_, _| false)
+            .is_empty());
+
+        let stats = scheduler.cron_stats();
+        assert_eq!(stats.fires, 3);
+        assert_eq!(stats.coalesced, 1);
+        assert!(stats.max_late_ns > 0 && stats.mean_drift_ms() > 0.0);
+    }
+
     #[test]
     fn test_persistent_scheduler_roundtrip() {
         let dir = tempfile::tempdir().unwrap();
@@ -2038,7 +2651,7 @@ mod tests {
 
         let mut ev = make_event("alice", "manager", 100, "persist me");
         ev.ea_id = 7;
-        sched.insert(ev);
+        sched.insert(ev).unwrap();
 
         let reloaded = Scheduler::with_store(store_path);
         let events = reloaded.list_by_ea(7);
@@ -2059,7 +2672,7 @@ mod tests {
         let sched = Scheduler::with_store(store_path);
         let mut ev = make_event("alice", "manager", 100, "persist after stale lock");
         ev.ea_id = 7;
-        sched.insert(ev);
+        sched.insert(ev).unwrap();
 
         assert!(
             !lock_path.exists(),
@@ -2067,4 +2680,113 @@ mod tests {
         );
         assert_eq!(sched.list_by_ea(7).len(), 1);
     }
+
+    #[cfg(unix)]
+    #[test]
+    fn shared_write_fails_when_store_lock_is_held() {
+        let dir = tempfile::tempdir().unwrap();
+        let store_path = events_store_path(dir.path());
+        let sched = Scheduler::with_store(store_path.clone());
+        // A live holder (this process) that never answers over IPC.
+        let _held = StoreLock::acquire(store_lock_path(&store_path)).unwrap();
+
+        assert!(sched
+            .insert(make_event("alice", "manager", 100, "lost"))
+            .is_err());
+        assert!(sched.cancel_by_ea(0).is_err());
+        assert!(
+            sched.list_by_ea(0).is_empty(),
+            "reads fall back to the cache"
+        );
+    }
+
+    #[test]
+    fn owned_store_journals_instead_of_rewriting_snapshot() {
+        let dir = tempfile::tempdir().unwrap();
+        let store_path = events_store_path(dir.path());
+        let owner = Scheduler::own_store(store_path.clone());
+        assert!(matches!(owner.store, Store::Owner(_)));
+        assert!(!owner.polls_store());
+
+        let mut keep = make_event("alice", "manager", 100, "keep");
+        keep.ea_id = 3;
+        let mut drop_me = make_event("bob", "manager", 200, "drop");
+        drop_me.ea_id = 3;
+        let drop_id = drop_me.id.clone();
+        owner.insert(keep).unwrap();
+        owner.insert(drop_me).unwrap();
+        assert!(owner.cancel_if_ea(&drop_id, 3).unwrap().is_ok());
+
+        // The snapshot is untouched; the journal carries the changes.
+        assert_eq!(std::fs::read_to_string(&store_path).unwrap().trim(), "[]");
+        assert_eq!(journal::read(&store_path).lines().count(), 3);
+        let replayed = load_events_from_store(&store_path);
+        assert_eq!(replayed.len(), 1);
+        assert_eq!(replayed[0].payload, "keep");
+
+        drop(owner);
+        assert!(!ipc::socket_path(&store_path).exists());
+        assert!(!store_lock_path(&store_path).exists());
+
+        // A new owner folds the journal into the snapshot on startup.
+        let owner = Scheduler::own_store(store_path.clone());
+        assert_eq!(owner.list_by_ea(3).len(), 1);
+        assert!(journal::read(&store_path).is_empty());
+        assert!(std::fs::read_to_string(&store_path)
+            .unwrap()
+            .contains("keep"));
+    }
+
+    #[test]
+    fn shared_store_forwards_to_live_owner() {
+        let dir = tempfile::tempdir().unwrap();
+        let store_path = events_store_path(dir.path());
+        let owner = Scheduler::own_store(store_path.clone());
+        let client = Scheduler::with_store(store_path.clone());
+        assert!(client.remote_owner_live());
+        assert_eq!(client.next_timestamp(), None, "only the owner delivers");
+
+        let mut ev = make_event("alice", "manager", 100, "via ipc");
+        ev.ea_id = 4;
+        let id = ev.id.clone();
+        client.insert(ev).unwrap();
+        assert_eq!(owner.list_by_ea(4).len(), 1);
+        assert_eq!(client.list_by_ea(4)[0].payload, "via ipc");
+        assert_eq!(client.cancel_if_ea(&id, 9).unwrap(), Err(true));
+        assert_eq!(client.cancel_by_receiver_and_ea("alice", 4).unwrap(), 1);
+        assert!(owner.list_by_ea(4).is_empty());
+
+        let batch: Vec<ScheduledEvent> = (0..3)
+            .map(|i| {
+                let mut ev = make_event("bob", "manager", 200 + i, "batched");
+                ev.ea_id = 4;
+                ev
+            })
+            .collect();
+        client.insert_many(batch).unwrap();
+        assert_eq!(owner.list_by_ea(4).len(), 3);
+        assert_eq!(client.cancel_by_receiver_and_ea("bob", 4).unwrap(), 3);
+
+        // A client that connects and never sends a request does not hold
+        // up the others.
+        let stalled =
+            std::os::unix::net::UnixStream::connect(ipc::socket_path(&store_path)).unwrap();
+        let started = std::time::Instant::now();
+        assert_eq!(client.cancel_by_ea(4).unwrap(), 0);
+        assert!(started.elapsed() < std::time::Duration::from_secs(2));
+        // Closing it ends its handler, which holds the owner meanwhile.
+        drop(stalled);
+
+        // "Second dashboard" falls back to a forwarding shared handle.
+        let second = Scheduler::own_store(store_path);
+        assert!(second.polls_store());
+        // The listener thread holds the owner while it answers a connection
+        // (here, `own_store`'s probe), so the last reference may drop there.
+        drop(owner);
+        let deadline = std::time::Instant::now() + std::time::Duration::from_secs(2);
+        while second.remote_owner_live() && std::time::Instant::now() < deadline {
+            std::thread::sleep(std::time::Duration::from_millis(10));
+        }
+        assert!(!second.remote_owner_live());
+    }
 }
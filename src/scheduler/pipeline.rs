@@ -0,0 +1,244 @@
+//! Concurrent prompt delivery with per-receiver ordering.
+//!
+//! A single delivery can take seconds (paste, render confirmation, submit),
+//! so awaiting each one in the event loop serialises wake-ups for unrelated
+//! panes. The pipeline gives every `(receiver, ea_id)` pane its own FIFO
+//! lane drained by one task at a time, and bounds the number of deliveries
+//! running across all lanes with a semaphore. Two deliveries to the same
+//! pane therefore never overlap or reorder, while different panes proceed
+//! in parallel.
+
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+
+use tokio::sync::Semaphore;
+
+use super::TickerBuffer;
+
+/// Live delivery counters, shared with the dashboard's event queue panel.
+#[derive(Debug, Default)]
+pub struct DeliveryStats {
+    queued: AtomicUsize,
+    in_flight: AtomicUsize,
+}
+
+impl DeliveryStats {
+    /// Deliveries waiting for their lane or a concurrency permit.
+    pub fn queued(&self) -> usize {
+        self.queued.load(Ordering::Relaxed)
+    }
+
+    /// Deliveries currently talking to tmux.
+    pub fn in_flight(&self) -> usize {
+        self.in_flight.load(Ordering::Relaxed)
+    }
+}
+
+/// One formatted delivery for a single pane.
+pub(crate) struct DeliveryJob {
+    pub receiver: String,
+    pub ea_id: u32,
+    /// Scheduled timestamp of the batch, used for the lag report.
+    pub timestamp: u64,
+    pub event_count: usize,
+    pub message: String,
+    pub restore_input: Option<String>,
+}
+
+type DeliverFn = dyn Fn(&DeliveryJob) + Send + Sync;
+type LaneKey = (String, u32);
+
+#[derive(Clone)]
+pub(crate) struct DeliveryPipeline {
+    /// Pending jobs per pane. A key is present exactly while a drain task
+    /// owns that lane, so `submit` knows whether to start one.
+    lanes: Arc<Mutex<HashMap<LaneKey, VecDeque<DeliveryJob>>>>,
+    permits: Arc<Semaphore>,
+    stats: Arc<DeliveryStats>,
+    ticker: TickerBuffer,
+    deliver: Arc<DeliverFn>,
+}
+
+impl DeliveryPipeline {
+    /// `deliver` runs on the blocking pool; `concurrency` is clamped to at
+    /// least one.
+    pub fn new(
+        concurrency: usize,
+        stats: Arc<DeliveryStats>,
+        ticker: TickerBuffer,
+        deliver: impl Fn(&DeliveryJob) + Send + Sync + 'static,
+    ) -> Self {
+        Self {
+            lanes: Arc::new(Mutex::new(HashMap::new())),
+            permits: Arc::new(Semaphore::new(concurrency.max(1))),
+            stats,
+            ticker,
+            deliver: Arc::new(deliver),
+        }
+    }
+
+    /// Queue `job` behind any earlier deliveries to the same pane. Returns
+    /// immediately; must be called from within a Tokio runtime.
+    pub fn submit(&self, job: DeliveryJob) {
+        let key = (job.receiver.clone(), job.ea_id);
+        self.stats.queued.fetch_add(1, Ordering::Relaxed);
+        let mut lanes = self.lanes.lock().unwrap();
+        if let Some(lane) = lanes.get_mut(&key) {
+            lane.push_back(job);
+            return;
+        }
+        lanes.insert(key.clone(), VecDeque::from([job]));
+        drop(lanes);
+        tokio::spawn(self.clone().drain(key));
+    }
+
+    /// True while a delivery to `(receiver, ea_id)` is queued or running.
+    pub fn is_busy(&self, receiver: &str, ea_id: u32) -> bool {
+        self.lanes
+            .lock()
+            .unwrap()
+            .contains_key(&(receiver.to_string(), ea_id))
+    }
+
+    async fn drain(self, key: LaneKey) {
+        loop {
+            // Take the permit before the job so `queued` keeps counting work
+            // that is only waiting on the concurrency bound.
+            let Ok(permit) = self.permits.clone().acquire_owned().await else {
+                return;
+            };
+            let job = {
+                let mut lanes = self.lanes.lock().unwrap();
+                match lanes.get_mut(&key).and_then(VecDeque::pop_front) {
+                    Some(job) => job,
+                    None => {
+                        lanes.remove(&key);
+                        return;
+                    }
+                }
+            };
+            self.stats.queued.fetch_sub(1, Ordering::Relaxed);
+            self.stats.in_flight.fetch_add(1, Ordering::Relaxed);
+
+            let deliver = self.deliver.clone();
+            let (receiver, ea_id, timestamp, event_count) = (
+                job.receiver.clone(),
+                job.ea_id,
+                job.timestamp,
+                job.event_count,
+            );
+            let result = tokio::task::spawn_blocking(move || deliver(&job)).await;
+
+            self.stats.in_flight.fetch_sub(1, Ordering::Relaxed);
+            drop(permit);
+
+            if let Err(e) = result {
+                self.ticker.push(format!(
+                    "delivery task failed for {} (ea {}): {}",
+                    receiver, ea_id, e
+                ));
+            }
+            let lag_ns = super::now_ns().saturating_sub(timestamp);
+            let lag_ms = lag_ns as f64 / 1_000_000.0;
+            self.ticker.push(format!(
+                "delivered {} event(s) to {}, lag={:.2}ms",
+                event_count, receiver, lag_ms
+            ));
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    fn job(receiver: &str, ea_id: u32, message: &str) -> DeliveryJob {
+        DeliveryJob {
+            receiver: receiver.to_string(),
+            ea_id,
+            timestamp: super::super::now_ns(),
+            event_count: 1,
+            message: message.to_string(),
+            restore_input: None,
+        }
+    }
+
+    async fn wait_idle(stats: &DeliveryStats) {
+        for _ in 0..500 {
+            if stats.queued() == 0 && stats.in_flight() == 0 {
+                return;
+            }
+            tokio::time::sleep(Duration::from_millis(5)).await;
+        }
+        panic!("pipeline did not drain");
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 2)]
+    async fn different_receivers_run_concurrently_within_bound() {
+        let stats = Arc::new(DeliveryStats::default());
+        let running = Arc::new(AtomicUsize::new(0));
+        let peak = Arc::new(AtomicUsize::new(0));
+        let (running_c, peak_c) = (running.clone(), peak.clone());
+        let pipeline = DeliveryPipeline::new(3, stats.clone(), TickerBuffer::new(), move |_| {
+            let now = running_c.fetch_add(1, Ordering::SeqCst) + 1;
+            peak_c.fetch_max(now, Ordering::SeqCst);
+            std::thread::sleep(Duration::from_millis(40));
+            running_c.fetch_sub(1, Ordering::SeqCst);
+        });
+
+        for i in 0..6 {
+            pipeline.submit(job(&format!("agent-{}", i), 0, "wake"));
+        }
+        assert_eq!(stats.queued() + stats.in_flight(), 6);
+        wait_idle(&stats).await;
+
+        assert_eq!(peak.load(Ordering::SeqCst), 3);
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 2)]
+    async fn same_receiver_is_delivered_in_order_without_overlap() {
+        let stats = Arc::new(DeliveryStats::default());
+        let seen = Arc::new(Mutex::new(Vec::new()));
+        let busy = Arc::new(Mutex::new(std::collections::HashSet::new()));
+        let overlapped = Arc::new(std::sync::atomic::AtomicBool::new(false));
+        let (seen_c, busy_c, overlapped_c) = (seen.clone(), busy.clone(), overlapped.clone());
+        let pipeline = DeliveryPipeline::new(4, stats.clone(), TickerBuffer::new(), move |job| {
+            let key = (job.receiver.clone(), job.ea_id);
+            if !busy_c.lock().unwrap().insert(key.clone()) {
+                overlapped_c.store(true, Ordering::SeqCst);
+            }
+            std::thread::sleep(Duration::from_millis(5));
+            seen_c
+                .lock()
+                .unwrap()
+                .push(format!("{}:{}", job.receiver, job.message));
+            busy_c.lock().unwrap().remove(&key);
+        });
+
+        for i in 0..5 {
+            pipeline.submit(job("a", 1, &i.to_string()));
+            pipeline.submit(job("b", 1, &i.to_string()));
+        }
+        // Same short name in another EA is a separate lane.
+        pipeline.submit(job("a", 2, "other-ea"));
+        wait_idle(&stats).await;
+
+        assert!(
+            !overlapped.load(Ordering::SeqCst),
+            "same-pane deliveries overlapped"
+        );
+        let seen = seen.lock().unwrap();
+        assert_eq!(seen.len(), 11);
+        for receiver in ["a", "b"] {
+            let order: Vec<&str> = seen
+                .iter()
+                .filter_map(|s| s.strip_prefix(&format!("{}:", receiver)))
+                .filter(|m| *m != "other-ea")
+                .collect();
+            assert_eq!(order, vec!["0", "1", "2", "3", "4"]);
+        }
+        assert!(pipeline.lanes.lock().unwrap().is_empty());
+    }
+}
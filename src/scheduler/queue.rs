@@ -0,0 +1,362 @@
+//! Indexed in-memory event queue.
+//!
+//! Events live in an id map, with a time-ordered set plus per-EA and
+//! per-`(receiver, ea_id)` id sets on the side. Cancel by id, per-EA and
+//! per-receiver queries, and pulling the earliest-due events then cost
+//! O(log n) or O(matches); a bare heap has to be drained and rebuilt for
+//! each of them.
+//!
+//! Recurring events are filed in a [`TimingWheel`] instead of the ordered
+//! set. They stay queued across fires and are re-armed in place.
+
+use std::collections::{BTreeSet, HashMap, HashSet};
+
+use super::wheel::{tick_of, TimingWheel};
+use super::ScheduledEvent;
+
+/// Position in delivery order: timestamp, then creation time (matching
+/// `ScheduledEvent`'s `Ord`), then id to keep keys unique.
+type TimeKey = (u64, u64, String);
+
+#[derive(Debug, Clone)]
+pub(crate) struct EventQueue {
+    events: HashMap<String, ScheduledEvent>,
+    /// One-shot events only.
+    by_time: BTreeSet<TimeKey>,
+    recurring: TimingWheel,
+    by_ea: HashMap<u32, HashSet<String>>,
+    by_receiver: HashMap<(String, u32), HashSet<String>>,
+}
+
+fn time_key(event: &ScheduledEvent) -> TimeKey {
+    (event.timestamp, event.created_at, event.id.clone())
+}
+
+impl Default for EventQueue {
+    fn default() -> Self {
+        Self {
+            events: HashMap::new(),
+            by_time: BTreeSet::new(),
+            recurring: TimingWheel::starting_at(tick_of(super::now_ns())),
+            by_ea: HashMap::new(),
+            by_receiver: HashMap::new(),
+        }
+    }
+}
+
+impl EventQueue {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn len(&self) -> usize {
+        self.events.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.events.is_empty()
+    }
+
+    /// Add `event`, replacing any queued event with the same id (a re-armed
+    /// or deferred event keeps its id).
+    pub fn push(&mut self, event: ScheduledEvent) {
+        self.remove(&event.id);
+        if event.recurring_ns.is_some() {
+            self.recurring
+                .insert(event.id.clone(), tick_of(event.timestamp));
+        } else {
+            self.by_time.insert(time_key(&event));
+        }
+        self.by_ea
+            .entry(event.ea_id)
+            .or_default()
+            .insert(event.id.clone());
+        self.by_receiver
+            .entry((event.receiver.clone(), event.ea_id))
+            .or_default()
+            .insert(event.id.clone());
+        self.events.insert(event.id.clone(), event);
+    }
+
+    pub fn get(&self, id: &str) -> Option<&ScheduledEvent> {
+        self.events.get(id)
+    }
+
+    pub fn remove(&mut self, id: &str) -> Option<ScheduledEvent> {
+        let event = self.events.remove(id)?;
+        if event.recurring_ns.is_some() {
+            self.recurring.remove(id);
+        } else {
+            self.by_time.remove(&time_key(&event));
+        }
+        if let Some(ids) = self.by_ea.get_mut(&event.ea_id) {
+            ids.remove(id);
+            if ids.is_empty() {
+                self.by_ea.remove(&event.ea_id);
+            }
+        }
+        let receiver_key = (event.receiver.clone(), event.ea_id);
+        if let Some(ids) = self.by_receiver.get_mut(&receiver_key) {
+            ids.remove(id);
+            if ids.is_empty() {
+                self.by_receiver.remove(&receiver_key);
+            }
+        }
+        Some(event)
+    }
+
+    /// Timestamp of the earliest event.
+    pub fn peek_timestamp(&self) -> Option<u64> {
+        let one_shot = self.by_time.first().map(|(timestamp, _, _)| *timestamp);
+        let recurring = self
+            .recurring
+            .earliest()
+            .iter()
+            .map(|id| self.events[id].timestamp)
+            .min();
+        one_shot.into_iter().chain(recurring).min()
+    }
+
+    /// All events in delivery order.
+    pub fn iter(&self) -> impl Iterator<Item = &ScheduledEvent> {
+        let mut events: Vec<&ScheduledEvent> = self.events.values().collect();
+        events.sort_by(|a, b| {
+            (a.timestamp, a.created_at, &a.id).cmp(&(b.timestamp, b.created_at, &b.id))
+        });
+        events.into_iter()
+    }
+
+    /// Remove and return every event, in delivery order.
+    pub fn drain(&mut self) -> std::vec::IntoIter<ScheduledEvent> {
+        let mut events: Vec<ScheduledEvent> =
+            std::mem::take(&mut self.events).into_values().collect();
+        events.sort_by_key(time_key);
+        *self = Self::new();
+        events.into_iter()
+    }
+
+    /// Recurring events whose wheel slot is due at `now`, in delivery order.
+    /// They stay queued; the caller re-arms each one it fires or defers, and
+    /// anything left alone is simply due again on the next call. Slot
+    /// granularity means an event may come out up to one slot early, so
+    /// heartbeats to one receiver in the same second share a delivery.
+    pub fn due_recurring(&mut self, now: u64) -> Vec<ScheduledEvent> {
+        let ids = self.recurring.advance(tick_of(now));
+        let mut due = Vec::with_capacity(ids.len());
+        for id in ids {
+            let event = &self.events[&id];
+            due.push(event.clone());
+            self.recurring.insert(id, tick_of(event.timestamp));
+        }
+        due.sort_by_key(time_key);
+        due
+    }
+
+    /// Move a queued recurring event to `timestamp`, keeping its id and
+    /// indexes. Returns false if `id` is not a queued recurring event.
+    pub fn rearm(&mut self, id: &str, timestamp: u64) -> bool {
+        match self.events.get_mut(id) {
+            Some(event) if event.recurring_ns.is_some() => {
+                event.timestamp = timestamp;
+                self.recurring.insert(id.to_string(), tick_of(timestamp));
+                true
+            }
+            _ => false,
+        }
+    }
+
+    /// Remove and return all one-shot events scheduled exactly at
+    /// `timestamp`, in delivery order.
+    pub fn take_at(&mut self, timestamp: u64) -> Vec<ScheduledEvent> {
+        let ids: Vec<String> = self
+            .by_time
+            .range((timestamp, 0, String::new())..)
+            .take_while(|(ts, _, _)| *ts == timestamp)
+            .map(|(_, _, id)| id.clone())
+            .collect();
+        ids.iter().filter_map(|id| self.remove(id)).collect()
+    }
+
+    /// Events owned by `ea_id`, in delivery order.
+    pub fn list_by_ea(&self, ea_id: u32) -> Vec<ScheduledEvent> {
+        let ids = self.by_ea.get(&ea_id);
+        self.collect_sorted(ids.into_iter().flatten())
+    }
+
+    pub fn remove_by_ea(&mut self, ea_id: u32) -> Vec<ScheduledEvent> {
+        let ids: Vec<String> = self
+            .by_ea
+            .get(&ea_id)
+            .map(|ids| ids.iter().cloned().collect())
+            .unwrap_or_default();
+        self.remove_all(ids)
+    }
+
+    /// Events addressed to `receiver` within `ea_id`, in delivery order.
+    pub fn list_by_receiver(&self, receiver: &str, ea_id: u32) -> Vec<ScheduledEvent> {
+        let ids = self.by_receiver.get(&(receiver.to_string(), ea_id));
+        self.collect_sorted(ids.into_iter().flatten())
+    }
+
+    pub fn remove_by_receiver(&mut self, receiver: &str, ea_id: u32) -> Vec<ScheduledEvent> {
+        let ids: Vec<String> = self
+            .by_receiver
+            .get(&(receiver.to_string(), ea_id))
+            .map(|ids| ids.iter().cloned().collect())
+            .unwrap_or_default();
+        self.remove_all(ids)
+    }
+
+    fn collect_sorted<'a>(&self, ids: impl Iterator<Item = &'a String>) -> Vec<ScheduledEvent> {
+        let mut events: Vec<ScheduledEvent> =
+            ids.filter_map(|id| self.events.get(id)).cloned().collect();
+        events.sort_by_key(time_key);
+        events
+    }
+
+    fn remove_all(&mut self, ids: Vec<String>) -> Vec<ScheduledEvent> {
+        let mut removed: Vec<ScheduledEvent> =
+            ids.iter().filter_map(|id| self.remove(id)).collect();
+        removed.sort_by_key(time_key);
+        removed
+    }
+}
+
+impl FromIterator<ScheduledEvent> for EventQueue {
+    fn from_iter<I: IntoIterator<Item = ScheduledEvent>>(iter: I) -> Self {
+        let mut queue = Self::new();
+        for event in iter {
+            queue.push(event);
+        }
+        queue
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn event(
+        id: &str,
+        receiver: &str,
+        ea_id: u32,
+        timestamp: u64,
+        created_at: u64,
+    ) -> ScheduledEvent {
+        ScheduledEvent {
+            id: id.to_string(),
+            sender: "s".to_string(),
+            receiver: receiver.to_string(),
+            timestamp,
+            payload: String::new(),
+            created_at,
+            recurring_ns: None,
+            ea_id,
+        }
+    }
+
+    fn ids(events: &[ScheduledEvent]) -> Vec<&str> {
+        events.iter().map(|e| e.id.as_str()).collect()
+    }
+
+    #[test]
+    fn orders_by_timestamp_then_created_at() {
+        let queue: EventQueue = [
+            event("c", "r", 0, 300, 0),
+            event("b2", "r", 0, 100, 20),
+            event("b1", "r", 0, 100, 10),
+        ]
+        .into_iter()
+        .collect();
+        assert_eq!(queue.peek_timestamp(), Some(100));
+        let order: Vec<&str> = queue.iter().map(|e| e.id.as_str()).collect();
+        assert_eq!(order, vec!["b1", "b2", "c"]);
+    }
+
+    #[test]
+    fn push_with_existing_id_replaces_and_reindexes() {
+        let mut queue = EventQueue::new();
+        queue.push(event("x", "alice", 1, 100, 0));
+        queue.push(event("x", "bob", 2, 50, 0));
+        assert_eq!(queue.len(), 1);
+        assert!(queue.list_by_ea(1).is_empty());
+        assert!(queue.list_by_receiver("alice", 1).is_empty());
+        assert_eq!(ids(&queue.list_by_receiver("bob", 2)), vec!["x"]);
+        assert_eq!(queue.peek_timestamp(), Some(50));
+    }
+
+    #[test]
+    fn indexed_removal_keeps_other_indexes_consistent() {
+        let mut queue: EventQueue = [
+            event("a1", "alice", 1, 10, 0),
+            event("a2", "alice", 1, 20, 0),
+            event("b1", "bob", 1, 15, 0),
+            event("a3", "alice", 2, 5, 0),
+        ]
+        .into_iter()
+        .collect();
+
+        assert_eq!(ids(&queue.remove_by_receiver("alice", 1)), vec!["a1", "a2"]);
+        assert_eq!(ids(&queue.list_by_ea(1)), vec!["b1"]);
+        assert_eq!(queue.remove("a3").unwrap().ea_id, 2);
+        assert!(queue.list_by_ea(2).is_empty());
+        assert_eq!(ids(&queue.remove_by_ea(1)), vec!["b1"]);
+        assert!(queue.is_empty());
+        assert!(queue.by_ea.is_empty() && queue.by_receiver.is_empty());
+        assert_eq!(queue.peek_timestamp(), None);
+    }
+
+    #[test]
+    fn take_at_pulls_only_the_given_timestamp() {
+        let mut queue: EventQueue = [
+            event("late", "r", 0, 200, 0),
+            event("due2", "r", 0, 100, 2),
+            event("due1", "q", 0, 100, 1),
+            event("early", "r", 0, 50, 0),
+        ]
+        .into_iter()
+        .collect();
+        assert_eq!(ids(&queue.take_at(100)), vec!["due1", "due2"]);
+        let rest: Vec<&str> = queue.iter().map(|e| e.id.as_str()).collect();
+        assert_eq!(rest, vec!["early", "late"]);
+        assert_eq!(
+            ids(&queue.drain().collect::<Vec<_>>()),
+            vec!["early", "late"]
+        );
+        assert!(queue.is_empty());
+    }
+
+    #[test]
+    fn recurring_events_rearm_in_place() {
+        let now = super::super::now_ns();
+        let mut cron = event("cron", "alice", 1, now - 1, 0);
+        cron.recurring_ns = Some(30_000_000_000);
+        let mut queue: EventQueue = [cron, event("once", "alice", 1, now + 60_000_000_000, 0)]
+            .into_iter()
+            .collect();
+
+        assert_eq!(queue.peek_timestamp(), Some(now - 1));
+        assert!(
+            queue.take_at(now - 1).is_empty(),
+            "take_at is one-shot only"
+        );
+        let due = queue.due_recurring(now);
+        assert_eq!(ids(&due), vec!["cron"]);
+        // Not re-armed yet: still queued and still due.
+        assert_eq!(queue.len(), 2);
+        assert_eq!(ids(&queue.due_recurring(now)), vec!["cron"]);
+
+        assert!(queue.rearm("cron", now + 30_000_000_000));
+        assert!(!queue.rearm("once", now));
+        assert!(queue.due_recurring(now).is_empty());
+        assert_eq!(queue.get("cron").unwrap().timestamp, now + 30_000_000_000);
+        assert_eq!(
+            ids(&queue.list_by_receiver("alice", 1)),
+            vec!["cron", "once"]
+        );
+
+        assert!(queue.remove("cron").is_some());
+        assert_eq!(queue.peek_timestamp(), Some(now + 60_000_000_000));
+        assert_eq!(queue.recurring.len(), 0);
+    }
+}
@@ -0,0 +1,286 @@
+//! Hierarchical timing wheel for recurring events.
+//!
+//! Heartbeat crons fire every 30s–5min per agent, so the recurring set is
+//! large and constantly re-armed. The wheel files each event id under a
+//! one-second tick: level 0 holds the 64 ticks of the current 64-tick block,
+//! level 1 the 64 blocks of the current 4096-tick block, and so on, with an
+//! overflow list past the top level. An entry's level is the highest 6-bit
+//! group in which its tick differs from the wheel's current tick, so
+//! inserting or re-arming is O(1), and advancing only re-files the levels
+//! whose enclosing block changed.
+//!
+//! Ticks are whole slots: every entry in a due slot is returned together,
+//! which lets the scheduler coalesce heartbeats to one receiver that fall
+//! in the same second into a single delivery.
+
+use std::collections::HashMap;
+
+/// Width of one wheel slot.
+pub(crate) const SLOT_NS: u64 = 1_000_000_000;
+
+const LEVEL_BITS: u32 = 6;
+const SLOTS: usize = 1 << LEVEL_BITS;
+const LEVELS: usize = 4;
+
+pub(crate) fn tick_of(timestamp_ns: u64) -> u64 {
+    timestamp_ns / SLOT_NS
+}
+
+#[derive(Debug, Clone)]
+pub(crate) struct TimingWheel {
+    now: u64,
+    levels: Vec<Vec<Vec<String>>>,
+    overflow: Vec<String>,
+    /// Placed tick per id (clamped to `now` for overdue entries), used to
+    /// find an entry without searching.
+    ticks: HashMap<String, u64>,
+}
+
+impl Default for TimingWheel {
+    fn default() -> Self {
+        Self::starting_at(0)
+    }
+}
+
+/// (level, slot) for `tick` relative to `now`, or `None` for the overflow.
+fn location(now: u64, tick: u64) -> Option<(usize, usize)> {
+    let differing = now ^ tick;
+    let level = if differing == 0 {
+        0
+    } else {
+        ((63 - differing.leading_zeros()) / LEVEL_BITS) as usize
+    };
+    (level < LEVELS).then(|| {
+        let slot = (tick >> (LEVEL_BITS * level as u32)) as usize & (SLOTS - 1);
+        (level, slot)
+    })
+}
+
+impl TimingWheel {
+    /// An empty wheel whose current tick is `now`. Starting near the real
+    /// clock keeps fresh entries out of the overflow list.
+    pub fn starting_at(now: u64) -> Self {
+        Self {
+            now,
+            levels: vec![vec![Vec::new(); SLOTS]; LEVELS],
+            overflow: Vec::new(),
+            ticks: HashMap::new(),
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.ticks.len()
+    }
+
+    pub fn insert(&mut self, id: String, tick: u64) {
+        self.remove(&id);
+        let tick = tick.max(self.now);
+        self.ticks.insert(id.clone(), tick);
+        self.file(id, tick);
+    }
+
+    fn file(&mut self, id: String, tick: u64) {
+        match location(self.now, tick) {
+            Some((level, slot)) => self.levels[level][slot].push(id),
+            None => self.overflow.push(id),
+        }
+    }
+
+    pub fn remove(&mut self, id: &str) -> bool {
+        let Some(tick) = self.ticks.remove(id) else {
+            return false;
+        };
+        let bucket = match location(self.now, tick) {
+            Some((level, slot)) => &mut self.levels[level][slot],
+            None => &mut self.overflow,
+        };
+        if let Some(pos) = bucket.iter().position(|entry| entry == id) {
+            bucket.swap_remove(pos);
+        }
+        true
+    }
+
+    /// Ids in the earliest non-empty slot. Every id in a level-0 slot shares
+    /// one tick; a higher-level slot spans several, but all of them precede
+    /// any later slot.
+    pub fn earliest(&self) -> &[String] {
+        for (level, slots) in self.levels.iter().enumerate() {
+            let start = (self.now >> (LEVEL_BITS * level as u32)) as usize & (SLOTS - 1);
+            if let Some(bucket) = slots[start..].iter().find(|bucket| !bucket.is_empty()) {
+                return bucket;
+            }
+        }
+        &self.overflow
+    }
+
+    /// Move the wheel to `now` and return every id whose tick is at or
+    /// before it. Returned ids are no longer in the wheel.
+    pub fn advance(&mut self, now: u64) -> Vec<String> {
+        if now < self.now {
+            return Vec::new();
+        }
+        let changed = self.now ^ now;
+        // Highest level whose enclosing block changed; entries at or below it
+        // must be re-filed (or are due). Higher levels are unaffected.
+        let top = if changed >> LEVEL_BITS == 0 {
+            None
+        } else {
+            Some(((63 - changed.leading_zeros()) / LEVEL_BITS) as usize)
+        };
+
+        let mut candidates = Vec::new();
+        match top {
+            None => {
+                // Same 64-tick block: only level-0 slots up to `now` can be due.
+                let from = self.now as usize & (SLOTS - 1);
+                let to = now as usize & (SLOTS - 1);
+                for bucket in &mut self.levels[0][from..=to] {
+                    candidates.append(bucket);
+                }
+            }
+            Some(top) => {
+                for slots in self.levels.iter_mut().take(top.min(LEVELS - 1) + 1) {
+                    for bucket in slots.iter_mut() {
+                        candidates.append(bucket);
+                    }
+                }
+                if top >= LEVELS - 1 {
+                    candidates.append(&mut self.overflow);
+                }
+            }
+        }
+
+        self.now = now;
+        let mut due = Vec::new();
+        for id in candidates {
+            let tick = self.ticks[&id];
+            if tick <= now {
+                self.ticks.remove(&id);
+                due.push(id);
+            } else {
+                self.file(id, tick);
+            }
+        }
+        due
+    }
+}
+
+/// Recurring-event fire statistics, reported in the event queue popup.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct CronStats {
+    pub fires: u64,
+    /// Recurring events that shared a delivery with another recurring event
+    /// for the same receiver instead of getting their own.
+    pub coalesced: u64,
+    /// Sum of `fired_at - scheduled` over all fires; negative when slot
+    /// coalescing fired an event slightly early.
+    pub total_drift_ns: i128,
+    pub max_late_ns: u64,
+    pub max_early_ns: u64,
+}
+
+impl CronStats {
+    pub fn record_fire(&mut self, scheduled: u64, fired_at: u64) {
+        self.fires += 1;
+        self.total_drift_ns += fired_at as i128 - scheduled as i128;
+        if fired_at >= scheduled {
+            self.max_late_ns = self.max_late_ns.max(fired_at - scheduled);
+        } else {
+            self.max_early_ns = self.max_early_ns.max(scheduled - fired_at);
+        }
+    }
+
+    pub fn mean_drift_ms(&self) -> f64 {
+        if self.fires == 0 {
+            return 0.0;
+        }
+        self.total_drift_ns as f64 / self.fires as f64 / 1_000_000.0
+    }
+}
+
+/// Next fire time for a recurring event scheduled at `scheduled`. Fixed-rate
+/// so late fires don't push every later one back, but missed periods (e.g.
+/// the machine slept) are skipped rather than replayed in a burst.
+pub(crate) fn next_fire(scheduled: u64, interval: u64, now: u64) -> u64 {
+    let next = scheduled.saturating_add(interval);
+    if next > now {
+        next
+    } else {
+        now.saturating_add(interval)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sorted(mut ids: Vec<String>) -> Vec<String> {
+        ids.sort();
+        ids
+    }
+
+    #[test]
+    fn entries_fire_at_their_tick_across_levels() {
+        let mut wheel = TimingWheel::default();
+        let ticks = [1u64, 63, 64, 65, 4095, 4096, 300_000, 20_000_000];
+        for tick in ticks {
+            wheel.insert(format!("t{}", tick), tick);
+        }
+
+        for target in ticks {
+            assert!(
+                wheel.advance(target - 1).is_empty(),
+                "nothing fires before tick {}",
+                target
+            );
+            assert_eq!(wheel.advance(target), vec![format!("t{}", target)]);
+        }
+        assert_eq!(wheel.len(), 0);
+    }
+
+    #[test]
+    fn large_jump_returns_everything_overdue() {
+        let mut wheel = TimingWheel::default();
+        wheel.insert("a".into(), 10);
+        wheel.insert("b".into(), 5_000);
+        wheel.insert("c".into(), 9_000_000);
+        assert_eq!(sorted(wheel.advance(6_000)), vec!["a", "b"]);
+        assert_eq!(wheel.earliest(), &["c".to_string()]);
+        assert!(wheel.advance(8_999_999).is_empty());
+        assert_eq!(wheel.advance(9_000_000), vec!["c"]);
+    }
+
+    #[test]
+    fn same_slot_entries_come_out_together_and_remove_works() {
+        let mut wheel = TimingWheel::default();
+        wheel.advance(1_000);
+        wheel.insert("x".into(), 1_030);
+        wheel.insert("y".into(), 1_030);
+        wheel.insert("z".into(), 1_200);
+        assert_eq!(sorted(wheel.earliest().to_vec()), vec!["x", "y"]);
+        assert!(wheel.remove("x"));
+        assert!(!wheel.remove("x"));
+        // Overdue inserts are clamped to the current tick.
+        wheel.insert("late".into(), 10);
+        assert_eq!(wheel.earliest(), &["late".to_string()]);
+        assert_eq!(sorted(wheel.advance(1_100)), vec!["late", "y"]);
+        assert_eq!(wheel.advance(1_200), vec!["z"]);
+    }
+
+    #[test]
+    fn next_fire_is_fixed_rate_but_skips_missed_periods() {
+        assert_eq!(next_fire(100, 30, 105), 130);
+        assert_eq!(next_fire(100, 30, 131), 161);
+    }
+
+    #[test]
+    fn cron_stats_track_signed_drift() {
+        let mut stats = CronStats::default();
+        stats.record_fire(1_000_000_000, 1_004_000_000);
+        stats.record_fire(1_000_000_000, 998_000_000);
+        assert_eq!(stats.fires, 2);
+        assert_eq!(stats.max_late_ns, 4_000_000);
+        assert_eq!(stats.max_early_ns, 2_000_000);
+        assert!((stats.mean_drift_ms() - 1.0).abs() < 1e-9);
+    }
+}
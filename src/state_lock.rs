@@ -0,0 +1,182 @@
+//! Cross-process advisory locks for per-EA state.
+//!
+//! The dashboard, the CLI and every agent's MCP server mutate the same
+//! state directory. Each kind of state gets its own lock file under
+//! `<state_dir>/.locks/`, so a `spawn_agent` rewriting `agent_parents.json`
+//! never waits on an `add_project` or a `log_justification` append.
+//!
+//! Locks are `flock(2)` exclusive locks on a file that is never removed:
+//! waiters block in the kernel instead of sleep-polling, and a holder that
+//! dies releases its lock with its file descriptors, so there is no stale
+//! lock to detect or reclaim. `flock` locks belong to the open file
+//! description, so two threads of one process exclude each other too.
+//!
+//! Lock order, to keep nested acquisition deadlock-free: an agent's
+//! lifecycle lock ([`agent_lock_name`]), then [`PROJECTS`], then
+//! [`STATE_JOURNAL`], then any single leaf lock ([`TASKS_MD`], [`AGENT_PARENTS`], [`WORKER_TASKS`],
+//! [`AGENT_PROJECTS`], [`ACTION_LOG`]). Leaf locks are never
+//! held while taking another lock.
+
+use anyhow::{Context, Result};
+use std::fs::{self, File, OpenOptions};
+use std::io;
+use std::os::raw::c_int;
+use std::os::unix::io::AsRawFd;
+use std::path::{Path, PathBuf};
+
+/// Project membership: held across "validate the project, create the
+/// session, record its project" so concurrent spawns and
+/// `complete_project` see a consistent view.
+pub const PROJECTS: &str = "projects";
+/// `tasks.md` read-modify-write.
+pub const TASKS_MD: &str = "tasks_md";
+pub const AGENT_PARENTS: &str = "agent_parents";
+pub const WORKER_TASKS: &str = "worker_tasks";
+pub const AGENT_PROJECTS: &str = "agent_projects";
+pub const ACTION_LOG: &str = "action_log";
+/// Appends to, compaction of, and migration to or from a journal-backed
+/// state store (see `state_store`).
+pub const STATE_JOURNAL: &str = "state_journal";
+
+const LOCK_EX: c_int = 2;
+const LOCK_NB: c_int = 4;
+
+extern "C" {
+    fn flock(fd: c_int, operation: c_int) -> c_int;
+}
+
+/// Lock serialising spawn/kill of one session, so two spawns of the same
+/// name can't both pass the "already exists" check.
+pub fn agent_lock_name(session_name: &str) -> String {
+    let safe: String = session_name
+        .chars()
+        .map(|c| {
+            if c.is_ascii_alphanumeric() || c == '-' || c == '_' {
+                c
+            } else {
+                '_'
+            }
+        })
+        .collect();
+    format!("agent-{}", safe)
+}
+
+fn lock_path(state_dir: &Path, name: &str) -> PathBuf {
+    state_dir.join(".locks").join(format!("{}.lock", name))
+}
+
+/// An exclusive lock, released on drop.
+#[derive(Debug)]
+pub struct StateLock {
+    _file: File,
+}
+
+impl StateLock {
+    /// Block until the `name` lock of `state_dir` is ours.
+    pub fn acquire(state_dir: &Path, name: &str) -> Result<Self> {
+        let _timer = crate::metrics::LOCK_WAIT.start_timer();
+        Self::lock(state_dir, name, LOCK_EX)
+            .map(|lock| lock.expect("blocking flock returned without the lock"))
+    }
+
+    /// Take the `name` lock of `state_dir` if nobody holds it; `None` when
+    /// somebody does.
+    pub fn try_acquire(state_dir: &Path, name: &str) -> Result<Option<Self>> {
+        Self::lock(state_dir, name, LOCK_EX | LOCK_NB)
+    }
+
+    fn lock(state_dir: &Path, name: &str, operation: c_int) -> Result<Option<Self>> {
+        let path = lock_path(state_dir, name);
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)
+                .with_context(|| format!("Failed to create lock directory {:?}", parent))?;
+        }
+        let file = OpenOptions::new()
+            .create(true)
+            .truncate(false)
+            .write(true)
+            .open(&path)
+            .with_context(|| format!("Failed to open lock {:?}", path))?;
+        loop {
+            // SAFETY: `file` owns a valid descriptor for the whole call.
+            if unsafe { flock(file.as_raw_fd(), operation) } == 0 {
+                return Ok(Some(Self { _file: file }));
+            }
+            let err = io::Error::last_os_error();
+            match err.kind() {
+                io::ErrorKind::Interrupted => continue,
+                io::ErrorKind::WouldBlock => return Ok(None),
+                _ => return Err(err).with_context(|| format!("Failed to acquire {:?}", path)),
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::{AtomicBool, Ordering};
+    use std::sync::Arc;
+    use std::time::Duration;
+
+    #[test]
+    fn lock_blocks_until_the_holder_releases_it() {
+        let dir = tempfile::tempdir().unwrap();
+        let held = StateLock::acquire(dir.path(), AGENT_PARENTS).unwrap();
+
+        let acquired = Arc::new(AtomicBool::new(false));
+        let waiter = {
+            let dir = dir.path().to_path_buf();
+            let acquired = acquired.clone();
+            std::thread::spawn(move || {
+                let _lock = StateLock::acquire(&dir, AGENT_PARENTS).unwrap();
+                acquired.store(true, Ordering::SeqCst);
+            })
+        };
+        std::thread::sleep(Duration::from_millis(50));
+        assert!(!acquired.load(Ordering::SeqCst), "waiter got a held lock");
+
+        // Other kinds of state are not serialised behind it.
+        StateLock::acquire(dir.path(), WORKER_TASKS).unwrap();
+
+        drop(held);
+        waiter.join().unwrap();
+        assert!(acquired.load(Ordering::SeqCst));
+    }
+
+    #[test]
+    fn try_acquire_reports_a_held_lock() {
+        let dir = tempfile::tempdir().unwrap();
+        let held = StateLock::try_acquire(dir.path(), PROJECTS).unwrap();
+        assert!(held.is_some());
+        assert!(StateLock::try_acquire(dir.path(), PROJECTS)
+            .unwrap()
+            .is_none());
+        drop(held);
+        assert!(StateLock::try_acquire(dir.path(), PROJECTS)
+            .unwrap()
+            .is_some());
+    }
+
+    #[test]
+    fn leftover_lock_file_does_not_block() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = lock_path(dir.path(), PROJECTS);
+        fs::create_dir_all(path.parent().unwrap()).unwrap();
+        // What a crashed holder of the old pid-file lock left behind.
+        fs::write(&path, u32::MAX.to_string()).unwrap();
+
+        let lock = StateLock::acquire(dir.path(), PROJECTS).expect("no stale state to reclaim");
+        drop(lock);
+        assert!(path.exists(), "lock files are kept for the next holder");
+    }
+
+    #[test]
+    fn agent_lock_names_are_filesystem_safe() {
+        assert_eq!(
+            agent_lock_name("omar-agent-0-api"),
+            "agent-omar-agent-0-api"
+        );
+        assert_eq!(agent_lock_name("../x y"), "agent-___x_y");
+    }
+}
@@ -0,0 +1,832 @@
+//! Per-EA agent records — worker tasks, the agent hierarchy, project
+//! membership and self-reported statuses — behind one [`StateStore`]
+//! interface with two backends:
+//!
+//! - **Files** (the default): one JSON file per table (`worker_tasks.json`,
+//!   `agent_parents.json`, `agent_projects.json`) plus `status/<session>.md`,
+//!   the layout OMAR has always used. Every change rewrites its table
+//!   whole under that table's lock, and a change spanning tables is one
+//!   rewrite per table.
+//! - **Journal**: every table in one `state.json` snapshot plus an
+//!   append-only `state.journal` holding one JSON line per transaction.
+//!   A transaction is a single `write(2)`, so its records land together or
+//!   (torn by a crash) not at all; a write costs what changed rather than
+//!   the table; readers replay only the lines appended since their last
+//!   read; and a children-of-parent index is kept alongside the tables.
+//!   The journal is folded back into the snapshot every
+//!   [`COMPACT_EVERY`] transactions, as the scheduler's event journal is.
+//!
+//! A state directory uses the journal backend exactly when its
+//! `state.journal` exists, so every process sharing the directory — the
+//! dashboard, the CLI, each agent's MCP server — agrees without being told.
+//! [`select_backend`] migrates a directory either way; migrating back to
+//! files is also how the journal's contents are exported as JSON.
+
+use std::collections::{BTreeMap, BTreeSet, HashMap};
+use std::fs::{self, OpenOptions};
+use std::io::{Read, Seek, SeekFrom, Write};
+use std::os::unix::fs::MetadataExt;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, OnceLock};
+
+use anyhow::{Context, Result};
+use serde::{Deserialize, Serialize};
+use serde_json::Value;
+
+use crate::memory::{read_json, write_json, write_text_atomic};
+use crate::state_lock::{self, StateLock};
+use crate::state_watch::{self, FileStamp};
+
+/// Transactions in the journal before the writer folds it into the
+/// snapshot.
+pub const COMPACT_EVERY: usize = 1024;
+
+const SNAPSHOT_FILE: &str = "state.json";
+const JOURNAL_FILE: &str = "state.journal";
+const STATUS_DIR: &str = "status";
+
+/// Which backend a state directory should use (`[state] backend` in
+/// config.toml).
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum Backend {
+    #[default]
+    Files,
+    Journal,
+}
+
+/// One kind of record. Keys are full session names throughout.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum Table {
+    /// Session → task description.
+    WorkerTasks,
+    /// Child session → parent session.
+    AgentParents,
+    /// Session → project id.
+    AgentProjects,
+    /// Session → the agent's self-reported status text.
+    Statuses,
+}
+
+impl Table {
+    pub const ALL: [Table; 4] = [
+        Table::WorkerTasks,
+        Table::AgentParents,
+        Table::AgentProjects,
+        Table::Statuses,
+    ];
+
+    /// The table's file in the files layout; statuses are a directory.
+    fn json_file(self) -> Option<&'static str> {
+        match self {
+            Table::WorkerTasks => Some("worker_tasks.json"),
+            Table::AgentParents => Some("agent_parents.json"),
+            Table::AgentProjects => Some("agent_projects.json"),
+            Table::Statuses => None,
+        }
+    }
+
+    fn lock_name(self) -> Option<&'static str> {
+        match self {
+            Table::WorkerTasks => Some(state_lock::WORKER_TASKS),
+            Table::AgentParents => Some(state_lock::AGENT_PARENTS),
+            Table::AgentProjects => Some(state_lock::AGENT_PROJECTS),
+            // One file per agent, each replaced atomically: nothing to
+            // read-modify-write.
+            Table::Statuses => None,
+        }
+    }
+}
+
+/// One record change. Both kinds are idempotent, so replaying a journal
+/// over a snapshot that already holds some of it is harmless.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+#[serde(tag = "op", rename_all = "snake_case")]
+pub enum Change {
+    Put {
+        table: Table,
+        key: String,
+        value: Value,
+    },
+    Delete {
+        table: Table,
+        key: String,
+    },
+}
+
+impl Change {
+    pub fn put(table: Table, key: &str, value: impl Into<Value>) -> Self {
+        Change::Put {
+            table,
+            key: key.to_string(),
+            value: value.into(),
+        }
+    }
+
+    pub fn delete(table: Table, key: &str) -> Self {
+        Change::Delete {
+            table,
+            key: key.to_string(),
+        }
+    }
+
+    fn table(&self) -> Table {
+        match self {
+            Change::Put { table, .. } | Change::Delete { table, .. } => *table,
+        }
+    }
+}
+
+pub trait StateStore: Send + Sync {
+    /// Every record of `table`.
+    fn records(&self, table: Table) -> HashMap<String, Value>;
+
+    fn get(&self, table: Table, key: &str) -> Option<Value>;
+
+    /// Apply `changes` in order. The journal backend applies them as one
+    /// transaction; the files backend table by table.
+    fn apply(&self, changes: &[Change]) -> Result<()>;
+
+    /// Sessions whose recorded parent is `parent`, sorted.
+    fn children_of(&self, parent: &str) -> Vec<String>;
+
+    /// A path whose [`FileStamp`] moves whenever `table` may have changed,
+    /// for [`state_watch`] subscribers.
+    fn watch_path(&self, table: Table) -> PathBuf;
+}
+
+/// The store for `state_dir`, per the backend it is on.
+pub fn open(state_dir: &Path) -> Arc<dyn StateStore> {
+    if journal_path(state_dir).exists() {
+        journal_store(state_dir)
+    } else {
+        Arc::new(FileStore::new(state_dir))
+    }
+}
+
+fn journal_path(state_dir: &Path) -> PathBuf {
+    state_dir.join(JOURNAL_FILE)
+}
+
+fn snapshot_path(state_dir: &Path) -> PathBuf {
+    state_dir.join(SNAPSHOT_FILE)
+}
+
+/// Journal stores are shared per directory so their replayed state is too.
+fn journal_store(state_dir: &Path) -> Arc<JournalStore> {
+    static STORES: OnceLock<Mutex<HashMap<PathBuf, Arc<JournalStore>>>> = OnceLock::new();
+    STORES
+        .get_or_init(Mutex::default)
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .entry(state_dir.to_path_buf())
+        .or_insert_with(|| Arc::new(JournalStore::new(state_dir)))
+        .clone()
+}
+
+/// Move `state_dir` onto `backend`, carrying every record across. Returns
+/// whether anything moved. Safe against concurrent writers in other
+/// processes: each is either seen by the migration or redirected to the
+/// new backend.
+pub fn select_backend(state_dir: &Path, backend: Backend) -> Result<bool> {
+    let on_journal = journal_path(state_dir).exists();
+    match backend {
+        Backend::Journal if !on_journal => migrate_to_journal(state_dir).map(|_| true),
+        Backend::Files if on_journal => migrate_to_files(state_dir).map(|_| true),
+        _ => Ok(false),
+    }
+}
+
+fn migrate_to_journal(state_dir: &Path) -> Result<()> {
+    fs::create_dir_all(state_dir)?;
+    let _journal_lock = StateLock::acquire(state_dir, state_lock::STATE_JOURNAL)?;
+    let files = FileStore::new(state_dir);
+
+    // Snapshot first so readers never see an empty store, then create the
+    // journal, which sends new writers to it. A file write that slipped in
+    // between the two is picked up by the second pass: it holds its
+    // table's lock, and the pass takes each lock in turn.
+    let mut tables: BTreeMap<Table, BTreeMap<String, Value>> = BTreeMap::new();
+    for table in Table::ALL {
+        tables.insert(table, files.records(table).into_iter().collect());
+    }
+    write_text_atomic(&snapshot_path(state_dir), &serde_json::to_string(&tables)?);
+    OpenOptions::new()
+        .create(true)
+        .append(true)
+        .open(journal_path(state_dir))
+        .context("create state journal")?;
+
+    let mut late = Vec::new();
+    for table in Table::ALL {
+        let _table_lock = table
+            .lock_name()
+            .map(|name| StateLock::acquire(state_dir, name))
+            .transpose()?;
+        let before = &tables[&table];
+        let now = files.records(table);
+        for (key, value) in &now {
+            if before.get(key) != Some(value) {
+                late.push(Change::put(table, key, value.clone()));
+            }
+        }
+        for key in before.keys().filter(|key| !now.contains_key(*key)) {
+            late.push(Change::delete(table, key));
+        }
+    }
+    if !late.is_empty() {
+        journal_store(state_dir).append_locked(&late)?;
+    }
+
+    // The JSON files would only go stale from here on.
+    for table in Table::ALL {
+        match table.json_file() {
+            Some(file) => {
+                let _ = fs::remove_file(state_dir.join(file));
+            }
+            None => {
+                let _ = clear_status_dir(state_dir);
+            }
+        }
+    }
+    Ok(())
+}
+
+fn migrate_to_files(state_dir: &Path) -> Result<()> {
+    let _journal_lock = StateLock::acquire(state_dir, state_lock::STATE_JOURNAL)?;
+    let journal = journal_store(state_dir);
+    let files = FileStore::new(state_dir);
+    for table in Table::ALL {
+        let records = journal.records(table);
+        let _table_lock = table
+            .lock_name()
+            .map(|name| StateLock::acquire(state_dir, name))
+            .transpose()?;
+        files.replace_table(table, &records)?;
+    }
+    // Journal first: it is what marks the directory as journal-backed.
+    fs::remove_file(journal_path(state_dir)).context("remove state journal")?;
+    let _ = fs::remove_file(snapshot_path(state_dir));
+    Ok(())
+}
+
+fn clear_status_dir(state_dir: &Path) -> Result<()> {
+    for entry in fs::read_dir(state_dir.join(STATUS_DIR))?.flatten() {
+        if entry.path().extension().is_some_and(|ext| ext == "md") {
+            let _ = fs::remove_file(entry.path());
+        }
+    }
+    Ok(())
+}
+
+/// Process-wide mutexes serialising each table's read-modify-write between
+/// threads; the flock in [`Table::lock_name`] covers other processes.
+static WORKER_TASKS_LOCK: Mutex<()> = Mutex::new(());
+static AGENT_PARENTS_LOCK: Mutex<()> = Mutex::new(());
+static AGENT_PROJECTS_LOCK: Mutex<()> = Mutex::new(());
+
+fn table_mutex(table: Table) -> Option<&'static Mutex<()>> {
+    match table {
+        Table::WorkerTasks => Some(&WORKER_TASKS_LOCK),
+        Table::AgentParents => Some(&AGENT_PARENTS_LOCK),
+        Table::AgentProjects => Some(&AGENT_PROJECTS_LOCK),
+        Table::Statuses => None,
+    }
+}
+
+/// The files backend.
+pub struct FileStore {
+    state_dir: PathBuf,
+}
+
+impl FileStore {
+    pub fn new(state_dir: &Path) -> Self {
+        Self {
+            state_dir: state_dir.to_path_buf(),
+        }
+    }
+
+    fn status_path(&self, session: &str) -> PathBuf {
+        self.state_dir
+            .join(STATUS_DIR)
+            .join(format!("{}.md", session))
+    }
+
+    fn read_table(&self, table: Table) -> HashMap<String, Value> {
+        let Some(file) = table.json_file() else {
+            return self.read_statuses();
+        };
+        let path = self.state_dir.join(file);
+        state_watch::cached(&path, || read_json(&path).unwrap_or_default())
+    }
+
+    fn read_statuses(&self) -> HashMap<String, Value> {
+        let Ok(entries) = fs::read_dir(self.state_dir.join(STATUS_DIR)) else {
+            return HashMap::new();
+        };
+        entries
+            .flatten()
+            .filter_map(|entry| {
+                let path = entry.path();
+                let session = path.file_stem()?.to_str()?.to_string();
+                (path.extension()? == "md").then_some(())?;
+                let text = fs::read_to_string(&path).ok()?;
+                Some((session, Value::String(text)))
+            })
+            .collect()
+    }
+
+    /// Apply one table's changes. Called with the table's locks held.
+    fn write_changes(&self, table: Table, changes: &[&Change]) {
+        let Some(file) = table.json_file() else {
+            for change in changes {
+                match change {
+                    Change::Put { key, value, .. } => {
+                        let text = value.as_str().map(str::to_string).unwrap_or_default();
+                        write_text_atomic(&self.status_path(key), &text);
+                    }
+                    Change::Delete { key, .. } => {
+                        let _ = fs::remove_file(self.status_path(key));
+                    }
+                }
+            }
+            return;
+        };
+        let mut records = self.read_table(table);
+        for change in changes {
+            match change {
+                Change::Put { key, value, .. } => {
+                    records.insert(key.clone(), value.clone());
+                }
+                Change::Delete { key, .. } => {
+                    records.remove(key);
+                }
+            }
+        }
+        write_json(&self.state_dir.join(file), &records);
+    }
+
+    /// Make `table` hold exactly `records`.
+    fn replace_table(&self, table: Table, records: &HashMap<String, Value>) -> Result<()> {
+        match table.json_file() {
+            Some(file) => write_json(&self.state_dir.join(file), records),
+            None => {
+                fs::create_dir_all(self.state_dir.join(STATUS_DIR))?;
+                let _ = clear_status_dir(&self.state_dir);
+                for (session, status) in records {
+                    let text = status.as_str().unwrap_or_default();
+                    write_text_atomic(&self.status_path(session), text);
+                }
+            }
+        }
+        Ok(())
+    }
+}
+
+impl StateStore for FileStore {
+    fn records(&self, table: Table) -> HashMap<String, Value> {
+        self.read_table(table)
+    }
+
+    fn get(&self, table: Table, key: &str) -> Option<Value> {
+        match table {
+            Table::Statuses => fs::read_to_string(self.status_path(key))
+                .ok()
+                .map(Value::String),
+            _ => self.read_table(table).remove(key),
+        }
+    }
+
+    fn apply(&self, changes: &[Change]) -> Result<()> {
+        for table in Table::ALL {
+            let batch: Vec<&Change> = changes.iter().filter(|c| c.table() == table).collect();
+            if batch.is_empty() {
+                continue;
+            }
+            let _guard = table_mutex(table).map(|m| m.lock().unwrap_or_else(|e| e.into_inner()));
+            // Best effort, as before the store existed: without the lock
+            // file the write still happens under the in-process mutex.
+            let file_lock = table
+                .lock_name()
+                .and_then(|name| StateLock::acquire(&self.state_dir, name).ok());
+            if journal_path(&self.state_dir).exists() {
+                // Migrated while we waited. Leaf locks are never held while
+                // taking another, so let go before the journal's.
+                drop(file_lock);
+                drop(_guard);
+                let rest: Vec<Change> = changes
+                    .iter()
+                    .filter(|c| c.table() >= table)
+                    .cloned()
+                    .collect();
+                return journal_store(&self.state_dir).apply(&rest);
+            }
+            self.write_changes(table, &batch);
+        }
+        Ok(())
+    }
+
+    fn children_of(&self, parent: &str) -> Vec<String> {
+        let mut children: Vec<String> = self
+            .read_table(Table::AgentParents)
+            .into_iter()
+            .filter(|(_, p)| p.as_str() == Some(parent))
+            .map(|(child, _)| child)
+            .collect();
+        children.sort();
+        children
+    }
+
+    fn watch_path(&self, table: Table) -> PathBuf {
+        match table.json_file() {
+            Some(file) => self.state_dir.join(file),
+            None => self.state_dir.join(STATUS_DIR),
+        }
+    }
+}
+
+/// A transaction: one journal line.
+#[derive(Debug, Serialize, Deserialize)]
+struct Transaction {
+    changes: Vec<Change>,
+}
+
+/// The journal backend's view of the directory, as of the last byte of
+/// journal it consumed.
+#[derive(Debug, Default)]
+struct Replayed {
+    tables: HashMap<Table, HashMap<String, Value>>,
+    /// Parent → children, kept in step with [`Table::AgentParents`].
+    children: HashMap<String, BTreeSet<String>>,
+    snapshot: Option<FileStamp>,
+    journal_ino: u64,
+    /// Journal bytes consumed: always just past a newline.
+    offset: u64,
+    /// Transactions in the journal (not yet compacted).
+    transactions: usize,
+}
+
+impl Replayed {
+    fn apply(&mut self, change: &Change) {
+        match change {
+            Change::Put { table, key, value } => {
+                if *table == Table::AgentParents {
+                    self.unlink_child(key);
+                    if let Some(parent) = value.as_str() {
+                        self.children
+                            .entry(parent.to_string())
+                            .or_default()
+                            .insert(key.clone());
+                    }
+                }
+                self.tables
+                    .entry(*table)
+                    .or_default()
+                    .insert(key.clone(), value.clone());
+            }
+            Change::Delete { table, key } => {
+                if *table == Table::AgentParents {
+                    self.unlink_child(key);
+                }
+                if let Some(records) = self.tables.get_mut(table) {
+                    records.remove(key);
+                }
+            }
+        }
+    }
+
+    fn unlink_child(&mut self, child: &str) {
+        let Some(parent) = self
+            .tables
+            .get(&Table::AgentParents)
+            .and_then(|parents| parents.get(child))
+            .and_then(Value::as_str)
+        else {
+            return;
+        };
+        if let Some(children) = self.children.get_mut(parent) {
+            children.remove(child);
+            if children.is_empty() {
+                self.children.remove(parent);
+            }
+        }
+    }
+
+    /// Apply whole lines from `bytes`; returns how many bytes they span.
+    /// A trailing partial line is left for a later read, and a line that
+    /// doesn't parse (torn by a crashed writer) is skipped.
+    fn replay(&mut self, bytes: &[u8]) -> usize {
+        let Some(end) = bytes.iter().rposition(|&b| b == b'\n').map(|i| i + 1) else {
+            return 0;
+        };
+        for line in bytes[..end].split(|&b| b == b'\n') {
+            if line.is_empty() {
+                continue;
+            }
+            if let Ok(transaction) = serde_json::from_slice::<Transaction>(line) {
+                for change in &transaction.changes {
+                    self.apply(change);
+                }
+                self.transactions += 1;
+            }
+        }
+        end
+    }
+}
+
+/// The journal backend.
+pub struct JournalStore {
+    state_dir: PathBuf,
+    replayed: Mutex<Replayed>,
+}
+
+impl JournalStore {
+    fn new(state_dir: &Path) -> Self {
+        Self {
+            state_dir: state_dir.to_path_buf(),
+            replayed: Mutex::default(),
+        }
+    }
+
+    /// Catch `replayed` up with the files: replay new journal lines, or
+    /// start over from the snapshot when it was rewritten or the journal
+    /// truncated or replaced.
+    fn sync(&self, replayed: &mut Replayed) {
+        let snapshot = FileStamp::of(&snapshot_path(&self.state_dir));
+        let Ok(meta) = fs::metadata(journal_path(&self.state_dir)) else {
+            return;
+        };
+        if snapshot != replayed.snapshot
+            || meta.ino() != replayed.journal_ino
+            || meta.len() < replayed.offset
+        {
+            let tables: HashMap<Table, HashMap<String, Value>> =
+                read_json(&snapshot_path(&self.state_dir)).unwrap_or_default();
+            *replayed = Replayed {
+                snapshot,
+                journal_ino: meta.ino(),
+                ..Replayed::default()
+            };
+            for (table, records) in tables {
+                for (key, value) in records {
+                    replayed.apply(&Change::Put { table, key, value });
+                }
+            }
+        }
+        if meta.len() == replayed.offset {
+            return;
+        }
+        let Ok(mut file) = fs::File::open(journal_path(&self.state_dir)) else {
+            return;
+        };
+        let mut bytes = Vec::new();
+        if file.seek(SeekFrom::Start(replayed.offset)).is_ok()
+            && file.read_to_end(&mut bytes).is_ok()
+        {
+            replayed.offset += replayed.replay(&bytes) as u64;
+        }
+    }
+
+    fn read<T>(&self, f: impl FnOnce(&Replayed) -> T) -> T {
+        let mut replayed = self.replayed.lock().unwrap_or_else(|e| e.into_inner());
+        self.sync(&mut replayed);
+        f(&replayed)
+    }
+
+    /// Append `changes` as one transaction. The caller holds
+    /// [`state_lock::STATE_JOURNAL`].
+    fn append_locked(&self, changes: &[Change]) -> Result<()> {
+        let mut replayed = self.replayed.lock().unwrap_or_else(|e| e.into_inner());
+        self.sync(&mut replayed);
+        let path = journal_path(&self.state_dir);
+        let mut file = OpenOptions::new()
+            .append(true)
+            .open(&path)
+            .with_context(|| format!("open {:?}", path))?;
+
+        let mut line = Vec::new();
+        // A crashed writer's partial line would otherwise swallow this one.
+        if file.metadata()?.len() > replayed.offset {
+            line.push(b'\n');
+        }
+        serde_json::to_writer(
+            &mut line,
+            &Transaction {
+                changes: changes.to_vec(),
+            },
+        )?;
+        line.push(b'\n');
+        file.write_all(&line)
+            .with_context(|| format!("append to {:?}", path))?;
+
+        for change in changes {
+            replayed.apply(change);
+        }
+        replayed.transactions += 1;
+        replayed.offset = file.metadata()?.len();
+        if replayed.transactions >= COMPACT_EVERY {
+            self.compact(&mut replayed)?;
+        }
+        Ok(())
+    }
+
+    /// Fold the journal into the snapshot. Snapshot first: a reader that
+    /// catches the two out of step replays the whole journal over the new
+    /// snapshot, which the changes' idempotence makes harmless.
+    fn compact(&self, replayed: &mut Replayed) -> Result<()> {
+        let tables: BTreeMap<Table, BTreeMap<&String, &Value>> = replayed
+            .tables
+            .iter()
+            .map(|(table, records)| (*table, records.iter().collect()))
+            .collect();
+        write_text_atomic(
+            &snapshot_path(&self.state_dir),
+            &serde_json::to_string(&tables)?,
+        );
+        OpenOptions::new()
+            .write(true)
+            .open(journal_path(&self.state_dir))?
+            .set_len(0)?;
+        replayed.snapshot = FileStamp::of(&snapshot_path(&self.state_dir));
+        replayed.offset = 0;
+        replayed.transactions = 0;
+        Ok(())
+    }
+}
+
+impl StateStore for JournalStore {
+    fn records(&self, table: Table) -> HashMap<String, Value> {
+        self.read(|replayed| replayed.tables.get(&table).cloned().unwrap_or_default())
+    }
+
+    fn get(&self, table: Table, key: &str) -> Option<Value> {
+        self.read(|replayed| replayed.tables.get(&table)?.get(key).cloned())
+    }
+
+    fn apply(&self, changes: &[Change]) -> Result<()> {
+        if changes.is_empty() {
+            return Ok(());
+        }
+        let _lock = StateLock::acquire(&self.state_dir, state_lock::STATE_JOURNAL)?;
+        if !journal_path(&self.state_dir).exists() {
+            // Migrated back to files while we waited.
+            return FileStore::new(&self.state_dir).apply(changes);
+        }
+        self.append_locked(changes)
+    }
+
+    fn children_of(&self, parent: &str) -> Vec<String> {
+        self.read(|replayed| {
+            replayed
+                .children
+                .get(parent)
+                .map(|children| children.iter().cloned().collect())
+                .unwrap_or_default()
+        })
+    }
+
+    fn watch_path(&self, _table: Table) -> PathBuf {
+        journal_path(&self.state_dir)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use serde_json::json;
+
+    fn seed(store: &dyn StateStore) {
+        store
+            .apply(&[
+                Change::put(Table::AgentParents, "pm", "ea"),
+                Change::put(Table::AgentParents, "w1", "pm"),
+                Change::put(Table::AgentParents, "w2", "pm"),
+                Change::put(Table::WorkerTasks, "w1", "build it"),
+                Change::put(Table::AgentProjects, "w1", 3),
+                Change::put(Table::Statuses, "w1", "halfway"),
+            ])
+            .unwrap();
+    }
+
+    fn check_seeded(store: &dyn StateStore) {
+        assert_eq!(store.children_of("pm"), ["w1", "w2"]);
+        assert_eq!(store.children_of("ea"), ["pm"]);
+        assert_eq!(store.get(Table::WorkerTasks, "w1"), Some(json!("build it")));
+        assert_eq!(store.get(Table::AgentProjects, "w1"), Some(json!(3)));
+        assert_eq!(store.get(Table::Statuses, "w1"), Some(json!("halfway")));
+        assert_eq!(store.records(Table::AgentParents).len(), 3);
+    }
+
+    #[test]
+    fn both_backends_store_the_same_records() {
+        let dir = tempfile::tempdir().unwrap();
+        let files = FileStore::new(&dir.path().join("files"));
+        seed(&files);
+        check_seeded(&files);
+
+        let journal_dir = dir.path().join("journal");
+        select_backend(&journal_dir, Backend::Journal).unwrap();
+        let journal = open(&journal_dir);
+        seed(journal.as_ref());
+        check_seeded(journal.as_ref());
+
+        for store in [&files as &dyn StateStore, journal.as_ref()] {
+            store
+                .apply(&[
+                    Change::put(Table::AgentParents, "w2", "ea"),
+                    Change::delete(Table::AgentParents, "w1"),
+                    Change::delete(Table::Statuses, "w1"),
+                ])
+                .unwrap();
+            assert!(store.children_of("pm").is_empty());
+            assert_eq!(store.children_of("ea"), ["pm", "w2"]);
+            assert_eq!(store.get(Table::Statuses, "w1"), None);
+        }
+    }
+
+    #[test]
+    fn a_journal_write_appends_one_line_per_transaction() {
+        let dir = tempfile::tempdir().unwrap();
+        select_backend(dir.path(), Backend::Journal).unwrap();
+        let store = open(dir.path());
+        seed(store.as_ref());
+        store
+            .apply(&[Change::put(Table::WorkerTasks, "w2", "test it")])
+            .unwrap();
+
+        let journal = fs::read_to_string(journal_path(dir.path())).unwrap();
+        assert_eq!(journal.lines().count(), 2);
+        assert!(journal.lines().last().unwrap().contains("test it"));
+        assert!(!dir.path().join("worker_tasks.json").exists());
+    }
+
+    #[test]
+    fn readers_replay_only_what_other_writers_appended() {
+        let dir = tempfile::tempdir().unwrap();
+        select_backend(dir.path(), Backend::Journal).unwrap();
+        let writer = JournalStore::new(dir.path());
+        let reader = JournalStore::new(dir.path());
+        seed(&writer);
+        check_seeded(&reader);
+
+        writer
+            .apply(&[Change::put(Table::AgentParents, "w3", "pm")])
+            .unwrap();
+        assert_eq!(reader.children_of("pm"), ["w1", "w2", "w3"]);
+
+        // A torn line from a crashed writer is skipped, and the next
+        // transaction still lands.
+        let mut journal = OpenOptions::new()
+            .append(true)
+            .open(journal_path(dir.path()))
+            .unwrap();
+        journal.write_all(b"{\"changes\":[{\"op\":\"put\"").unwrap();
+        writer
+            .apply(&[Change::put(Table::AgentParents, "w4", "pm")])
+            .unwrap();
+        assert_eq!(reader.children_of("pm"), ["w1", "w2", "w3", "w4"]);
+    }
+
+    #[test]
+    fn compaction_folds_the_journal_into_the_snapshot() {
+        let dir = tempfile::tempdir().unwrap();
+        select_backend(dir.path(), Backend::Journal).unwrap();
+        let writer = JournalStore::new(dir.path());
+        let reader = JournalStore::new(dir.path());
+        for i in 0..COMPACT_EVERY + 5 {
+            writer
+                .apply(&[Change::put(Table::WorkerTasks, &format!("w{i}"), "task")])
+                .unwrap();
+        }
+
+        let journal = fs::read_to_string(journal_path(dir.path())).unwrap();
+        assert_eq!(journal.lines().count(), 5);
+        assert_eq!(reader.records(Table::WorkerTasks).len(), COMPACT_EVERY + 5);
+    }
+
+    #[test]
+    fn migration_round_trips_every_table() {
+        let dir = tempfile::tempdir().unwrap();
+        seed(&FileStore::new(dir.path()));
+
+        assert!(select_backend(dir.path(), Backend::Journal).unwrap());
+        assert!(!select_backend(dir.path(), Backend::Journal).unwrap());
+        check_seeded(open(dir.path()).as_ref());
+        assert!(!dir.path().join("agent_parents.json").exists());
+        assert!(!dir.path().join("status/w1.md").exists());
+
+        open(dir.path())
+            .apply(&[Change::put(Table::WorkerTasks, "w2", "test it")])
+            .unwrap();
+        assert!(select_backend(dir.path(), Backend::Files).unwrap());
+        assert!(!journal_path(dir.path()).exists());
+        let files = open(dir.path());
+        check_seeded(files.as_ref());
+        assert_eq!(files.get(Table::WorkerTasks, "w2"), Some(json!("test it")));
+        assert_eq!(
+            fs::read_to_string(dir.path().join("status/w1.md")).unwrap(),
+            "halfway"
+        );
+    }
+}
@@ -0,0 +1,370 @@
+//! Change tracking for OMAR's on-disk state files.
+//!
+//! The dashboard, CLI and per-agent MCP servers share state through small
+//! files (`eas.json`, `active_ea`, and per-EA `tasks.md`,
+//! `agent_parents.json`, `worker_tasks.json`, `status/` — or
+//! `state.journal` on the journal backend, see `state_store`). This module gives
+//! every reader one way to notice that a file changed:
+//!
+//! - [`cached`] memoises a file's parsed value per process and re-parses only
+//!   when the file's [`FileStamp`] moved, so hot readers stop paying a read
+//!   and parse on every call.
+//! - [`subscribe`] registers a set of paths with one shared background
+//!   thread that signals the subscriber when any changed. The dashboard
+//!   uses it to refresh right after an out-of-band MCP write instead of at
+//!   its next tick.
+//!
+//! The thread sleeps on a [`DirWatch`] over the directories holding the
+//! subscribed paths, and re-stats them when one of those directories
+//! changes, so an idle dashboard is not woken at all. Stamps still decide
+//! what changed — events only say when to look. Directories the platform
+//! can't watch are stat-polled every [`POLL_INTERVAL`] instead.
+
+use std::any::Any;
+use std::collections::{HashMap, HashSet};
+use std::os::unix::fs::MetadataExt;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::time::{Duration, SystemTime};
+
+use tokio::sync::mpsc;
+
+use crate::dir_watch::{self, DirWatch};
+
+/// How often the watcher thread stats subscribed paths while some of their
+/// directories can't be watched.
+pub const POLL_INTERVAL: Duration = Duration::from_millis(100);
+/// Backstop re-stat while every directory is watched, for subscribers whose
+/// path set grew without a change in a watched directory.
+const RESCAN_INTERVAL: Duration = Duration::from_secs(5);
+/// Pause after a change event so the burst a rename produces (and the
+/// writer's other files) is handled in one pass.
+const SETTLE: Duration = Duration::from_millis(10);
+
+/// A file modified this recently may be rewritten again within the same
+/// mtime tick on coarse-timestamp filesystems, so its stamp isn't trusted
+/// to prove the contents unchanged (git's "racy timestamp" problem).
+const RACY_WINDOW: Duration = Duration::from_secs(2);
+
+/// Enough of a file's metadata to tell whether it changed since it was last
+/// read. The stores write atomically via rename, so a rewrite always
+/// changes the inode even within one mtime tick.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FileStamp {
+    modified: Option<SystemTime>,
+    len: u64,
+    ino: u64,
+}
+
+impl FileStamp {
+    /// `None` when the file does not exist (or can't be stat'ed).
+    pub fn of(path: &Path) -> Option<Self> {
+        let meta = std::fs::metadata(path).ok()?;
+        Some(Self {
+            modified: meta.modified().ok(),
+            len: meta.len(),
+            ino: meta.ino(),
+        })
+    }
+
+    /// Whether the file is old enough that an unchanged stamp means
+    /// unchanged contents.
+    fn settled(&self) -> bool {
+        self.modified
+            .and_then(|modified| modified.elapsed().ok())
+            .is_some_and(|age| age >= RACY_WINDOW)
+    }
+}
+
+/// An equal stamp only proves a path unchanged once it has settled; a
+/// missing file stays missing until a stamp appears.
+fn unchanged(before: Option<FileStamp>, now: Option<FileStamp>) -> bool {
+    before == now && now.is_none_or(|stamp| stamp.settled())
+}
+
+/// The file a cached value was last loaded from, and its stamp at the time.
+#[derive(Debug, Default)]
+pub struct LoadedFrom(Option<(PathBuf, Option<FileStamp>)>);
+
+impl LoadedFrom {
+    /// True when `path` isn't the file last loaded or may have changed
+    /// since; records the current stamp either way. The stamp is taken
+    /// before the caller reads the file, so a write racing that read is
+    /// seen next time.
+    pub fn stale(&mut self, path: &Path) -> bool {
+        let stamp = FileStamp::of(path);
+        let fresh = matches!(&self.0, Some((loaded, s)) if loaded == path && unchanged(*s, stamp));
+        if !fresh {
+            self.0 = Some((path.to_path_buf(), stamp));
+        }
+        !fresh
+    }
+}
+
+type CacheEntry = (Option<FileStamp>, Arc<dyn Any + Send + Sync>);
+
+fn cache() -> &'static Mutex<HashMap<PathBuf, CacheEntry>> {
+    static CACHE: OnceLock<Mutex<HashMap<PathBuf, CacheEntry>>> = OnceLock::new();
+    CACHE.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+/// The value `load` produces for `path`, re-running it only when the file
+/// changed since the last call in this process. `load` must read `path`
+/// itself and depend on nothing else.
+pub fn cached<T>(path: &Path, load: impl FnOnce() -> T) -> T
+where
+    T: Clone + Send + Sync + 'static,
+{
+    let stamp = FileStamp::of(path);
+    if let Some((cached_stamp, value)) = cache().lock().unwrap_or_else(|e| e.into_inner()).get(path)
+    {
+        if unchanged(*cached_stamp, stamp) {
+            if let Some(value) = value.downcast_ref::<T>() {
+                return value.clone();
+            }
+        }
+    }
+    let value = load();
+    cache()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .insert(path.to_path_buf(), (stamp, Arc::new(value.clone())));
+    value
+}
+
+type PathSet = Box<dyn Fn() -> Vec<PathBuf> + Send>;
+
+/// One subscriber: the paths it cares about (re-evaluated on every pass, so
+/// files of EAs created later are picked up) and their last stamps.
+struct Subscription {
+    paths: PathSet,
+    stamps: HashMap<PathBuf, Option<FileStamp>>,
+    tx: mpsc::UnboundedSender<()>,
+}
+
+impl Subscription {
+    fn new(paths: PathSet) -> (Self, mpsc::UnboundedReceiver<()>) {
+        let (tx, rx) = mpsc::unbounded_channel();
+        let mut sub = Self {
+            paths,
+            stamps: HashMap::new(),
+            tx,
+        };
+        sub.stamps = sub.current();
+        (sub, rx)
+    }
+
+    fn current(&self) -> HashMap<PathBuf, Option<FileStamp>> {
+        (self.paths)()
+            .into_iter()
+            .map(|path| {
+                let stamp = FileStamp::of(&path);
+                (path, stamp)
+            })
+            .collect()
+    }
+
+    /// Re-stat and signal on change. False once the receiver is gone.
+    fn poll(&mut self) -> bool {
+        if self.tx.is_closed() {
+            return false;
+        }
+        let current = self.current();
+        if current != self.stamps {
+            self.stamps = current;
+            return self.tx.send(()).is_ok();
+        }
+        true
+    }
+
+    /// Directories whose change events cover this subscriber's paths.
+    fn dirs(&self) -> impl Iterator<Item = PathBuf> + '_ {
+        self.stamps
+            .keys()
+            .filter_map(|path| dir_watch::dir_for(path))
+    }
+}
+
+struct Registry {
+    subscriptions: Mutex<Vec<Subscription>>,
+    /// Wakes the watcher thread: sent by the directory watch, and by
+    /// [`subscribe`] so new paths are watched straight away.
+    wake: std::sync::mpsc::Sender<()>,
+}
+
+fn registry() -> &'static Registry {
+    static REGISTRY: OnceLock<Registry> = OnceLock::new();
+    REGISTRY.get_or_init(|| {
+        let (wake, woken) = std::sync::mpsc::channel();
+        let watch_wake = wake.clone();
+        let watch = DirWatch::new(move || {
+            let _ = watch_wake.send(());
+        });
+        std::thread::spawn(move || watch_loop(watch, woken));
+        Registry {
+            subscriptions: Mutex::new(Vec::new()),
+            wake,
+        }
+    })
+}
+
+fn watch_loop(mut watch: DirWatch, woken: std::sync::mpsc::Receiver<()>) {
+    let mut watched = false;
+    let mut watching = HashSet::new();
+    loop {
+        let timeout = if watched {
+            RESCAN_INTERVAL
+        } else {
+            POLL_INTERVAL
+        };
+        if woken.recv_timeout(timeout).is_ok() {
+            std::thread::sleep(SETTLE);
+            while woken.try_recv().is_ok() {}
+        }
+        let dirs: HashSet<PathBuf> = {
+            let mut subscriptions = registry()
+                .subscriptions
+                .lock()
+                .unwrap_or_else(|e| e.into_inner());
+            subscriptions.retain_mut(Subscription::poll);
+            subscriptions.iter().flat_map(Subscription::dirs).collect()
+        };
+        watched = watch.sync(&dirs);
+        if dirs != watching {
+            // A file may have changed in a newly watched directory before
+            // its watch was in place: look once more.
+            watching = dirs;
+            let _ = registry().wake.send(());
+        }
+    }
+}
+
+/// Signal on the returned channel whenever any path `paths` yields is
+/// created, rewritten or removed. Signals are edge-triggered and may be
+/// coalesced: one signal can stand for several writes. Dropping the
+/// receiver unsubscribes.
+pub fn subscribe(paths: impl Fn() -> Vec<PathBuf> + Send + 'static) -> mpsc::UnboundedReceiver<()> {
+    let (sub, rx) = Subscription::new(Box::new(paths));
+    let registry = registry();
+    registry
+        .subscriptions
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .push(sub);
+    let _ = registry.wake.send(());
+    rx
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::fs::File;
+
+    fn backdate(path: &Path) {
+        let old = SystemTime::now() - Duration::from_secs(60);
+        File::options()
+            .write(true)
+            .open(path)
+            .unwrap()
+            .set_modified(old)
+            .unwrap();
+    }
+
+    #[test]
+    fn loaded_from_only_reports_changed_files() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("agent_parents.json");
+        let other = dir.path().join("other.json");
+        let mut loaded = LoadedFrom::default();
+
+        assert!(loaded.stale(&path), "first load of a missing file");
+        assert!(!loaded.stale(&path));
+
+        std::fs::write(&path, "{}").unwrap();
+        assert!(loaded.stale(&path), "file appeared");
+        assert!(loaded.stale(&path), "fresh writes are not trusted yet");
+        backdate(&path);
+        assert!(loaded.stale(&path));
+        assert!(!loaded.stale(&path));
+
+        // Atomic same-length rewrite, as the state stores do it.
+        let tmp = dir.path().join(".agent_parents.tmp");
+        std::fs::write(&tmp, "[]").unwrap();
+        backdate(&tmp);
+        std::fs::rename(&tmp, &path).unwrap();
+        assert!(loaded.stale(&path), "rename replaced the file");
+        assert!(!loaded.stale(&path));
+
+        // Switching EAs points the same slot at another file.
+        assert!(loaded.stale(&other));
+        assert!(loaded.stale(&path));
+    }
+
+    #[test]
+    fn cached_reparses_only_after_a_change() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("tasks.md");
+        std::fs::write(&path, "1. one\n").unwrap();
+        backdate(&path);
+
+        let mut loads = 0;
+        let mut read = |loads: &mut usize| {
+            cached(&path, || {
+                *loads += 1;
+                std::fs::read_to_string(&path).unwrap()
+            })
+        };
+        assert_eq!(read(&mut loads), "1. one\n");
+        assert_eq!(read(&mut loads), "1. one\n");
+        assert_eq!(loads, 1);
+
+        std::fs::write(&path, "1. two\n").unwrap();
+        assert_eq!(read(&mut loads), "1. two\n");
+        assert_eq!(loads, 2);
+    }
+
+    #[test]
+    fn subscription_signals_once_per_change_and_follows_new_paths() {
+        let dir = tempfile::tempdir().unwrap();
+        let root = dir.path().to_path_buf();
+        let (mut sub, mut rx) = Subscription::new(Box::new(move || {
+            std::fs::read_dir(&root)
+                .into_iter()
+                .flatten()
+                .flatten()
+                .map(|entry| entry.path())
+                .collect()
+        }));
+
+        assert!(sub.poll());
+        assert!(rx.try_recv().is_err(), "nothing changed yet");
+
+        std::fs::write(dir.path().join("eas.json"), "[]").unwrap();
+        assert!(sub.poll());
+        assert!(rx.try_recv().is_ok());
+        assert!(sub.poll());
+        assert!(rx.try_recv().is_err(), "one signal per change");
+
+        std::fs::remove_file(dir.path().join("eas.json")).unwrap();
+        assert!(sub.poll());
+        assert!(rx.try_recv().is_ok());
+
+        drop(rx);
+        assert!(!sub.poll(), "dropped receivers unsubscribe");
+    }
+
+    #[tokio::test]
+    async fn subscribe_signals_writes_to_watched_paths() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("ea-1").join("agent_parents.json");
+        let watched = path.clone();
+        let mut rx = subscribe(move || vec![watched.clone()]);
+
+        // Let the watcher thread pick the subscription up.
+        tokio::time::sleep(Duration::from_millis(50)).await;
+        std::fs::create_dir_all(path.parent().unwrap()).unwrap();
+        std::fs::write(&path, "{}").unwrap();
+        let signalled = tokio::time::timeout(Duration::from_secs(2), rx.recv()).await;
+        assert!(matches!(signalled, Ok(Some(()))));
+    }
+}
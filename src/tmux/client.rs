@@ -2,11 +2,15 @@
 
 use anyhow::{anyhow, Context, Result};
 use std::io::Write;
-use std::process::Command;
+use std::process::{Command, Stdio};
 use std::thread;
 use std::time::{Duration, Instant};
 
-use super::Session;
+use super::control::{self, CommandOutput};
+use super::node::{self, Node};
+use super::watch::{PaneWatch, StreamMatcher};
+use super::{PaneSnapshot, Session};
+use crate::metrics;
 
 /// Options for reliable prompt delivery and related readiness helpers.
 ///
@@ -107,15 +111,20 @@ pub struct TmuxClient {
 
 pub fn tmux_command() -> Command {
     let mut cmd = Command::new("tmux");
-    if let Ok(server) = std::env::var("OMAR_TMUX_SERVER") {
-        let server = server.trim();
-        if !server.is_empty() {
-            cmd.args(["-L", server]);
-        }
+    if let Some(server) = configured_server() {
+        cmd.args(["-L", &server]);
     }
     cmd
 }
 
+/// The `-L` socket name selected via `OMAR_TMUX_SERVER`, if any.
+pub(super) fn configured_server() -> Option<String> {
+    std::env::var("OMAR_TMUX_SERVER")
+        .ok()
+        .map(|server| server.trim().to_string())
+        .filter(|server| !server.is_empty())
+}
+
 fn exact_session_target(target: &str) -> String {
     if target.starts_with('=') || target.contains(':') || target.contains('.') {
         target.to_string()
@@ -124,7 +133,7 @@ fn exact_session_target(target: &str) -> String {
     }
 }
 
-fn exact_pane_target(target: &str) -> String {
+pub(super) fn exact_pane_target(target: &str) -> String {
     if target.contains(':') || target.contains('.') {
         target.to_string()
     } else if target.starts_with('=') {
@@ -134,12 +143,15 @@ fn exact_pane_target(target: &str) -> String {
     }
 }
 
-fn popup_attach_command(target: &str) -> String {
-    let tmux_server = std::env::var("OMAR_TMUX_SERVER")
-        .ok()
-        .map(|server| server.trim().to_string())
-        .filter(|server| !server.is_empty());
-    popup_attach_command_with_server(target, tmux_server.as_deref())
+/// Session name inside a `-t` target (`=name:`, `name:0.1`, …). tmux
+/// forbids `:` and `.` in session names, so the first part is the name.
+fn target_session(target: &str) -> &str {
+    let target = target.strip_prefix('=').unwrap_or(target);
+    target.split([':', '.']).next().unwrap_or(target)
+}
+
+fn popup_attach_command(node: &Node, target: &str) -> String {
+    popup_attach_command_with_server(target, node.socket())
 }
 
 fn popup_attach_command_with_server(target: &str, tmux_server: Option<&str>) -> String {
@@ -165,26 +177,153 @@ impl TmuxClient {
         &self.prefix
     }
 
-    fn run(&self, args: &[&str]) -> Result<String> {
-        let output = tmux_command()
-            .args(args)
+    /// Run a tmux command and return its raw outcome, on the node that owns
+    /// the session it targets (see `node`). `list-sessions` asks every
+    /// node and merges the answers.
+    fn exec(&self, args: &[&str]) -> Result<CommandOutput> {
+        if node::sharded() && args.first() == Some(&"list-sessions") {
+            return self.exec_everywhere(args);
+        }
+        self.exec_on(&self.route(args), args)
+    }
+
+    /// Run a tmux command on `node`. Stateless commands go over the
+    /// server's persistent control-mode connection when one is available
+    /// (see `control`); everything else, and every command when control
+    /// mode is unavailable, forks a `tmux` client.
+    fn exec_on(&self, node: &Node, args: &[&str]) -> Result<CommandOutput> {
+        let _timer = metrics::TMUX_CALL.start_timer();
+        if args
+            .first()
+            .is_some_and(|cmd| control::control_eligible(cmd))
+        {
+            if let Some(result) = control::run(node, args) {
+                return result;
+            }
+        }
+
+        let output = node
+            .tmux(args)
             .output()
             .context("Failed to execute tmux - is tmux installed?")?;
+        control::note_exec_result(node, output.status.success());
+        Ok(CommandOutput {
+            success: output.status.success(),
+            stdout: String::from_utf8_lossy(&output.stdout).into(),
+            stderr: String::from_utf8_lossy(&output.stderr).into(),
+        })
+    }
 
-        if !output.status.success() {
-            let stderr = String::from_utf8_lossy(&output.stderr);
+    /// Run a `list-sessions` on every node at once and concatenate the
+    /// listings, recording which node holds which session. `args` must
+    /// print `#{session_name}` first on each line. A node that cannot be
+    /// reached is left out (its sessions keep their last known owner);
+    /// the call fails only when no node answered.
+    fn exec_everywhere(&self, args: &[&str]) -> Result<CommandOutput> {
+        let results: Vec<(Node, Result<CommandOutput>)> = thread::scope(|scope| {
+            let handles: Vec<_> = node::all()
+                .into_iter()
+                .map(|node| {
+                    scope.spawn(move || {
+                        let result = self.exec_on(&node, args);
+                        (node, result)
+                    })
+                })
+                .collect();
+            handles
+                .into_iter()
+                .filter_map(|handle| handle.join().ok())
+                .collect()
+        });
+
+        let mut merged = String::new();
+        let mut answered = false;
+        let mut first_failure = None;
+        for (node, result) in results {
+            match result {
+                Ok(output) if output.success => {
+                    node::replace_owned(
+                        &node,
+                        output
+                            .stdout
+                            .lines()
+                            .map(|line| line.split('|').next().unwrap_or(line)),
+                    );
+                    merged.push_str(&output.stdout);
+                    answered = true;
+                }
+                Ok(output) => {
+                    if no_server(&output.stderr) {
+                        node::replace_owned(&node, std::iter::empty());
+                    }
+                    first_failure.get_or_insert(Ok(output));
+                }
+                Err(e) => {
+                    first_failure.get_or_insert(Err(e));
+                }
+            }
+        }
+        match first_failure {
+            _ if answered => Ok(CommandOutput {
+                success: true,
+                stdout: merged,
+                stderr: String::new(),
+            }),
+            Some(failure) => failure,
+            None => Err(anyhow!("no tmux node answered")),
+        }
+    }
+
+    /// The node a command must run on: the owner of the session its `-t`
+    /// targets, or the local node.
+    fn route(&self, args: &[&str]) -> Node {
+        if !node::sharded() {
+            return Node::local();
+        }
+        args.iter()
+            .position(|arg| *arg == "-t")
+            .and_then(|flag| args.get(flag + 1))
+            .map(|target| self.node_for(target))
+            .unwrap_or_else(Node::local)
+    }
+
+    /// The node holding the session in `target`. An unknown session
+    /// triggers one listing of every node before defaulting to local.
+    fn node_for(&self, target: &str) -> Node {
+        if !node::sharded() {
+            return Node::local();
+        }
+        let session = target_session(target);
+        if let Some(owner) = node::owner(session) {
+            return owner;
+        }
+        self.refresh_owners();
+        node::owner(session).unwrap_or_else(Node::local)
+    }
+
+    fn refresh_owners(&self) {
+        let _ = self.exec_everywhere(&["list-sessions", "-F", "#{session_name}"]);
+    }
+
+    pub(super) fn run(&self, args: &[&str]) -> Result<String> {
+        Self::checked(args, self.exec(args)?)
+    }
+
+    fn run_on(&self, node: &Node, args: &[&str]) -> Result<String> {
+        Self::checked(args, self.exec_on(node, args)?)
+    }
+
+    fn checked(args: &[&str], output: CommandOutput) -> Result<String> {
+        if !output.success {
+            let stderr = output.stderr;
             // "no server running" is not an error for list-sessions.
             // Other tmux commands must surface failures to callers.
-            if args.first() == Some(&"list-sessions")
-                && (stderr.contains("no server running")
-                    || stderr.contains("no sessions")
-                    || stderr.contains("error connecting to"))
-            {
+            if args.first() == Some(&"list-sessions") && no_server(&stderr) {
                 return Ok(String::new());
             }
             anyhow::bail!("tmux error: {}", stderr);
         }
-        Ok(String::from_utf8_lossy(&output.stdout).into())
+        Ok(output.stdout)
     }
 
     /// List all sessions matching the prefix
@@ -207,6 +346,9 @@ impl TmuxClient {
                 if parts.len() != 4 {
                     return None;
                 }
+                if parts[0] == control::CONTROL_SESSION {
+                    return None;
+                }
                 Some(Session::new(
                     parts[0].to_string(),
                     parts[1].parse().ok()?,
@@ -238,6 +380,9 @@ impl TmuxClient {
                 if parts.len() != 4 {
                     return None;
                 }
+                if parts[0] == control::CONTROL_SESSION {
+                    return None;
+                }
                 Some(Session::new(
                     parts[0].to_string(),
                     parts[1].parse().ok()?,
@@ -250,6 +395,127 @@ impl TmuxClient {
         Ok(sessions)
     }
 
+    /// Snapshot every session whose name starts with `prefix` (all sessions
+    /// when empty): session fields, pane activity and current command from a
+    /// single `list-sessions`, plus — when `tail_lines > 0` — a plain-text
+    /// tail of each pane captured in one batch. Over a control connection
+    /// the captures are pipelined into one round-trip; on the exec path they
+    /// run as a single chained `;` invocation. Callers polling many agents
+    /// should prefer this over per-session `capture_pane_plain` /
+    /// `get_pane_activity` calls.
+    pub fn snapshot_all(&self, prefix: &str, tail_lines: i32) -> Result<Vec<PaneSnapshot>> {
+        let output = self.run(&[
+            "list-sessions",
+            "-F",
+            "#{session_name}|#{session_activity}|#{session_attached}|#{pane_pid}|#{window_activity}|#{pane_current_command}",
+        ])?;
+
+        let mut snapshots: Vec<PaneSnapshot> = output
+            .lines()
+            .filter(|line| prefix.is_empty() || line.starts_with(prefix))
+            .filter_map(parse_snapshot_line)
+            .collect();
+
+        if tail_lines > 0 && !snapshots.is_empty() {
+            let names: Vec<&str> = snapshots.iter().map(|s| s.session.name.as_str()).collect();
+            let tails = self.capture_tails(&names, tail_lines);
+            for (snapshot, tail) in snapshots.iter_mut().zip(tails) {
+                snapshot.tail = tail;
+            }
+        }
+        Ok(snapshots)
+    }
+
+    /// Plain-text tails for `sessions`, in order. A pane that cannot be
+    /// captured (e.g. its session died mid-batch) yields an empty tail.
+    /// Each node's panes are captured as one batch, all nodes at once.
+    fn capture_tails(&self, sessions: &[&str], lines: i32) -> Vec<String> {
+        if !node::sharded() {
+            return self.capture_tails_on(&Node::local(), sessions, lines);
+        }
+        let mut groups: Vec<(Node, Vec<usize>)> = Vec::new();
+        for (index, session) in sessions.iter().enumerate() {
+            let owner = self.node_for(session);
+            match groups.iter_mut().find(|(node, _)| node.name == owner.name) {
+                Some((_, indices)) => indices.push(index),
+                None => groups.push((owner, vec![index])),
+            }
+        }
+        let mut tails = vec![String::new(); sessions.len()];
+        thread::scope(|scope| {
+            let handles: Vec<_> = groups
+                .iter()
+                .map(|(node, indices)| {
+                    scope.spawn(move || {
+                        let names: Vec<&str> = indices.iter().map(|&i| sessions[i]).collect();
+                        self.capture_tails_on(node, &names, lines)
+                    })
+                })
+                .collect();
+            for ((_, indices), handle) in groups.iter().zip(handles) {
+                if let Ok(captured) = handle.join() {
+                    for (&index, tail) in indices.iter().zip(captured) {
+                        tails[index] = tail;
+                    }
+                }
+            }
+        });
+        tails
+    }
+
+    fn capture_tails_on(&self, node: &Node, sessions: &[&str], lines: i32) -> Vec<String> {
+        let start = (-lines).to_string();
+        let targets: Vec<String> = sessions.iter().map(|s| exact_pane_target(s)).collect();
+        let commands: Vec<[&str; 6]> = targets
+            .iter()
+            .map(|target| ["capture-pane", "-t", target, "-p", "-S", &start])
+            .collect();
+        let batch: Vec<&[&str]> = commands.iter().map(|c| c.as_slice()).collect();
+
+        if let Some(Ok(outputs)) = control::run_batch(node, &batch) {
+            return outputs
+                .into_iter()
+                .map(|out| {
+                    if out.success {
+                        tail_pane_lines(out.stdout, lines)
+                    } else {
+                        String::new()
+                    }
+                })
+                .collect();
+        }
+
+        // Exec path: one tmux process runs every capture, each followed by
+        // a delimiter line so the combined stdout can be split back apart.
+        let delimiter = format!("omar-snapshot-{}", uuid::Uuid::new_v4().simple());
+        let mut args: Vec<&str> = Vec::with_capacity(commands.len() * 11);
+        for command in &commands {
+            if !args.is_empty() {
+                args.push(";");
+            }
+            args.extend_from_slice(command);
+            args.extend_from_slice(&[";", "display-message", "-p", &delimiter]);
+        }
+        let chained = node
+            .tmux(&args)
+            .output()
+            .ok()
+            .filter(|out| out.status.success())
+            .map(|out| split_delimited(&String::from_utf8_lossy(&out.stdout), &delimiter));
+        match chained {
+            Some(tails) if tails.len() == sessions.len() => tails
+                .into_iter()
+                .map(|tail| tail_pane_lines(tail, lines))
+                .collect(),
+            // tmux aborts a command list at the first failure, so a session
+            // vanishing mid-batch costs one capture per pane instead.
+            _ => sessions
+                .iter()
+                .map(|session| self.capture_pane_plain(session, lines).unwrap_or_default())
+                .collect(),
+        }
+    }
+
     /// Capture the last N lines of a pane's output, including ANSI escape
     /// sequences (suitable for display in a colored dashboard).
     pub fn capture_pane(&self, target: &str, lines: i32) -> Result<String> {
@@ -347,8 +613,8 @@ impl TmuxClient {
     /// Send literal text to a pane.
     ///
     /// For small payloads uses `send-keys -l` directly. For large payloads
-    /// (>= 2 KB) writes to a temporary file and uses `load-buffer` +
-    /// `paste-buffer` to avoid tmux's internal message-size limit, which
+    /// (>= 2 KB) streams the text into a named buffer and pastes it (see
+    /// `paste_payload`) to avoid tmux's internal message-size limit, which
     /// silently drops oversized `send-keys -l` arguments.
     pub const LARGE_PAYLOAD_THRESHOLD: usize = 2048;
 
@@ -357,22 +623,71 @@ impl TmuxClient {
         if text.len() < Self::LARGE_PAYLOAD_THRESHOLD {
             self.run(&["send-keys", "-t", &target, "-l", "--", text])?;
         } else {
-            // Avoid passing large text as a CLI arg; owner-only temp file is
-            // removed when `tmp` drops.
-            let mut tmp = crate::paths::create_private_temp_file("omar-task", "txt")
-                .context("Failed to create temp file for task payload")?;
-            tmp.write_all(text.as_bytes())
-                .context("Failed to write task to temp file")?;
-            let path_str = tmp
-                .path()
-                .to_str()
-                .context("Temp file path is not valid UTF-8")?;
-            self.run(&["load-buffer", path_str])?;
-            self.run(&["paste-buffer", "-t", &target])?;
+            self.paste_payload(&target, text, &[])?;
         }
         Ok(())
     }
 
+    /// Load `text` into a fresh named buffer and paste it into `target`
+    /// with `paste-buffer -d <paste_flags>`, in a single round-trip and
+    /// without the payload ever touching disk or a process command line
+    /// (payloads can carry pasted secrets, and `/proc/<pid>/cmdline` is
+    /// world-readable).
+    ///
+    /// Over a control connection the payload rides the private stdin pipe
+    /// as a quoted `set-buffer` argument, pipelined with the paste. On the
+    /// exec path one forked client runs `load-buffer -` (payload on its
+    /// stdin) chained with `paste-buffer` via tmux's `;` separator. A failed
+    /// load or paste deletes the buffer best-effort so nothing accumulates.
+    fn paste_payload(&self, target: &str, text: &str, paste_flags: &[&str]) -> Result<()> {
+        let buffer_name = format!("omar-paste-{}", uuid::Uuid::new_v4());
+        let mut paste = vec!["paste-buffer", "-b", &buffer_name, "-t", target, "-d"];
+        paste.extend_from_slice(paste_flags);
+        let cleanup = ["delete-buffer", "-b", buffer_name.as_str()];
+        // Buffers are per server: load and paste on the pane's node.
+        let node = self.node_for(target);
+
+        let timer = metrics::TMUX_CALL.start_timer();
+        let load = ["set-buffer", "-b", &buffer_name, "--", text];
+        if let Some(result) = control::run_batch(&node, &[&load, &paste]) {
+            drop(timer);
+            if let Some(failed) = result?.into_iter().find(|output| !output.success) {
+                let _ = self.exec_on(&node, &cleanup);
+                anyhow::bail!("tmux error: {}", failed.stderr);
+            }
+            return Ok(());
+        }
+
+        let mut chained = vec!["load-buffer", "-b", &buffer_name, "-", ";"];
+        chained.extend_from_slice(&paste);
+        let mut child = node
+            .tmux(&chained)
+            .stdin(Stdio::piped())
+            .stdout(Stdio::piped())
+            .stderr(Stdio::piped())
+            .spawn()
+            .context("Failed to execute tmux - is tmux installed?")?;
+        // Dropping stdin after the write is the EOF that ends load-buffer.
+        // A write error (tmux exited early) is reported after the exit
+        // status, whose stderr says why.
+        let written = child
+            .stdin
+            .take()
+            .context("tmux stdin was not captured")?
+            .write_all(text.as_bytes());
+        let output = child
+            .wait_with_output()
+            .context("Failed to wait for tmux")?;
+        drop(timer);
+        control::note_exec_result(&node, output.status.success());
+        if !output.status.success() {
+            let _ = self.exec_on(&node, &cleanup);
+            anyhow::bail!("tmux error: {}", String::from_utf8_lossy(&output.stderr));
+        }
+        written.context("Failed to stream paste payload to tmux")?;
+        Ok(())
+    }
+
     /// Paste text into a pane via load-buffer + paste-buffer.
     /// Uses bracketed paste (-p) so the backend receives the entire payload
     /// as a single paste event. This is more reliable than send-keys for
@@ -394,34 +709,10 @@ impl TmuxClient {
     /// this but `-r` makes behavior identical across versions.
     pub fn paste_text(&self, target: &str, text: &str) -> Result<()> {
         let target = exact_pane_target(target);
-        let buffer_name = format!("omar-paste-{}", uuid::Uuid::new_v4());
-
-        // Owner-only temp file (payloads can carry pasted secrets), removed
-        // when `tmp` drops.
-        let mut tmp = crate::paths::create_private_temp_file("omar-paste", "txt")
-            .context("Failed to create temp file for paste payload")?;
-        tmp.write_all(text.as_bytes())
-            .context("Failed to write paste text to temp file")?;
-        let path_str = tmp
-            .path()
-            .to_str()
-            .context("Temp file path is not valid UTF-8")?;
-        self.run(&["load-buffer", "-b", &buffer_name, path_str])?;
-        // Paste from the named buffer using bracketed paste mode so the
-        // target pane treats it as a single paste operation. `-d` deletes
-        // the buffer after pasting. `-r` preserves LFs verbatim — see the
-        // doc comment above for why this matters for raw-mode TUIs.
-        self.run(&[
-            "paste-buffer",
-            "-b",
-            &buffer_name,
-            "-t",
-            &target,
-            "-d",
-            "-p",
-            "-r",
-        ])?;
-        Ok(())
+        // Bracketed paste (`-p`) so the target pane treats it as a single
+        // paste operation; `-r` preserves LFs verbatim — see the doc
+        // comment above for why this matters for raw-mode TUIs.
+        self.paste_payload(&target, text, &["-p", "-r"])
     }
 
     /// Reliably deliver a prompt to a tmux session.
@@ -462,6 +753,11 @@ impl TmuxClient {
     ///    encoding layer.
     /// 6. Verify with `wait_for_change` that Enter caused an observable
     ///    transition. If not, clear the input and retry.
+    ///
+    /// When the pane can be streamed (`PaneWatch`), steps 3 and 6 wait on
+    /// the pane's output instead of polling: captures run only to confirm
+    /// a matcher hit or settled output, and any output after Enter counts
+    /// as the transition.
     pub fn deliver_prompt(&self, session: &str, text: &str, opts: &DeliveryOptions) -> Result<()> {
         // Per-delivery UUID so a stale sentinel from a previous delivery
         // cannot false-positive the end-sentinel poll on retry.
@@ -471,7 +767,16 @@ impl TmuxClient {
         let end_sentinel = format!("<UserPromptEnds:{}>", short_id);
         let wrapped = format!("{}\n{}\n{}", start_sentinel, text, end_sentinel);
 
+        // Stream the pane's output for the whole delivery so the waits below
+        // wake on what the TUI prints instead of polling captures. `None`
+        // (pane already piped, or tmux refused) keeps the polling path.
+        let mut watch = PaneWatch::start(self, &exact_pane_target(session));
+
         for attempt in 1..=opts.max_retries {
+            metrics::DELIVERY_ATTEMPTS.inc();
+            if attempt > 1 {
+                metrics::DELIVERY_RETRIES.inc();
+            }
             // Clear any leftover input from a prior attempt. No-op on the
             // first attempt against a fresh widget.
             let _ = self.send_keys(session, "C-u");
@@ -486,6 +791,9 @@ impl TmuxClient {
                 .matches(PASTE_PLACEHOLDER_MARKER)
                 .count();
 
+            if let Some(watch) = watch.as_mut() {
+                watch.skip_pending();
+            }
             self.paste_text(session, &wrapped)?;
 
             // Wait until we have proof the paste rendered. Two acceptable
@@ -499,7 +807,16 @@ impl TmuxClient {
             //       renders literally. We compare counts rather than mere
             //       presence so a stale placeholder from prior chat
             //       history can't false-positive the check.
-            let rendered = {
+            let rendered = if let Some(watch) = watch.as_mut() {
+                self.wait_rendered_streaming(
+                    watch,
+                    session,
+                    &end_sentinel,
+                    baseline_placeholders,
+                    opts.verify_timeout,
+                    opts.poll_interval,
+                )
+            } else {
                 let deadline = Instant::now() + opts.verify_timeout;
                 let mut found = false;
                 while Instant::now() < deadline {
@@ -526,16 +843,30 @@ impl TmuxClient {
             let content_before = self.capture_pane(session, 50).unwrap_or_default();
             let activity_before = self.get_pane_activity(session).unwrap_or(0);
 
+            if let Some(watch) = watch.as_mut() {
+                watch.skip_pending();
+            }
             let target = exact_pane_target(session);
             self.run(&["send-keys", "-t", &target, "-H", "0d"])?;
 
-            if self.wait_for_change(
-                session,
-                activity_before,
-                &content_before,
-                opts.verify_timeout,
-                opts.poll_interval,
-            ) {
+            let submitted = if let Some(watch) = watch.as_mut() {
+                self.wait_for_output(
+                    watch,
+                    session,
+                    activity_before,
+                    &content_before,
+                    opts.verify_timeout,
+                )
+            } else {
+                self.wait_for_change(
+                    session,
+                    activity_before,
+                    &content_before,
+                    opts.verify_timeout,
+                    opts.poll_interval,
+                )
+            };
+            if submitted {
                 return Ok(());
             }
 
@@ -544,6 +875,7 @@ impl TmuxClient {
             }
         }
 
+        metrics::DELIVERY_FAILURES.inc();
         anyhow::bail!(
             "prompt delivery to '{}' was not verified after {} attempt(s)",
             session,
@@ -615,6 +947,81 @@ impl TmuxClient {
         false
     }
 
+    /// Streaming counterpart of the render poll in `deliver_prompt`. Output
+    /// completing the end sentinel or a `[Pasted ` marker triggers an
+    /// immediate capture to confirm (TUIs may repaint an old placeholder);
+    /// so does the stream going quiet for `quiet` after unconfirmed output,
+    /// because line wrapping or widget borders can split the sentinel where
+    /// the matcher cannot see it. A final check at the deadline means the
+    /// stream only ever saves captures — it never misses a render the
+    /// capture poll would have seen.
+    fn wait_rendered_streaming(
+        &self,
+        watch: &mut PaneWatch<'_>,
+        session: &str,
+        end_sentinel: &str,
+        baseline_placeholders: usize,
+        timeout: Duration,
+        quiet: Duration,
+    ) -> bool {
+        let confirm = || {
+            self.capture_pane_plain(session, 200)
+                .map(|hay| paste_rendered(&hay, end_sentinel, baseline_placeholders))
+                .unwrap_or(false)
+        };
+        let mut matcher = StreamMatcher::new(&[end_sentinel, PASTE_PLACEHOLDER_MARKER]);
+        let deadline = Instant::now() + timeout;
+        let mut unconfirmed_since: Option<Instant> = None;
+        while Instant::now() < deadline {
+            // Block until output arrives, or until the stream has been
+            // quiet long enough to confirm by capture.
+            let wait = unconfirmed_since
+                .map_or(timeout, |at| quiet.saturating_sub(at.elapsed()))
+                .min(deadline.saturating_duration_since(Instant::now()));
+            let chunk = watch.wait_new(wait);
+            if !chunk.is_empty() {
+                if matcher.feed(&chunk) && confirm() {
+                    return true;
+                }
+                unconfirmed_since = Some(Instant::now());
+            } else if unconfirmed_since.is_some_and(|at| at.elapsed() >= quiet) {
+                unconfirmed_since = None;
+                if confirm() {
+                    return true;
+                }
+            }
+        }
+        confirm()
+    }
+
+    /// Streaming counterpart of `wait_for_change`: any pane output after
+    /// Enter is the observable transition. If the stream stays silent, one
+    /// activity/content comparison at the deadline covers output the pipe
+    /// may have missed.
+    fn wait_for_output(
+        &self,
+        watch: &mut PaneWatch<'_>,
+        session: &str,
+        activity_before: i64,
+        content_before: &str,
+        timeout: Duration,
+    ) -> bool {
+        let deadline = Instant::now() + timeout;
+        while Instant::now() < deadline {
+            if !watch
+                .wait_new(deadline.saturating_duration_since(Instant::now()))
+                .is_empty()
+            {
+                return true;
+            }
+        }
+        self.get_pane_activity(session)
+            .is_ok_and(|current| current > activity_before)
+            || self
+                .capture_pane(session, 50)
+                .is_ok_and(|content| content != content_before)
+    }
+
     /// Wait until pane output contains ALL of the provided markers.
     /// Matching is case-insensitive; returns false on timeout.
     ///
@@ -652,6 +1059,35 @@ impl TmuxClient {
 
     /// Create a new detached session
     pub fn new_session(&self, name: &str, command: &str, workdir: Option<&str>) -> Result<()> {
+        self.new_session_on(&Node::local(), name, command, workdir)
+    }
+
+    /// Create a new detached agent session on the node with the most room
+    /// (see `node::place`). Without extra nodes this is `new_session`.
+    /// Sessions the dashboard itself drives (managers) stay on
+    /// `new_session` so they are always local.
+    pub fn new_agent_session(
+        &self,
+        name: &str,
+        command: &str,
+        workdir: Option<&str>,
+    ) -> Result<()> {
+        if !node::sharded() {
+            return self.new_session(name, command, workdir);
+        }
+        // Other processes spawn too: count what every node holds now.
+        self.refresh_owners();
+        let target = node::place()?;
+        self.new_session_on(&target, name, command, workdir)
+    }
+
+    fn new_session_on(
+        &self,
+        node: &Node,
+        name: &str,
+        command: &str,
+        workdir: Option<&str>,
+    ) -> Result<()> {
         let mut args = vec!["new-session", "-d", "-s", name];
 
         if let Some(dir) = workdir {
@@ -662,8 +1098,25 @@ impl TmuxClient {
         // interpreted consistently (including quoted args and shell metacharacters)
         // instead of relying on tmux's shell-command parser heuristics.
         args.extend(["sh", "-lc", command]);
-        self.run(&args)?;
-        self.run(&["set-option", "-t", name, "history-limit", "10000"])?;
+        self.run_on(node, &args)?;
+        if node::sharded() {
+            node::record_owner(name, node);
+        }
+        self.run_on(node, &["set-option", "-t", name, "history-limit", "10000"])?;
+        Ok(())
+    }
+
+    /// Rename a session. Fails if `name` no longer exists or `new_name` is
+    /// taken, so of several callers racing to rename one session only one
+    /// succeeds.
+    pub fn rename_session(&self, name: &str, new_name: &str) -> Result<()> {
+        let target = exact_session_target(name);
+        let owner = self.node_for(&target);
+        self.run_on(&owner, &["rename-session", "-t", &target, new_name])?;
+        if node::sharded() {
+            node::forget(name);
+            node::record_owner(new_name, &owner);
+        }
         Ok(())
     }
 
@@ -671,18 +1124,16 @@ impl TmuxClient {
     pub fn kill_session(&self, name: &str) -> Result<()> {
         let target = exact_session_target(name);
         self.run(&["kill-session", "-t", &target])?;
+        if node::sharded() {
+            node::forget(name);
+        }
         Ok(())
     }
 
     /// Check if a session exists
     pub fn has_session(&self, name: &str) -> Result<bool> {
         let target = exact_session_target(name);
-        let result = tmux_command()
-            .args(["has-session", "-t", &target])
-            .output()
-            .context("Failed to execute tmux")?;
-
-        Ok(result.status.success())
+        Ok(self.exec(&["has-session", "-t", &target])?.success)
     }
 
     /// Return true when a tmux session exists and has at least one live pane.
@@ -692,13 +1143,10 @@ impl TmuxClient {
     /// but the session cannot accept input or be attached as a running agent.
     pub fn session_has_live_pane(&self, name: &str) -> Result<bool> {
         let target = exact_session_target(name);
-        let result = tmux_command()
-            .args(["list-panes", "-t", &target, "-F", "#{pane_dead}"])
-            .output()
-            .context("Failed to execute tmux")?;
+        let result = self.exec(&["list-panes", "-t", &target, "-F", "#{pane_dead}"])?;
 
-        if !result.status.success() {
-            let stderr = String::from_utf8_lossy(&result.stderr);
+        if !result.success {
+            let stderr = result.stderr;
             if stderr.contains("can't find")
                 || stderr.contains("no server running")
                 || stderr.contains("no sessions")
@@ -709,9 +1157,7 @@ impl TmuxClient {
             anyhow::bail!("tmux error: {}", stderr);
         }
 
-        Ok(String::from_utf8_lossy(&result.stdout)
-            .lines()
-            .any(|line| line.trim() != "1"))
+        Ok(result.stdout.lines().any(|line| line.trim() != "1"))
     }
 
     /// Find a session by exact name.
@@ -737,8 +1183,8 @@ impl TmuxClient {
     /// Attach to a session (blocks until detached)
     pub fn attach_session(&self, session: &str) -> Result<()> {
         let target = exact_session_target(session);
-        tmux_command()
-            .args(["attach-session", "-t", &target])
+        self.node_for(&target)
+            .tmux(&["attach-session", "-t", &target])
             .status()
             .context("Failed to attach to tmux session")?;
         Ok(())
@@ -747,7 +1193,7 @@ impl TmuxClient {
     /// Open a popup attached to a session
     pub fn attach_popup(&self, session: &str, width: &str, height: &str) -> Result<()> {
         let target = exact_session_target(session);
-        let command = popup_attach_command(&target);
+        let command = popup_attach_command(&self.node_for(&target), &target);
         let status = tmux_command()
             .args(["display-popup", "-E", "-w", width, "-h", height, &command])
             .status()
@@ -759,6 +1205,48 @@ impl TmuxClient {
     }
 }
 
+fn parse_snapshot_line(line: &str) -> Option<PaneSnapshot> {
+    // The command is last so a stray `|` in it cannot shift other fields.
+    let parts: Vec<&str> = line.splitn(6, '|').collect();
+    if parts.len() != 6 || parts[0] == control::CONTROL_SESSION {
+        return None;
+    }
+    Some(PaneSnapshot {
+        session: Session::new(
+            parts[0].to_string(),
+            parts[1].parse().ok()?,
+            parts[2] == "1",
+            parts[3].parse().ok()?,
+        ),
+        pane_activity: parts[4].parse().ok()?,
+        command: parts[5].to_string(),
+        tail: String::new(),
+    })
+}
+
+/// True when tmux's stderr means the server has no sessions to list.
+fn no_server(stderr: &str) -> bool {
+    stderr.contains("no server running")
+        || stderr.contains("no sessions")
+        || stderr.contains("error connecting to")
+}
+
+/// Split chained-command stdout on `delimiter` lines. Each chunk keeps its
+/// trailing newlines so it matches a standalone capture's output.
+fn split_delimited(output: &str, delimiter: &str) -> Vec<String> {
+    let mut chunks = Vec::new();
+    let mut current = String::new();
+    for line in output.lines() {
+        if line == delimiter {
+            chunks.push(std::mem::take(&mut current));
+        } else {
+            current.push_str(line);
+            current.push('\n');
+        }
+    }
+    chunks
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -1672,6 +2160,64 @@ mod tests {
         );
     }
 
+    /// The streamed paste path must deliver payloads byte-for-byte — a
+    /// leading `-`, `$VAR`, quotes and backslashes must not be read as
+    /// flags or expanded by tmux's command parser — and a failed paste must
+    /// not leave its named buffer behind.
+    #[test]
+    fn test_paste_payload_is_verbatim_and_cleans_up_on_failure() {
+        if !tmux_available() {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+
+        let session = "omar-test-paste-verbatim";
+        let _ = tmux_command()
+            .args(["kill-session", "-t", session])
+            .output();
+        let _guard = SessionGuard(session.to_string());
+        let ok = tmux_command()
+            .args(["new-session", "-d", "-s", session, "cat"])
+            .status()
+            .map(|s| s.success())
+            .unwrap_or(false);
+        if !ok {
+            eprintln!("Skipping test: failed to create tmux session");
+            return;
+        }
+
+        let marker = uuid::Uuid::new_v4().simple().to_string();
+        let payload = format!("-n $HOME \"q\" \\x {marker}");
+        let client = TmuxClient::new("omar-test-");
+        if client.paste_text(session, &payload).is_err() {
+            eprintln!("Skipping test: paste_text failed (sandbox?)");
+            return;
+        }
+        let deadline = Instant::now() + Duration::from_secs(3);
+        let mut pane = String::new();
+        while Instant::now() < deadline {
+            pane = client.capture_pane_plain(session, 100).unwrap_or_default();
+            if pane.contains(&marker) {
+                break;
+            }
+            thread::sleep(Duration::from_millis(50));
+        }
+        assert!(
+            pane.contains(&payload),
+            "paste must arrive verbatim: {pane:?}"
+        );
+
+        let missing = format!("{session}:99");
+        assert!(client.paste_text(&missing, &marker).is_err());
+        let buffers = client
+            .run(&["list-buffers", "-F", "#{buffer_sample}"])
+            .unwrap_or_default();
+        assert!(
+            !buffers.contains(&marker),
+            "failed paste leaked its buffer: {buffers:?}"
+        );
+    }
+
     /// Regression: `deliver_prompt` must wrap the payload with per-delivery
     /// UUID sentinels and only submit once the end sentinel has rendered
     /// into the pane. The previous implementation used heuristic needle
@@ -1806,6 +2352,75 @@ mod tests {
         );
     }
 
+    #[test]
+    fn test_parse_snapshot_line_and_split_delimited() {
+        let snap = parse_snapshot_line("omar-agent-a|100|1|4242|105|node|x").unwrap();
+        assert_eq!(snap.session.name, "omar-agent-a");
+        assert_eq!(snap.session.activity, 100);
+        assert!(snap.session.attached);
+        assert_eq!(snap.session.pane_pid, 4242);
+        assert_eq!(snap.pane_activity, 105);
+        assert_eq!(snap.command, "node|x");
+        assert!(parse_snapshot_line("__omar_control|1|1|2|3|cat").is_none());
+        assert!(parse_snapshot_line("short|1|0|2").is_none());
+
+        assert_eq!(
+            split_delimited("a\nb\n\nD\nc\nD\n", "D"),
+            vec!["a\nb\n\n".to_string(), "c\n".to_string()]
+        );
+    }
+
+    #[test]
+    fn test_snapshot_all_collects_every_matching_session() {
+        if !tmux_available() {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+
+        let names = ["omar-test-snapshot-a", "omar-test-snapshot-b"];
+        let mut guards = Vec::new();
+        for (i, name) in names.iter().enumerate() {
+            let _ = tmux_command().args(["kill-session", "-t", name]).output();
+            guards.push(SessionGuard(name.to_string()));
+            let command = format!("echo snapshot-marker-{i}; sleep 60");
+            let ok = tmux_command()
+                .args(["new-session", "-d", "-s", name, &command])
+                .status()
+                .map(|s| s.success())
+                .unwrap_or(false);
+            if !ok {
+                eprintln!("Skipping test: failed to create tmux session");
+                return;
+            }
+        }
+        thread::sleep(Duration::from_millis(300));
+
+        let client = TmuxClient::new("omar-test-");
+        // Twice: the first call runs on the exec path, the second may ride
+        // the control connection. Both must agree.
+        for _ in 0..2 {
+            let snapshots = client.snapshot_all("omar-test-snapshot-", 50).unwrap();
+            assert_eq!(snapshots.len(), 2, "got {snapshots:?}");
+            for (i, name) in names.iter().enumerate() {
+                let snap = snapshots
+                    .iter()
+                    .find(|s| s.session.name == *name)
+                    .expect("snapshot for session");
+                assert!(snap.pane_activity > 0);
+                assert!(snap.session.pane_pid > 0);
+                assert!(!snap.command.is_empty());
+                assert!(
+                    snap.tail.contains(&format!("snapshot-marker-{i}")),
+                    "tail for {name}: {:?}",
+                    snap.tail
+                );
+            }
+        }
+
+        let bare = client.snapshot_all("omar-test-snapshot-", 0).unwrap();
+        assert!(bare.iter().all(|s| s.tail.is_empty()));
+    }
+
     fn extract_sentinel_id(hay: &str, prefix: &str) -> Option<String> {
         let start = hay.find(prefix)? + prefix.len();
         let rest = &hay[start..];
@@ -0,0 +1,694 @@
+//! Persistent tmux control-mode (`tmux -C`) connections.
+//!
+//! Forking a `tmux` client per command dominates dashboard CPU once a swarm
+//! grows past a few dozen agents: every refresh issues a `list-sessions`
+//! plus a capture per session, and every prompt delivery polls the pane
+//! dozens of times. A control-mode client is a single long-lived `tmux -C`
+//! process that reads commands on stdin and answers each one with a
+//! `%begin <time> <number> <flags>` … `%end`/`%error` block on stdout, so one
+//! connection per tmux server replaces all of those forks.
+//!
+//! Commands are pipelined: callers write their command line and enqueue a
+//! reply slot under one writer lock, and the reader thread hands completed
+//! blocks to slots in FIFO order (tmux executes a client's commands
+//! strictly in order). Blocks whose flags lack bit 0 were not requested by
+//! us (e.g. the initial attach) and are skipped, as are `%` notifications.
+//!
+//! A control client must be attached to a session, and attaching to an
+//! agent session would flip its `session_attached` flag — which the kill
+//! path refuses to touch. Connections therefore attach to a dedicated
+//! hidden session ([`CONTROL_SESSION`]) created with `destroy-unattached`,
+//! so it disappears with the last control client and never outlives us.
+//! Session listings in `TmuxClient` filter it out.
+//!
+//! Not every command is routed here: session creation depends on the
+//! calling client's cwd/environment and attach/popup are interactive, so
+//! only the stateless query/input commands in [`control_eligible`] are
+//! multiplexed. Everything else — and everything when control mode fails
+//! or `OMAR_TMUX_CONTROL=0` — takes the classic fork/exec path.
+
+use anyhow::{anyhow, Result};
+use std::collections::{HashMap, VecDeque};
+use std::io::{BufRead, BufReader, Write};
+use std::process::{Child, ChildStdin, Stdio};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::mpsc::{self, SyncSender};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use super::health;
+use super::node::Node;
+
+/// Name of the hidden session every control client attaches to.
+pub(crate) const CONTROL_SESSION: &str = "__omar_control";
+
+/// Upper bound on a single command round-trip. tmux answers in
+/// milliseconds; hitting this means the connection is wedged, so it is torn
+/// down rather than left to block every later caller.
+const REPLY_TIMEOUT: Duration = Duration::from_secs(10);
+
+/// How long to stay on the exec path after a connection fails before trying
+/// to reconnect.
+const RECONNECT_BACKOFF: Duration = Duration::from_secs(5);
+
+/// Commands that behave identically over a control connection and a forked
+/// client. Anything that depends on the client's cwd/environment
+/// (`new-session`) or needs a terminal (`attach-session`, `display-popup`)
+/// stays on the exec path.
+pub(crate) fn control_eligible(command: &str) -> bool {
+    matches!(
+        command,
+        "capture-pane"
+            | "display-message"
+            | "list-sessions"
+            | "list-panes"
+            | "has-session"
+            | "send-keys"
+            | "set-buffer"
+            | "load-buffer"
+            | "paste-buffer"
+            | "pipe-pane"
+            | "delete-buffer"
+            | "set-option"
+            | "kill-session"
+    )
+}
+
+/// Transport-independent result of one tmux command, shaped like the exec
+/// path's `Output`: stdout/stderr text with one `\n`-terminated line each.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct CommandOutput {
+    pub success: bool,
+    pub stdout: String,
+    pub stderr: String,
+}
+
+/// One complete `%begin` … `%end`/`%error` block.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct Reply {
+    /// Bit 0 of the block flags: set when the command came from this
+    /// client's stdin rather than from tmux itself.
+    pub client_originated: bool,
+    pub success: bool,
+    pub body: Vec<String>,
+}
+
+impl Reply {
+    fn into_output(self) -> CommandOutput {
+        let mut text = String::new();
+        for line in &self.body {
+            text.push_str(line);
+            text.push('\n');
+        }
+        if self.success {
+            CommandOutput {
+                success: true,
+                stdout: text,
+                stderr: String::new(),
+            }
+        } else {
+            CommandOutput {
+                success: false,
+                stdout: String::new(),
+                stderr: text,
+            }
+        }
+    }
+}
+
+/// A parsed control-mode protocol unit.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) enum ControlLine {
+    Reply(Reply),
+    /// Any `%…` line outside a reply block (`%output`, `%sessions-changed`…).
+    Notification(String),
+    /// The server closed the connection (`%exit [reason]`).
+    Exit,
+}
+
+struct OpenBlock {
+    /// `<time> <number> <flags>` — a closing line must repeat it exactly,
+    /// so pane text that happens to start with `%end` cannot end the block.
+    guard: String,
+    client_originated: bool,
+    body: Vec<String>,
+}
+
+/// Line-oriented state machine for the control-mode reply protocol.
+#[derive(Default)]
+pub(crate) struct ReplyParser {
+    open: Option<OpenBlock>,
+}
+
+impl ReplyParser {
+    /// Feed one line (without its trailing `\n`). Returns a complete unit
+    /// when the line finishes one.
+    pub fn feed(&mut self, line: &str) -> Option<ControlLine> {
+        if let Some(block) = self.open.as_mut() {
+            let closing = line
+                .strip_prefix("%end ")
+                .map(|guard| (guard, true))
+                .or_else(|| line.strip_prefix("%error ").map(|guard| (guard, false)));
+            if let Some((guard, success)) = closing {
+                if guard == block.guard {
+                    let block = self.open.take()?;
+                    return Some(ControlLine::Reply(Reply {
+                        client_originated: block.client_originated,
+                        success,
+                        body: block.body,
+                    }));
+                }
+            }
+            block.body.push(line.to_string());
+            return None;
+        }
+
+        if let Some(guard) = line.strip_prefix("%begin ") {
+            let flags = guard.split(' ').nth(2)?.parse::<u32>().ok()?;
+            self.open = Some(OpenBlock {
+                guard: guard.to_string(),
+                client_originated: flags & 1 == 1,
+                body: Vec::new(),
+            });
+            return None;
+        }
+        if line == "%exit" || line.starts_with("%exit ") {
+            return Some(ControlLine::Exit);
+        }
+        if line.starts_with('%') {
+            return Some(ControlLine::Notification(line.to_string()));
+        }
+        None
+    }
+}
+
+/// Extract the value of an activity-subscription notification:
+/// `%subscription-changed <name> $<sid> @<wid> <idx> %<pid> : <value>`.
+/// The fields before ` : ` never contain user data, so the first separator
+/// is the real one even when session names contain it.
+fn activity_value(line: &str) -> Option<&str> {
+    let rest = line
+        .strip_prefix("%subscription-changed ")?
+        .strip_prefix(health::ACTIVITY_SUBSCRIPTION)?
+        .strip_prefix(' ')?;
+    rest.split_once(" : ").map(|(_, value)| value)
+}
+
+/// Quote one argument for the tmux command parser. Double quotes with
+/// escapes keep the command on a single stdin line (newlines become `\n`)
+/// and disable `$VAR`/`~` expansion, so the argument reaches the command
+/// byte-for-byte as the exec path would pass it.
+pub(crate) fn quote_arg(arg: &str) -> String {
+    let mut out = String::with_capacity(arg.len() + 2);
+    out.push('"');
+    for ch in arg.chars() {
+        match ch {
+            '\\' => out.push_str("\\\\"),
+            '"' => out.push_str("\\\""),
+            '$' => out.push_str("\\$"),
+            '\n' => out.push_str("\\n"),
+            '\r' => out.push_str("\\r"),
+            '\t' => out.push_str("\\t"),
+            c if (c as u32) < 0x20 || c == '\u{7f}' => {
+                out.push_str(&format!("\\{:03o}", c as u32));
+            }
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+    out
+}
+
+fn command_line(args: &[&str]) -> String {
+    let mut line = String::new();
+    for (i, arg) in args.iter().enumerate() {
+        if i > 0 {
+            line.push(' ');
+        }
+        line.push_str(&quote_arg(arg));
+    }
+    line.push('\n');
+    line
+}
+
+/// Why a control-mode call did not produce a reply.
+pub(crate) enum ControlFailure {
+    /// The command was never written; retrying on the exec path is safe.
+    NotSent,
+    /// The command may have run but its reply was lost. Not retried, since
+    /// commands like `send-keys` are not idempotent.
+    Lost(anyhow::Error),
+}
+
+struct Connection {
+    stdin: Mutex<ChildStdin>,
+    pending: Arc<Mutex<VecDeque<SyncSender<Reply>>>>,
+    alive: Arc<AtomicBool>,
+    child: Mutex<Child>,
+}
+
+impl Connection {
+    fn open(node: &Node) -> Result<Self> {
+        // `cat` idles on the hidden pane without printing anything. `$TMUX`
+        // is deliberately inherited: without `-L`, tmux resolves the socket
+        // from it, and the connection must reach the same server the exec
+        // path does (control clients are exempt from the nesting check).
+        let mut cmd = node.tmux(&["-C", "new-session", "-A", "-s", CONTROL_SESSION, "cat"]);
+        cmd.stdin(Stdio::piped())
+            .stdout(Stdio::piped())
+            .stderr(Stdio::null());
+        let mut child = cmd
+            .spawn()
+            .map_err(|e| anyhow!("failed to start tmux control client: {e}"))?;
+        let stdin = child.stdin.take().ok_or_else(|| anyhow!("no stdin"))?;
+        let stdout = child.stdout.take().ok_or_else(|| anyhow!("no stdout"))?;
+
+        let pending: Arc<Mutex<VecDeque<SyncSender<Reply>>>> = Arc::default();
+        let alive = Arc::new(AtomicBool::new(true));
+        let reader_pending = Arc::clone(&pending);
+        let reader_alive = Arc::clone(&alive);
+        // tmux reads stdin before the startup `new-session -A` has run, so
+        // anything written early would race the hidden session into
+        // existence. The startup command's own (non-client) reply block
+        // marks the point where the connection is usable.
+        let (ready_tx, ready_rx) = mpsc::sync_channel::<bool>(1);
+        let reader_server = node.key();
+        thread::Builder::new()
+            .name("tmux-control".to_string())
+            .spawn(move || {
+                let mut reader = BufReader::new(stdout);
+                let mut parser = ReplyParser::default();
+                let mut buf = Vec::new();
+                let mut ready_tx = Some(ready_tx);
+                loop {
+                    buf.clear();
+                    match reader.read_until(b'\n', &mut buf) {
+                        Ok(0) | Err(_) => break,
+                        Ok(_) => {}
+                    }
+                    if buf.last() == Some(&b'\n') {
+                        buf.pop();
+                    }
+                    match parser.feed(&String::from_utf8_lossy(&buf)) {
+                        Some(ControlLine::Reply(reply)) if reply.client_originated => {
+                            let slot = reader_pending
+                                .lock()
+                                .unwrap_or_else(|e| e.into_inner())
+                                .pop_front();
+                            if let Some(slot) = slot {
+                                let _ = slot.send(reply);
+                            }
+                        }
+                        Some(ControlLine::Reply(reply)) => {
+                            if let Some(ready) = ready_tx.take() {
+                                let _ = ready.send(reply.success);
+                            }
+                        }
+                        Some(ControlLine::Notification(line)) => {
+                            if let Some(value) = activity_value(&line) {
+                                health::apply_activity_update(&reader_server, value);
+                            }
+                        }
+                        Some(ControlLine::Exit) => break,
+                        None => {}
+                    }
+                }
+                reader_alive.store(false, Ordering::SeqCst);
+                health::clear_activity(&reader_server);
+                // Dropping the senders wakes every waiter with an error.
+                reader_pending
+                    .lock()
+                    .unwrap_or_else(|e| e.into_inner())
+                    .clear();
+            })
+            .map_err(|e| anyhow!("failed to start tmux control reader: {e}"))?;
+
+        let conn = Self {
+            stdin: Mutex::new(stdin),
+            pending,
+            alive,
+            child: Mutex::new(child),
+        };
+        if ready_rx.recv_timeout(REPLY_TIMEOUT) != Ok(true) {
+            conn.shutdown();
+            return Err(anyhow!("tmux control client failed to attach"));
+        }
+        // Handshake doubles as setup: the hidden session must vanish with
+        // its last control client so it never keeps a server alive.
+        match conn.execute(&[
+            "set-option",
+            "-t",
+            // `set-option` resolves its target as a pane, so the exact
+            // session form needs the trailing colon.
+            &format!("={CONTROL_SESSION}:"),
+            "destroy-unattached",
+            "on",
+        ]) {
+            Ok(out) if out.success => {
+                // Push-based activity for the health tracker. Needs tmux
+                // 3.2+; on older servers the command fails and health
+                // checks keep their capture-diff fallback.
+                let subscription = format!(
+                    "{}::{}",
+                    health::ACTIVITY_SUBSCRIPTION,
+                    health::ACTIVITY_FORMAT
+                );
+                let _ = conn.execute(&["refresh-client", "-B", &subscription]);
+                Ok(conn)
+            }
+            Ok(out) => {
+                conn.shutdown();
+                Err(anyhow!("tmux control setup failed: {}", out.stderr.trim()))
+            }
+            Err(ControlFailure::NotSent) => {
+                conn.shutdown();
+                Err(anyhow!("tmux control client exited during startup"))
+            }
+            Err(ControlFailure::Lost(e)) => {
+                conn.shutdown();
+                Err(e)
+            }
+        }
+    }
+
+    fn is_alive(&self) -> bool {
+        self.alive.load(Ordering::SeqCst)
+    }
+
+    fn execute(&self, args: &[&str]) -> std::result::Result<CommandOutput, ControlFailure> {
+        let mut outputs = self.execute_batch(&[args])?;
+        outputs.pop().ok_or(ControlFailure::NotSent)
+    }
+
+    /// Pipeline several commands: all lines go out in one write and the
+    /// replies are collected afterwards, so N commands cost one round-trip.
+    fn execute_batch(
+        &self,
+        commands: &[&[&str]],
+    ) -> std::result::Result<Vec<CommandOutput>, ControlFailure> {
+        let mut receivers = Vec::with_capacity(commands.len());
+        {
+            // Holding the stdin lock across enqueue + write keeps the reply
+            // queue in the same order tmux sees the commands.
+            let mut stdin = self.stdin.lock().unwrap_or_else(|e| e.into_inner());
+            if !self.is_alive() {
+                return Err(ControlFailure::NotSent);
+            }
+            let mut lines = String::new();
+            {
+                let mut pending = self.pending.lock().unwrap_or_else(|e| e.into_inner());
+                for args in commands {
+                    let (tx, rx) = mpsc::sync_channel(1);
+                    pending.push_back(tx);
+                    receivers.push(rx);
+                    lines.push_str(&command_line(args));
+                }
+            }
+            if stdin
+                .write_all(lines.as_bytes())
+                .and_then(|_| stdin.flush())
+                .is_err()
+            {
+                // Nothing after us can have been queued while we hold the
+                // stdin lock, and no reply can exist for an unwritten line.
+                let mut pending = self.pending.lock().unwrap_or_else(|e| e.into_inner());
+                for _ in 0..receivers.len() {
+                    pending.pop_back();
+                }
+                self.alive.store(false, Ordering::SeqCst);
+                return Err(ControlFailure::NotSent);
+            }
+        }
+        let deadline = Instant::now() + REPLY_TIMEOUT;
+        let mut outputs = Vec::with_capacity(receivers.len());
+        for rx in receivers {
+            match rx.recv_timeout(deadline.saturating_duration_since(Instant::now())) {
+                Ok(reply) => outputs.push(reply.into_output()),
+                Err(mpsc::RecvTimeoutError::Timeout) => {
+                    self.shutdown();
+                    return Err(ControlFailure::Lost(anyhow!(
+                        "tmux control-mode reply timed out after {:?}",
+                        REPLY_TIMEOUT
+                    )));
+                }
+                Err(mpsc::RecvTimeoutError::Disconnected) => {
+                    return Err(ControlFailure::Lost(anyhow!(
+                        "tmux control connection closed before replying"
+                    )));
+                }
+            }
+        }
+        Ok(outputs)
+    }
+
+    fn shutdown(&self) {
+        self.alive.store(false, Ordering::SeqCst);
+        let mut child = self.child.lock().unwrap_or_else(|e| e.into_inner());
+        let _ = child.kill();
+        let _ = child.wait();
+    }
+}
+
+impl Drop for Connection {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
+}
+
+/// Per-server connection state.
+#[derive(Default)]
+struct ServerSlot {
+    conn: Option<Arc<Connection>>,
+    /// Set once an exec call against this server succeeded. `new-session -A`
+    /// would otherwise start a brand-new server just to answer a
+    /// `has-session` probe after the user ran `kill-server`.
+    reachable: bool,
+    retry_at: Option<Instant>,
+    /// A `Connection::open` for this server is in flight. Other callers use
+    /// the exec path meanwhile rather than wait out the handshake.
+    connecting: bool,
+}
+
+fn slots() -> &'static Mutex<HashMap<String, ServerSlot>> {
+    static SLOTS: OnceLock<Mutex<HashMap<String, ServerSlot>>> = OnceLock::new();
+    SLOTS.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+fn control_disabled() -> bool {
+    std::env::var("OMAR_TMUX_CONTROL")
+        .map(|v| matches!(v.trim(), "0" | "false" | "off"))
+        .unwrap_or(false)
+}
+
+/// Get (or lazily open) the connection for `node`, or `None` when the
+/// caller should use the exec path.
+fn connection_for(node: &Node) -> Option<Arc<Connection>> {
+    if control_disabled() {
+        return None;
+    }
+    let key = node.key();
+    {
+        let mut slots = slots().lock().unwrap_or_else(|e| e.into_inner());
+        let slot = slots.entry(key.clone()).or_default();
+        if let Some(conn) = &slot.conn {
+            if conn.is_alive() {
+                return Some(Arc::clone(conn));
+            }
+            // Server exited or the client died: require fresh proof the server
+            // is up before reconnecting.
+            slot.conn = None;
+            slot.reachable = false;
+            slot.retry_at = Some(Instant::now() + RECONNECT_BACKOFF);
+        }
+        if slot.connecting || !slot.reachable || slot.retry_at.is_some_and(|at| Instant::now() < at)
+        {
+            return None;
+        }
+        slot.connecting = true;
+    }
+
+    // Opening can take up to REPLY_TIMEOUT against a slow or unreachable
+    // server; the registry lock stays free so other nodes are unaffected.
+    let opened = Connection::open(node).map(Arc::new);
+
+    let mut slots = slots().lock().unwrap_or_else(|e| e.into_inner());
+    let slot = slots.entry(key).or_default();
+    slot.connecting = false;
+    match opened {
+        Ok(conn) => {
+            slot.conn = Some(Arc::clone(&conn));
+            slot.retry_at = None;
+            Some(conn)
+        }
+        Err(_) => {
+            slot.retry_at = Some(Instant::now() + RECONNECT_BACKOFF);
+            None
+        }
+    }
+}
+
+/// Run a command over the control connection for `node`.
+///
+/// `None` means the command was not sent and the caller should exec it.
+pub(crate) fn run(node: &Node, args: &[&str]) -> Option<Result<CommandOutput>> {
+    let conn = connection_for(node)?;
+    match conn.execute(args) {
+        Ok(output) => Some(Ok(output)),
+        Err(ControlFailure::NotSent) => None,
+        Err(ControlFailure::Lost(e)) => Some(Err(e)),
+    }
+}
+
+/// Run several commands as one pipelined round-trip over the control
+/// connection for `node`, returning one output per command in order.
+///
+/// `None` means nothing was sent and the caller should use the exec path.
+pub(crate) fn run_batch(node: &Node, commands: &[&[&str]]) -> Option<Result<Vec<CommandOutput>>> {
+    let conn = connection_for(node)?;
+    match conn.execute_batch(commands) {
+        Ok(outputs) => Some(Ok(outputs)),
+        Err(ControlFailure::NotSent) => None,
+        Err(ControlFailure::Lost(e)) => Some(Err(e)),
+    }
+}
+
+/// Record the outcome of an exec-path call so a later call may upgrade to a
+/// control connection once the server is known to be running.
+pub(crate) fn note_exec_result(node: &Node, success: bool) {
+    if !success || control_disabled() {
+        return;
+    }
+    let mut slots = slots().lock().unwrap_or_else(|e| e.into_inner());
+    slots.entry(node.key()).or_default().reachable = true;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn feed_all(parser: &mut ReplyParser, lines: &[&str]) -> Vec<ControlLine> {
+        lines.iter().filter_map(|line| parser.feed(line)).collect()
+    }
+
+    #[test]
+    fn parser_matches_begin_end_blocks_and_skips_notifications() {
+        let mut parser = ReplyParser::default();
+        let units = feed_all(
+            &mut parser,
+            &[
+                "%begin 1792000011 265 0",
+                "%end 1792000011 265 0",
+                "%session-changed $0 a",
+                "%begin 1792000011 270 1",
+                "a|1",
+                "b|0",
+                "%end 1792000011 270 1",
+                "%begin 1792000012 272 1",
+                "can't find session: nope",
+                "%error 1792000012 272 1",
+                "%exit",
+            ],
+        );
+        assert_eq!(
+            units,
+            vec![
+                ControlLine::Reply(Reply {
+                    client_originated: false,
+                    success: true,
+                    body: vec![],
+                }),
+                ControlLine::Notification("%session-changed $0 a".to_string()),
+                ControlLine::Reply(Reply {
+                    client_originated: true,
+                    success: true,
+                    body: vec!["a|1".to_string(), "b|0".to_string()],
+                }),
+                ControlLine::Reply(Reply {
+                    client_originated: true,
+                    success: false,
+                    body: vec!["can't find session: nope".to_string()],
+                }),
+                ControlLine::Exit,
+            ]
+        );
+    }
+
+    #[test]
+    fn parser_ignores_pane_text_that_looks_like_a_terminator() {
+        let mut parser = ReplyParser::default();
+        let units = feed_all(
+            &mut parser,
+            &[
+                "%begin 10 5 1",
+                "%end 1 1 1",
+                "%output %1 hi",
+                "%end 10 5 1",
+            ],
+        );
+        assert_eq!(
+            units,
+            vec![ControlLine::Reply(Reply {
+                client_originated: true,
+                success: true,
+                body: vec!["%end 1 1 1".to_string(), "%output %1 hi".to_string()],
+            })]
+        );
+    }
+
+    #[test]
+    fn reply_output_mirrors_exec_shape() {
+        let ok = Reply {
+            client_originated: true,
+            success: true,
+            body: vec!["x".to_string(), String::new()],
+        }
+        .into_output();
+        assert_eq!(ok.stdout, "x\n\n");
+        assert!(ok.stderr.is_empty());
+
+        let err = Reply {
+            client_originated: true,
+            success: false,
+            body: vec!["no such session".to_string()],
+        }
+        .into_output();
+        assert!(!err.success);
+        assert_eq!(err.stderr, "no such session\n");
+    }
+
+    #[test]
+    fn quote_arg_escapes_parser_metacharacters() {
+        assert_eq!(quote_arg("plain"), "\"plain\"");
+        assert_eq!(quote_arg("a\"b\\c$HOME"), "\"a\\\"b\\\\c\\$HOME\"");
+        assert_eq!(quote_arg("l1\nl2\tx\r"), "\"l1\\nl2\\tx\\r\"");
+        assert_eq!(quote_arg("\u{1b}[0m"), "\"\\033[0m\"");
+        assert_eq!(quote_arg("#{pane_pid} ; ❯"), "\"#{pane_pid} ; ❯\"");
+        assert_eq!(
+            command_line(&["send-keys", "-t", "=a:", "-l", "--", "x y"]),
+            "\"send-keys\" \"-t\" \"=a:\" \"-l\" \"--\" \"x y\"\n"
+        );
+    }
+
+    #[test]
+    fn activity_value_extracts_subscription_payload() {
+        assert_eq!(
+            activity_value("%subscription-changed omar-activity $1 - - - : a|1|2\tb : c|3|4\t"),
+            Some("a|1|2\tb : c|3|4\t")
+        );
+        assert_eq!(
+            activity_value("%subscription-changed other $1 - - - : x"),
+            None
+        );
+        assert_eq!(activity_value("%output %1 hi"), None);
+    }
+
+    #[test]
+    fn eligible_commands_exclude_session_creation_and_attach() {
+        assert!(control_eligible("capture-pane"));
+        assert!(control_eligible("send-keys"));
+        assert!(!control_eligible("new-session"));
+        assert!(!control_eligible("attach-session"));
+        assert!(!control_eligible("display-popup"));
+    }
+}
@@ -1,8 +1,12 @@
 #![allow(dead_code)]
 
 use std::collections::HashMap;
+use std::sync::{Mutex, OnceLock};
+use std::time::{SystemTime, UNIX_EPOCH};
 
-use super::TmuxClient;
+use super::client::configured_server;
+use super::node;
+use super::{PaneSnapshot, TmuxClient};
 
 /// Health state of an agent
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -22,26 +26,157 @@ impl HealthState {
     }
 }
 
-/// Checks health of agent sessions by comparing pane content between frames.
-/// If the pane content has changed since the last check, the session is Running;
-/// otherwise it is Idle.
+/// Name of the format subscription every control connection registers.
+pub(crate) const ACTIVITY_SUBSCRIPTION: &str = "omar-activity";
+
+/// Session-scoped subscription format. `#{S:…}` loops over every session on
+/// the server, so one subscription covers agents in all sessions — unlike
+/// `%output`, which tmux only emits for panes in the control client's own
+/// (hidden) session. OMAR sessions have a single pane, so the window-level
+/// fields are pane-level. tmux re-evaluates subscriptions once a second and
+/// only pushes `%subscription-changed` when the value differs.
+pub(crate) const ACTIVITY_FORMAT: &str =
+    "#{S:#{session_name}|#{window_activity}|#{history_bytes}\t}";
+
+/// Activity of one session's pane as last pushed by tmux.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct PaneActivity {
+    /// `#{window_activity}`: unix seconds of the most recent pane output.
+    pub last_activity: i64,
+    /// Running total of scrollback growth (`#{history_bytes}` deltas) seen
+    /// since tracking started.
+    pub output_bytes: u64,
+    history_bytes: u64,
+}
+
+/// Latest pushed activity per tmux server (keyed like control
+/// connections), then per session name. A server is only present while its
+/// control connection is up and the subscription has reported at least once.
+fn trackers() -> &'static Mutex<HashMap<String, HashMap<String, PaneActivity>>> {
+    static TRACKERS: OnceLock<Mutex<HashMap<String, HashMap<String, PaneActivity>>>> =
+        OnceLock::new();
+    TRACKERS.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+fn activity_listeners() -> &'static Mutex<Vec<tokio::sync::mpsc::UnboundedSender<()>>> {
+    static LISTENERS: OnceLock<Mutex<Vec<tokio::sync::mpsc::UnboundedSender<()>>>> =
+        OnceLock::new();
+    LISTENERS.get_or_init(|| Mutex::new(Vec::new()))
+}
+
+/// Signal once per pushed activity change on any server, so the dashboard
+/// can refresh when an agent starts or stops producing output instead of
+/// polling for it.
+pub fn subscribe_activity() -> tokio::sync::mpsc::UnboundedReceiver<()> {
+    let (tx, rx) = tokio::sync::mpsc::unbounded_channel();
+    activity_listeners()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .push(tx);
+    rx
+}
+
+/// Apply one `%subscription-changed` value. The value lists every session,
+/// so sessions missing from it are gone and are dropped.
+pub(crate) fn apply_activity_update(server: &str, value: &str) {
+    let mut trackers = trackers().lock().unwrap_or_else(|e| e.into_inner());
+    let previous = trackers.remove(server).unwrap_or_default();
+    let mut next = HashMap::with_capacity(previous.len());
+    for record in value.split('\t') {
+        let mut fields = record.rsplitn(3, '|');
+        let (Some(history), Some(activity), Some(name)) =
+            (fields.next(), fields.next(), fields.next())
+        else {
+            continue;
+        };
+        let (Ok(history_bytes), Ok(last_activity)) = (history.parse::<u64>(), activity.parse())
+        else {
+            continue;
+        };
+        let output_bytes = previous.get(name).map_or(0, |prev| {
+            prev.output_bytes + history_bytes.saturating_sub(prev.history_bytes)
+        });
+        next.insert(
+            name.to_string(),
+            PaneActivity {
+                last_activity,
+                output_bytes,
+                history_bytes,
+            },
+        );
+    }
+    let changed = next != previous;
+    trackers.insert(server.to_string(), next);
+    drop(trackers);
+    if changed {
+        activity_listeners()
+            .lock()
+            .unwrap_or_else(|e| e.into_inner())
+            .retain(|tx| tx.send(()).is_ok());
+    }
+}
+
+/// Forget a server's activity when its control connection goes away, so
+/// frozen timestamps are never mistaken for idle agents.
+pub(crate) fn clear_activity(server: &str) {
+    trackers()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .remove(server);
+}
+
+/// Pushed activity for a session on the node that owns it, if tracked.
+pub fn tracked_activity(session_name: &str) -> Option<PaneActivity> {
+    let server = node::owner(session_name)
+        .map(|node| node.key())
+        .unwrap_or_else(|| configured_server().unwrap_or_default());
+    trackers()
+        .lock()
+        .unwrap_or_else(|e| e.into_inner())
+        .get(&server)?
+        .get(session_name)
+        .copied()
+}
+
+fn now_secs() -> i64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_secs() as i64)
+        .unwrap_or(0)
+}
+
+/// Reports whether agent sessions are Running or Idle.
+///
+/// Primary source is the push-based activity tracker fed by the control
+/// connection's subscription: a session is Running while its last output is
+/// within `idle_threshold` seconds, at O(1) per check with no tmux calls.
+/// Sessions the tracker does not know yet (no control connection, tmux
+/// without `refresh-client -B`, or a session created since the last push)
+/// fall back to comparing a pane capture against the previous frame.
 pub struct HealthChecker {
     client: TmuxClient,
-    /// Last captured pane content per session name
+    idle_threshold: i64,
+    /// Last captured pane content per session name (fallback path only)
     last_frames: HashMap<String, String>,
 }
 
 impl HealthChecker {
-    pub fn new(client: TmuxClient, _idle_threshold: i64) -> Self {
+    pub fn new(client: TmuxClient, idle_threshold: i64) -> Self {
         Self {
             client,
+            idle_threshold,
             last_frames: HashMap::new(),
         }
     }
 
-    /// Check the health of a session by comparing against the previous frame.
-    /// Returns Running if pane content changed, Idle if unchanged.
+    /// Check the health of a session from tracked activity, or by comparing
+    /// against the previous frame when the session is not tracked.
     pub fn check(&mut self, session_name: &str) -> HealthState {
+        if let Some(activity) = tracked_activity(session_name) {
+            self.last_frames.remove(session_name);
+            return health_from_activity(activity.last_activity, now_secs(), self.idle_threshold);
+        }
+
         let current = self
             .client
             .capture_pane(session_name, 50)
@@ -61,6 +196,17 @@ impl HealthChecker {
         }
     }
 
+    /// Health for a session already covered by a `snapshot_all` result.
+    /// Tracked activity wins; otherwise the snapshot's own
+    /// `window_activity` is judged against the idle threshold, so no pane
+    /// capture is ever needed.
+    pub fn check_snapshot(&mut self, snapshot: &PaneSnapshot) -> HealthState {
+        self.last_frames.remove(&snapshot.session.name);
+        let last_activity = tracked_activity(&snapshot.session.name)
+            .map_or(snapshot.pane_activity, |activity| activity.last_activity);
+        health_from_activity(last_activity, now_secs(), self.idle_threshold)
+    }
+
     /// Remove stale entries for sessions that no longer exist
     pub fn retain_sessions(&mut self, active_sessions: &[String]) {
         self.last_frames
@@ -68,6 +214,14 @@ impl HealthChecker {
     }
 }
 
+fn health_from_activity(last_activity: i64, now: i64, idle_threshold: i64) -> HealthState {
+    if now.saturating_sub(last_activity) <= idle_threshold {
+        HealthState::Running
+    } else {
+        HealthState::Idle
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -77,4 +231,100 @@ mod tests {
         assert_eq!(HealthState::Running.as_str(), "running");
         assert_eq!(HealthState::Idle.as_str(), "idle");
     }
+
+    #[test]
+    fn test_activity_update_tracks_sessions_and_output_growth() {
+        let server = "omar-test-activity-tracker";
+        apply_activity_update(server, "a|100|768\tb|90|0\t");
+        apply_activity_update(server, "a|105|1268\tweird|name|120|10\t");
+        let guard = trackers().lock().unwrap();
+        let table = guard.get(server).unwrap();
+        assert_eq!(table["a"].last_activity, 105);
+        assert_eq!(table["a"].output_bytes, 500);
+        assert!(
+            !table.contains_key("b"),
+            "sessions absent from a push are gone"
+        );
+        assert_eq!(table["weird|name"].last_activity, 120);
+        drop(guard);
+
+        clear_activity(server);
+        assert!(trackers().lock().unwrap().get(server).is_none());
+    }
+
+    #[test]
+    fn test_activity_update_wakes_subscribers() {
+        let server = "omar-test-activity-wake";
+        let mut changes = subscribe_activity();
+        apply_activity_update(server, "a|100|0\t");
+        assert!(changes.try_recv().is_ok(), "a changed push must signal");
+        clear_activity(server);
+    }
+
+    #[test]
+    fn test_health_from_activity_uses_idle_threshold() {
+        assert_eq!(health_from_activity(100, 110, 15), HealthState::Running);
+        assert_eq!(health_from_activity(100, 115, 15), HealthState::Running);
+        assert_eq!(health_from_activity(100, 116, 15), HealthState::Idle);
+    }
+
+    #[test]
+    fn test_health_checker_reads_pushed_activity_for_live_session() {
+        let tmux_ok = super::super::tmux_command()
+            .arg("-V")
+            .output()
+            .map(|o| o.status.success())
+            .unwrap_or(false);
+        if !tmux_ok {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+
+        let session = "omar-test-health-tracker";
+        let _ = super::super::tmux_command()
+            .args(["kill-session", "-t", &format!("={session}")])
+            .output();
+        let ok = super::super::tmux_command()
+            .args([
+                "new-session",
+                "-d",
+                "-s",
+                session,
+                "while :; do echo tick; sleep 0.2; done",
+            ])
+            .status()
+            .map(|s| s.success())
+            .unwrap_or(false);
+        if !ok {
+            eprintln!("Skipping test: failed to create tmux session");
+            return;
+        }
+
+        let client = TmuxClient::new("omar-test-");
+        let deadline = std::time::Instant::now() + std::time::Duration::from_secs(5);
+        let mut tracked = None;
+        while std::time::Instant::now() < deadline {
+            // The first call proves the server is up; later calls ride the
+            // control connection whose subscription feeds the tracker.
+            let _ = client.list_sessions();
+            tracked = tracked_activity(session);
+            if tracked.is_some() {
+                break;
+            }
+            std::thread::sleep(std::time::Duration::from_millis(200));
+        }
+        let _ = client.kill_session(session);
+
+        let Some(activity) = tracked else {
+            eprintln!("Skipping test: tmux lacks refresh-client -B subscriptions");
+            return;
+        };
+        assert!(activity.last_activity > 0);
+        let mut checker = HealthChecker::new(client, 15);
+        assert_eq!(checker.check(session), HealthState::Running);
+        assert!(
+            checker.last_frames.is_empty(),
+            "tracked sessions must not fall back to pane captures"
+        );
+    }
 }
@@ -1,10 +1,19 @@
 mod client;
+mod control;
 mod health;
+mod node;
+mod output_log;
 mod session;
+mod watch;
 
 pub use client::{tmux_command, DeliveryOptions, TmuxClient};
-pub use health::{HealthChecker, HealthState};
-pub use session::Session;
+pub use health::{subscribe_activity, HealthChecker, HealthState};
+pub use node::configure as configure_nodes;
+pub use output_log::{
+    log_dir as output_log_dir, sweep as sweep_output_logs, OutputLog, OutputRead,
+    SWEEP_INTERVAL as OUTPUT_SWEEP_INTERVAL,
+};
+pub use session::{PaneSnapshot, Session};
 
 /// Readiness markers for each supported backend — strings that must ALL
 /// appear in a backend's rendered TUI before the pane is considered ready
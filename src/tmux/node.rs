@@ -0,0 +1,271 @@
+//! Agent sharding across several local tmux servers ("nodes").
+//!
+//! One tmux server serializes every command and redraw for the whole
+//! swarm. `[[nodes]]` in the config registers further servers on this
+//! machine, each on its own `-L` socket, and `TmuxClient` routes every
+//! command for a session to the node that owns it. The dashboard's own
+//! server (`OMAR_TMUX_SERVER`) is always the implicit `local` node; with no extra nodes registered nothing here is
+//! consulted and every command goes to it exactly as before.
+//!
+//! Ownership is learned, not stored: each `list-sessions` fans out to every
+//! node and records which node answered for which session, and sessions
+//! created or renamed through this process are recorded as they change.
+//! Placement of new agent sessions picks the node holding the fewest
+//! sessions that is still under its `max_agents`.
+
+use anyhow::{bail, Result};
+use std::collections::HashMap;
+use std::process::Command;
+use std::sync::{OnceLock, RwLock};
+
+use super::client::configured_server;
+use crate::config::NodeConfig;
+
+/// Name of the implicit node for the dashboard's own tmux server.
+pub const LOCAL_NODE: &str = "local";
+
+/// One tmux server agent sessions can live on.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Node {
+    pub name: String,
+    socket: Option<String>,
+    max_agents: Option<usize>,
+}
+
+impl Node {
+    /// The dashboard's own server. Rebuilt per call because
+    /// `OMAR_TMUX_SERVER` is read at call time throughout the crate.
+    pub fn local() -> Self {
+        Self {
+            name: LOCAL_NODE.to_string(),
+            socket: configured_server(),
+            max_agents: registry()
+                .read()
+                .unwrap_or_else(|e| e.into_inner())
+                .local_max_agents,
+        }
+    }
+
+    fn from_config(config: &NodeConfig) -> Self {
+        Self {
+            name: config.name.clone(),
+            socket: config
+                .socket
+                .as_ref()
+                .map(|socket| socket.trim().to_string())
+                .filter(|socket| !socket.is_empty()),
+            max_agents: config.max_agents,
+        }
+    }
+
+    /// Identity of the node's tmux server, used to key control connections
+    /// and pushed activity: the bare socket name, as it was before nodes
+    /// existed.
+    pub fn key(&self) -> String {
+        self.socket.clone().unwrap_or_default()
+    }
+
+    /// A `tmux` invocation on this node running `args`.
+    pub fn tmux(&self, args: &[&str]) -> Command {
+        let mut cmd = Command::new("tmux");
+        if let Some(socket) = &self.socket {
+            cmd.args(["-L", socket]);
+        }
+        cmd.args(args);
+        cmd
+    }
+
+    /// `-L` socket name of the node's server, if any.
+    pub fn socket(&self) -> Option<&str> {
+        self.socket.as_deref()
+    }
+}
+
+#[derive(Default)]
+struct Registry {
+    /// Registered nodes besides `local`, in config order.
+    extra: Vec<Node>,
+    local_max_agents: Option<usize>,
+    /// Session name → owning node name, as last observed.
+    owners: HashMap<String, String>,
+}
+
+fn registry() -> &'static RwLock<Registry> {
+    static REGISTRY: OnceLock<RwLock<Registry>> = OnceLock::new();
+    REGISTRY.get_or_init(|| RwLock::new(Registry::default()))
+}
+
+/// Register the `[[nodes]]` from the config for this process.
+pub fn configure(nodes: &[NodeConfig]) {
+    let mut registry = registry().write().unwrap_or_else(|e| e.into_inner());
+    registry.local_max_agents = None;
+    registry.extra.clear();
+    registry.owners.clear();
+    for config in nodes {
+        if config.name == LOCAL_NODE && config.socket.is_none() {
+            registry.local_max_agents = config.max_agents;
+        } else if !config.name.is_empty()
+            && config.name != LOCAL_NODE
+            && registry.extra.iter().all(|node| node.name != config.name)
+        {
+            registry.extra.push(Node::from_config(config));
+        }
+    }
+}
+
+/// True when agents may live on more than the local node.
+pub fn sharded() -> bool {
+    !registry()
+        .read()
+        .unwrap_or_else(|e| e.into_inner())
+        .extra
+        .is_empty()
+}
+
+/// Every node, `local` first.
+pub fn all() -> Vec<Node> {
+    let mut nodes = vec![Node::local()];
+    nodes.extend(
+        registry()
+            .read()
+            .unwrap_or_else(|e| e.into_inner())
+            .extra
+            .iter()
+            .cloned(),
+    );
+    nodes
+}
+
+fn by_name(name: &str) -> Option<Node> {
+    if name == LOCAL_NODE {
+        return Some(Node::local());
+    }
+    registry()
+        .read()
+        .unwrap_or_else(|e| e.into_inner())
+        .extra
+        .iter()
+        .find(|node| node.name == name)
+        .cloned()
+}
+
+/// The node last seen holding `session`, if any.
+pub fn owner(session: &str) -> Option<Node> {
+    let name = registry()
+        .read()
+        .unwrap_or_else(|e| e.into_inner())
+        .owners
+        .get(session)
+        .cloned()?;
+    by_name(&name)
+}
+
+/// Record that `session` now lives on `node`.
+pub fn record_owner(session: &str, node: &Node) {
+    registry()
+        .write()
+        .unwrap_or_else(|e| e.into_inner())
+        .owners
+        .insert(session.to_string(), node.name.clone());
+}
+
+/// Forget `session` (killed, or renamed away).
+pub fn forget(session: &str) {
+    registry()
+        .write()
+        .unwrap_or_else(|e| e.into_inner())
+        .owners
+        .remove(session);
+}
+
+/// Replace everything known about `node` with a fresh session listing.
+pub fn replace_owned<'a>(node: &Node, sessions: impl IntoIterator<Item = &'a str>) {
+    let mut registry = registry().write().unwrap_or_else(|e| e.into_inner());
+    registry.owners.retain(|_, owner| *owner != node.name);
+    for session in sessions {
+        registry
+            .owners
+            .insert(session.to_string(), node.name.clone());
+    }
+}
+
+/// Pick the node for a new agent session from the current ownership map:
+/// the one holding the fewest sessions among those under `max_agents`,
+/// earlier nodes winning ties. Callers refresh ownership first.
+pub fn place() -> Result<Node> {
+    let nodes = all();
+    let registry = registry().read().unwrap_or_else(|e| e.into_inner());
+    let loads: Vec<(usize, Option<usize>)> = nodes
+        .iter()
+        .map(|node| {
+            let held = registry
+                .owners
+                .values()
+                .filter(|owner| **owner == node.name)
+                .count();
+            (held, node.max_agents)
+        })
+        .collect();
+    drop(registry);
+    match choose(&loads) {
+        Some(index) => Ok(nodes[index].clone()),
+        None => bail!("Every tmux node is at its max_agents limit"),
+    }
+}
+
+/// Index of the least-loaded `(held, max_agents)` entry with room left.
+fn choose(loads: &[(usize, Option<usize>)]) -> Option<usize> {
+    loads
+        .iter()
+        .enumerate()
+        .filter(|(_, (held, max))| max.is_none_or(|max| *held < max))
+        .min_by_key(|(index, (held, _))| (*held, *index))
+        .map(|(index, _)| index)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn choose_prefers_least_loaded_node_with_room() {
+        assert_eq!(choose(&[(3, None), (1, None), (1, None)]), Some(1));
+        assert_eq!(choose(&[(3, None), (5, Some(5)), (4, Some(8))]), Some(0));
+        assert_eq!(choose(&[(2, Some(2)), (7, None)]), Some(1));
+        assert_eq!(choose(&[(2, Some(2)), (1, Some(1))]), None);
+    }
+
+    #[test]
+    fn configure_registers_socket_nodes_after_local() {
+        configure(&[
+            NodeConfig {
+                name: LOCAL_NODE.to_string(),
+                max_agents: Some(40),
+                ..NodeConfig::default()
+            },
+            NodeConfig {
+                name: "second".to_string(),
+                socket: Some("omar-2".to_string()),
+                ..NodeConfig::default()
+            },
+        ]);
+        let names: Vec<String> = all().into_iter().map(|node| node.name).collect();
+        assert_eq!(names, vec![LOCAL_NODE.to_string(), "second".to_string()]);
+        assert_eq!(Node::local().max_agents, Some(40));
+        configure(&[]);
+    }
+
+    #[test]
+    fn local_socket_nodes_run_tmux_directly() {
+        let node = Node::from_config(&NodeConfig {
+            name: "second".to_string(),
+            socket: Some("omar-2".to_string()),
+            ..NodeConfig::default()
+        });
+        assert_eq!(node.key(), "omar-2");
+        let cmd = node.tmux(&["list-sessions"]);
+        assert_eq!(cmd.get_program(), "tmux");
+        let args: Vec<_> = cmd.get_args().collect();
+        assert_eq!(args, ["-L", "omar-2", "list-sessions"]);
+    }
+}
@@ -0,0 +1,550 @@
+//! Persistent, bounded log of everything a pane prints.
+//!
+//! `get_agent` re-captures a 200-line screen per call, so a supervisor that
+//! polls a worker re-reads the same text over and over. Instead, each agent
+//! pane is piped (`pipe-pane -O`) into `split`, which cuts the byte stream
+//! into fixed-size chunk files as it arrives. A byte's offset in the stream
+//! follows from the chunk it landed in, so readers resume from a cursor and
+//! only receive new bytes, and the ring is bounded by deleting the oldest
+//! chunks — no process has to stay around to rotate anything.
+//!
+//! Layout of a log directory:
+//!
+//! ```text
+//! <dir>/<base offset>/caaaaaa, caaaaab, …   one "generation" per pipe
+//! <dir>/markers                             `[TASK COMPLETE]` index
+//! ```
+//!
+//! A pipe that dies (the tmux server restarted, the pane was respawned)
+//! is replaced by a new generation whose base is the previous end offset,
+//! so offsets only ever grow. The pane's `@omar_output_log` option names
+//! its log, which lets [`PaneWatch`](super::watch) tail an existing log
+//! instead of needing a pipe of its own (tmux allows one per pane).
+
+use anyhow::{Context, Result};
+use std::collections::HashSet;
+use std::fs::{self, File};
+use std::io::{Read, Seek, SeekFrom};
+use std::path::{Path, PathBuf};
+use std::time::{Duration, SystemTime};
+
+use super::client::exact_pane_target;
+use super::TmuxClient;
+
+/// Bytes per chunk file. Every chunk but a generation's last is full.
+pub const CHUNK_BYTES: u64 = 64 * 1024;
+/// Chunks kept per log, so each agent's ring holds about 1 MiB.
+const MAX_CHUNKS: usize = 16;
+/// Suffix length passed to `split -a`: 26^6 chunks, far more than a pane
+/// prints.
+const SUFFIX_LEN: u32 = 6;
+const CHUNK_PREFIX: &str = "c";
+const MARKERS_FILE: &str = "markers";
+/// Pane option naming the log directory a pane is piped into.
+pub(crate) const LOG_OPTION: &str = "@omar_output_log";
+
+pub const TASK_COMPLETE_MARKER: &str = "[TASK COMPLETE]";
+/// A marker counts as the pane's current state while less than this much
+/// output followed it: enough for a TUI to redraw its prompt and status
+/// line, not enough for a new turn of work.
+pub const READY_TAIL_BYTES: u64 = 4096;
+
+/// How often the dashboard runs [`sweep`].
+pub const SWEEP_INTERVAL: Duration = Duration::from_secs(30);
+/// A log written this recently is kept even when its session is not in the
+/// live set: the session may have started after the snapshot was taken.
+const ORPHAN_GRACE: Duration = Duration::from_secs(60);
+
+/// Directory of `session`'s log under an EA state directory.
+pub fn log_dir(state_dir: &Path, session: &str) -> PathBuf {
+    state_dir.join("output").join(session)
+}
+
+/// Bound every log under `state_dir` to its ring size, and delete the logs
+/// of sessions not in `live` (they exited on their own, or were killed
+/// outside omar).
+///
+/// `split` keeps appending chunks for as long as the pane prints, and
+/// nothing else trims a log nobody reads, so this runs periodically.
+pub fn sweep(state_dir: &Path, live: &HashSet<&str>) {
+    sweep_with_grace(state_dir, live, ORPHAN_GRACE);
+}
+
+fn sweep_with_grace(state_dir: &Path, live: &HashSet<&str>, grace: Duration) {
+    let Ok(entries) = fs::read_dir(state_dir.join("output")) else {
+        return;
+    };
+    for entry in entries.flatten() {
+        let log = OutputLog::new(entry.path());
+        let name = entry.file_name();
+        if name.to_str().is_some_and(|name| live.contains(name)) {
+            log.prune();
+        } else if log.idle_for().is_some_and(|idle| idle >= grace) {
+            let _ = fs::remove_dir_all(log.dir());
+        }
+    }
+}
+
+/// Bytes returned by [`OutputLog::read`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct OutputRead {
+    /// Offset of the first byte of `data`.
+    pub offset: u64,
+    /// Cursor for the next read: the offset just past `data`.
+    pub next_offset: u64,
+    /// Bytes between the requested offset and `offset` that the ring
+    /// already dropped.
+    pub dropped: u64,
+    pub data: Vec<u8>,
+}
+
+/// Where the last task-completion marker was seen.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct MarkerIndex {
+    /// The stream has been searched up to here.
+    pub scanned_to: u64,
+    /// Offset just past the most recent marker.
+    pub last_marker_end: Option<u64>,
+}
+
+impl MarkerIndex {
+    /// True when the last marker is followed by less than
+    /// [`READY_TAIL_BYTES`] of output. O(1): no output is reread.
+    pub fn ready_to_complete(&self) -> bool {
+        self.last_marker_end
+            .is_some_and(|end| self.scanned_to.saturating_sub(end) < READY_TAIL_BYTES)
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct OutputLog {
+    dir: PathBuf,
+}
+
+impl OutputLog {
+    pub fn new(dir: impl Into<PathBuf>) -> Self {
+        Self { dir: dir.into() }
+    }
+
+    pub fn dir(&self) -> &Path {
+        &self.dir
+    }
+
+    /// Pipe `target` into this log unless it already is. Returns false when
+    /// the pane is piped somewhere else (a user's pipe, or a delivery watch
+    /// started before the log existed); the log then stays as it is.
+    pub fn attach(&self, client: &TmuxClient, target: &str) -> Result<bool> {
+        let target = exact_pane_target(target);
+        let format = format!("#{{pane_pipe}}\t#{{{}}}", LOG_OPTION);
+        let state = client.run(&["display-message", "-p", "-t", &target, &format])?;
+        let (piped, log) = state.trim_end().split_once('\t').unwrap_or(("0", ""));
+        if piped == "1" {
+            return Ok(Path::new(log) == self.dir);
+        }
+
+        let generation = self.dir.join(format!("{:020}", self.end_offset()));
+        fs::create_dir_all(&generation)
+            .with_context(|| format!("Failed to create output log {:?}", generation))?;
+        self.prune();
+        let dir = self.dir.to_str().context("Output log path is not UTF-8")?;
+        let prefix = generation
+            .join(CHUNK_PREFIX)
+            .to_str()
+            .context("Output log path is not UTF-8")?
+            .replace('\'', r"'\''");
+        client.run(&["set-option", "-p", "-t", &target, LOG_OPTION, dir])?;
+        let command = format!(
+            "exec split -b {} -a {} - '{}'",
+            CHUNK_BYTES, SUFFIX_LEN, prefix
+        );
+        client.run(&["pipe-pane", "-O", "-o", "-t", &target, &command])?;
+        Ok(true)
+    }
+
+    /// Generations as (base offset, directory), oldest first.
+    fn generations(&self) -> Vec<(u64, PathBuf)> {
+        let mut generations: Vec<(u64, PathBuf)> = fs::read_dir(&self.dir)
+            .into_iter()
+            .flatten()
+            .flatten()
+            .filter_map(|entry| {
+                let base = entry.file_name().to_str()?.parse().ok()?;
+                Some((base, entry.path()))
+            })
+            .collect();
+        generations.sort();
+        generations
+    }
+
+    /// Chunks of one generation as (index, path), oldest first.
+    fn chunks(generation: &Path) -> Vec<(u64, PathBuf)> {
+        let mut chunks: Vec<(u64, PathBuf)> = fs::read_dir(generation)
+            .into_iter()
+            .flatten()
+            .flatten()
+            .filter_map(|entry| {
+                let name = entry.file_name();
+                let index = chunk_index(name.to_str()?.strip_prefix(CHUNK_PREFIX)?)?;
+                Some((index, entry.path()))
+            })
+            .collect();
+        chunks.sort();
+        chunks
+    }
+
+    /// Offset just past the last byte logged so far.
+    pub fn end_offset(&self) -> u64 {
+        let Some((base, generation)) = self.generations().pop() else {
+            return 0;
+        };
+        match Self::chunks(&generation).pop() {
+            Some((index, path)) => base + index * CHUNK_BYTES + file_len(&path),
+            None => base,
+        }
+    }
+
+    /// Offset of the oldest byte still in the ring.
+    pub fn start_offset(&self) -> u64 {
+        for (base, generation) in self.generations() {
+            if let Some((index, _)) = Self::chunks(&generation).first() {
+                return base + index * CHUNK_BYTES;
+            }
+        }
+        self.end_offset()
+    }
+
+    /// Time since the log last gained a generation or chunk.
+    fn idle_for(&self) -> Option<Duration> {
+        let mut modified = fs::metadata(&self.dir)
+            .and_then(|meta| meta.modified())
+            .ok()?;
+        if let Some((_, generation)) = self.generations().pop() {
+            let latest = Self::chunks(&generation)
+                .pop()
+                .map_or(generation, |(_, chunk)| chunk);
+            if let Ok(time) = fs::metadata(latest).and_then(|meta| meta.modified()) {
+                modified = modified.max(time);
+            }
+        }
+        Some(
+            SystemTime::now()
+                .duration_since(modified)
+                .unwrap_or(Duration::ZERO),
+        )
+    }
+
+    /// Drop the oldest chunks beyond the ring size, and generations left
+    /// empty. The live chunk is never removed.
+    fn prune(&self) {
+        let generations = self.generations();
+        let all: Vec<PathBuf> = generations
+            .iter()
+            .flat_map(|(_, generation)| Self::chunks(generation))
+            .map(|(_, chunk)| chunk)
+            .collect();
+        let excess = all.len().saturating_sub(MAX_CHUNKS);
+        for chunk in &all[..excess] {
+            let _ = fs::remove_file(chunk);
+        }
+        let live = generations.last().map(|(_, generation)| generation);
+        for (_, generation) in &generations {
+            if Some(generation) != live && Self::chunks(generation).is_empty() {
+                let _ = fs::remove_dir(generation);
+            }
+        }
+    }
+
+    /// Up to `max_bytes` bytes starting at `since`, or at the oldest byte
+    /// still kept when the ring has moved past `since`.
+    pub fn read(&self, since: u64, max_bytes: usize) -> OutputRead {
+        self.prune();
+        let start = self.start_offset();
+        let offset = since.max(start).min(self.end_offset());
+        let mut data = Vec::new();
+        let generations = self.generations();
+        for (i, (base, generation)) in generations.iter().enumerate() {
+            let next_base = generations.get(i + 1).map(|(next, _)| *next);
+            if next_base.is_some_and(|next| next <= offset) {
+                continue;
+            }
+            for (index, chunk) in Self::chunks(generation) {
+                let chunk_start = base + index * CHUNK_BYTES;
+                let pos = offset + data.len() as u64;
+                if data.len() >= max_bytes || chunk_start + CHUNK_BYTES <= pos {
+                    continue;
+                }
+                let want = max_bytes - data.len();
+                let _ = read_at(&chunk, pos.saturating_sub(chunk_start), want, &mut data);
+            }
+            if data.len() >= max_bytes {
+                break;
+            }
+        }
+        OutputRead {
+            offset,
+            next_offset: offset + data.len() as u64,
+            dropped: offset.saturating_sub(since),
+            data,
+        }
+    }
+
+    fn load_markers(&self) -> MarkerIndex {
+        let text = fs::read_to_string(self.dir.join(MARKERS_FILE)).unwrap_or_default();
+        let mut fields = text.split_whitespace();
+        let scanned_to = fields.next().and_then(|f| f.parse().ok()).unwrap_or(0);
+        let last_marker_end = fields.next().and_then(|f| f.parse().ok());
+        MarkerIndex {
+            scanned_to,
+            last_marker_end,
+        }
+    }
+
+    fn save_markers(&self, index: &MarkerIndex) {
+        let text = match index.last_marker_end {
+            Some(end) => format!("{} {}\n", index.scanned_to, end),
+            None => format!("{}\n", index.scanned_to),
+        };
+        let tmp = self
+            .dir
+            .join(format!("{}.tmp.{}", MARKERS_FILE, std::process::id()));
+        if fs::write(&tmp, text).is_ok() {
+            let _ = fs::rename(&tmp, self.dir.join(MARKERS_FILE));
+        }
+    }
+
+    /// The marker index, brought up to date by searching only the bytes
+    /// logged since the previous call.
+    pub fn markers(&self) -> MarkerIndex {
+        let mut index = self.load_markers();
+        let needle = TASK_COMPLETE_MARKER.as_bytes();
+        let end = self.end_offset();
+        if index.scanned_to >= end {
+            return index;
+        }
+        // Back up so a marker split across two scans is still found.
+        let mut cursor = index.scanned_to.saturating_sub(needle.len() as u64 - 1);
+        while cursor < end {
+            let read = self.read(cursor, CHUNK_BYTES as usize);
+            if read.data.is_empty() {
+                break;
+            }
+            if let Some(pos) = read
+                .data
+                .windows(needle.len())
+                .rposition(|window| window == needle)
+            {
+                let marker_end = read.offset + (pos + needle.len()) as u64;
+                if index.last_marker_end.map_or(true, |last| marker_end > last) {
+                    index.last_marker_end = Some(marker_end);
+                }
+            }
+            if read.next_offset >= end {
+                cursor = read.next_offset;
+                break;
+            }
+            // Overlap consecutive windows by one needle length.
+            cursor = (read.next_offset - (needle.len() as u64 - 1)).max(cursor + 1);
+        }
+        index.scanned_to = cursor.max(index.scanned_to);
+        self.save_markers(&index);
+        index
+    }
+
+    /// True when the last `[TASK COMPLETE]` marker is at the end of the
+    /// stream (see [`READY_TAIL_BYTES`]).
+    pub fn ready_to_complete(&self) -> bool {
+        self.markers().ready_to_complete()
+    }
+}
+
+/// `split` names chunks with base-26 letter suffixes (`aaaaaa`, `aaaaab`, …).
+fn chunk_index(suffix: &str) -> Option<u64> {
+    if suffix.len() != SUFFIX_LEN as usize {
+        return None;
+    }
+    suffix.bytes().try_fold(0u64, |acc, byte| {
+        byte.is_ascii_lowercase()
+            .then(|| acc * 26 + u64::from(byte - b'a'))
+    })
+}
+
+fn file_len(path: &Path) -> u64 {
+    fs::metadata(path).map(|meta| meta.len()).unwrap_or(0)
+}
+
+fn read_at(path: &Path, pos: u64, max: usize, out: &mut Vec<u8>) -> std::io::Result<usize> {
+    let mut file = File::open(path)?;
+    file.seek(SeekFrom::Start(pos))?;
+    file.take(max as u64).read_to_end(out)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn chunk_name(index: u64) -> String {
+        let mut suffix = vec![b'a'; SUFFIX_LEN as usize];
+        let mut rest = index;
+        for slot in suffix.iter_mut().rev() {
+            *slot = b'a' + (rest % 26) as u8;
+            rest /= 26;
+        }
+        format!("{}{}", CHUNK_PREFIX, String::from_utf8(suffix).unwrap())
+    }
+
+    /// Lay `bytes` out the way `split` would, as a generation at `base`.
+    fn write_generation(dir: &Path, base: u64, bytes: &[u8]) {
+        let generation = dir.join(format!("{:020}", base));
+        fs::create_dir_all(&generation).unwrap();
+        for (index, chunk) in bytes.chunks(CHUNK_BYTES as usize).enumerate() {
+            fs::write(generation.join(chunk_name(index as u64)), chunk).unwrap();
+        }
+    }
+
+    #[test]
+    fn chunk_suffixes_decode_in_split_order() {
+        assert_eq!(chunk_index("aaaaaa"), Some(0));
+        assert_eq!(chunk_index("aaaaab"), Some(1));
+        assert_eq!(chunk_index("aaaaba"), Some(26));
+        assert_eq!(chunk_index(&chunk_name(12345)[1..]), Some(12345));
+        assert_eq!(chunk_index("aaaaa"), None);
+        assert_eq!(chunk_index("aaaaa1"), None);
+    }
+
+    #[test]
+    fn reads_resume_across_chunks_and_generations() {
+        let dir = tempfile::tempdir().unwrap();
+        let first: Vec<u8> = (0..CHUNK_BYTES + 10).map(|i| (i % 251) as u8).collect();
+        write_generation(dir.path(), 0, &first);
+        write_generation(dir.path(), first.len() as u64, b"second pipe");
+        let log = OutputLog::new(dir.path());
+
+        assert_eq!(log.start_offset(), 0);
+        assert_eq!(log.end_offset(), first.len() as u64 + 11);
+
+        let read = log.read(CHUNK_BYTES - 5, 8);
+        assert_eq!(read.offset, CHUNK_BYTES - 5);
+        assert_eq!(read.data, first[(CHUNK_BYTES - 5) as usize..][..8].to_vec());
+
+        let read = log.read(CHUNK_BYTES + 5, 1024);
+        assert_eq!(read.data.len(), 5 + 11);
+        assert!(read.data.ends_with(b"second pipe"));
+        assert_eq!(read.next_offset, log.end_offset());
+
+        let caught_up = log.read(read.next_offset, 1024);
+        assert!(caught_up.data.is_empty());
+        assert_eq!(caught_up.next_offset, read.next_offset);
+    }
+
+    #[test]
+    fn ring_drops_oldest_chunks_and_reports_the_gap() {
+        let dir = tempfile::tempdir().unwrap();
+        let total = CHUNK_BYTES * (MAX_CHUNKS as u64 + 2) + 3;
+        let bytes = vec![b'x'; total as usize];
+        write_generation(dir.path(), 0, &bytes);
+        let log = OutputLog::new(dir.path());
+
+        let read = log.read(0, 16);
+        assert_eq!(read.offset, 3 * CHUNK_BYTES, "oldest kept chunk");
+        assert_eq!(read.dropped, 3 * CHUNK_BYTES);
+        assert_eq!(log.end_offset(), total, "offsets survive pruning");
+    }
+
+    #[test]
+    fn sweep_prunes_live_logs_and_removes_orphans() {
+        let state = tempfile::tempdir().unwrap();
+        let bytes = vec![b'x'; (CHUNK_BYTES * (MAX_CHUNKS as u64 + 4)) as usize];
+        write_generation(&log_dir(state.path(), "live"), 0, &bytes);
+        write_generation(&log_dir(state.path(), "exited"), 0, b"done");
+        let live = HashSet::from(["live"]);
+
+        // Fresh logs outlive a missing session for the grace period.
+        sweep(state.path(), &live);
+        assert!(log_dir(state.path(), "exited").exists());
+
+        sweep_with_grace(state.path(), &live, Duration::ZERO);
+        assert!(!log_dir(state.path(), "exited").exists());
+        let log = OutputLog::new(log_dir(state.path(), "live"));
+        assert_eq!(log.start_offset(), 4 * CHUNK_BYTES);
+        assert_eq!(log.end_offset(), bytes.len() as u64);
+    }
+
+    #[test]
+    fn markers_are_indexed_incrementally() {
+        let dir = tempfile::tempdir().unwrap();
+        let log = OutputLog::new(dir.path());
+        assert!(!log.ready_to_complete());
+
+        let generation = dir.path().join(format!("{:020}", 0));
+        fs::create_dir_all(&generation).unwrap();
+        let chunk = generation.join(chunk_name(0));
+        fs::write(&chunk, b"working...\r\n[TASK COMP").unwrap();
+        assert!(!log.ready_to_complete());
+
+        // The rest of the marker arrives after the first scan.
+        let mut data = fs::read(&chunk).unwrap();
+        data.extend_from_slice(b"LETE]\r\n> ");
+        fs::write(&chunk, &data).unwrap();
+        let index = log.markers();
+        assert_eq!(index.last_marker_end, Some(data.len() as u64 - 4));
+        assert!(log.ready_to_complete());
+
+        // A new turn of work pushes the marker out of the tail.
+        data.extend(std::iter::repeat(b'.').take(READY_TAIL_BYTES as usize));
+        fs::write(&chunk, &data).unwrap();
+        assert!(!log.ready_to_complete());
+        assert_eq!(log.markers().scanned_to, data.len() as u64);
+    }
+
+    #[test]
+    fn attach_pipes_the_pane_once_and_logs_its_output() {
+        let _env_lock = crate::test_env_lock();
+        if !std::process::Command::new("tmux")
+            .arg("-V")
+            .output()
+            .map(|output| output.status.success())
+            .unwrap_or(false)
+        {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+        let server = format!("omar-output-log-test-{}", std::process::id());
+        let previous = std::env::var_os("OMAR_TMUX_SERVER");
+        std::env::set_var("OMAR_TMUX_SERVER", &server);
+
+        let dir = tempfile::tempdir().unwrap();
+        let log = OutputLog::new(dir.path().join("agent"));
+        let client = TmuxClient::new("");
+        client.new_session("agent", "sh", None).unwrap();
+        let attached = log.attach(&client, "agent").unwrap();
+        let again = log.attach(&client, "agent").unwrap();
+        let other = OutputLog::new(dir.path().join("other"))
+            .attach(&client, "agent")
+            .unwrap();
+        client
+            .send_keys_literal("agent", "echo logged-line")
+            .unwrap();
+        client.send_keys("agent", "Enter").unwrap();
+        let deadline = std::time::Instant::now() + std::time::Duration::from_secs(5);
+        let mut output = String::new();
+        while std::time::Instant::now() < deadline {
+            output = String::from_utf8_lossy(&log.read(0, 4096).data).into_owned();
+            if output.matches("logged-line").count() >= 2 {
+                break;
+            }
+            std::thread::sleep(std::time::Duration::from_millis(50));
+        }
+
+        let _ = std::process::Command::new("tmux")
+            .args(["-L", &server, "kill-server"])
+            .status();
+        match previous {
+            Some(value) => std::env::set_var("OMAR_TMUX_SERVER", value),
+            None => std::env::remove_var("OMAR_TMUX_SERVER"),
+        }
+
+        assert!(attached && again, "re-attaching to our own log is a no-op");
+        assert!(!other, "a pane has one pipe");
+        assert!(output.matches("logged-line").count() >= 2, "{:?}", output);
+    }
+}
@@ -17,3 +17,18 @@ impl Session {
         }
     }
 }
+
+/// Everything the dashboard and API need about one session's pane, gathered
+/// for all sessions at once by `TmuxClient::snapshot_all`.
+#[derive(Debug, Clone)]
+pub struct PaneSnapshot {
+    pub session: Session,
+    /// `#{window_activity}` — see `TmuxClient::get_pane_activity` for why
+    /// window-level activity stands in for pane activity.
+    pub pane_activity: i64,
+    /// `#{pane_current_command}` (e.g. "claude", "zsh").
+    pub command: String,
+    /// Plain-text tail of the pane; empty when no tail was requested or the
+    /// capture failed.
+    pub tail: String,
+}
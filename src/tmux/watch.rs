@@ -0,0 +1,461 @@
+//! Streaming pane-output watch used to confirm prompt delivery without
+//! capture polling.
+//!
+//! tmux only emits `%output` notifications for panes in a control client's
+//! own session, and attaching to an agent session would flip its
+//! `session_attached` flag. `pipe-pane -O` gives the same byte stream for
+//! any pane: tmux writes everything the pane prints into a private FIFO
+//! that a reader thread drains as it arrives, so waiting for output is a
+//! blocking receive instead of a tmux round-trip plus a 200-line scan.
+//!
+//! [`StreamMatcher`] scans only the newly arrived bytes, with escape
+//! sequences stripped and a short carry-over so needles split across reads
+//! still match. A hit is a *candidate* — callers confirm it against a real
+//! capture, since TUIs can repaint stale text.
+//!
+//! A pane that already feeds its persistent output log (`output_log`) is
+//! watched by tailing that log, since tmux allows one pipe per pane.
+//!
+//! Our own pipes are tagged with the owning process in [`WATCH_OPTION`]. If
+//! that process died mid-delivery the pipe outlives it, so the next watch
+//! replaces it instead of falling back to capture polling for good.
+
+use std::fs::{File, OpenOptions};
+use std::io::{Read, Write};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{mpsc, Arc};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use super::output_log::{OutputLog, LOG_OPTION};
+use super::TmuxClient;
+use crate::paths::PrivateFifo;
+
+/// Pane option holding the pid of the process whose watch pipes the pane.
+const WATCH_OPTION: &str = "@omar_watch_pipe";
+/// First and longest sleep between reads while tailing an output log,
+/// which has no blocking read; the interval doubles while it stays quiet.
+const LOG_TICK_MIN: Duration = Duration::from_millis(2);
+const LOG_TICK_MAX: Duration = Duration::from_millis(50);
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum EscapeState {
+    Text,
+    Esc,
+    /// `ESC [` … final byte 0x40–0x7e.
+    Csi,
+    /// `ESC ]` (and DCS/APC/PM/SOS) … BEL or `ESC \`.
+    Str,
+    StrEsc,
+}
+
+/// Incremental multi-needle matcher over a raw terminal byte stream.
+pub(crate) struct StreamMatcher {
+    needles: Vec<Vec<u8>>,
+    hits: Vec<usize>,
+    /// Last `longest needle - 1` visible bytes from earlier chunks.
+    carry: Vec<u8>,
+    state: EscapeState,
+}
+
+impl StreamMatcher {
+    pub fn new(needles: &[&str]) -> Self {
+        Self {
+            needles: needles.iter().map(|n| n.as_bytes().to_vec()).collect(),
+            hits: vec![0; needles.len()],
+            carry: Vec::new(),
+            state: EscapeState::Text,
+        }
+    }
+
+    /// Number of occurrences of needle `index` seen so far.
+    pub fn hits(&self, index: usize) -> usize {
+        self.hits[index]
+    }
+
+    /// Feed the next raw chunk. Returns true when any needle completed an
+    /// occurrence inside this chunk.
+    pub fn feed(&mut self, raw: &[u8]) -> bool {
+        let carried = self.carry.len();
+        let mut visible = std::mem::take(&mut self.carry);
+        for &byte in raw {
+            self.state = match (self.state, byte) {
+                (EscapeState::Text, 0x1b) => EscapeState::Esc,
+                // Control bytes (CR, LF, BS, …) carry no matchable text.
+                (EscapeState::Text, b) if b < 0x20 || b == 0x7f => EscapeState::Text,
+                (EscapeState::Text, b) => {
+                    visible.push(b);
+                    EscapeState::Text
+                }
+                (EscapeState::Esc, b'[') => EscapeState::Csi,
+                (EscapeState::Esc, b']' | b'P' | b'X' | b'^' | b'_') => EscapeState::Str,
+                (EscapeState::Esc, _) => EscapeState::Text,
+                (EscapeState::Csi, 0x40..=0x7e) => EscapeState::Text,
+                (EscapeState::Csi, _) => EscapeState::Csi,
+                (EscapeState::Str, 0x07) => EscapeState::Text,
+                (EscapeState::Str, 0x1b) => EscapeState::StrEsc,
+                (EscapeState::Str, _) => EscapeState::Str,
+                (EscapeState::StrEsc, b'\\') => EscapeState::Text,
+                (EscapeState::StrEsc, _) => EscapeState::Str,
+            };
+        }
+
+        let mut matched = false;
+        for (needle, hits) in self.needles.iter().zip(self.hits.iter_mut()) {
+            if needle.is_empty() || visible.len() < needle.len() {
+                continue;
+            }
+            // Only count occurrences that end in the new bytes; ones wholly
+            // inside the carry were counted by the previous call.
+            let new = visible
+                .windows(needle.len())
+                .enumerate()
+                .filter(|(start, window)| start + window.len() > carried && window == needle)
+                .count();
+            if new > 0 {
+                *hits += new;
+                matched = true;
+            }
+        }
+
+        let keep = self
+            .needles
+            .iter()
+            .map(|n| n.len().saturating_sub(1))
+            .max()
+            .unwrap_or(0);
+        let from = visible.len().saturating_sub(keep);
+        self.carry = visible.split_off(from);
+        matched
+    }
+}
+
+/// Where a [`PaneWatch`] reads from.
+enum Source {
+    /// A pipe of our own into a FIFO, closed on drop.
+    Pipe(FifoReader),
+    /// The pane's persistent output log, read from a cursor.
+    Log { log: OutputLog, offset: u64 },
+}
+
+/// A thread blocked reading a FIFO, forwarding each chunk it reads.
+struct FifoReader {
+    chunks: mpsc::Receiver<Vec<u8>>,
+    /// Our own handle on the FIFO. Opening read-write never blocks waiting
+    /// for tmux's writer, and lets drop wake the thread with one byte.
+    handle: File,
+    stop: Arc<AtomicBool>,
+    /// Unlinked on drop; open handles keep working.
+    _fifo: PrivateFifo,
+}
+
+impl FifoReader {
+    fn start(fifo: PrivateFifo) -> Option<Self> {
+        let handle = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .open(fifo.path())
+            .ok()?;
+        let mut reader = handle.try_clone().ok()?;
+        let stop = Arc::new(AtomicBool::new(false));
+        let (tx, chunks) = mpsc::channel();
+        let stopped = stop.clone();
+        thread::Builder::new()
+            .name("omar-pane-watch".to_string())
+            .spawn(move || {
+                let mut buf = vec![0; 64 * 1024];
+                while let Ok(n) = reader.read(&mut buf) {
+                    if n == 0
+                        || stopped.load(Ordering::Acquire)
+                        || tx.send(buf[..n].to_vec()).is_err()
+                    {
+                        break;
+                    }
+                }
+            })
+            .ok()?;
+        Some(Self {
+            chunks,
+            handle,
+            stop,
+            _fifo: fifo,
+        })
+    }
+
+    /// `data` plus every chunk already received.
+    fn drain(&self, mut data: Vec<u8>) -> Vec<u8> {
+        while let Ok(chunk) = self.chunks.try_recv() {
+            data.extend(chunk);
+        }
+        data
+    }
+}
+
+impl Drop for FifoReader {
+    fn drop(&mut self) {
+        self.stop.store(true, Ordering::Release);
+        let _ = self.handle.write_all(&[0]);
+    }
+}
+
+/// A `pipe-pane -O` stream of one pane's output.
+pub(crate) struct PaneWatch<'a> {
+    client: &'a TmuxClient,
+    target: String,
+    source: Source,
+}
+
+impl<'a> PaneWatch<'a> {
+    /// Start streaming `target`'s output: through its output log when it
+    /// has one, otherwise through a pipe of our own. Returns `None` when
+    /// the pane is piped elsewhere (the user's pipe, or a live delivery's —
+    /// `pipe-pane` allows one per pane) or the pipe cannot be set up;
+    /// callers then fall back to capture polling.
+    pub fn start(client: &'a TmuxClient, target: &str) -> Option<Self> {
+        let format = format!("#{{pane_pipe}}\t#{{{}}}\t#{{{}}}", LOG_OPTION, WATCH_OPTION);
+        let state = client
+            .run(&["display-message", "-p", "-t", target, &format])
+            .ok()?;
+        let mut fields = state.trim_end_matches('\n').split('\t');
+        let piped = fields.next().unwrap_or("1");
+        let log_dir = fields.next().unwrap_or_default();
+        let owner = fields.next().unwrap_or_default();
+        if piped == "1" && !log_dir.is_empty() {
+            let log = OutputLog::new(log_dir);
+            let offset = log.end_offset();
+            return Some(Self {
+                client,
+                target: target.to_string(),
+                source: Source::Log { log, offset },
+            });
+        }
+        // A pipe tagged by a process that is gone was left behind by a
+        // delivery that never finished; `pipe-pane` below replaces it.
+        let abandoned = owner
+            .parse()
+            .is_ok_and(|pid| !crate::process::pid_alive(pid));
+        if piped == "1" && !abandoned {
+            return None;
+        }
+
+        let fifo = crate::paths::create_private_fifo("omar-watch").ok()?;
+        let command = format!(
+            "exec cat > '{}'",
+            fifo.path().to_str()?.replace('\'', r"'\''")
+        );
+        let reader = FifoReader::start(fifo)?;
+        let pid = std::process::id().to_string();
+        client
+            .run(&["set-option", "-p", "-t", target, WATCH_OPTION, &pid])
+            .ok()?;
+        client
+            .run(&["pipe-pane", "-O", "-t", target, &command])
+            .ok()?;
+        Some(Self {
+            client,
+            target: target.to_string(),
+            source: Source::Pipe(reader),
+        })
+    }
+
+    /// Bytes the pane printed since the previous call, waiting up to
+    /// `timeout` for the first of them.
+    pub fn wait_new(&mut self, timeout: Duration) -> Vec<u8> {
+        match &mut self.source {
+            Source::Pipe(reader) => match reader.chunks.recv_timeout(timeout) {
+                Ok(first) => reader.drain(first),
+                Err(_) => Vec::new(),
+            },
+            Source::Log { log, offset } => {
+                let deadline = Instant::now() + timeout;
+                let mut tick = LOG_TICK_MIN;
+                loop {
+                    let read = log.read(*offset, usize::MAX);
+                    *offset = read.next_offset;
+                    let left = deadline.saturating_duration_since(Instant::now());
+                    if !read.data.is_empty() || left.is_zero() {
+                        return read.data;
+                    }
+                    thread::sleep(tick.min(left));
+                    tick = (tick * 2).min(LOG_TICK_MAX);
+                }
+            }
+        }
+    }
+
+    /// Discard everything printed so far.
+    pub fn skip_pending(&mut self) {
+        match &mut self.source {
+            Source::Pipe(reader) => {
+                reader.drain(Vec::new());
+            }
+            Source::Log { log, offset } => *offset = log.end_offset(),
+        }
+    }
+}
+
+impl Drop for PaneWatch<'_> {
+    fn drop(&mut self) {
+        // `pipe-pane` without a command closes the pane's pipe. The output
+        // log's pipe is not ours to close.
+        if matches!(self.source, Source::Pipe(_)) {
+            let _ = self.client.run(&["pipe-pane", "-t", &self.target]);
+            let _ = self
+                .client
+                .run(&["set-option", "-p", "-u", "-t", &self.target, WATCH_OPTION]);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn matcher_strips_escapes_and_matches_across_chunks() {
+        let mut matcher = StreamMatcher::new(&["<UserPromptEnds:ab12>", "[Pasted "]);
+        assert!(!matcher.feed(b"\x1b[2K\r> hello <UserPrompt"));
+        assert!(matcher.feed(b"\x1b[1mEnds:\x1b[0mab12>\r\n"));
+        assert_eq!(matcher.hits(0), 1);
+        assert_eq!(matcher.hits(1), 0);
+
+        // The carried-over tail must not be counted twice.
+        assert!(!matcher.feed(b"x"));
+        assert_eq!(matcher.hits(0), 1);
+
+        assert!(matcher.feed(b"\x1b]0;title\x07[Pasted text #1 +40 lines]"));
+        assert_eq!(matcher.hits(1), 1);
+    }
+
+    #[test]
+    fn matcher_handles_escape_split_between_chunks() {
+        let mut matcher = StreamMatcher::new(&["END"]);
+        assert!(!matcher.feed(b"E\x1b["));
+        assert!(!matcher.feed(b"31"));
+        assert!(matcher.feed(b"mND"));
+        assert_eq!(matcher.hits(0), 1);
+    }
+
+    #[test]
+    fn watch_tails_an_existing_output_log_and_leaves_its_pipe() {
+        let _env_lock = crate::test_env_lock();
+        if !std::process::Command::new("tmux")
+            .arg("-V")
+            .output()
+            .map(|output| output.status.success())
+            .unwrap_or(false)
+        {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+        let server = format!("omar-watch-log-test-{}", std::process::id());
+        let previous = std::env::var_os("OMAR_TMUX_SERVER");
+        std::env::set_var("OMAR_TMUX_SERVER", &server);
+
+        let dir = tempfile::tempdir().unwrap();
+        let client = TmuxClient::new("");
+        client.new_session("agent", "sh", None).unwrap();
+        OutputLog::new(dir.path()).attach(&client, "agent").unwrap();
+        let mut seen = Vec::new();
+        let tails_log = {
+            let mut watch = PaneWatch::start(&client, "=agent:").expect("log-backed watch");
+            client.send_keys_literal("agent", "echo watched").unwrap();
+            client.send_keys("agent", "Enter").unwrap();
+            let deadline = std::time::Instant::now() + std::time::Duration::from_secs(5);
+            while std::time::Instant::now() < deadline
+                && !String::from_utf8_lossy(&seen).contains("watched\r\n")
+            {
+                seen.extend(watch.wait_new(std::time::Duration::from_millis(50)));
+            }
+            matches!(watch.source, Source::Log { .. })
+        };
+        let still_piped = client
+            .run(&["display-message", "-p", "-t", "=agent:", "#{pane_pipe}"])
+            .map(|out| out.trim() == "1")
+            .unwrap_or(false);
+
+        let _ = std::process::Command::new("tmux")
+            .args(["-L", &server, "kill-server"])
+            .status();
+        match previous {
+            Some(value) => std::env::set_var("OMAR_TMUX_SERVER", value),
+            None => std::env::remove_var("OMAR_TMUX_SERVER"),
+        }
+
+        assert!(tails_log);
+        assert!(String::from_utf8_lossy(&seen).contains("watched"));
+        assert!(still_piped, "dropping the watch keeps the log's pipe");
+    }
+
+    #[test]
+    fn watch_replaces_a_pipe_left_by_a_dead_process() {
+        let _env_lock = crate::test_env_lock();
+        if !std::process::Command::new("tmux")
+            .arg("-V")
+            .output()
+            .map(|output| output.status.success())
+            .unwrap_or(false)
+        {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+        let server = format!("omar-watch-stale-test-{}", std::process::id());
+        let previous = std::env::var_os("OMAR_TMUX_SERVER");
+        std::env::set_var("OMAR_TMUX_SERVER", &server);
+
+        let client = TmuxClient::new("");
+        client.new_session("agent", "sh", None).unwrap();
+        let target = "=agent:";
+        // What a delivery leaves behind when its process dies mid-wait
+        // (pids above i32::MAX never name a live process).
+        client
+            .run(&["set-option", "-p", "-t", target, WATCH_OPTION, "4294967295"])
+            .unwrap();
+        client
+            .run(&["pipe-pane", "-O", "-t", target, "cat > /dev/null"])
+            .unwrap();
+        let mut seen = Vec::new();
+        let streamed = match PaneWatch::start(&client, target) {
+            Some(mut watch) => {
+                client.send_keys_literal("agent", "echo reclaimed").unwrap();
+                client.send_keys("agent", "Enter").unwrap();
+                let deadline = Instant::now() + Duration::from_secs(5);
+                while Instant::now() < deadline
+                    && !String::from_utf8_lossy(&seen).contains("reclaimed\r\n")
+                {
+                    seen.extend(watch.wait_new(Duration::from_millis(100)));
+                }
+                matches!(watch.source, Source::Pipe(_))
+            }
+            None => false,
+        };
+        let after = client
+            .run(&[
+                "display-message",
+                "-p",
+                "-t",
+                target,
+                &format!("#{{pane_pipe}}|#{{{}}}", WATCH_OPTION),
+            ])
+            .unwrap_or_default();
+
+        let _ = std::process::Command::new("tmux")
+            .args(["-L", &server, "kill-server"])
+            .status();
+        match previous {
+            Some(value) => std::env::set_var("OMAR_TMUX_SERVER", value),
+            None => std::env::remove_var("OMAR_TMUX_SERVER"),
+        }
+
+        assert!(streamed, "the abandoned pipe is replaced");
+        assert!(String::from_utf8_lossy(&seen).contains("reclaimed"));
+        assert_eq!(after.trim(), "0|", "dropping the watch closes and untags");
+    }
+
+    #[test]
+    fn matcher_counts_repeated_needles_in_one_chunk() {
+        let mut matcher = StreamMatcher::new(&["[Pasted "]);
+        assert!(matcher.feed(b"[Pasted text #1] ... [Pasted text #2]"));
+        assert_eq!(matcher.hits(0), 2);
+    }
+}
@@ -7,7 +7,7 @@ use ratatui::{
 };
 use regex::Regex;
 
-use crate::app::{AgentInfo, App, ConfirmAction, SidebarPanel};
+use crate::app::{AgentInfo, App, CommandTreeNode, ConfirmAction, SidebarPanel};
 use crate::config;
 use crate::tmux::HealthState;
 
@@ -330,8 +330,12 @@ const QUOTES: &[&str] = &[
 
 pub const QUOTE_COUNT: usize = QUOTES.len();
 
+/// Pane output parsed for display, as cached by [`App::focus_parent_preview`].
+pub type PreviewText = ratatui::text::Text<'static>;
+
 /// Render the entire dashboard
 pub fn render(frame: &mut Frame, app: &App) {
+    app.ticker_scrolling.set(false);
     let status_height = 3;
     let outer = Layout::default()
         .direction(Direction::Vertical)
@@ -516,6 +520,7 @@ fn render_status_row(frame: &mut Frame, app: &App, status_spans: &[Span], area:
                 .collect();
             let total_len = padded.chars().count();
             let offset = app.ticker_offset % total_len;
+            app.ticker_scrolling.set(true);
             padded
                 .chars()
                 .cycle()
@@ -591,12 +596,17 @@ fn render_agent_grid(frame: &mut Frame, app: &App, area: Rect) {
         return;
     }
 
-    // Simple 2-column grid layout
+    // Simple 2-column grid layout. Only the page of rows holding the
+    // selected card is laid out and rendered, so a large swarm costs no
+    // more per frame than a screenful of cards.
     let cols = 2.min(children.len()).max(1);
     let total_rows = children.len().div_ceil(cols);
+    let fitting_rows = (area.height / MIN_CARD_HEIGHT).max(1) as usize;
+    let rows = visible_page(total_rows, fitting_rows, app.selected / cols);
 
-    let row_height = (area.height / total_rows as u16).max(6);
-    let row_constraints: Vec<Constraint> = (0..total_rows)
+    let row_height = (area.height / rows.len() as u16).max(MIN_CARD_HEIGHT);
+    let row_constraints: Vec<Constraint> = rows
+        .clone()
         .map(|_| Constraint::Length(row_height))
         .collect();
 
@@ -605,30 +615,59 @@ fn render_agent_grid(frame: &mut Frame, app: &App, area: Rect) {
         .constraints(row_constraints)
         .split(area);
 
-    for (i, child) in children.iter().enumerate() {
-        let row = i / cols;
-        let col = i % cols;
-
-        if row >= row_chunks.len() {
-            break;
-        }
-
-        let col_constraints: Vec<Constraint> = (0..cols)
-            .map(|_| Constraint::Ratio(1, cols as u32))
-            .collect();
+    let col_constraints: Vec<Constraint> = (0..cols)
+        .map(|_| Constraint::Ratio(1, cols as u32))
+        .collect();
 
+    for (row_area, row) in row_chunks.iter().zip(rows) {
         let col_chunks = Layout::default()
             .direction(Direction::Horizontal)
-            .constraints(col_constraints)
-            .split(row_chunks[row]);
+            .constraints(col_constraints.clone())
+            .split(*row_area);
 
-        if col < col_chunks.len() {
+        for (col, card_area) in col_chunks.iter().enumerate() {
+            let i = row * cols + col;
+            let Some(child) = children.get(i) else {
+                break;
+            };
             let is_selected = !app.sidebar_focused && !app.manager_selected && i == app.selected;
-            render_summary_card(frame, app, child, col_chunks[col], is_selected);
+            render_summary_card(frame, app, child, *card_area, is_selected);
         }
     }
 }
 
+/// Shortest agent card the grid lays out before paging.
+const MIN_CARD_HEIGHT: u16 = 6;
+
+/// The items of a `len`-item list that a `visible`-item viewport shows:
+/// the page holding `anchor`. Paging rather than scrolling keeps the view
+/// stable without remembering an offset between frames.
+fn visible_page(len: usize, visible: usize, anchor: usize) -> std::ops::Range<usize> {
+    let visible = visible.max(1);
+    let start = anchor.min(len.saturating_sub(1)) / visible * visible;
+    start..(start + visible).min(len)
+}
+
+/// The tree nodes a `height`-line panel shows, on the page holding the
+/// focus parent, and the "x–y of n" line to end it with when the tree
+/// doesn't fit.
+fn visible_tree_nodes(app: &App, height: usize) -> (&[CommandTreeNode], Option<Line<'static>>) {
+    let nodes = app.command_tree.as_slice();
+    if nodes.len() <= height {
+        return (nodes, None);
+    }
+    let focus = nodes
+        .iter()
+        .position(|node| node.session_name == app.focus_parent)
+        .unwrap_or(0);
+    let page = visible_page(nodes.len(), height.saturating_sub(1), focus);
+    let footer = Line::from(Span::styled(
+        format!("{}–{} of {}", page.start + 1, page.end, nodes.len()),
+        Style::default().fg(COLOR_INACTIVE),
+    ));
+    (&nodes[page], Some(footer))
+}
+
 fn render_focus_parent(frame: &mut Frame, app: &App, area: Rect) {
     let parent_info = app.focus_parent_info();
 
@@ -708,20 +747,12 @@ fn render_focus_parent(frame: &mut Frame, app: &App, area: Rect) {
             .border_style(border_style)
             .padding(Padding::horizontal(1));
 
-        // Get focus parent output - more lines to fill the panel
+        // Get focus parent output - more lines to fill the panel. The
+        // parsed lines are cached until the pane produces new output.
         let available_lines = area.height.saturating_sub(2) as i32;
-        let output = app
-            .get_focus_parent_output(available_lines.max(20))
-            .unwrap_or_default();
-
-        // Parse ANSI codes and convert to ratatui text
-        let mut content = match ansi_to_tui::IntoText::into_text(&output) {
-            Ok(text) => text,
-            Err(_) => {
-                let plain = strip_ansi(&output);
-                ratatui::text::Text::raw(plain)
-            }
-        };
+        let preview = app.focus_parent_preview(available_lines.max(20), parse_pane_output);
+        let mut content =
+            ratatui::text::Text::from(preview.lines.iter().map(borrow_line).collect::<Vec<_>>());
 
         if !is_manager && app.child_count(&app.focus_parent) > 0 {
             let now_ns = std::time::SystemTime::now()
@@ -831,8 +862,9 @@ fn render_command_tree(frame: &mut Frame, app: &App, area: Rect) {
     }
 
     let mut lines: Vec<Line> = Vec::new();
+    let (nodes, footer) = visible_tree_nodes(app, area.height.saturating_sub(2) as usize);
 
-    for node in &app.command_tree {
+    for node in nodes {
         let (health_color, icon) = match node.health {
             HealthState::Running => (Color::Green, "●"),
             HealthState::Idle => (Color::Yellow, "○"),
@@ -862,11 +894,9 @@ fn render_command_tree(frame: &mut Frame, app: &App, area: Rect) {
         } else {
             // Build prefix from ancestor continuation lines
             let mut prefix = String::from(" ");
-            for i in 0..node.ancestor_is_last.len() {
-                if i == 0 {
-                    continue; // skip EA level (always root)
-                }
-                if node.ancestor_is_last[i] {
+            // Depth 0 is the EA level (always root).
+            for i in 1..node.depth {
+                if node.ancestor_is_last.is_last(i) {
                     prefix.push_str("    ");
                 } else {
                     prefix.push_str(" │  ");
@@ -904,6 +934,9 @@ fn render_command_tree(frame: &mut Frame, app: &App, area: Rect) {
 
         lines.push(Line::from(spans));
     }
+    if let Some(footer) = footer {
+        lines.push(footer);
+    }
 
     let paragraph = Paragraph::new(lines).block(block);
     frame.render_widget(paragraph, area);
@@ -916,8 +949,18 @@ fn render_event_queue(frame: &mut Frame, app: &App, area: Rect) {
     } else {
         COLOR_INACTIVE
     };
+    // Delivery pipeline load: deliveries waiting for their pane's lane or a
+    // concurrency slot, and deliveries currently running.
+    let stats = app.scheduler.delivery_stats();
+    let title = match (stats.queued(), stats.in_flight()) {
+        (0, 0) => " Event Queue ".to_string(),
+        (queued, in_flight) => format!(
+            " Event Queue · {} queued · {} delivering ",
+            queued, in_flight
+        ),
+    };
     let block = Block::default()
-        .title(" Event Queue ")
+        .title(title)
         .borders(Borders::ALL)
         .border_type(BorderType::Thick)
         .border_style(Style::default().fg(border_color))
@@ -960,6 +1003,27 @@ fn render_event_queue(frame: &mut Frame, app: &App, area: Rect) {
     frame.render_widget(paragraph, area);
 }
 
+/// Parse ANSI codes and convert to ratatui text
+fn parse_pane_output(output: &str) -> PreviewText {
+    match ansi_to_tui::IntoText::into_text(&output) {
+        Ok(text) => text,
+        Err(_) => ratatui::text::Text::raw(strip_ansi(output)),
+    }
+}
+
+/// A view of a cached line that borrows its text instead of copying it.
+fn borrow_line<'a>(line: &'a Line<'static>) -> Line<'a> {
+    let mut borrowed = Line::from(
+        line.spans
+            .iter()
+            .map(|span| Span::styled(span.content.as_ref(), span.style))
+            .collect::<Vec<_>>(),
+    )
+    .style(line.style);
+    borrowed.alignment = line.alignment;
+    borrowed
+}
+
 /// Strip ANSI escape codes from a string (fallback)
 fn strip_ansi(s: &str) -> String {
     use std::sync::OnceLock;
@@ -1232,6 +1296,7 @@ fn render_help_bar(frame: &mut Frame, app: &App, area: Rect) {
                     .collect();
                 let total_len = padded.chars().count();
                 let offset = app.ticker_offset % total_len;
+                app.ticker_scrolling.set(true);
                 padded
                     .chars()
                     .cycle()
@@ -1551,6 +1616,22 @@ fn render_events_popup(frame: &mut Frame, app: &App) {
         }
     }
 
+    let cron = app.scheduler.cron_stats();
+    if cron.fires > 0 {
+        lines.push(Line::from(""));
+        lines.push(Line::from(Span::styled(
+            format!(
+                "Cron: {} fires, {} coalesced, drift mean {:+.1}ms, max late {:.1}ms, max early {:.1}ms",
+                cron.fires,
+                cron.coalesced,
+                cron.mean_drift_ms(),
+                cron.max_late_ns as f64 / 1_000_000.0,
+                cron.max_early_ns as f64 / 1_000_000.0,
+            ),
+            Style::default().fg(COLOR_INACTIVE),
+        )));
+    }
+
     lines.push(Line::from(""));
     lines.push(Line::from(Span::styled(
         "Press Esc or 'e' to close",
@@ -1747,7 +1828,10 @@ fn render_sidebar_popup(frame: &mut Frame, app: &App, panel: SidebarPanel) {
                     Style::default().fg(COLOR_INACTIVE),
                 )));
             } else {
-                for node in &app.command_tree {
+                // Borders plus the two closing lines below.
+                let height = area.height.saturating_sub(4) as usize;
+                let (nodes, footer) = visible_tree_nodes(app, height);
+                for node in nodes {
                     let (health_color, icon) = match node.health {
                         HealthState::Running => (Color::Green, "●"),
                         HealthState::Idle => (Color::Yellow, "○"),
@@ -1763,7 +1847,7 @@ fn render_sidebar_popup(frame: &mut Frame, app: &App, panel: SidebarPanel) {
                     let mut prefix = String::new();
                     if node.depth > 0 {
                         for d in 1..node.depth {
-                            if d < node.ancestor_is_last.len() && node.ancestor_is_last[d] {
+                            if node.ancestor_is_last.is_last(d) {
                                 prefix.push_str("    ");
                             } else {
                                 prefix.push_str(" │  ");
@@ -1785,6 +1869,9 @@ fn render_sidebar_popup(frame: &mut Frame, app: &App, panel: SidebarPanel) {
                         Span::styled(icon, Style::default().fg(health_color)),
                     ]));
                 }
+                if let Some(footer) = footer {
+                    lines.push(footer);
+                }
             }
             (" Chain of Command ", lines)
         }
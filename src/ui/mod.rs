@@ -1,4 +1,5 @@
 mod dashboard;
 
 pub use dashboard::render;
+pub use dashboard::PreviewText;
 pub use dashboard::QUOTE_COUNT;
@@ -0,0 +1,299 @@
+//! Pre-booted idle agent sessions ("warm pool").
+//!
+//! Backend cold start (the claude/codex/opencode TUI booting and bringing up
+//! its MCP server) is most of a spawn's latency. When `[warm_pool]` in
+//! config.toml asks for it, the dashboard keeps that many idle sessions per
+//! EA and backend, launched with the agent prompt but no identity.
+//! `spawn_agent` claims one by renaming it to the new agent's name; the
+//! name, parent and task then arrive in the first message, as they already
+//! do on a cold spawn.
+//!
+//! The pool has no state outside tmux. A warm session's name records its EA
+//! and a hash of the command and working directory it was started with, so
+//! any process can find a matching one, and `rename-session` makes the claim
+//! atomic: of two spawns racing for one session, only one rename finds it.
+//! Warm names start with `<base>warm-`, never with an EA's `<base><id>-`
+//! prefix, so agent listings don't see them.
+
+use anyhow::Result;
+use uuid::Uuid;
+
+use crate::content_hash::content_hash;
+use crate::ea::EaId;
+use crate::manager::{self, McpLaunchContext};
+use crate::tmux::TmuxClient;
+
+/// Sessions a single reconcile pass may start, so a dashboard launch with a
+/// large pool doesn't boot every backend at once.
+const MAX_STARTS_PER_PASS: usize = 4;
+
+/// Stands in for the parent in a warm session's system prompt; the real
+/// one is named in the `YOUR PARENT:` line of the first message.
+const WARM_PARENT_NAME: &str = "<YOUR PARENT from your first message>";
+const WARM_TASK: &str = "<YOUR TASK from your first message>";
+
+/// One pool to keep filled: `size` sessions of `base_command` for `ea_id`.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct PoolTarget {
+    pub ea_id: EaId,
+    pub base_command: String,
+    pub size: usize,
+}
+
+fn all_pools_prefix(base_prefix: &str) -> String {
+    format!("{}warm-", base_prefix)
+}
+
+/// [`content_hash`] folded to 32 bits; claimants and the dashboard must
+/// agree on it.
+fn pool_key(base_command: &str, workdir: &str) -> String {
+    let hash = content_hash([base_command.as_bytes(), workdir.as_bytes()]);
+    format!("{:08x}", (hash ^ (hash >> 32)) as u32)
+}
+
+/// Name prefix shared by the warm sessions of one pool.
+fn pool_prefix(base_prefix: &str, ea_id: EaId, base_command: &str, workdir: &str) -> String {
+    format!(
+        "{}{}-{}-",
+        all_pools_prefix(base_prefix),
+        ea_id,
+        pool_key(base_command, workdir)
+    )
+}
+
+/// Launch command for a warm session: the agent prompt with the
+/// per-spawn values replaced by pointers to the first message.
+fn warm_command(base_command: &str, context: &McpLaunchContext) -> String {
+    let prompt_file = manager::prompts_dir(&context.omar_dir).join("agent.md");
+    manager::build_agent_command(
+        base_command,
+        &prompt_file,
+        &[
+            ("{{PARENT_NAME}}", WARM_PARENT_NAME),
+            ("{{TASK}}", WARM_TASK),
+            ("{{EA_ID}}", &context.ea_id.to_string()),
+        ],
+        context,
+    )
+}
+
+/// Claim a live warm session started with `base_command` in `workdir` and
+/// rename it to `session_name`. False when the pool has none, in which case
+/// the caller spawns cold.
+pub fn claim(
+    base_prefix: &str,
+    ea_id: EaId,
+    base_command: &str,
+    workdir: &str,
+    session_name: &str,
+) -> bool {
+    let client = TmuxClient::new(pool_prefix(base_prefix, ea_id, base_command, workdir));
+    let Ok(candidates) = client.list_sessions() else {
+        return false;
+    };
+    candidates.iter().any(|candidate| {
+        client
+            .session_has_live_pane(&candidate.name)
+            .unwrap_or(false)
+            && client.rename_session(&candidate.name, session_name).is_ok()
+    })
+}
+
+/// What a reconcile pass does: start one session per entry of `start` (an
+/// index into the targets) and kill `kill`.
+#[derive(Debug, Default, PartialEq, Eq)]
+struct Plan {
+    start: Vec<usize>,
+    kill: Vec<String>,
+}
+
+/// `pools` pairs each target's name prefix with its size. Sessions no pool
+/// wants (an EA was deleted, a backend was dropped from the config, the
+/// default workdir changed) and any surplus are killed.
+fn plan(existing: &[String], pools: &[(String, usize)]) -> Plan {
+    let mut plan = Plan::default();
+    let mut counts = vec![0usize; pools.len()];
+    for name in existing {
+        match pools
+            .iter()
+            .position(|(prefix, _)| name.starts_with(prefix.as_str()))
+        {
+            Some(i) if counts[i] < pools[i].1 => counts[i] += 1,
+            _ => plan.kill.push(name.clone()),
+        }
+    }
+    for (i, (_, size)) in pools.iter().enumerate() {
+        for _ in counts[i]..*size {
+            if plan.start.len() == MAX_STARTS_PER_PASS {
+                return plan;
+            }
+            plan.start.push(i);
+        }
+    }
+    plan
+}
+
+/// Bring the warm sessions under `base_prefix` to `targets`. `context_for`
+/// builds the MCP launch context an EA's sessions are started with.
+/// Returns how many sessions were started.
+pub fn reconcile(
+    base_prefix: &str,
+    workdir: &str,
+    targets: &[PoolTarget],
+    context_for: impl Fn(EaId) -> McpLaunchContext,
+) -> Result<usize> {
+    let client = TmuxClient::new(all_pools_prefix(base_prefix));
+    let existing: Vec<String> = client
+        .list_sessions()?
+        .into_iter()
+        .map(|session| session.name)
+        .collect();
+    let pools: Vec<(String, usize)> = targets
+        .iter()
+        .map(|target| {
+            (
+                pool_prefix(base_prefix, target.ea_id, &target.base_command, workdir),
+                target.size,
+            )
+        })
+        .collect();
+
+    let plan = plan(&existing, &pools);
+    for name in &plan.kill {
+        let _ = client.kill_session(name);
+    }
+    for &i in &plan.start {
+        let target = &targets[i];
+        let name = format!(
+            "{}{}",
+            pools[i].0,
+            &Uuid::new_v4().simple().to_string()[..8]
+        );
+        let command = warm_command(&target.base_command, &context_for(target.ea_id));
+        client.new_agent_session(&name, &command, Some(workdir))?;
+    }
+    Ok(plan.start.len())
+}
+
+/// Kill every warm session of `ea_id`, e.g. when the EA is deleted.
+pub fn drain(base_prefix: &str, ea_id: EaId) {
+    let client = TmuxClient::new(format!("{}{}-", all_pools_prefix(base_prefix), ea_id));
+    for session in client.list_sessions().unwrap_or_default() {
+        let _ = client.kill_session(&session.name);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::ea;
+
+    #[test]
+    fn pool_names_are_keyed_by_command_and_workdir_outside_ea_prefixes() {
+        let claude = pool_prefix("omar-agent-", 0, "claude --x", "/src");
+        assert_eq!(claude, pool_prefix("omar-agent-", 0, "claude --x", "/src"));
+        assert_ne!(claude, pool_prefix("omar-agent-", 0, "claude --x", "/tmp"));
+        assert_ne!(claude, pool_prefix("omar-agent-", 0, "codex", "/src"));
+        assert_ne!(claude, pool_prefix("omar-agent-", 1, "claude --x", "/src"));
+        assert!(claude.starts_with("omar-agent-warm-0-"));
+
+        for ea_id in [0, 1, 10] {
+            assert!(!claude.starts_with(&ea::ea_prefix(ea_id, "omar-agent-")));
+            assert!(!claude.starts_with(&ea::ea_manager_session(ea_id, "omar-agent-")));
+        }
+        // The EA-0 drain prefix must not also match EA 10's pools.
+        let ea10 = pool_prefix("omar-agent-", 10, "claude --x", "/src");
+        assert!(!ea10.starts_with("omar-agent-warm-1-"));
+    }
+
+    #[test]
+    fn plan_tops_up_and_kills_unwanted_sessions() {
+        let pools = vec![("p0-a-".to_string(), 2), ("p1-b-".to_string(), 1)];
+        let existing = vec![
+            "p0-a-1".to_string(),
+            "p0-a-2".to_string(),
+            "p0-a-3".to_string(),
+            "p9-gone-1".to_string(),
+        ];
+        let plan = plan(&existing, &pools);
+        assert_eq!(plan.start, vec![1]);
+        assert_eq!(
+            plan.kill,
+            vec!["p0-a-3".to_string(), "p9-gone-1".to_string()]
+        );
+    }
+
+    #[test]
+    fn plan_spreads_large_top_ups_over_passes() {
+        let pools = vec![("p0-a-".to_string(), 3), ("p1-b-".to_string(), 3)];
+        let plan = plan(&[], &pools);
+        assert_eq!(plan.start, vec![0, 0, 0, 1]);
+        assert!(plan.kill.is_empty());
+    }
+
+    fn context(omar_dir: &std::path::Path) -> McpLaunchContext {
+        McpLaunchContext {
+            omar_dir: omar_dir.to_path_buf(),
+            ea_id: 3,
+            session_prefix: "omar-agent-".to_string(),
+            default_command: "claude".to_string(),
+            default_workdir: ".".to_string(),
+            health_idle_warning: 15,
+            tmux_server: None,
+        }
+    }
+
+    #[test]
+    fn warm_command_leaves_identity_to_the_first_message() {
+        let dir = tempfile::tempdir().unwrap();
+        let command = warm_command(
+            "claude --dangerously-skip-permissions",
+            &context(dir.path()),
+        );
+        assert!(command.contains("--system-prompt"));
+        assert!(command.contains(WARM_PARENT_NAME));
+        assert!(command.contains("s|{{EA_ID}}|3|g"));
+
+        // Backends without prompt wiring launch as-is.
+        let command = warm_command("unknown-backend --flag", &context(dir.path()));
+        assert_eq!(command, "unknown-backend --flag");
+    }
+
+    #[test]
+    fn claim_renames_exactly_one_live_warm_session() {
+        let _env_lock = crate::test_env_lock();
+        if !std::process::Command::new("tmux")
+            .arg("-V")
+            .output()
+            .map(|output| output.status.success())
+            .unwrap_or(false)
+        {
+            eprintln!("Skipping test: tmux not available");
+            return;
+        }
+        let server = format!("omar-warm-pool-test-{}", std::process::id());
+        let previous = std::env::var_os("OMAR_TMUX_SERVER");
+        std::env::set_var("OMAR_TMUX_SERVER", &server);
+
+        let client = TmuxClient::new("");
+        let warm = format!("{}a", pool_prefix("omar-agent-", 0, "claude", "/src"));
+        client.new_session(&warm, "sleep 600", None).unwrap();
+
+        let other_pool = claim("omar-agent-", 0, "codex", "/src", "omar-agent-0-w0");
+        let claimed = claim("omar-agent-", 0, "claude", "/src", "omar-agent-0-w1");
+        let drained = claim("omar-agent-", 0, "claude", "/src", "omar-agent-0-w2");
+        let renamed = client.has_session("omar-agent-0-w1").unwrap_or(false);
+
+        let _ = std::process::Command::new("tmux")
+            .args(["-L", &server, "kill-server"])
+            .status();
+        match previous {
+            Some(value) => std::env::set_var("OMAR_TMUX_SERVER", value),
+            None => std::env::remove_var("OMAR_TMUX_SERVER"),
+        }
+
+        assert!(!other_pool, "pools are keyed by command");
+        assert!(claimed && renamed);
+        assert!(!drained, "a claimed session leaves the pool");
+    }
+}